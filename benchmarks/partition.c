@@ -0,0 +1,139 @@
+/**
+ * Benchmark of the vectorized partitions.
+ * 
+ * This benchmark compares the partition of an array according to a value with
+ * each instruction set supported by the processor, against the scalar
+ * partition, over several distributions of the values: uniform, sorted,
+ * reversed and with few unique values. The pivot is the median value, so that
+ * half of the comparisons of the scalar partition are mispredicted on uniform
+ * samples.
+ * 
+ * Usage:
+ *    partition [max_exponent]
+ * 
+ * The benchmark runs over samples of size 10^3 up to 10^max_exponent, with
+ * max_exponent defaulting to 7. Use utilities/run_benchmarks.sh to compile and
+ * run it.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../c/base.h"
+
+/**
+ * Returns a pseudo-random number uniformly distributed in (0, 1], generated
+ * with a xorshift generator, to build the samples independently of rand().
+ */
+static double uniform(uint64_t *state)
+{
+   *state ^= *state << 13;
+   *state ^= *state >> 7;
+   *state ^= *state << 17;
+   return (double)((*state >> 11) + 1) / 9007199254740992.;
+}
+
+/**
+ * Returns the current time in seconds.
+ */
+static double now()
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/**
+ * Fill a sample with a distribution of values.
+ */
+static void fill(double *x, int64_t n, const char *distribution, uint64_t *state)
+{
+   for (int64_t i = 0; i < n; i++)
+   {
+      if (strcmp(distribution, "uniform") == 0)
+         x[i] = uniform(state);
+      else if (strcmp(distribution, "sorted") == 0)
+         x[i] = (double)i;
+      else if (strcmp(distribution, "reversed") == 0)
+         x[i] = (double)(n - i);
+      else
+         x[i] = (double)(int)(uniform(state) * 4.);
+   }
+}
+
+static const char *instruction_sets[] = {"scalar", "avx2", "avx512"};
+
+/**
+ * Time the partition of a sample with an instruction set, in nanoseconds per
+ * element, excluding the time taken to restore the sample before each
+ * partition.
+ */
+static double time_partition(
+   int instruction_set, double *x, double *work, int64_t n, double value, int64_t repeats, int64_t *index)
+{
+   double start = now();
+   for (int64_t r = 0; r < repeats; r++)
+      memcpy(work, x, n * sizeof(double));
+   double copy_time = now() - start;
+
+   start = now();
+   for (int64_t r = 0; r < repeats; r++)
+   {
+      memcpy(work, x, n * sizeof(double));
+      *index = partition_on_value_using(instruction_set, work, 0, n - 1, value);
+   }
+   double time = now() - start - copy_time;
+
+   return (time > 0. ? time : 0.) / (double)(repeats * n) * 1e9;
+}
+
+int main(int argc, char **argv)
+{
+   int max_exponent = argc > 1 ? atoi(argv[1]) : 7;
+   uint64_t state = 88172645463325252ULL;
+   uint64_t random_state;
+   random_seed(&random_state, RANDOM_DEFAULT_SEED);
+   const char *distributions[] = {"uniform", "sorted", "reversed", "few-unique"};
+   int supported = supported_instruction_set();
+
+   printf("%12s %12s %8s %12s %10s\n", "n", "distribution", "set", "[ns/el]", "speed-up");
+
+   int64_t n = 1000;
+   for (int exponent = 3; exponent <= max_exponent; exponent++, n *= 10)
+   {
+      double *x = malloc(n * sizeof(double));
+      double *work = malloc(n * sizeof(double));
+
+      for (int d = 0; d < 4; d++)
+      {
+         fill(x, n, distributions[d], &state);
+
+         // Median value as pivot
+         memcpy(work, x, n * sizeof(double));
+         double value = select_kth_smallest(work, n, n / 2, &random_state);
+
+         // Repeat small sizes, so that each measurement covers about 10^8 elements
+         int64_t repeats = n < 100000000 ? 100000000 / n : 1;
+         int64_t scalar_index, index;
+         double scalar_time = time_partition(INSTRUCTION_SET_SCALAR, x, work, n, value, repeats, &scalar_index);
+
+         for (int set = INSTRUCTION_SET_SCALAR; set <= supported; set++)
+         {
+            double time = set == INSTRUCTION_SET_SCALAR
+               ? scalar_time
+               : time_partition(set, x, work, n, value, repeats, &index);
+            if (set == INSTRUCTION_SET_SCALAR)
+               index = scalar_index;
+
+            printf("%12lld %12s %8s %12.3f %9.2fx%s\n", (long long)n, distributions[d], instruction_sets[set],
+               time, scalar_time / time, index == scalar_index ? "" : "  MISMATCH");
+         }
+      }
+
+      free(x);
+      free(work);
+   }
+
+   return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * Benchmark of the selection of the k-th smallest element.
+ * 
+ * This benchmark compares the introselect of function 'select_kth_smallest',
+ * with three-way partitions and a median of medians fallback, against the
+ * previous randomized quickselect with two-way partitions, over samples with
+ * distinct values and over samples with many duplicates, for which two-way
+ * partitions are quadratic.
+ * 
+ * Usage:
+ *    selection [max_exponent]
+ * 
+ * The benchmark runs over samples of size 10^3 up to 10^max_exponent, with
+ * max_exponent defaulting to 7. The previous quickselect, being quadratic on
+ * the samples with duplicates, only runs up to 10^5, and fewer times. Use
+ * utilities/run_benchmarks.sh to compile and run it.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../c/base.h"
+
+// Time after which the repetitions of a quadratic measurement stop
+#define MAX_SECONDS 1.
+
+/**
+ * Returns a pseudo-random number uniformly distributed in (0, 1], generated
+ * with a xorshift generator, to build the samples independently of the
+ * generator of the pivots.
+ */
+static double uniform(uint64_t *state)
+{
+   *state ^= *state << 13;
+   *state ^= *state >> 7;
+   *state ^= *state << 17;
+   return (double)((*state >> 11) + 1) / 9007199254740992.;
+}
+
+/**
+ * Returns the current time in seconds.
+ */
+static double now()
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/**
+ * Fill a sample with a distribution of values.
+ */
+static void fill(double *x, int64_t n, const char *distribution, uint64_t *state)
+{
+   for (int64_t i = 0; i < n; i++)
+   {
+      if (strcmp(distribution, "uniform") == 0)
+         x[i] = uniform(state);
+      else if (strcmp(distribution, "sorted") == 0)
+         x[i] = (double)i;
+      else if (strcmp(distribution, "organ-pipe") == 0)
+         x[i] = (double)(i < n / 2 ? i : n - i);
+      else if (strcmp(distribution, "quantized") == 0)
+         x[i] = (double)(int)(uniform(state) * 16.);
+      else if (strcmp(distribution, "two-valued") == 0)
+         x[i] = uniform(state) < 0.5 ? 0. : 1.;
+      else
+         x[i] = 1.;
+   }
+}
+
+/**
+ * Previous selection, a randomized quickselect with a Lomuto partition.
+ */
+static double legacy_partition_on_kth_smallest(
+   double *x, int64_t begin, int64_t end, int64_t k, uint64_t *random_state)
+{
+   while (1)
+   {
+      if (begin == end)
+         return x[begin];
+
+      int64_t pivot_index = random_range(random_state, begin, end);
+      double value = x[pivot_index];
+
+      swap(x, pivot_index, end);
+      int64_t i = begin;
+      for (int64_t j = begin; j < end; j++)
+      {
+         if (x[j] < value)
+         {
+            swap(x, i, j);
+            i++;
+         }
+      }
+      swap(x, i, end);
+      pivot_index = i;
+
+      if (k == pivot_index)
+         return x[k];
+      else if (k < pivot_index)
+         end = pivot_index - 1;
+      else
+         begin = pivot_index + 1;
+   }
+}
+
+int main(int argc, char **argv)
+{
+   int max_exponent = argc > 1 ? atoi(argv[1]) : 7;
+   uint64_t state = 88172645463325252ULL;
+   const char *distributions[] = {"uniform", "sorted", "organ-pipe", "quantized", "two-valued", "constant"};
+   uint64_t random_state;
+
+   printf("%12s %12s %18s %18s %10s\n", "n", "distribution", "quickselect [ns/el]", "introselect [ns/el]",
+      "speed-up");
+
+   int64_t n = 1000;
+   for (int exponent = 3; exponent <= max_exponent; exponent++, n *= 10)
+   {
+      double *x = malloc(n * sizeof(double));
+      double *work = malloc(n * sizeof(double));
+
+      for (int d = 0; d < 6; d++)
+      {
+         fill(x, n, distributions[d], &state);
+
+         // Repeat small sizes, so that each measurement covers about 10^7 elements
+         int64_t repeats = n < 10000000 ? 10000000 / n : 1;
+         double legacy_result = 0., result = 0., legacy_time = -1.;
+
+         if (exponent <= 5)
+         {
+            random_seed(&random_state, 1);
+            double start = now();
+            int64_t r = 0;
+            while (r < repeats && (r == 0 || now() - start < MAX_SECONDS))
+            {
+               memcpy(work, x, n * sizeof(double));
+               legacy_result = legacy_partition_on_kth_smallest(work, 0, n - 1, n / 2, &random_state);
+               r++;
+            }
+            legacy_time = (now() - start) / (double)(r * n) * 1e9;
+         }
+
+         random_seed(&random_state, 1);
+         double start = now();
+         for (int64_t r = 0; r < repeats; r++)
+         {
+            memcpy(work, x, n * sizeof(double));
+            result = partition_on_kth_smallest(work, 0, n - 1, n / 2, &random_state);
+         }
+         double time = (now() - start) / (double)(repeats * n) * 1e9;
+
+         if (legacy_time < 0.)
+            printf("%12lld %12s %18s %18.2f %10s\n", (long long)n, distributions[d], "-", time, "-");
+         else
+            printf("%12lld %12s %18.2f %18.2f %9.2fx%s\n", (long long)n, distributions[d], legacy_time, time,
+               legacy_time / time, legacy_result == result ? "" : "  MISMATCH");
+      }
+
+      free(x);
+      free(work);
+   }
+
+   return 0;
+}
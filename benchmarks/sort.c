@@ -0,0 +1,138 @@
+/**
+ * Benchmark of the sort of the sort-bound estimators.
+ * 
+ * This benchmark compares function 'sort', a radix sort on the bits of the
+ * values for large samples and a pattern-defeating quicksort for small ones,
+ * against the standard library's qsort with a comparison function, in both
+ * orders, over samples with distinct values, presorted samples and samples with
+ * many duplicates.
+ * 
+ * Usage:
+ *    sort [max_exponent]
+ * 
+ * The benchmark runs over samples of size 10^1 up to 10^max_exponent, with
+ * max_exponent defaulting to 7. Use utilities/run_benchmarks.sh to compile and
+ * run it.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../c/robustats.h"
+
+/**
+ * Returns a pseudo-random number uniformly distributed in (0, 1], generated
+ * with a xorshift generator.
+ */
+static double uniform(uint64_t *state)
+{
+   *state ^= *state << 13;
+   *state ^= *state >> 7;
+   *state ^= *state << 17;
+   return (double)((*state >> 11) + 1) / 9007199254740992.;
+}
+
+/**
+ * Returns the current time in seconds.
+ */
+static double now()
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/**
+ * Fill a sample with a distribution of values.
+ */
+static void fill(double *x, int64_t n, const char *distribution, uint64_t *state)
+{
+   for (int64_t i = 0; i < n; i++)
+   {
+      if (strcmp(distribution, "uniform") == 0)
+         x[i] = uniform(state);
+      else if (strcmp(distribution, "normal-ish") == 0)
+         x[i] = uniform(state) + uniform(state) + uniform(state) - 1.5;
+      else if (strcmp(distribution, "sorted") == 0)
+         x[i] = (double)i;
+      else if (strcmp(distribution, "reversed") == 0)
+         x[i] = (double)(n - i);
+      else
+         x[i] = (double)(int)(uniform(state) * 16.);
+   }
+}
+
+/**
+ * Comparison functions of qsort, the previous sort.
+ */
+static int compare_ascending(const void *a, const void *b)
+{
+   double x = *(const double *)a, y = *(const double *)b;
+   return (x > y) - (x < y);
+}
+
+static int compare_descending(const void *a, const void *b)
+{
+   return compare_ascending(b, a);
+}
+
+int main(int argc, char **argv)
+{
+   int max_exponent = argc > 1 ? atoi(argv[1]) : 7;
+   uint64_t state = 88172645463325252ULL;
+   const char *distributions[] = {"uniform", "normal-ish", "sorted", "reversed", "quantized"};
+   const char *orders[] = {"ascending", "descending"};
+
+   printf("%10s %12s %11s %14s %14s %10s\n", "n", "distribution", "order", "qsort [ns/el]", "sort [ns/el]",
+      "speed-up");
+
+   int64_t n = 10;
+   for (int exponent = 1; exponent <= max_exponent; exponent++, n *= 10)
+   {
+      double *x = malloc(n * sizeof(double));
+      double *expected = malloc(n * sizeof(double));
+      double *work = malloc(n * sizeof(double));
+      workspace ws;
+      workspace_init(&ws);
+      workspace_reserve(&ws, sort_workspace_size(n));
+
+      for (int d = 0; d < 5; d++)
+      {
+         fill(x, n, distributions[d], &state);
+
+         for (int descending = 0; descending <= 1; descending++)
+         {
+            // Repeat small sizes, so that each measurement covers about 10^7 elements
+            int64_t repeats = n < 10000000 ? 10000000 / n : 1;
+
+            double start = now();
+            for (int64_t r = 0; r < repeats; r++)
+            {
+               memcpy(expected, x, n * sizeof(double));
+               qsort(expected, n, sizeof(double), descending ? compare_descending : compare_ascending);
+            }
+            double qsort_time = (now() - start) / (double)(repeats * n) * 1e9;
+
+            start = now();
+            for (int64_t r = 0; r < repeats; r++)
+            {
+               memcpy(work, x, n * sizeof(double));
+               sort(work, n, descending, &ws);
+            }
+            double time = (now() - start) / (double)(repeats * n) * 1e9;
+
+            int match = memcmp(work, expected, n * sizeof(double)) == 0;
+            printf("%10lld %12s %11s %14.2f %14.2f %9.2fx%s\n", (long long)n, distributions[d], orders[descending],
+               qsort_time, time, qsort_time / time, match ? "" : "  MISMATCH");
+         }
+      }
+
+      workspace_free(&ws);
+      free(x);
+      free(expected);
+      free(work);
+   }
+
+   return 0;
+}
@@ -0,0 +1,286 @@
+/**
+ * Benchmark suite of the estimators and of the selection primitives.
+ * 
+ * This benchmark times the weighted median, the medcouple, the mode, the
+ * selection of the k-th smallest element and the partitions of c/base.c over
+ * samples of size 10^2 up to 10^max_exponent, drawn from several
+ * distributions: uniform, heavy-tailed (Cauchy), skewed (log-normal), with
+ * heavy duplicates (16 distinct values) and pre-sorted. It reports the median,
+ * mean and minimum times per element over the repetitions of each
+ * measurement, the memory taken by the estimators from their workspace and the
+ * peak resident memory of the process during the measurement, which includes
+ * the samples, and writes them as JSON so that runs can be compared between
+ * commits, for instance with benchmarks/suite.py.
+ * 
+ * Usage:
+ *    suite [max_exponent] [output.json]
+ * 
+ * The maximum exponent defaults to 6. The samples of size 10^8 take about
+ * 3 GB of memory. Use utilities/run_benchmarks.sh to compile and run it.
+ */
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../c/base.h"
+#include "../c/robustats.h"
+
+// Number of elements over which each measurement is repeated, and time after
+// which the repetitions stop
+#define MIN_ELEMENTS 10000000
+#define MAX_SECONDS 1.
+
+#define PI 3.14159265358979323846
+
+#define N_DISTRIBUTIONS 5
+#define N_ESTIMATORS 6
+
+static const char *distributions[N_DISTRIBUTIONS] = {"uniform", "heavy-tailed", "skewed", "duplicates", "sorted"};
+static const char *estimators[N_ESTIMATORS] = {
+   "weighted_median", "medcouple", "mode", "select_kth_smallest", "partition_on_value", "partition_three_way"};
+
+/**
+ * Returns a pseudo-random number uniformly distributed in (0, 1], generated
+ * with a xorshift generator, to build the samples independently of the
+ * generator of the pivots.
+ */
+static double uniform(uint64_t *state)
+{
+   *state ^= *state << 13;
+   *state ^= *state >> 7;
+   *state ^= *state << 17;
+   return (double)((*state >> 11) + 1) / 9007199254740992.;
+}
+
+/**
+ * Returns a pseudo-random number normally distributed, by the Box-Muller
+ * transform.
+ */
+static double normal(uint64_t *state)
+{
+   return sqrt(-2. * log(uniform(state))) * cos(2. * PI * uniform(state));
+}
+
+/**
+ * Returns the current time in seconds.
+ */
+static double now()
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/**
+ * Reset the peak resident memory of the process, on Linux.
+ */
+static void reset_peak_memory()
+{
+   FILE *file = fopen("/proc/self/clear_refs", "w");
+   if (file != NULL)
+   {
+      fputs("5", file);
+      fclose(file);
+   }
+}
+
+/**
+ * Returns the peak resident memory of the process in bytes since the last
+ * reset, on Linux, or -1 elsewhere.
+ */
+static int64_t peak_memory()
+{
+   char line[256];
+   long long kilobytes = -1;
+
+   FILE *file = fopen("/proc/self/status", "r");
+   if (file == NULL)
+      return -1;
+   while (fgets(line, sizeof(line), file) != NULL)
+      if (sscanf(line, "VmHWM: %lld kB", &kilobytes) == 1)
+         break;
+   fclose(file);
+
+   return kilobytes < 0 ? -1 : (int64_t)kilobytes * 1024;
+}
+
+/**
+ * Fill a sample with a distribution of values.
+ */
+static void fill(double *x, int64_t n, const char *distribution, uint64_t *state)
+{
+   for (int64_t i = 0; i < n; i++)
+   {
+      if (strcmp(distribution, "uniform") == 0)
+         x[i] = uniform(state);
+      else if (strcmp(distribution, "heavy-tailed") == 0)
+         x[i] = tan(PI * (uniform(state) - 0.5));
+      else if (strcmp(distribution, "skewed") == 0)
+         x[i] = exp(normal(state));
+      else if (strcmp(distribution, "duplicates") == 0)
+         x[i] = (double)(int)(uniform(state) * 16.);
+      else
+         x[i] = (double)i / (double)n;
+   }
+}
+
+/**
+ * Run an estimator once over a copy of the sample.
+ * 
+ * Returns:
+ *    Result of the estimator, to check that runs agree.
+ */
+static double run(int estimator, double *work, double *work_w, int64_t n, workspace *ws)
+{
+   int64_t lower, upper;
+
+   switch (estimator)
+   {
+   case 0:
+      return weighted_median_in_place(work, work_w, 0, n - 1, &ws->random_state);
+   case 1:
+      return medcouple(work, n, DBL_EPSILON, DBL_MIN, ws);
+   case 2:
+      return mode(work, n, ws);
+   case 3:
+      return partition_on_kth_smallest(work, 0, n - 1, n / 2, &ws->random_state);
+   case 4:
+      return (double)partition_on_value(work, 0, n - 1, work[n / 3]);
+   default:
+      partition_three_way(work, 0, n - 1, work[n / 3], &lower, &upper);
+      return (double)lower;
+   }
+}
+
+/**
+ * Print a number as JSON, NaN and infinities being null.
+ */
+static void print_json_number(FILE *file, double value)
+{
+   if (isfinite(value))
+      fprintf(file, "%.17g", value);
+   else
+      fprintf(file, "null");
+}
+
+int main(int argc, char **argv)
+{
+   int max_exponent = argc > 1 ? atoi(argv[1]) : 6;
+   FILE *json = argc > 2 ? fopen(argv[2], "w") : NULL;
+   uint64_t state = 88172645463325252ULL;
+   int first = 1;
+
+   if (argc > 2 && json == NULL)
+   {
+      fprintf(stderr, "Cannot open %s\n", argv[2]);
+      return 1;
+   }
+   if (json != NULL)
+      fprintf(json, "{\n  \"suite\": \"c\",\n  \"instruction_set\": %d,\n  \"results\": [", supported_instruction_set());
+
+   printf("%20s %13s %10s %10s %10s %10s %14s %14s\n", "estimator", "distribution", "n", "[ns/el]", "mean", "min",
+      "workspace [B]", "peak RSS [B]");
+
+   // Times of the repetitions of a measurement
+   double *times = malloc((MIN_ELEMENTS / 100 + 1) * sizeof(double));
+
+   int64_t n = 100;
+   for (int exponent = 2; exponent <= max_exponent; exponent++, n *= 10)
+   {
+      double *x = malloc(n * sizeof(double));
+      double *w = malloc(n * sizeof(double));
+      double *work = malloc(n * sizeof(double));
+      double *work_w = malloc(n * sizeof(double));
+      if (x == NULL || w == NULL || work == NULL || work_w == NULL)
+      {
+         fprintf(stderr, "Cannot allocate samples of size %lld\n", (long long)n);
+         return 1;
+      }
+      for (int64_t i = 0; i < n; i++)
+         w[i] = uniform(&state);
+
+      for (int d = 0; d < N_DISTRIBUTIONS; d++)
+      {
+         fill(x, n, distributions[d], &state);
+
+         for (int e = 0; e < N_ESTIMATORS; e++)
+         {
+            workspace ws;
+            workspace_init(&ws);
+            workspace_seed(&ws, 1);
+            reset_peak_memory();
+
+            // The first run sizes the workspace, which is then reused as by
+            // repeated calls
+            int64_t repeats = 0, workspace_bytes = 0;
+            double total = 0., result = 0.;
+            double start = now();
+            while (repeats == 0 || (repeats * n < MIN_ELEMENTS && now() - start < MAX_SECONDS))
+            {
+               memcpy(work, x, n * sizeof(double));
+               memcpy(work_w, w, n * sizeof(double));
+
+               double begin = now();
+               result = run(e, work, work_w, n, &ws);
+               times[repeats] = now() - begin;
+
+               total += times[repeats];
+               if (repeats == 0)
+               {
+                  workspace_bytes = (int64_t)(ws.size + ws.overflow_size);
+                  workspace_reset(&ws);
+               }
+               repeats++;
+            }
+            int64_t peak = peak_memory();
+            workspace_free(&ws);
+
+            qsort(times, repeats, sizeof(double), compare_ascending);
+            double median_ns = times[repeats / 2] / (double)n * 1e9;
+            double mean_ns = total / (double)(repeats * n) * 1e9;
+            double min_ns = times[0] / (double)n * 1e9;
+            printf("%20s %13s %10lld %10.2f %10.2f %10.2f %14lld %14lld\n", estimators[e], distributions[d],
+               (long long)n, median_ns, mean_ns, min_ns, (long long)workspace_bytes, (long long)peak);
+
+            if (json != NULL)
+            {
+               fprintf(json, "%s\n    {\"estimator\": \"%s\", \"distribution\": \"%s\", \"n\": %lld, \"repeats\": %lld, "
+                  "\"ns_per_element\": ", first ? "" : ",", estimators[e], distributions[d], (long long)n,
+                  (long long)repeats);
+               print_json_number(json, median_ns);
+               fprintf(json, ", \"mean_ns_per_element\": ");
+               print_json_number(json, mean_ns);
+               fprintf(json, ", \"min_ns_per_element\": ");
+               print_json_number(json, min_ns);
+               fprintf(json, ", \"workspace_bytes\": %lld, \"peak_rss_bytes\": ", (long long)workspace_bytes);
+               if (peak < 0)
+                  fprintf(json, "null");
+               else
+                  fprintf(json, "%lld", (long long)peak);
+               fprintf(json, ", \"result\": ");
+               print_json_number(json, result);
+               fprintf(json, "}");
+               first = 0;
+            }
+         }
+      }
+
+      free(x);
+      free(w);
+      free(work);
+      free(work_w);
+   }
+
+   free(times);
+
+   if (json != NULL)
+   {
+      fprintf(json, "\n  ]\n}\n");
+      fclose(json);
+   }
+
+   return 0;
+}
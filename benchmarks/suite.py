@@ -0,0 +1,178 @@
+"""Benchmark suite of the Python estimators, and comparison of benchmark runs.
+
+The estimators are timed through the Python bindings over the sizes and
+distributions of the C benchmark suite, benchmarks/suite.c, and the results
+are written as JSON in the same format, so that the runs of either suite can
+be compared between commits:
+
+    python benchmarks/suite.py run --max-exponent 6 --output after.json
+    python benchmarks/suite.py compare before.json after.json --threshold 1.1
+
+The comparison lists the measurements whose time per element changed by more
+than the threshold, or whose result changed, and fails if any got slower.
+"""
+
+import argparse
+import json
+import sys
+import time
+from typing import List, Optional
+
+import numpy as np
+
+# Number of elements over which each measurement is repeated, and time after
+# which the repetitions stop
+MIN_ELEMENTS = 10_000_000
+MAX_SECONDS = 1.0
+
+DISTRIBUTIONS = ["uniform", "heavy-tailed", "skewed", "duplicates", "sorted"]
+
+ESTIMATORS = ["weighted_median", "medcouple", "mode", "quantiles", "mad", "qn"]
+
+
+def sample(n: int, distribution: str, rng: np.random.Generator) -> np.ndarray:
+    """Draw a sample of a distribution of the suite."""
+    if distribution == "uniform":
+        return rng.uniform(size=n)
+    if distribution == "heavy-tailed":
+        return rng.standard_cauchy(size=n)
+    if distribution == "skewed":
+        return rng.lognormal(size=n)
+    if distribution == "duplicates":
+        return np.floor(rng.uniform(size=n) * 16.0)
+    return np.arange(n) / n
+
+
+def reset_peak_memory() -> None:
+    """Reset the peak resident memory of the process, on Linux."""
+    try:
+        with open("/proc/self/clear_refs", "w") as file:
+            file.write("5")
+    except OSError:
+        pass
+
+
+def peak_memory() -> Optional[int]:
+    """Peak resident memory of the process in bytes since the last reset, on Linux."""
+    try:
+        with open("/proc/self/status") as file:
+            for line in file:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1]) * 1024
+    except OSError:
+        pass
+    return None
+
+
+def run(max_exponent: int, output: Optional[str]) -> None:
+    """Time the estimators and print the results, writing them as JSON if an output is given."""
+    # Imported here so that runs can be compared without building the extension
+    import robustats
+
+    calls = {
+        "weighted_median": lambda x, w, ws: robustats.weighted_median(x, w, workspace=ws),
+        "medcouple": lambda x, w, ws: robustats.medcouple(x, workspace=ws),
+        "mode": lambda x, w, ws: robustats.mode(x, workspace=ws),
+        "quantiles": lambda x, w, ws: robustats.quantiles(x, [0.25, 0.5, 0.75], workspace=ws)[1],
+        "mad": lambda x, w, ws: robustats.mad(x, workspace=ws),
+        "qn": lambda x, w, ws: robustats.qn(x, workspace=ws),
+    }
+    rng = np.random.default_rng(0)
+    results: List[dict] = []
+
+    print(
+        f"{'estimator':>16} {'distribution':>13} {'n':>10} {'[ns/el]':>10} {'mean':>10} {'min':>10} {'workspace':>12}"
+    )
+    for exponent in range(2, max_exponent + 1):
+        n = 10**exponent
+        w = rng.uniform(size=n)
+        for distribution in DISTRIBUTIONS:
+            x = sample(n, distribution, rng)
+            for name in ESTIMATORS:
+                estimator = calls[name]
+                # The first call sizes the workspace, which is then reused as
+                # by repeated calls
+                workspace = robustats.Workspace()
+                reset_peak_memory()
+                times = []
+                start = time.perf_counter()
+                while not times or (len(times) * n < MIN_ELEMENTS and time.perf_counter() - start < MAX_SECONDS):
+                    begin = time.perf_counter()
+                    result = estimator(x, w, workspace)
+                    times.append(time.perf_counter() - begin)
+                    if len(times) == 1:
+                        workspace_bytes = workspace.size
+
+                times.sort()
+                entry = {
+                    "estimator": name,
+                    "distribution": distribution,
+                    "n": n,
+                    "repeats": len(times),
+                    "ns_per_element": times[len(times) // 2] / n * 1e9,
+                    "mean_ns_per_element": sum(times) / (len(times) * n) * 1e9,
+                    "min_ns_per_element": times[0] / n * 1e9,
+                    "workspace_bytes": workspace_bytes,
+                    "peak_rss_bytes": peak_memory(),
+                    "result": float(result) if np.isfinite(result) else None,
+                }
+                results.append(entry)
+                print(
+                    f"{name:>16} {distribution:>13} {n:>10} {entry['ns_per_element']:>10.2f} "
+                    f"{entry['mean_ns_per_element']:>10.2f} {entry['min_ns_per_element']:>10.2f} {workspace_bytes:>12}"
+                )
+
+    if output is not None:
+        with open(output, "w") as file:
+            json.dump({"suite": "python", "results": results}, file, indent=2)
+
+
+def compare(before: str, after: str, threshold: float) -> int:
+    """Compare two runs of a suite.
+
+    Returns:
+        1 if a measurement got slower by more than the threshold, 0 otherwise.
+    """
+    with open(before) as file:
+        old = {(r["estimator"], r["distribution"], r["n"]): r for r in json.load(file)["results"]}
+    with open(after) as file:
+        new = {(r["estimator"], r["distribution"], r["n"]): r for r in json.load(file)["results"]}
+
+    slower = 0
+    print(f"{'estimator':>20} {'distribution':>13} {'n':>10} {'before':>10} {'after':>10} {'ratio':>8}")
+    for key in sorted(old.keys() & new.keys()):
+        ratio = new[key]["ns_per_element"] / old[key]["ns_per_element"]
+        changed_result = old[key]["result"] != new[key]["result"]
+        if ratio > threshold or ratio < 1 / threshold or changed_result:
+            flag = "  SLOWER" if ratio > threshold else "  faster" if ratio < 1 / threshold else ""
+            flag += "  RESULT CHANGED" if changed_result else ""
+            print(
+                f"{key[0]:>20} {key[1]:>13} {key[2]:>10} {old[key]['ns_per_element']:>10.2f} "
+                f"{new[key]['ns_per_element']:>10.2f} {ratio:>7.2f}x{flag}"
+            )
+            slower += ratio > threshold
+
+    print(f"{slower} of {len(old.keys() & new.keys())} measurements slower by more than {threshold:.2f}x")
+    return 1 if slower > 0 else 0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    run_parser = commands.add_parser("run", help="Time the Python estimators.")
+    run_parser.add_argument("--max-exponent", type=int, default=6, help="Largest size of the samples, as 10^exponent.")
+    run_parser.add_argument("--output", help="JSON file into which to write the results.")
+    compare_parser = commands.add_parser("compare", help="Compare two runs of the C or of the Python suite.")
+    compare_parser.add_argument("before", help="JSON results of the reference run.")
+    compare_parser.add_argument("after", help="JSON results of the new run.")
+    compare_parser.add_argument("--threshold", type=float, default=1.1, help="Ratio of the times flagged as changed.")
+    arguments = parser.parse_args()
+
+    if arguments.command == "run":
+        run(arguments.max_exponent, arguments.output)
+        return 0
+    return compare(arguments.before, arguments.after, arguments.threshold)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
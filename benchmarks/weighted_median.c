@@ -0,0 +1,224 @@
+/**
+ * Benchmark of the weighted median.
+ * 
+ * This benchmark compares the weighted median computed over a contiguous
+ * buffer of values and weights, which is the one used by the library, against
+ * the previous implementation, which zipped values and weights into an array
+ * of pointers to rows of two elements, allocated one by one.
+ * 
+ * Usage:
+ *    weighted_median [max_exponent]
+ * 
+ * The benchmark runs over samples of size 10^3 up to 10^max_exponent, with
+ * max_exponent defaulting to 8. Use utilities/run_benchmarks.sh to compile and
+ * run it.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../c/base.h"
+#include "../c/robustats.h"
+
+/**
+ * Returns a pseudo-random number uniformly distributed in (0, 1], generated
+ * with a xorshift generator, to build the samples independently of rand().
+ */
+static double uniform(uint64_t *state)
+{
+   *state ^= *state << 13;
+   *state ^= *state >> 7;
+   *state ^= *state << 17;
+   return (double)((*state >> 11) + 1) / 9007199254740992.;
+}
+
+/**
+ * Returns the current time in seconds.
+ */
+static double now()
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+/**
+ * Previous weighted median implementation, over zipped rows.
+ * 
+ * The terminal cases read the zipped rows, instead of the original arrays, so
+ * that the result can be checked against the current implementation.
+ */
+static void legacy_swap_2d(double **x, int64_t n2, int64_t i, int64_t j)
+{
+   double temp;
+
+   for (int64_t k = 0; k < n2; k++)
+   {
+      temp = x[i][k];
+      x[i][k] = x[j][k];
+      x[j][k] = temp;
+   }
+}
+
+static int64_t legacy_partition_on_kth_element_2d(
+   double **x, int64_t begin, int64_t end, int64_t n2, int64_t m, int64_t k)
+{
+   double value = x[k][m];
+
+   legacy_swap_2d(x, n2, k, end);
+
+   int64_t i = begin;
+   for (int64_t j = begin; j < end; j++)
+   {
+      if (x[j][m] < value)
+      {
+         legacy_swap_2d(x, n2, i, j);
+         i++;
+      }
+   }
+
+   legacy_swap_2d(x, n2, i, end);
+
+   return i;
+}
+
+// State of the generator of the pivots of the previous implementation
+static uint64_t legacy_random_state;
+
+static double legacy_partition_on_kth_smallest_2d(
+   double **x, int64_t begin, int64_t end, int64_t n2, int64_t m, int64_t k)
+{
+   while (1)
+   {
+      if (begin == end)
+         return x[begin][m];
+
+      int64_t pivot_index = random_range(&legacy_random_state, begin, end);
+      pivot_index = legacy_partition_on_kth_element_2d(x, begin, end, n2, m, pivot_index);
+
+      if (k == pivot_index)
+         return x[k][m];
+      else if (k < pivot_index)
+         end = pivot_index - 1;
+      else
+         begin = pivot_index + 1;
+   }
+}
+
+static double legacy_weighted_median(double *x, double *w, int64_t begin, int64_t end)
+{
+   int64_t xw_n, n, i, median_index;
+   double median, result;
+   double w_lower_sum, w_lower_sum_norm, w_higher_sum, w_higher_sum_norm;
+
+   xw_n = end - begin + 1;
+   double **xw = (double**)malloc(xw_n * sizeof(double*));
+   for (i = 0; i < xw_n; i++)
+   {
+      xw[i] = (double*)malloc(2 * sizeof(double));
+      xw[i][0] = x[i];
+      xw[i][1] = w[i];
+   }
+
+   double w_sum = sum_double(w, xw_n);
+
+   while (1)
+   {
+      n = end - begin + 1;
+
+      if (n == 1)
+      {
+         result = xw[begin][0];
+         break;
+      }
+      else if (n == 2)
+      {
+         result = xw[begin][1] >= xw[end][1] ? xw[begin][0] : xw[end][0];
+         break;
+      }
+
+      median_index = begin + (n - 1) / 2;
+      median = legacy_partition_on_kth_smallest_2d(xw, begin, end, 2, 0, median_index);
+
+      w_lower_sum = 0.;
+      for (i = begin; i < median_index; i++)
+         w_lower_sum += xw[i][1];
+      w_lower_sum_norm = w_lower_sum / w_sum;
+
+      w_higher_sum = 0.;
+      for (i = median_index + 1; i <= end; i++)
+         w_higher_sum += xw[i][1];
+      w_higher_sum_norm = w_higher_sum / w_sum;
+
+      if (w_lower_sum_norm < 0.5 && w_higher_sum_norm < 0.5)
+      {
+         result = median;
+         break;
+      }
+      else if (w_lower_sum_norm > 0.5)
+      {
+         xw[median_index][1] = xw[median_index][1] + w_higher_sum;
+         end = median_index;
+      }
+      else
+      {
+         xw[median_index][1] = xw[median_index][1] + w_lower_sum;
+         begin = median_index;
+      }
+   }
+
+   for (i = 0; i < xw_n; i++)
+      free(xw[i]);
+   free(xw);
+
+   return result;
+}
+
+int main(int argc, char **argv)
+{
+   int max_exponent = argc > 1 ? atoi(argv[1]) : 8;
+   uint64_t state = 88172645463325252ULL;
+
+   printf("%12s %16s %16s %10s\n", "n", "zipped [ns/el]", "flat [ns/el]", "speed-up");
+
+   workspace ws;
+   workspace_init(&ws);
+
+   int64_t n = 1000;
+   for (int exponent = 3; exponent <= max_exponent; exponent++, n *= 10)
+   {
+      double *x = malloc(n * sizeof(double));
+      double *w = malloc(n * sizeof(double));
+      for (int64_t i = 0; i < n; i++)
+      {
+         x[i] = uniform(&state);
+         w[i] = uniform(&state);
+      }
+
+      // Repeat small sizes, so that each measurement covers about 10^7 elements
+      int64_t repeats = n < 10000000 ? 10000000 / n : 1;
+      double legacy_result = 0., result = 0.;
+
+      random_seed(&legacy_random_state, 1);
+      double start = now();
+      for (int64_t r = 0; r < repeats; r++)
+         legacy_result = legacy_weighted_median(x, w, 0, n - 1);
+      double legacy_time = (now() - start) / (double)(repeats * n) * 1e9;
+
+      workspace_seed(&ws, 1);
+      start = now();
+      for (int64_t r = 0; r < repeats; r++)
+         result = weighted_median(x, w, 0, n - 1, &ws);
+      double time = (now() - start) / (double)(repeats * n) * 1e9;
+
+      printf("%12lld %16.2f %16.2f %9.2fx%s\n", (long long)n, legacy_time, time,
+         legacy_time / time, legacy_result == result ? "" : "  MISMATCH");
+
+      free(x);
+      free(w);
+   }
+
+   workspace_free(&ws);
+
+   return 0;
+}
@@ -1,7 +1,14 @@
+#include <float.h>
 #include <stdint.h>
+#include <string.h>
 #include <Python.h>
 #include <numpy/arrayobject.h>
+#include "base.h"
+#include "counters.h"
+#include "external.h"
+#include "parallel.h"
 #include "robustats.h"
+#include "sketch.h"
 
 // Docstrings
 static char module_docstring[] =
@@ -12,17 +19,117 @@ static char medcouple_docstring[] =
     "Calculate the medcouple of a data sample.";
 static char mode_docstring[] =
     "Calculate the mode of a data sample.";
+static char weighted_quantiles_docstring[] =
+    "Calculate weighted quantiles of several orders of a data sample with respective weights, in a single pass.";
+static char quantiles_docstring[] =
+    "Calculate quantiles of several orders of a data sample, in a single pass.";
+static char adjusted_boxplot_docstring[] =
+    "Calculate the fences of the adjusted boxplot of a data sample and flag its outliers.";
+static char qn_docstring[] =
+    "Calculate the Qn estimator of scale of a data sample.";
+static char sn_docstring[] =
+    "Calculate the Sn estimator of scale of a data sample.";
+static char hodges_lehmann_docstring[] =
+    "Calculate the Hodges-Lehmann estimator of location of a data sample.";
+static char theil_sen_docstring[] =
+    "Calculate the Theil-Sen estimator of the slope and intercept of a simple linear regression.";
+static char mad_docstring[] =
+    "Calculate the median absolute deviation of a data sample.";
+static char robust_zscore_docstring[] =
+    "Calculate the robust z-scores of a data sample, from its median and median absolute deviation.";
+static char weighted_median_batch_docstring[] =
+    "Calculate the weighted medians of a sequence of data samples with respective weights, in parallel.";
+static char medcouple_batch_docstring[] =
+    "Calculate the medcouples of a sequence of data samples, in parallel.";
+static char mode_batch_docstring[] =
+    "Calculate the modes of a sequence of data samples, in parallel.";
+static char weighted_median_axis_docstring[] =
+    "Calculate the weighted medians of the slices of an array along an axis, with respective weights.";
+static char medcouple_axis_docstring[] =
+    "Calculate the medcouples of the slices of an array along an axis.";
+static char mode_axis_docstring[] =
+    "Calculate the modes of the slices of an array along an axis.";
+static char mad_axis_docstring[] =
+    "Calculate the median absolute deviations of the slices of an array along an axis.";
+static char rolling_medcouple_docstring[] =
+    "Calculate the medcouples of a data sample over a sliding window.";
+static char rolling_weighted_median_docstring[] =
+    "Calculate the weighted medians of a data sample with respective weights over a sliding window.";
+static char rolling_mode_docstring[] =
+    "Calculate the modes of a data sample over a sliding window.";
+static char weighted_median_external_docstring[] =
+    "Calculate the weighted median of a data sample read from files or memory-mapped arrays, with bounded memory.";
+static char mode_external_docstring[] =
+    "Calculate the mode of a data sample read from a file or a memory-mapped array, sorting it in scratch files.";
+static char medcouple_external_docstring[] =
+    "Calculate the medcouple of a data sample read from a file or a memory-mapped array, sorting it in scratch files.";
+static char workspace_docstring[] =
+    "Workspace(n=0, counters=False)\n--\n\n"
+    "Memory reused by the estimators across calls, preallocated for samples of n data points, recording the "
+    "counters of the work of each call if counters is true.";
+static char sketch_docstring[] =
+    "Sketch(size=1000)\n--\n\n"
+    "Mergeable summary of a weighted data sample in at most size items, from which to estimate weighted quantiles.";
 
 // Available functions
 static PyObject *robustats_weighted_median(PyObject *self, PyObject *args);
 static PyObject *robustats_medcouple(PyObject *self, PyObject *args);
 static PyObject *robustats_mode(PyObject *self, PyObject *args);
+static PyObject *robustats_weighted_quantiles(PyObject *self, PyObject *args);
+static PyObject *robustats_quantiles(PyObject *self, PyObject *args);
+static PyObject *robustats_adjusted_boxplot(PyObject *self, PyObject *args);
+static PyObject *robustats_qn(PyObject *self, PyObject *args);
+static PyObject *robustats_sn(PyObject *self, PyObject *args);
+static PyObject *robustats_hodges_lehmann(PyObject *self, PyObject *args);
+static PyObject *robustats_theil_sen(PyObject *self, PyObject *args);
+static PyObject *robustats_mad(PyObject *self, PyObject *args);
+static PyObject *robustats_robust_zscore(PyObject *self, PyObject *args);
+static PyObject *robustats_weighted_median_batch(PyObject *self, PyObject *args);
+static PyObject *robustats_medcouple_batch(PyObject *self, PyObject *args);
+static PyObject *robustats_mode_batch(PyObject *self, PyObject *args);
+static PyObject *robustats_weighted_median_axis(PyObject *self, PyObject *args);
+static PyObject *robustats_medcouple_axis(PyObject *self, PyObject *args);
+static PyObject *robustats_mode_axis(PyObject *self, PyObject *args);
+static PyObject *robustats_mad_axis(PyObject *self, PyObject *args);
+static PyObject *robustats_rolling_medcouple(PyObject *self, PyObject *args);
+static PyObject *robustats_rolling_weighted_median(PyObject *self, PyObject *args);
+static PyObject *robustats_rolling_mode(PyObject *self, PyObject *args);
+static PyObject *robustats_weighted_median_external(PyObject *self, PyObject *args);
+static PyObject *robustats_mode_external(PyObject *self, PyObject *args);
+static PyObject *robustats_medcouple_external(PyObject *self, PyObject *args);
 
 // Module specification
 static PyMethodDef module_methods[] = {
     {"weighted_median", (PyCFunction)robustats_weighted_median, METH_VARARGS, weighted_median_docstring},
     {"medcouple", (PyCFunction)robustats_medcouple, METH_VARARGS, medcouple_docstring},
     {"mode", (PyCFunction)robustats_mode, METH_VARARGS, mode_docstring},
+    {"weighted_quantiles", (PyCFunction)robustats_weighted_quantiles, METH_VARARGS, weighted_quantiles_docstring},
+    {"quantiles", (PyCFunction)robustats_quantiles, METH_VARARGS, quantiles_docstring},
+    {"adjusted_boxplot", (PyCFunction)robustats_adjusted_boxplot, METH_VARARGS, adjusted_boxplot_docstring},
+    {"qn", (PyCFunction)robustats_qn, METH_VARARGS, qn_docstring},
+    {"sn", (PyCFunction)robustats_sn, METH_VARARGS, sn_docstring},
+    {"hodges_lehmann", (PyCFunction)robustats_hodges_lehmann, METH_VARARGS, hodges_lehmann_docstring},
+    {"theil_sen", (PyCFunction)robustats_theil_sen, METH_VARARGS, theil_sen_docstring},
+    {"mad", (PyCFunction)robustats_mad, METH_VARARGS, mad_docstring},
+    {"robust_zscore", (PyCFunction)robustats_robust_zscore, METH_VARARGS, robust_zscore_docstring},
+    {"weighted_median_batch", (PyCFunction)robustats_weighted_median_batch, METH_VARARGS,
+     weighted_median_batch_docstring},
+    {"medcouple_batch", (PyCFunction)robustats_medcouple_batch, METH_VARARGS, medcouple_batch_docstring},
+    {"mode_batch", (PyCFunction)robustats_mode_batch, METH_VARARGS, mode_batch_docstring},
+    {"weighted_median_axis", (PyCFunction)robustats_weighted_median_axis, METH_VARARGS,
+     weighted_median_axis_docstring},
+    {"medcouple_axis", (PyCFunction)robustats_medcouple_axis, METH_VARARGS, medcouple_axis_docstring},
+    {"mode_axis", (PyCFunction)robustats_mode_axis, METH_VARARGS, mode_axis_docstring},
+    {"mad_axis", (PyCFunction)robustats_mad_axis, METH_VARARGS, mad_axis_docstring},
+    {"rolling_medcouple", (PyCFunction)robustats_rolling_medcouple, METH_VARARGS,
+     rolling_medcouple_docstring},
+    {"rolling_weighted_median", (PyCFunction)robustats_rolling_weighted_median, METH_VARARGS,
+     rolling_weighted_median_docstring},
+    {"rolling_mode", (PyCFunction)robustats_rolling_mode, METH_VARARGS, rolling_mode_docstring},
+    {"weighted_median_external", (PyCFunction)robustats_weighted_median_external, METH_VARARGS,
+     weighted_median_external_docstring},
+    {"mode_external", (PyCFunction)robustats_mode_external, METH_VARARGS, mode_external_docstring},
+    {"medcouple_external", (PyCFunction)robustats_medcouple_external, METH_VARARGS, medcouple_external_docstring},
     {NULL, NULL, 0, NULL}
 };
 
@@ -35,124 +142,2613 @@ static struct PyModuleDef robustatsmodule = {
     module_methods
 };
 
+// Workspace shared by the calls that are not given a workspace, so that
+// repeated calls do not allocate memory each time. Workspaces larger than
+// WORKSPACE_MAX_RETAINED bytes are not retained between calls.
+#define WORKSPACE_MAX_RETAINED ((size_t)1 << 26)
+static workspace default_workspace;
+static PyThread_type_lock default_workspace_lock = NULL;
+
+// Scratch memory into which lists and strided buffers are converted, shared
+// by the calls so that repeated calls do not allocate memory each time. The
+// samples converted while it is in use take memory of their own, and scratch
+// memory larger than WORKSPACE_MAX_RETAINED bytes is not retained
+#define SCRATCH_NONE 0
+#define SCRATCH_SHARED 1
+#define SCRATCH_OWNED 2
+static void *scratch_memory = NULL;
+static size_t scratch_size = 0;
+static PyThread_type_lock scratch_lock = NULL;
+
+// Workspace object
+typedef struct {
+    PyObject_HEAD
+    workspace ws;
+    PyThread_type_lock lock;  // Held while the workspace is in use by a call
+    int counting;  // Whether to record the counters of the calls
+    counters counts;  // Counters of the last call
+} WorkspaceObject;
+
+// Size of the largest workspace used by the estimators over samples of n data
+// points, including the copies of the samples
+static size_t max_workspace_size(int64_t n)
+{
+    size_t copy_size = workspace_array_size(n * sizeof(double));
+    size_t sizes[] = {
+        weighted_median_workspace_size(n),
+        copy_size + medcouple_workspace_size(n),
+        copy_size,
+        rolling_weighted_median_workspace_size(n),
+        rolling_medcouple_workspace_size(n),
+        rolling_mode_workspace_size(n),
+    };
+
+    size_t size = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        if (sizes[i] > size)
+            size = sizes[i];
+
+    return size;
+}
+
+static PyObject *Workspace_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    WorkspaceObject *self = (WorkspaceObject*)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+
+    workspace_init(&self->ws);
+    self->counting = 0;
+    counters_reset(&self->counts);
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == NULL) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+
+    return (PyObject*)self;
+}
+
+static int Workspace_init(WorkspaceObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"n", "counters", NULL};
+    Py_ssize_t n = 0;
+    int counting = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|np", kwlist, &n, &counting))
+        return -1;
+
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "The number of data points must be non-negative.");
+        return -1;
+    }
+    if (counting && !counters_enabled()) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "The library was compiled without counters: build it with ROBUSTATS_COUNTERS=1.");
+        return -1;
+    }
+    self->counting = counting;
+
+    // Preallocate the memory for samples of n data points
+    if (n > 0 && !workspace_reserve(&self->ws, max_workspace_size((int64_t)n))) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    return 0;
+}
+
+static void Workspace_dealloc(WorkspaceObject *self)
+{
+    workspace_free(&self->ws);
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject *Workspace_clear(WorkspaceObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!PyThread_acquire_lock(self->lock, NOWAIT_LOCK)) {
+        PyErr_SetString(PyExc_RuntimeError, "The workspace is in use by another call.");
+        return NULL;
+    }
+
+    workspace_free(&self->ws);
+    PyThread_release_lock(self->lock);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Workspace_get_size(WorkspaceObject *self, void *closure)
+{
+    return PyLong_FromSize_t(self->ws.size + self->ws.overflow_size);
+}
+
+static PyObject *Workspace_get_counters(WorkspaceObject *self, void *closure)
+{
+    if (!self->counting)
+        Py_RETURN_NONE;
+
+    counters *c = &self->counts;
+    return Py_BuildValue(
+        "{s:L,s:L,s:L,s:L,s:L,s:d,s:d,s:d,s:d}",
+        "iterations", (long long)c->iterations,
+        "partitions", (long long)c->partitions,
+        "comparisons", (long long)c->comparisons,
+        "swaps", (long long)c->swaps,
+        "bytes_allocated", (long long)c->bytes_allocated,
+        "sort_seconds", c->seconds[PHASE_SORT],
+        "matrix_seconds", c->seconds[PHASE_MATRIX],
+        "weighted_median_seconds", c->seconds[PHASE_WEIGHTED_MEDIAN],
+        "remaining_seconds", c->seconds[PHASE_REMAINING]);
+}
+
+static PyMethodDef Workspace_methods[] = {
+    {"clear", (PyCFunction)Workspace_clear, METH_NOARGS, "Free the memory of the workspace."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Workspace_getset[] = {
+    {"size", (getter)Workspace_get_size, NULL, "Size of the memory of the workspace in bytes.", NULL},
+    {"counters", (getter)Workspace_get_counters, NULL,
+     "Counters of the work of the last call given the workspace, or None if they are not recorded.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject WorkspaceType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_robustats.Workspace",
+    .tp_doc = workspace_docstring,
+    .tp_basicsize = sizeof(WorkspaceObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = Workspace_new,
+    .tp_init = (initproc)Workspace_init,
+    .tp_dealloc = (destructor)Workspace_dealloc,
+    .tp_methods = Workspace_methods,
+    .tp_getset = Workspace_getset,
+};
+
+// Sketch object
+typedef struct {
+    PyObject_HEAD
+    sketch s;
+} SketchObject;
+
+static PyObject *Sketch_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    SketchObject *self = (SketchObject*)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+
+    sketch_init(&self->s, 1000);
+
+    return (PyObject*)self;
+}
+
+static int Sketch_init(SketchObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"size", NULL};
+    Py_ssize_t size = 1000;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &size))
+        return -1;
+
+    if (size < 8) {
+        PyErr_SetString(PyExc_ValueError, "The size of the sketch must be at least 8.");
+        return -1;
+    }
+
+    sketch_free(&self->s);
+    sketch_init(&self->s, (int64_t)size);
+
+    return 0;
+}
+
+static void Sketch_dealloc(SketchObject *self)
+{
+    sketch_free(&self->s);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject *Sketch_add(SketchObject *self, PyObject *args)
+{
+    PyObject *x_obj, *w_obj;
+
+    if (!PyArg_ParseTuple(args, "OO", &x_obj, &w_obj))
+        return NULL;
+
+    // Interpret the input objects as contiguous arrays of float64
+    PyObject *x_array = PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+    if (x_array == NULL)
+        return NULL;
+    PyObject *w_array = PyArray_FROM_OTF(w_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+    if (w_array == NULL) {
+        Py_DECREF(x_array);
+        return NULL;
+    }
+
+    PyObject *ret = NULL;
+    int64_t n = (int64_t)PyArray_SIZE((PyArrayObject*)x_array);
+    if (n != (int64_t)PyArray_SIZE((PyArrayObject*)w_array))
+        PyErr_SetString(PyExc_ValueError, "The data sample and the weights have different lengths.");
+    else if (!sketch_add(&self->s, PyArray_DATA((PyArrayObject*)x_array), PyArray_DATA((PyArrayObject*)w_array), n))
+        PyErr_NoMemory();
+    else {
+        Py_INCREF(Py_None);
+        ret = Py_None;
+    }
+
+    Py_DECREF(x_array);
+    Py_DECREF(w_array);
+
+    return ret;
+}
+
+static PyTypeObject SketchType;
+
+static PyObject *Sketch_merge(SketchObject *self, PyObject *other)
+{
+    if (!PyObject_TypeCheck(other, &SketchType)) {
+        PyErr_SetString(PyExc_TypeError, "The sketch to merge must be a Sketch object.");
+        return NULL;
+    }
+    if (other == (PyObject*)self) {
+        PyErr_SetString(PyExc_ValueError, "A sketch cannot be merged into itself.");
+        return NULL;
+    }
+
+    if (!sketch_merge(&self->s, &((SketchObject*)other)->s))
+        return PyErr_NoMemory();
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *Sketch_quantile(SketchObject *self, PyObject *args)
+{
+    double q;
+
+    if (!PyArg_ParseTuple(args, "d", &q))
+        return NULL;
+
+    if (!(q >= 0. && q <= 1.)) {
+        PyErr_SetString(PyExc_ValueError, "The order of the quantile must be between 0 and 1.");
+        return NULL;
+    }
+    if (!(sketch_total_weight(&self->s) > 0.)) {
+        PyErr_SetString(PyExc_ValueError, "The sketch has no weight.");
+        return NULL;
+    }
+
+    double quantile;
+    if (!sketch_quantile(&self->s, q, &quantile, NULL))
+        return PyErr_NoMemory();
+
+    return Py_BuildValue("d", quantile);
+}
+
+static PyObject *Sketch_to_bytes(SketchObject *self, PyObject *Py_UNUSED(ignored))
+{
+    PyObject *bytes = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)sketch_serialized_size(&self->s));
+    if (bytes == NULL)
+        return NULL;
+
+    sketch_serialize(&self->s, PyBytes_AS_STRING(bytes));
+
+    return bytes;
+}
+
+static PyObject *Sketch_from_bytes(PyTypeObject *type, PyObject *args)
+{
+    Py_buffer buffer;
+
+    if (!PyArg_ParseTuple(args, "y*", &buffer))
+        return NULL;
+
+    SketchObject *self = (SketchObject*)PyObject_CallObject((PyObject*)type, NULL);
+    if (self == NULL) {
+        PyBuffer_Release(&buffer);
+        return NULL;
+    }
+
+    sketch_free(&self->s);
+    int status = sketch_deserialize(&self->s, buffer.buf, (size_t)buffer.len);
+    PyBuffer_Release(&buffer);
+
+    if (status <= 0) {
+        if (status == 0)
+            PyErr_SetString(PyExc_ValueError, "The bytes are not a serialized sketch.");
+        else
+            PyErr_NoMemory();
+        Py_DECREF(self);
+        return NULL;
+    }
+
+    return (PyObject*)self;
+}
+
+static PyObject *Sketch_get_size(SketchObject *self, void *closure)
+{
+    return PyLong_FromLongLong((long long)self->s.size);
+}
+
+static PyObject *Sketch_get_n_items(SketchObject *self, void *closure)
+{
+    return PyLong_FromLongLong((long long)self->s.n);
+}
+
+static PyObject *Sketch_get_total_weight(SketchObject *self, void *closure)
+{
+    return PyFloat_FromDouble(sketch_total_weight(&self->s));
+}
+
+static PyObject *Sketch_get_exact(SketchObject *self, void *closure)
+{
+    return PyBool_FromLong(self->s.exact);
+}
+
+static PyMethodDef Sketch_methods[] = {
+    {"add", (PyCFunction)Sketch_add, METH_VARARGS, "Add a data sample with respective weights to the sketch."},
+    {"merge", (PyCFunction)Sketch_merge, METH_O, "Merge another sketch into the sketch."},
+    {"quantile", (PyCFunction)Sketch_quantile, METH_VARARGS, "Estimate a weighted quantile of the sketch."},
+    {"to_bytes", (PyCFunction)Sketch_to_bytes, METH_NOARGS, "Serialize the sketch into bytes."},
+    {"from_bytes", (PyCFunction)Sketch_from_bytes, METH_VARARGS | METH_CLASS,
+     "Deserialize a sketch serialized by method 'to_bytes'."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Sketch_getset[] = {
+    {"size", (getter)Sketch_get_size, NULL, "Maximum number of items of the sketch.", NULL},
+    {"n_items", (getter)Sketch_get_n_items, NULL, "Number of items of the sketch.", NULL},
+    {"total_weight", (getter)Sketch_get_total_weight, NULL, "Total weight of the data points of the sketch.", NULL},
+    {"exact", (getter)Sketch_get_exact, NULL, "Whether the items of the sketch are its data points.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject SketchType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_robustats.Sketch",
+    .tp_doc = sketch_docstring,
+    .tp_basicsize = sizeof(SketchObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = Sketch_new,
+    .tp_init = (initproc)Sketch_init,
+    .tp_dealloc = (destructor)Sketch_dealloc,
+    .tp_methods = Sketch_methods,
+    .tp_getset = Sketch_getset,
+};
+
 // Initialize the module
 PyMODINIT_FUNC PyInit__robustats(void)
 {
-    PyObject *m;
+    PyObject *m;
+
+    if (PyType_Ready(&WorkspaceType) < 0)
+        return NULL;
+    if (PyType_Ready(&SketchType) < 0)
+        return NULL;
+
+    m = PyModule_Create(&robustatsmodule);
+    if (m == NULL)
+        return NULL;
+
+    // Load Numpy functionality
+    import_array();
+
+    // Default workspace and its lock
+    workspace_init(&default_workspace);
+    default_workspace_lock = PyThread_allocate_lock();
+    if (default_workspace_lock == NULL) {
+        Py_DECREF(m);
+        return PyErr_NoMemory();
+    }
+
+    // Lock of the scratch memory of the conversions of the data samples
+    scratch_lock = PyThread_allocate_lock();
+    if (scratch_lock == NULL) {
+        Py_DECREF(m);
+        return PyErr_NoMemory();
+    }
+
+    Py_INCREF(&WorkspaceType);
+    if (PyModule_AddObject(m, "Workspace", (PyObject*)&WorkspaceType) < 0) {
+        Py_DECREF(&WorkspaceType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&SketchType);
+    if (PyModule_AddObject(m, "Sketch", (PyObject*)&SketchType) < 0) {
+        Py_DECREF(&SketchType);
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    return m;
+}
+
+// Release the workspace of a call obtained with acquire_workspace. Returns 0
+// with a MemoryError if a function of the call could not allocate its memory,
+// and 1 otherwise. The GIL must be held.
+static int release_workspace(PyObject *workspace_obj, workspace *ws, workspace *temporary)
+{
+    int failed = ws->failed;
+
+    counters_attach(NULL);
+
+    if (ws == temporary)
+        workspace_free(temporary);
+    else if (ws == &default_workspace) {
+        if (ws->size + ws->overflow_size > WORKSPACE_MAX_RETAINED)
+            workspace_free(ws);
+        PyThread_release_lock(default_workspace_lock);
+    }
+    else
+        PyThread_release_lock(((WorkspaceObject*)workspace_obj)->lock);
+
+    if (failed) {
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    return 1;
+}
+
+// Acquire the workspace of a call, with a main block of at least the given
+// size. This is the given Workspace object or, if None, the default workspace
+// unless it is in use by another thread, in which case a temporary workspace
+// is used. The GIL must be held.
+static workspace *acquire_workspace(PyObject *workspace_obj, size_t size, workspace *temporary)
+{
+    workspace *ws;
+
+    if (workspace_obj != Py_None) {
+        if (!PyObject_TypeCheck(workspace_obj, &WorkspaceType)) {
+            PyErr_SetString(PyExc_TypeError, "The workspace must be a Workspace object.");
+            return NULL;
+        }
+        if (!PyThread_acquire_lock(((WorkspaceObject*)workspace_obj)->lock, NOWAIT_LOCK)) {
+            PyErr_SetString(PyExc_RuntimeError, "The workspace is in use by another call.");
+            return NULL;
+        }
+        ws = &((WorkspaceObject*)workspace_obj)->ws;
+
+        // The work of the call, which runs in the calling thread, is recorded
+        // into the counters of the workspace
+        if (((WorkspaceObject*)workspace_obj)->counting) {
+            counters_reset(&((WorkspaceObject*)workspace_obj)->counts);
+            counters_attach(&((WorkspaceObject*)workspace_obj)->counts);
+        }
+    }
+    else if (PyThread_acquire_lock(default_workspace_lock, NOWAIT_LOCK))
+        ws = &default_workspace;
+    else {
+        workspace_init(temporary);
+        ws = temporary;
+    }
+
+    // Release the memory of the previous call, merging the memory that
+    // overflowed the main block into it
+    workspace_reset(ws);
+    if (!workspace_reserve(ws, size)) {
+        release_workspace(workspace_obj, ws, temporary);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    return ws;
+}
+
+// Converter of the seed of the generator of the pivots, for PyArg_ParseTuple:
+// None gives the default seed, and integers are taken modulo 2^64
+static int parse_seed(PyObject *obj, void *seed)
+{
+    if (obj == Py_None) {
+        *(uint64_t*)seed = RANDOM_DEFAULT_SEED;
+        return 1;
+    }
+    if (!PyLong_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError, "The seed must be an integer or None.");
+        return 0;
+    }
+
+    *(uint64_t*)seed = (uint64_t)PyLong_AsUnsignedLongLongMask(obj);
+    return !PyErr_Occurred();
+}
+
+
+// Sets of types of the data samples computed natively by the estimators, the
+// data samples of other types being converted to float64
+#define NATIVE_FLOAT64 0  // float64
+#define NATIVE_FLOATING 1  // float32 and float64
+#define NATIVE_NUMERIC 2  // float32, float64, int32 and int64
+
+// Data sample interpreted as a contiguous array
+typedef struct {
+    PyObject *array;  // Numpy array of the data, or NULL if read otherwise
+    Py_buffer view;  // Buffer of the data, if read through the buffer protocol
+    int scratch;  // Memory holding a conversion of the data: SCRATCH_NONE, SCRATCH_SHARED or SCRATCH_OWNED
+    void *x;
+    int64_t n;
+    int type;  // Numpy type of the elements
+    size_t item_size;  // Size of the elements in bytes
+    int in_place;  // Whether the estimators may modify the data of the array
+} sample;
+
+// Take scratch memory of the given size for the data of a sample. The GIL
+// must be held.
+static int acquire_scratch(sample *x, size_t size)
+{
+    if (size == 0)
+        size = 1;
+
+    if (PyThread_acquire_lock(scratch_lock, NOWAIT_LOCK)) {
+        if (size > scratch_size) {
+            void *memory = PyMem_Realloc(scratch_memory, size);
+            if (memory == NULL) {
+                PyThread_release_lock(scratch_lock);
+                PyErr_NoMemory();
+                return 0;
+            }
+            scratch_memory = memory;
+            scratch_size = size;
+        }
+        x->scratch = SCRATCH_SHARED;
+        x->x = scratch_memory;
+        return 1;
+    }
+
+    x->x = PyMem_Malloc(size);
+    if (x->x == NULL) {
+        PyErr_NoMemory();
+        return 0;
+    }
+    x->scratch = SCRATCH_OWNED;
+    return 1;
+}
+
+// Release the data of a sample obtained with parse_sample. The GIL must be
+// held.
+static void release_sample(sample *x)
+{
+    if (x->scratch == SCRATCH_SHARED) {
+        if (scratch_size > WORKSPACE_MAX_RETAINED) {
+            PyMem_Free(scratch_memory);
+            scratch_memory = NULL;
+            scratch_size = 0;
+        }
+        PyThread_release_lock(scratch_lock);
+    }
+    else if (x->scratch == SCRATCH_OWNED)
+        PyMem_Free(x->x);
+    x->scratch = SCRATCH_NONE;
+
+    if (x->view.obj != NULL)
+        PyBuffer_Release(&x->view);
+    Py_XDECREF(x->array);
+    x->array = NULL;
+}
+
+// Numpy type in which to interpret an object: the type of a Numpy array, if
+// among the native types, or float64 otherwise
+static int sample_type(PyObject *obj, int native)
+{
+    if (native == NATIVE_FLOAT64 || !PyArray_Check(obj))
+        return NPY_DOUBLE;
+
+    int type = PyArray_TYPE((PyArrayObject*)obj);
+    if (type == NPY_FLOAT)
+        return NPY_FLOAT;
+    if (native == NATIVE_NUMERIC && PyTypeNum_ISSIGNED(type)) {
+        if (PyArray_ITEMSIZE((PyArrayObject*)obj) == 4)
+            return NPY_INT32;
+        if (PyArray_ITEMSIZE((PyArrayObject*)obj) == 8)
+            return NPY_INT64;
+    }
+
+    return NPY_DOUBLE;
+}
+
+// Numpy type of the elements of a buffer, from their format in the syntax of
+// the struct module, or -1 if they are not floats nor signed integers of 4 or
+// 8 bytes in the byte order of the machine
+static int buffer_type(Py_buffer *view)
+{
+    const char *format = view->format;
+
+    if (format[0] == '@' || format[0] == '=' || format[0] == (PY_LITTLE_ENDIAN ? '<' : '>'))
+        format++;
+    if (format[0] == '\0' || format[1] != '\0')
+        return -1;
+
+    switch (format[0]) {
+    case 'd':
+        return view->itemsize == 8 ? NPY_DOUBLE : -1;
+    case 'f':
+        return view->itemsize == 4 ? NPY_FLOAT : -1;
+    case 'i':
+    case 'l':
+    case 'q':
+    case 'n':
+        return view->itemsize == 4 ? NPY_INT32 : view->itemsize == 8 ? NPY_INT64 : -1;
+    default:
+        return -1;
+    }
+}
+
+// Value of an element of a native type as a float64
+static double load_as_double(const char *item, int type)
+{
+    switch (type) {
+    case NPY_FLOAT:
+        return (double)*(const float*)item;
+    case NPY_INT32:
+        return (double)*(const int32_t*)item;
+    case NPY_INT64:
+        return (double)*(const int64_t*)item;
+    default:
+        return *(const double*)item;
+    }
+}
+
+// Copy the elements of a buffer in row-major order into contiguous memory,
+// converting them from their native type into float64 if the types differ
+static void gather_buffer(Py_buffer *view, int type, int sample_type, char *out, int64_t n)
+{
+    Py_ssize_t index[PyBUF_MAX_NDIM] = {0};
+    int ndim = view->ndim;
+    size_t out_size = sample_type == type ? (size_t)view->itemsize : sizeof(double);
+
+    if (n == 0)
+        return;
+
+    // The elements are copied along the last dimension, the indices of the
+    // other dimensions being incremented as those of a counter
+    Py_ssize_t length = ndim > 0 ? view->shape[ndim - 1] : 1;
+    Py_ssize_t stride = ndim > 0 ? view->strides[ndim - 1] : 0;
+    const char *row = view->buf;
+    while (1) {
+        const char *item = row;
+        for (Py_ssize_t i = 0; i < length; i++, item += stride, out += out_size) {
+            if (sample_type == type)
+                memcpy(out, item, out_size);
+            else
+                *(double*)out = load_as_double(item, type);
+        }
+
+        int d = ndim - 2;
+        for (; d >= 0; d--) {
+            row += view->strides[d];
+            if (++index[d] < view->shape[d])
+                break;
+            row -= view->strides[d] * view->shape[d];
+            index[d] = 0;
+        }
+        if (d < 0)
+            return;
+    }
+}
+
+// Interpret an object exposing the buffer protocol, other than a Numpy array,
+// as a data sample. Its data is read without copying if it is contiguous and
+// of a native type, and is otherwise converted into scratch memory.
+//
+// Returns:
+//    1 if the object was interpreted, 0 with an exception set if it failed,
+//    and -1 if its elements are not of a native type, to interpret it with
+//    Numpy instead.
+static int parse_buffer(PyObject *obj, int overwrite_input, int native, sample *x)
+{
+    if (PyObject_GetBuffer(obj, &x->view, PyBUF_RECORDS_RO) < 0) {
+        PyErr_Clear();
+        x->view.obj = NULL;
+        return -1;
+    }
+
+    int type = buffer_type(&x->view);
+    if (type < 0) {
+        PyBuffer_Release(&x->view);
+        x->view.obj = NULL;
+        return -1;
+    }
+
+    x->n = 1;
+    for (int d = 0; d < x->view.ndim; d++)
+        x->n *= x->view.shape[d];
+
+    // The native types of the sample are those of function 'sample_type'
+    if (native == NATIVE_FLOAT64 || (type != NPY_FLOAT && native == NATIVE_FLOATING))
+        x->type = NPY_DOUBLE;
+    else
+        x->type = type;
+    x->item_size = x->type == type ? (size_t)x->view.itemsize : sizeof(double);
+
+    if (x->type == type && PyBuffer_IsContiguous(&x->view, 'C')) {
+        x->x = x->view.buf;
+        x->in_place = overwrite_input && !x->view.readonly;
+        return 1;
+    }
+
+    if (!acquire_scratch(x, x->n * x->item_size)) {
+        PyBuffer_Release(&x->view);
+        x->view.obj = NULL;
+        return 0;
+    }
+    gather_buffer(&x->view, type, x->type, x->x, x->n);
+    x->in_place = 1;
+
+    return 1;
+}
+
+// Convert a list or a tuple of Python floats and integers into float64, in
+// scratch memory.
+//
+// Returns:
+//    1 if the object was converted, 0 with an exception set if it failed,
+//    and -1 if it holds other objects, to interpret it with Numpy instead.
+static int parse_list(PyObject *obj, sample *x)
+{
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(obj);
+    PyObject **items = PySequence_Fast_ITEMS(obj);
+
+    if (!acquire_scratch(x, n * sizeof(double)))
+        return 0;
+
+    double *values = x->x;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *item = items[i];
+        if (PyFloat_CheckExact(item)) {
+            values[i] = PyFloat_AS_DOUBLE(item);
+            continue;
+        }
+        if (PyLong_CheckExact(item)) {
+            values[i] = PyLong_AsDouble(item);
+            if (values[i] != -1. || !PyErr_Occurred())
+                continue;
+            PyErr_Clear();
+        }
+
+        release_sample(x);
+        return -1;
+    }
+
+    x->n = (int64_t)n;
+    x->type = NPY_DOUBLE;
+    x->item_size = sizeof(double);
+    x->in_place = 1;
+
+    return 1;
+}
+
+// Interpret an object as a data sample of one of the native types. Its data
+// may be modified in-place if it is a fresh copy of the object, or if it is
+// the data of the object and overwrite_input is true. Lists and tuples of
+// numbers, and objects exposing the buffer protocol other than Numpy arrays,
+// are read without going through a Numpy array. The sample is released with
+// function 'release_sample'.
+static int parse_sample(PyObject *obj, int overwrite_input, int native, sample *x)
+{
+    x->array = NULL;
+    x->view.obj = NULL;
+    x->scratch = SCRATCH_NONE;
+
+    if (PyList_CheckExact(obj) || PyTuple_CheckExact(obj)) {
+        int parsed = parse_list(obj, x);
+        if (parsed >= 0)
+            return parsed;
+    }
+    else if (!PyArray_Check(obj) && PyObject_CheckBuffer(obj)) {
+        int parsed = parse_buffer(obj, overwrite_input, native, x);
+        if (parsed >= 0)
+            return parsed;
+    }
+
+    // Interpret the input object as a numpy array
+    x->type = sample_type(obj, native);
+    x->array = PyArray_FROM_OTF(obj, x->type, NPY_ARRAY_IN_ARRAY);
+
+    // If that didn't work, throw an exception
+    if (x->array == NULL)
+        return 0;
+
+    // The array is a fresh copy when it was converted from a list or a tuple,
+    // or from a Numpy array of another type or layout. Any other object, such
+    // as one with an '__array__' method, may hand out its own data, even in
+    // an array that owns it, so it is only modified with 'overwrite_input'
+    PyArrayObject *array = (PyArrayObject*)x->array;
+    x->n = (int64_t)PyArray_SIZE(array);
+    x->x = PyArray_DATA(array);
+    x->item_size = (size_t)PyArray_ITEMSIZE(array);
+    x->in_place = PyList_CheckExact(obj) || PyTuple_CheckExact(obj)
+                  || (PyArray_Check(obj) && x->array != obj)
+                  || (overwrite_input && PyArray_ISWRITEABLE(array));
+
+    return 1;
+}
+
+// Weighted median of values of a native type, computed in-place
+static double weighted_median_of_type(int type, void *x, double *w, int64_t n, uint64_t *random_state)
+{
+    switch (type) {
+    case NPY_FLOAT:
+        return weighted_median_in_place_float32(x, w, 0, n - 1, random_state);
+    case NPY_INT32:
+        return weighted_median_in_place_int32(x, w, 0, n - 1, random_state);
+    case NPY_INT64:
+        return weighted_median_in_place_int64(x, w, 0, n - 1, random_state);
+    default:
+        return weighted_median_in_place(x, w, 0, n - 1, random_state);
+    }
+}
+
+// Medcouple of values of a native type, with the epsilons of the type, or
+// approximate medcouple if the tolerance is positive
+static double medcouple_of_type(int type, void *x, int64_t n, int64_t n_threads, double tolerance, workspace *ws)
+{
+    switch (type) {
+    case NPY_FLOAT:
+        if (tolerance > 0.)
+            return medcouple_approximate_float32(x, n, FLT_EPSILON, FLT_MIN, tolerance, ws);
+        return medcouple_parallel_float32(x, n, FLT_EPSILON, FLT_MIN, n_threads, ws);
+    default:
+        if (tolerance > 0.)
+            return medcouple_approximate(x, n, DBL_EPSILON, DBL_MIN, tolerance, ws);
+        return medcouple_parallel(x, n, DBL_EPSILON, DBL_MIN, n_threads, ws);
+    }
+}
+
+// Mode of values of a native type
+static double mode_of_type(int type, void *x, int64_t n, workspace *ws)
+{
+    switch (type) {
+    case NPY_FLOAT:
+        return mode_float32(x, n, ws);
+    case NPY_INT32:
+        return mode_int32(x, n, ws);
+    case NPY_INT64:
+        return mode_int64(x, n, ws);
+    default:
+        return mode(x, n, ws);
+    }
+}
+
+// Weighted quantiles of values of a native type, computed in-place
+static void weighted_quantiles_of_type(
+    int type, void *x, double *w, int64_t n, double *qs, int64_t n_qs, double *quantiles, uint64_t *random_state)
+{
+    switch (type) {
+    case NPY_FLOAT:
+        weighted_quantiles_in_place_float32(x, w, n, qs, n_qs, quantiles, random_state);
+        break;
+    case NPY_INT32:
+        weighted_quantiles_in_place_int32(x, w, n, qs, n_qs, quantiles, random_state);
+        break;
+    case NPY_INT64:
+        weighted_quantiles_in_place_int64(x, w, n, qs, n_qs, quantiles, random_state);
+        break;
+    default:
+        weighted_quantiles_in_place(x, w, n, qs, n_qs, quantiles, random_state);
+    }
+}
+
+// Quantiles of values of a native type, computed in-place
+static void quantiles_of_type(int type, void *x, int64_t n, double *qs, int64_t n_qs, double *quantiles, workspace *ws)
+{
+    switch (type) {
+    case NPY_FLOAT:
+        quantiles_in_place_float32(x, n, qs, n_qs, quantiles, ws);
+        break;
+    case NPY_INT32:
+        quantiles_in_place_int32(x, n, qs, n_qs, quantiles, ws);
+        break;
+    case NPY_INT64:
+        quantiles_in_place_int64(x, n, qs, n_qs, quantiles, ws);
+        break;
+    default:
+        quantiles_in_place(x, n, qs, n_qs, quantiles, ws);
+    }
+}
+
+static PyObject *robustats_weighted_median(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *w_obj, *workspace_obj;
+    int overwrite_input;
+    uint64_t seed;
+    sample x, w;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OOpOO&", &x_obj, &w_obj, &overwrite_input, &workspace_obj, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input objects as data samples
+    if (!parse_sample(x_obj, overwrite_input, NATIVE_NUMERIC, &x))
+        return NULL;
+    if (!parse_sample(w_obj, overwrite_input, NATIVE_FLOAT64, &w)) {
+        release_sample(&x);
+        return NULL;
+    }
+
+    PyObject *ret = NULL;
+    if (x.n != w.n) {
+        PyErr_SetString(PyExc_ValueError, "The data sample and the weights have different lengths.");
+        goto cleanup;
+    }
+    if (x.n == 0) {
+        PyErr_SetString(PyExc_ValueError, "The data sample must not be empty.");
+        goto cleanup;
+    }
+
+    // Values and weights are either modified in-place or copied once into a
+    // single buffer of the workspace
+    workspace temporary;
+    int copy = !x.in_place || !w.in_place;
+    size_t x_size = x.n * x.item_size, w_size = w.n * sizeof(double);
+    size_t size = copy ? workspace_array_size(x_size) + workspace_array_size(w_size) : 0;
+    workspace *ws = acquire_workspace(workspace_obj, size, &temporary);
+    if (ws == NULL)
+        goto cleanup;
+    workspace_seed(ws, seed);
+
+    void *xw_x = x.x;
+    double *xw_w = w.x;
+    if (copy) {
+        xw_x = workspace_alloc(ws, x_size);
+        xw_w = workspace_alloc(ws, w_size);
+        if (xw_x == NULL || xw_w == NULL) {
+            release_workspace(workspace_obj, ws, &temporary);
+            PyErr_NoMemory();
+            goto cleanup;
+        }
+    }
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    Py_BEGIN_ALLOW_THREADS
+    if (copy) {
+        memcpy(xw_x, x.x, x_size);
+        memcpy(xw_w, w.x, w_size);
+    }
+    value = weighted_median_of_type(x.type, xw_x, xw_w, x.n, &ws->random_state);
+    Py_END_ALLOW_THREADS
+
+    if (!release_workspace(workspace_obj, ws, &temporary))
+        goto cleanup;
+
+    // Build the output tuple
+    ret = Py_BuildValue("d", value);
+
+cleanup:
+    release_sample(&x);
+    release_sample(&w);
+    return ret;
+}
+
+static PyObject *robustats_medcouple(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *workspace_obj;
+    int overwrite_input;
+    uint64_t seed;
+    Py_ssize_t n_threads;
+    double tolerance;
+    sample x;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OpOO&nd", &x_obj, &overwrite_input, &workspace_obj, parse_seed, &seed, &n_threads,
+                          &tolerance))
+        return NULL;
+
+    // Interpret the input object as a data sample
+    if (!parse_sample(x_obj, overwrite_input, NATIVE_FLOATING, &x))
+        return NULL;
+
+    // The data sample is either sorted in-place or copied once into the
+    // workspace, from which the estimator allocates its temporary arrays
+    workspace temporary;
+    size_t copy_size = x.in_place ? 0 : workspace_array_size(x.n * x.item_size);
+    size_t size = copy_size + medcouple_parallel_workspace_size(x.n, (int64_t)n_threads);
+    workspace *ws = acquire_workspace(workspace_obj, size, &temporary);
+    if (ws == NULL) {
+        release_sample(&x);
+        return NULL;
+    }
+    workspace_seed(ws, seed);
+    void *buffer = x.in_place ? x.x : workspace_alloc(ws, x.n * x.item_size);
+    if (buffer == NULL) {
+        release_workspace(workspace_obj, ws, &temporary);
+        release_sample(&x);
+        return PyErr_NoMemory();
+    }
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    Py_BEGIN_ALLOW_THREADS
+    if (buffer != x.x)
+        memcpy(buffer, x.x, x.n * x.item_size);
+    value = medcouple_of_type(x.type, buffer, x.n, (int64_t)n_threads, tolerance, ws);
+    Py_END_ALLOW_THREADS
+
+    // Clean up
+    int allocated = release_workspace(workspace_obj, ws, &temporary);
+    release_sample(&x);
+    if (!allocated)
+        return NULL;
+
+    // Build the output tuple
+    PyObject *ret = Py_BuildValue("d", value);
+    return ret;
+}
+
+static PyObject *robustats_mode(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *workspace_obj;
+    int overwrite_input;
+    sample x;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OpO", &x_obj, &overwrite_input, &workspace_obj))
+        return NULL;
+
+    // Interpret the input object as a data sample
+    if (!parse_sample(x_obj, overwrite_input, NATIVE_NUMERIC, &x))
+        return NULL;
+    if (x.n == 0) {
+        PyErr_SetString(PyExc_ValueError, "The data sample must not be empty.");
+        release_sample(&x);
+        return NULL;
+    }
+
+    // The data sample is either sorted in-place or copied once into the
+    // workspace, from which the sort also allocates its buffer
+    workspace temporary;
+    size_t copy_size = x.in_place ? 0 : workspace_array_size(x.n * x.item_size);
+    workspace *ws = acquire_workspace(workspace_obj, copy_size + mode_workspace_size(x.n), &temporary);
+    if (ws == NULL) {
+        release_sample(&x);
+        return NULL;
+    }
+    void *buffer = x.in_place ? x.x : workspace_alloc(ws, x.n * x.item_size);
+    if (buffer == NULL) {
+        release_workspace(workspace_obj, ws, &temporary);
+        release_sample(&x);
+        return PyErr_NoMemory();
+    }
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    Py_BEGIN_ALLOW_THREADS
+    if (buffer != x.x)
+        memcpy(buffer, x.x, x.n * x.item_size);
+    value = mode_of_type(x.type, buffer, x.n, ws);
+    Py_END_ALLOW_THREADS
+
+    // Clean up
+    int allocated = release_workspace(workspace_obj, ws, &temporary);
+    release_sample(&x);
+    if (!allocated)
+        return NULL;
+
+    // Build the output tuple
+    PyObject *ret = Py_BuildValue("d", value);
+    return ret;
+}
+
+// Data samples of a batch
+typedef struct {
+    int64_t n_samples;
+    sample *samples;
+} batch_samples;
+
+// Context of the parallel tasks computing the estimators of a batch, each
+// thread allocating from its own workspace the copies of the samples that
+// cannot be modified in-place
+typedef struct {
+    batch_samples *x;
+    batch_samples *w;
+    double epsilon1;
+    double epsilon2;
+    double *values;
+    workspace *workspaces;
+    int failed;  // Whether the memory of a task could not be allocated
+    uint64_t seed;  // Seed of the generators of the pivots
+} batch_context;
+
+static void free_batch_samples(batch_samples *samples)
+{
+    for (int64_t i = 0; i < samples->n_samples; i++)
+        release_sample(&samples->samples[i]);
+
+    PyMem_Free(samples->samples);
+}
+
+static int parse_batch_samples(PyObject *obj, int overwrite_input, batch_samples *samples)
+{
+    PyObject *sequence = PySequence_Fast(obj, "The data samples must be a sequence of arrays.");
+    if (sequence == NULL)
+        return 0;
+
+    samples->n_samples = (int64_t)PySequence_Fast_GET_SIZE(sequence);
+    samples->samples = PyMem_Calloc(samples->n_samples + 1, sizeof(sample));
+    if (samples->samples == NULL) {
+        Py_DECREF(sequence);
+        PyErr_NoMemory();
+        return 0;
+    }
+
+    // Interpret the items of the sequence as data samples
+    for (int64_t i = 0; i < samples->n_samples; i++) {
+        if (!parse_sample(PySequence_Fast_GET_ITEM(sequence, i), overwrite_input, NATIVE_FLOAT64,
+                          &samples->samples[i])) {
+            Py_DECREF(sequence);
+            free_batch_samples(samples);
+            return 0;
+        }
+    }
+    Py_DECREF(sequence);
+
+    return 1;
+}
+
+// Check that none of the data samples of a batch is empty, before starting the
+// tasks of estimators that are not defined on an empty data sample
+static int check_batch_samples_not_empty(batch_samples *samples)
+{
+    for (int64_t i = 0; i < samples->n_samples; i++)
+        if (samples->samples[i].n == 0) {
+            PyErr_Format(PyExc_ValueError, "The data sample %lld must not be empty.", (long long)i);
+            return 0;
+        }
+
+    return 1;
+}
+
+// Data of a sample of a batch that the estimators can modify, copying it into
+// the workspace if it cannot be modified in-place
+static double *task_data(batch_samples *samples, int64_t i, workspace *ws)
+{
+    sample *x = &samples->samples[i];
+
+    if (x->in_place)
+        return x->x;
+
+    double *copy = workspace_alloc(ws, x->n * sizeof(double));
+    if (copy != NULL)
+        memcpy(copy, x->x, x->n * sizeof(double));
+    return copy;
+}
+
+static void weighted_median_task(void *context, int64_t i, int64_t thread)
+{
+    batch_context *batch = (batch_context*)context;
+    workspace *ws = &batch->workspaces[thread];
+
+    workspace_reset(ws);
+    workspace_seed(ws, batch->seed + (uint64_t)i);
+    double *x = task_data(batch->x, i, ws);
+    double *w = task_data(batch->w, i, ws);
+    if (x == NULL || w == NULL) {
+        batch->failed = 1;
+        return;
+    }
+
+    batch->values[i] = weighted_median_in_place(x, w, 0, batch->x->samples[i].n - 1, &ws->random_state);
+}
+
+static void medcouple_task(void *context, int64_t i, int64_t thread)
+{
+    batch_context *batch = (batch_context*)context;
+    workspace *ws = &batch->workspaces[thread];
+
+    workspace_reset(ws);
+    workspace_seed(ws, batch->seed + (uint64_t)i);
+    double *x = task_data(batch->x, i, ws);
+    if (x == NULL) {
+        batch->failed = 1;
+        return;
+    }
+
+    batch->values[i] = medcouple(x, batch->x->samples[i].n, batch->epsilon1, batch->epsilon2, ws);
+    if (ws->failed)
+        batch->failed = 1;
+}
+
+static void mode_task(void *context, int64_t i, int64_t thread)
+{
+    batch_context *batch = (batch_context*)context;
+    workspace *ws = &batch->workspaces[thread];
+
+    workspace_reset(ws);
+    double *x = task_data(batch->x, i, ws);
+    if (x == NULL) {
+        batch->failed = 1;
+        return;
+    }
+
+    batch->values[i] = mode(x, batch->x->samples[i].n, ws);
+}
+
+static PyObject *run_batch(parallel_task task, batch_context *batch, int64_t n_threads)
+{
+    // Create the output array
+    npy_intp dims[1] = {(npy_intp)batch->x->n_samples};
+    PyObject *values_array = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (values_array == NULL)
+        return NULL;
+    batch->values = (double*)PyArray_DATA((PyArrayObject*)values_array);
+
+    // Workspaces of the threads, which grow to the largest sample of each
+    // thread and are then reused for its following samples. The generator of
+    // the pivots is seeded for each sample from its index, so that the pivots
+    // do not depend on the thread computing it
+    if (n_threads < 1)
+        n_threads = 1;
+    if (n_threads > batch->x->n_samples)
+        n_threads = batch->x->n_samples > 0 ? batch->x->n_samples : 1;
+    batch->workspaces = PyMem_Malloc(n_threads * sizeof(workspace));
+    if (batch->workspaces == NULL) {
+        Py_DECREF(values_array);
+        return PyErr_NoMemory();
+    }
+    for (int64_t i = 0; i < n_threads; i++)
+        workspace_init(&batch->workspaces[i]);
+    batch->failed = 0;
+
+    // Compute the estimators in parallel, releasing the GIL
+    Py_BEGIN_ALLOW_THREADS
+    parallel_for(task, batch, batch->x->n_samples, n_threads);
+    for (int64_t i = 0; i < n_threads; i++)
+        workspace_free(&batch->workspaces[i]);
+    Py_END_ALLOW_THREADS
+
+    PyMem_Free(batch->workspaces);
+
+    if (batch->failed) {
+        Py_DECREF(values_array);
+        return PyErr_NoMemory();
+    }
+
+    return values_array;
+}
+
+static PyObject *robustats_weighted_quantiles(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *w_obj, *qs_obj, *workspace_obj;
+    int overwrite_input;
+    uint64_t seed;
+    sample x, w, qs;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OOOpOO&", &x_obj, &w_obj, &qs_obj, &overwrite_input, &workspace_obj, parse_seed,
+                          &seed))
+        return NULL;
+
+    // Interpret the input objects as data samples, the orders of the quantiles
+    // being sorted ascendingly
+    if (!parse_sample(x_obj, overwrite_input, NATIVE_NUMERIC, &x))
+        return NULL;
+    if (!parse_sample(w_obj, overwrite_input, NATIVE_FLOAT64, &w)) {
+        release_sample(&x);
+        return NULL;
+    }
+    if (!parse_sample(qs_obj, 0, NATIVE_FLOAT64, &qs)) {
+        release_sample(&x);
+        release_sample(&w);
+        return NULL;
+    }
+
+    PyArrayObject *values_array = NULL;
+    if (x.n != w.n) {
+        PyErr_SetString(PyExc_ValueError, "The data sample and the weights have different lengths.");
+        goto cleanup;
+    }
+    if (x.n == 0) {
+        PyErr_SetString(PyExc_ValueError, "The data sample must not be empty.");
+        goto cleanup;
+    }
+
+    npy_intp dims[1] = {(npy_intp)qs.n};
+    values_array = (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (values_array == NULL)
+        goto cleanup;
+
+    // Values and weights are either modified in-place or copied once into the
+    // workspace
+    workspace temporary;
+    int copy = !x.in_place || !w.in_place;
+    size_t x_size = x.n * x.item_size, w_size = w.n * sizeof(double);
+    size_t size = copy ? workspace_array_size(x_size) + workspace_array_size(w_size) : 0;
+    workspace *ws = acquire_workspace(workspace_obj, size, &temporary);
+    if (ws == NULL) {
+        Py_CLEAR(values_array);
+        goto cleanup;
+    }
+    workspace_seed(ws, seed);
+
+    void *xw_x = x.x;
+    double *xw_w = w.x;
+    if (copy) {
+        xw_x = workspace_alloc(ws, x_size);
+        xw_w = workspace_alloc(ws, w_size);
+        if (xw_x == NULL || xw_w == NULL) {
+            release_workspace(workspace_obj, ws, &temporary);
+            PyErr_NoMemory();
+            Py_CLEAR(values_array);
+            goto cleanup;
+        }
+    }
+    double *values = (double*)PyArray_DATA(values_array);
+
+    // Call the external C function, releasing the GIL during the computation
+    Py_BEGIN_ALLOW_THREADS
+    if (copy) {
+        memcpy(xw_x, x.x, x_size);
+        memcpy(xw_w, w.x, w_size);
+    }
+    weighted_quantiles_of_type(x.type, xw_x, xw_w, x.n, qs.x, qs.n, values, &ws->random_state);
+    Py_END_ALLOW_THREADS
+
+    if (!release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
+
+cleanup:
+    release_sample(&x);
+    release_sample(&w);
+    release_sample(&qs);
+
+    return (PyObject*)values_array;
+}
+
+static PyObject *robustats_quantiles(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *qs_obj, *workspace_obj;
+    int overwrite_input;
+    uint64_t seed;
+    sample x, qs;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OOpOO&", &x_obj, &qs_obj, &overwrite_input, &workspace_obj, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input objects as data samples, the orders of the quantiles
+    // being sorted ascendingly
+    if (!parse_sample(x_obj, overwrite_input, NATIVE_NUMERIC, &x))
+        return NULL;
+    if (!parse_sample(qs_obj, 0, NATIVE_FLOAT64, &qs)) {
+        release_sample(&x);
+        return NULL;
+    }
+
+    PyArrayObject *values_array = NULL;
+    if (x.n == 0) {
+        PyErr_SetString(PyExc_ValueError, "The data sample must not be empty.");
+        goto cleanup;
+    }
+
+    npy_intp dims[1] = {(npy_intp)qs.n};
+    values_array = (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (values_array == NULL)
+        goto cleanup;
+
+    // The data sample is either partitioned in-place or copied once into the
+    // workspace, from which the selections also allocate their ranks
+    workspace temporary;
+    size_t copy_size = x.in_place ? 0 : workspace_array_size(x.n * x.item_size);
+    workspace *ws = acquire_workspace(workspace_obj, copy_size + quantiles_workspace_size(qs.n), &temporary);
+    if (ws == NULL) {
+        Py_CLEAR(values_array);
+        goto cleanup;
+    }
+    workspace_seed(ws, seed);
+    void *buffer = x.in_place ? x.x : workspace_alloc(ws, x.n * x.item_size);
+    if (buffer == NULL) {
+        release_workspace(workspace_obj, ws, &temporary);
+        PyErr_NoMemory();
+        Py_CLEAR(values_array);
+        goto cleanup;
+    }
+    double *values = (double*)PyArray_DATA(values_array);
+
+    // Call the external C function, releasing the GIL during the computation
+    Py_BEGIN_ALLOW_THREADS
+    if (buffer != x.x)
+        memcpy(buffer, x.x, x.n * x.item_size);
+    quantiles_of_type(x.type, buffer, x.n, qs.x, qs.n, values, ws);
+    Py_END_ALLOW_THREADS
+
+    if (!release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
+
+cleanup:
+    release_sample(&x);
+    release_sample(&qs);
+
+    return (PyObject*)values_array;
+}
+
+static PyObject *robustats_adjusted_boxplot(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *workspace_obj;
+    double factor;
+    Py_ssize_t n_threads;
+    uint64_t seed;
+    sample x;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OdnOO&", &x_obj, &factor, &n_threads, &workspace_obj, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input object as a data sample, which is copied by the
+    // estimator, so as to flag the outliers of the original one
+    if (!parse_sample(x_obj, 0, NATIVE_FLOATING, &x))
+        return NULL;
+
+    PyObject *ret = NULL;
+    if (x.n == 0) {
+        PyErr_SetString(PyExc_ValueError, "The data sample must not be empty.");
+        goto cleanup;
+    }
+
+    npy_intp dims[1] = {(npy_intp)x.n};
+    PyArrayObject *outliers_array = (PyArrayObject*)PyArray_SimpleNew(1, dims, NPY_BOOL);
+    if (outliers_array == NULL)
+        goto cleanup;
+
+    workspace temporary;
+    workspace *ws = acquire_workspace(workspace_obj, adjusted_boxplot_workspace_size(x.n, n_threads), &temporary);
+    if (ws == NULL) {
+        Py_DECREF(outliers_array);
+        goto cleanup;
+    }
+    workspace_seed(ws, seed);
+    uint8_t *outliers = (uint8_t*)PyArray_DATA(outliers_array);
+
+    // Call the external C function, releasing the GIL during the computation
+    double mc, bounds[4];
+    Py_BEGIN_ALLOW_THREADS
+    if (x.type == NPY_FLOAT)
+        mc = adjusted_boxplot_float32(x.x, x.n, factor, FLT_EPSILON, FLT_MIN, n_threads, bounds, outliers, ws);
+    else
+        mc = adjusted_boxplot(x.x, x.n, factor, DBL_EPSILON, DBL_MIN, n_threads, bounds, outliers, ws);
+    Py_END_ALLOW_THREADS
+
+    if (!release_workspace(workspace_obj, ws, &temporary)) {
+        Py_DECREF(outliers_array);
+        goto cleanup;
+    }
+
+    // Build the output tuple
+    ret = Py_BuildValue("dddddN", bounds[2], bounds[3], mc, bounds[0], bounds[1], outliers_array);
+
+cleanup:
+    release_sample(&x);
+
+    return ret;
+}
+
+// Estimators of samples of floating-point values, which sort them
+typedef double (*sorting_estimator)(double *x, int64_t n, workspace *ws);
+typedef double (*sorting_estimator_float32)(float *x, int64_t n, workspace *ws);
+
+// Estimate of a data sample, computed by an estimator given for each native
+// type
+static PyObject *robustats_sorting_estimator(
+    PyObject *args, sorting_estimator estimator, sorting_estimator_float32 estimator_float32,
+    size_t (*workspace_size)(int64_t n))
+{
+    PyObject *x_obj, *workspace_obj;
+    int overwrite_input;
+    uint64_t seed;
+    sample x;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OpOO&", &x_obj, &overwrite_input, &workspace_obj, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input object as a data sample
+    if (!parse_sample(x_obj, overwrite_input, NATIVE_FLOATING, &x))
+        return NULL;
+
+    // The data sample is either sorted in-place or copied once into the
+    // workspace, from which the estimator also allocates its temporary arrays
+    workspace temporary;
+    size_t copy_size = x.in_place ? 0 : workspace_array_size(x.n * x.item_size);
+    workspace *ws = acquire_workspace(workspace_obj, copy_size + workspace_size(x.n), &temporary);
+    if (ws == NULL) {
+        release_sample(&x);
+        return NULL;
+    }
+    workspace_seed(ws, seed);
+    void *buffer = x.in_place ? x.x : workspace_alloc(ws, x.n * x.item_size);
+    if (buffer == NULL) {
+        release_workspace(workspace_obj, ws, &temporary);
+        release_sample(&x);
+        return PyErr_NoMemory();
+    }
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    Py_BEGIN_ALLOW_THREADS
+    if (buffer != x.x)
+        memcpy(buffer, x.x, x.n * x.item_size);
+    if (x.type == NPY_FLOAT)
+        value = estimator_float32(buffer, x.n, ws);
+    else
+        value = estimator(buffer, x.n, ws);
+    Py_END_ALLOW_THREADS
+
+    // Clean up
+    int allocated = release_workspace(workspace_obj, ws, &temporary);
+    release_sample(&x);
+    if (!allocated)
+        return NULL;
+
+    // Build the output tuple
+    PyObject *ret = Py_BuildValue("d", value);
+    return ret;
+}
+
+static PyObject *robustats_qn(PyObject *self, PyObject *args)
+{
+    return robustats_sorting_estimator(args, qn, qn_float32, qn_workspace_size);
+}
+
+static PyObject *robustats_sn(PyObject *self, PyObject *args)
+{
+    return robustats_sorting_estimator(args, sn, sn_float32, sn_workspace_size);
+}
+
+static PyObject *robustats_hodges_lehmann(PyObject *self, PyObject *args)
+{
+    return robustats_sorting_estimator(args, hodges_lehmann, hodges_lehmann_float32, hodges_lehmann_workspace_size);
+}
+
+static PyObject *robustats_theil_sen(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *y_obj, *workspace_obj;
+    uint64_t seed;
+    sample x, y;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OOOO&", &x_obj, &y_obj, &workspace_obj, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input objects as data samples, which are copied into the
+    // workspace
+    if (!parse_sample(x_obj, 0, NATIVE_FLOAT64, &x))
+        return NULL;
+    if (!parse_sample(y_obj, 0, NATIVE_FLOAT64, &y)) {
+        release_sample(&x);
+        return NULL;
+    }
+
+    PyObject *ret = NULL;
+    if (x.n != y.n) {
+        PyErr_SetString(PyExc_ValueError, "The abscissas and the ordinates have different lengths.");
+        goto cleanup;
+    }
+
+    workspace temporary;
+    workspace *ws = acquire_workspace(workspace_obj, theil_sen_workspace_size(x.n), &temporary);
+    if (ws == NULL)
+        goto cleanup;
+    workspace_seed(ws, seed);
+
+    // Call the external C function, releasing the GIL during the computation
+    double slope, intercept;
+    Py_BEGIN_ALLOW_THREADS
+    slope = theil_sen(x.x, y.x, x.n, &intercept, ws);
+    Py_END_ALLOW_THREADS
+
+    if (!release_workspace(workspace_obj, ws, &temporary))
+        goto cleanup;
+
+    // Build the output tuple
+    ret = Py_BuildValue("dd", slope, intercept);
+
+cleanup:
+    release_sample(&x);
+    release_sample(&y);
+
+    return ret;
+}
+
+static PyObject *robustats_mad(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *workspace_obj;
+    int overwrite_input;
+    uint64_t seed;
+    sample x;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OpOO&", &x_obj, &overwrite_input, &workspace_obj, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input object as a data sample
+    if (!parse_sample(x_obj, overwrite_input, NATIVE_FLOATING, &x))
+        return NULL;
+
+    // The data sample is either overwritten by the deviations or copied once
+    // into the workspace, the selections needing no other memory
+    workspace temporary;
+    size_t copy_size = x.in_place ? 0 : workspace_array_size(x.n * x.item_size);
+    workspace *ws = acquire_workspace(workspace_obj, copy_size, &temporary);
+    if (ws == NULL) {
+        release_sample(&x);
+        return NULL;
+    }
+    workspace_seed(ws, seed);
+    void *buffer = x.in_place ? x.x : workspace_alloc(ws, x.n * x.item_size);
+    if (buffer == NULL) {
+        release_workspace(workspace_obj, ws, &temporary);
+        release_sample(&x);
+        return PyErr_NoMemory();
+    }
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    Py_BEGIN_ALLOW_THREADS
+    if (buffer != x.x)
+        memcpy(buffer, x.x, x.n * x.item_size);
+    if (x.type == NPY_FLOAT)
+        value = mad_in_place_float32(buffer, x.n, NULL, &ws->random_state);
+    else
+        value = mad_in_place(buffer, x.n, NULL, &ws->random_state);
+    Py_END_ALLOW_THREADS
+
+    // Clean up
+    int allocated = release_workspace(workspace_obj, ws, &temporary);
+    release_sample(&x);
+    if (!allocated)
+        return NULL;
+
+    // Build the output tuple
+    PyObject *ret = Py_BuildValue("d", value);
+    return ret;
+}
+
+static PyObject *robustats_weighted_median_batch(PyObject *self, PyObject *args)
+{
+    PyObject *xs_obj, *ws_obj;
+    Py_ssize_t n_threads;
+    int overwrite_input;
+    uint64_t seed;
+    batch_samples xs, ws;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OOnpO&", &xs_obj, &ws_obj, &n_threads, &overwrite_input, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input sequences as sequences of data samples
+    if (!parse_batch_samples(xs_obj, overwrite_input, &xs))
+        return NULL;
+    if (!parse_batch_samples(ws_obj, overwrite_input, &ws)) {
+        free_batch_samples(&xs);
+        return NULL;
+    }
+
+    // Check that values and weights match
+    PyObject *ret = NULL;
+    if (xs.n_samples != ws.n_samples) {
+        PyErr_SetString(PyExc_ValueError, "The numbers of data samples and of weights differ.");
+        goto cleanup;
+    }
+    for (int64_t i = 0; i < xs.n_samples; i++)
+        if (xs.samples[i].n != ws.samples[i].n) {
+            PyErr_Format(PyExc_ValueError, "The data sample %lld and its weights have different lengths.",
+                         (long long)i);
+            goto cleanup;
+        }
+    if (!check_batch_samples_not_empty(&xs))
+        goto cleanup;
+
+    batch_context batch = {&xs, &ws};
+    batch.seed = seed;
+    ret = run_batch(weighted_median_task, &batch, (int64_t)n_threads);
+
+cleanup:
+    free_batch_samples(&xs);
+    free_batch_samples(&ws);
+    return ret;
+}
+
+static PyObject *robustats_medcouple_batch(PyObject *self, PyObject *args)
+{
+    double epsilon1, epsilon2;
+    PyObject *xs_obj;
+    Py_ssize_t n_threads;
+    int overwrite_input;
+    uint64_t seed;
+    batch_samples xs;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OddnpO&", &xs_obj, &epsilon1, &epsilon2, &n_threads, &overwrite_input, parse_seed,
+                          &seed))
+        return NULL;
+
+    // Interpret the input sequence as a sequence of data samples
+    if (!parse_batch_samples(xs_obj, overwrite_input, &xs))
+        return NULL;
+
+    batch_context batch = {&xs, NULL, epsilon1, epsilon2};
+    batch.seed = seed;
+    PyObject *ret = run_batch(medcouple_task, &batch, (int64_t)n_threads);
+
+    free_batch_samples(&xs);
+    return ret;
+}
+
+static PyObject *robustats_mode_batch(PyObject *self, PyObject *args)
+{
+    PyObject *xs_obj;
+    Py_ssize_t n_threads;
+    int overwrite_input;
+    batch_samples xs;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "Onp", &xs_obj, &n_threads, &overwrite_input))
+        return NULL;
+
+    // Interpret the input sequence as a sequence of data samples
+    if (!parse_batch_samples(xs_obj, overwrite_input, &xs))
+        return NULL;
+    if (!check_batch_samples_not_empty(&xs)) {
+        free_batch_samples(&xs);
+        return NULL;
+    }
+
+    batch_context batch = {&xs};
+    PyObject *ret = run_batch(mode_task, &batch, (int64_t)n_threads);
+
+    free_batch_samples(&xs);
+    return ret;
+}
+
+// Interpret an object as an aligned numpy array of doubles, of any strides,
+// and normalize the axis along which to compute an estimator
+static PyArrayObject *parse_axis_array(PyObject *obj, int *axis)
+{
+    PyArrayObject *array = (PyArrayObject*)PyArray_FROM_OTF(obj, NPY_DOUBLE, NPY_ARRAY_ALIGNED);
+    if (array == NULL)
+        return NULL;
 
-    m = PyModule_Create(&robustatsmodule);
-    if (m == NULL)
+    if (PyArray_NDIM(array) == 0) {
+        PyErr_SetString(PyExc_ValueError, "The data sample must have at least one dimension.");
+        Py_DECREF(array);
+        return NULL;
+    }
+    if (*axis < -PyArray_NDIM(array) || *axis >= PyArray_NDIM(array)) {
+        PyErr_Format(PyExc_ValueError, "Axis %d is out of bounds for an array of dimension %d.", *axis,
+                     PyArray_NDIM(array));
+        Py_DECREF(array);
+        return NULL;
+    }
+    if (*axis < 0)
+        *axis += PyArray_NDIM(array);
+    if (PyArray_DIM(array, *axis) == 0) {
+        PyErr_SetString(PyExc_ValueError, "The data sample must not be empty along the axis.");
+        Py_DECREF(array);
         return NULL;
+    }
 
-    // Load Numpy functionality
-    import_array();
+    return array;
+}
 
-    return m;
+// Create the output array of an estimator computed along an axis, which has
+// the shape of the input array without the axis
+static PyArrayObject *new_axis_output(PyArrayObject *array, int axis)
+{
+    npy_intp dims[NPY_MAXDIMS];
+    int ndim = 0;
+
+    for (int i = 0; i < PyArray_NDIM(array); i++)
+        if (i != axis)
+            dims[ndim++] = PyArray_DIM(array, i);
+
+    return (PyArrayObject*)PyArray_SimpleNew(ndim, dims, NPY_DOUBLE);
 }
 
-static PyObject *robustats_weighted_median(PyObject *self, PyObject *args)
+// Copy a strided slice of doubles into a contiguous buffer
+static void gather(char *data, npy_intp stride, int64_t n, double *buffer)
 {
-    PyObject *x_obj, *w_obj;
+    for (int64_t i = 0; i < n; i++)
+        buffer[i] = *(double*)(data + i * stride);
+}
+
+static PyObject *robustats_weighted_median_axis(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *w_obj, *workspace_obj;
+    int axis, w_axis;
+    uint64_t seed;
 
     // Parse the input tuple
-    if (!PyArg_ParseTuple(args, "OO", &x_obj, &w_obj))
+    if (!PyArg_ParseTuple(args, "OOiOO&", &x_obj, &w_obj, &axis, &workspace_obj, parse_seed, &seed))
         return NULL;
+    w_axis = axis;
 
-    // Interpret the input objects as numpy arrays
-    PyObject *x_array = PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_IN_ARRAY);
-    PyObject *w_array = PyArray_FROM_OTF(w_obj, NPY_DOUBLE, NPY_IN_ARRAY);
+    // Interpret the input objects as numpy arrays, without copying them
+    PyArrayObject *x_array = parse_axis_array(x_obj, &axis);
+    if (x_array == NULL)
+        return NULL;
+    PyArrayObject *w_array = parse_axis_array(w_obj, &w_axis);
+    if (w_array == NULL) {
+        Py_DECREF(x_array);
+        return NULL;
+    }
+    if (!PyArray_SAMESHAPE(x_array, w_array)) {
+        PyErr_SetString(PyExc_ValueError, "The data sample and the weights have different shapes.");
+        Py_DECREF(x_array);
+        Py_DECREF(w_array);
+        return NULL;
+    }
 
-    // If that didn't work, throw an exception
-    if (x_array == NULL || w_array == NULL) {
-        Py_XDECREF(x_array);
-        Py_XDECREF(w_array);
+    PyArrayObject *values_array = new_axis_output(x_array, axis);
+    PyArrayIterObject *x_iter = (PyArrayIterObject*)PyArray_IterAllButAxis((PyObject*)x_array, &axis);
+    PyArrayIterObject *w_iter = (PyArrayIterObject*)PyArray_IterAllButAxis((PyObject*)w_array, &axis);
+
+    // Number of data points of each slice and strides along the axis
+    int64_t n = (int64_t)PyArray_DIM(x_array, axis);
+    npy_intp x_stride = PyArray_STRIDE(x_array, axis);
+    npy_intp w_stride = PyArray_STRIDE(w_array, axis);
+
+    // Buffer of values and weights in the workspace, reused for all the slices
+    workspace temporary;
+    workspace *ws = NULL;
+    double *xw = NULL;
+    if (values_array != NULL && x_iter != NULL && w_iter != NULL) {
+        ws = acquire_workspace(workspace_obj, weighted_median_workspace_size(n), &temporary);
+        if (ws != NULL) {
+            workspace_seed(ws, seed);
+            xw = workspace_alloc(ws, 2 * n * sizeof(double));
+        }
+    }
+
+    if (xw == NULL) {
+        if (ws != NULL)
+            ws->failed = 1;
+        Py_XDECREF(values_array);
+        values_array = NULL;
+        goto cleanup;
+    }
+
+    double *values = (double*)PyArray_DATA(values_array);
+
+    // Call the external C function over each slice, releasing the GIL
+    Py_BEGIN_ALLOW_THREADS
+    for (int64_t i = 0; x_iter->index < x_iter->size; i++) {
+        gather(x_iter->dataptr, x_stride, n, xw);
+        gather(w_iter->dataptr, w_stride, n, xw + n);
+        values[i] = weighted_median_in_place(xw, xw + n, 0, n - 1, &ws->random_state);
+        PyArray_ITER_NEXT(x_iter);
+        PyArray_ITER_NEXT(w_iter);
+    }
+    Py_END_ALLOW_THREADS
+
+cleanup:
+    if (ws != NULL && !release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
+    Py_XDECREF(x_iter);
+    Py_XDECREF(w_iter);
+    Py_DECREF(x_array);
+    Py_DECREF(w_array);
+
+    return values_array == NULL ? NULL : PyArray_Return(values_array);
+}
+
+static PyObject *robustats_medcouple_axis(PyObject *self, PyObject *args)
+{
+    double epsilon1, epsilon2, tolerance;
+    PyObject *x_obj, *workspace_obj;
+    int axis;
+    uint64_t seed;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OddiOO&d", &x_obj, &epsilon1, &epsilon2, &axis, &workspace_obj, parse_seed, &seed,
+                          &tolerance))
+        return NULL;
+
+    // Interpret the input object as a numpy array, without copying it
+    PyArrayObject *x_array = parse_axis_array(x_obj, &axis);
+    if (x_array == NULL)
+        return NULL;
+
+    PyArrayObject *values_array = new_axis_output(x_array, axis);
+    PyArrayIterObject *x_iter = (PyArrayIterObject*)PyArray_IterAllButAxis((PyObject*)x_array, &axis);
+
+    // Number of data points of each slice and stride along the axis
+    int64_t n = (int64_t)PyArray_DIM(x_array, axis);
+    npy_intp x_stride = PyArray_STRIDE(x_array, axis);
+
+    // Buffer of data points in the workspace, reused for all the slices, from
+    // which the estimator also allocates its temporary arrays
+    workspace temporary;
+    workspace *ws = NULL;
+    double *x = NULL;
+    if (values_array != NULL && x_iter != NULL) {
+        size_t size = workspace_array_size(n * sizeof(double)) + medcouple_workspace_size(n);
+        ws = acquire_workspace(workspace_obj, size, &temporary);
+        if (ws != NULL) {
+            workspace_seed(ws, seed);
+            x = workspace_alloc(ws, n * sizeof(double));
+        }
+    }
+
+    if (x == NULL) {
+        if (ws != NULL)
+            ws->failed = 1;
+        Py_XDECREF(values_array);
+        values_array = NULL;
+        goto cleanup;
+    }
+
+    double *values = (double*)PyArray_DATA(values_array);
+
+    // Call the external C function over each slice, releasing the GIL
+    Py_BEGIN_ALLOW_THREADS
+    for (int64_t i = 0; x_iter->index < x_iter->size; i++) {
+        gather(x_iter->dataptr, x_stride, n, x);
+        if (tolerance > 0.)
+            values[i] = medcouple_approximate(x, n, epsilon1, epsilon2, tolerance, ws);
+        else
+            values[i] = medcouple(x, n, epsilon1, epsilon2, ws);
+        PyArray_ITER_NEXT(x_iter);
+    }
+    Py_END_ALLOW_THREADS
+
+cleanup:
+    if (ws != NULL && !release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
+    Py_XDECREF(x_iter);
+    Py_DECREF(x_array);
+
+    return values_array == NULL ? NULL : PyArray_Return(values_array);
+}
+
+static PyObject *robustats_mode_axis(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *workspace_obj;
+    int axis;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OiO", &x_obj, &axis, &workspace_obj))
+        return NULL;
+
+    // Interpret the input object as a numpy array, without copying it
+    PyArrayObject *x_array = parse_axis_array(x_obj, &axis);
+    if (x_array == NULL)
+        return NULL;
+
+    PyArrayObject *values_array = new_axis_output(x_array, axis);
+    PyArrayIterObject *x_iter = (PyArrayIterObject*)PyArray_IterAllButAxis((PyObject*)x_array, &axis);
+
+    // Number of data points of each slice and stride along the axis
+    int64_t n = (int64_t)PyArray_DIM(x_array, axis);
+    npy_intp x_stride = PyArray_STRIDE(x_array, axis);
+
+    // Buffer of data points in the workspace, reused for all the slices, from
+    // which the sort also allocates its buffer
+    workspace temporary;
+    workspace *ws = NULL;
+    double *x = NULL;
+    if (values_array != NULL && x_iter != NULL) {
+        size_t size = workspace_array_size(n * sizeof(double)) + mode_workspace_size(n);
+        ws = acquire_workspace(workspace_obj, size, &temporary);
+        if (ws != NULL)
+            x = workspace_alloc(ws, n * sizeof(double));
+    }
+
+    if (x == NULL) {
+        if (ws != NULL)
+            ws->failed = 1;
+        Py_XDECREF(values_array);
+        values_array = NULL;
+        goto cleanup;
+    }
+
+    double *values = (double*)PyArray_DATA(values_array);
+
+    // Call the external C function over each slice, releasing the GIL
+    Py_BEGIN_ALLOW_THREADS
+    for (int64_t i = 0; x_iter->index < x_iter->size; i++) {
+        gather(x_iter->dataptr, x_stride, n, x);
+        values[i] = mode(x, n, ws);
+        PyArray_ITER_NEXT(x_iter);
+    }
+    Py_END_ALLOW_THREADS
+
+cleanup:
+    if (ws != NULL && !release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
+    Py_XDECREF(x_iter);
+    Py_DECREF(x_array);
+
+    return values_array == NULL ? NULL : PyArray_Return(values_array);
+}
+
+static PyObject *robustats_mad_axis(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *workspace_obj;
+    int axis;
+    uint64_t seed;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OiOO&", &x_obj, &axis, &workspace_obj, parse_seed, &seed))
+        return NULL;
+
+    // Interpret the input object as a numpy array, without copying it
+    PyArrayObject *x_array = parse_axis_array(x_obj, &axis);
+    if (x_array == NULL)
         return NULL;
+
+    PyArrayObject *values_array = new_axis_output(x_array, axis);
+    PyArrayIterObject *x_iter = (PyArrayIterObject*)PyArray_IterAllButAxis((PyObject*)x_array, &axis);
+
+    // Number of data points of each slice and stride along the axis
+    int64_t n = (int64_t)PyArray_DIM(x_array, axis);
+    npy_intp x_stride = PyArray_STRIDE(x_array, axis);
+
+    // Buffer of data points in the workspace, reused for all the slices
+    workspace temporary;
+    workspace *ws = NULL;
+    double *x = NULL;
+    if (values_array != NULL && x_iter != NULL) {
+        ws = acquire_workspace(workspace_obj, workspace_array_size(n * sizeof(double)), &temporary);
+        if (ws != NULL) {
+            workspace_seed(ws, seed);
+            x = workspace_alloc(ws, n * sizeof(double));
+        }
+    }
+
+    if (x == NULL) {
+        if (ws != NULL)
+            ws->failed = 1;
+        Py_XDECREF(values_array);
+        values_array = NULL;
+        goto cleanup;
+    }
+
+    double *values = (double*)PyArray_DATA(values_array);
+
+    // Call the external C function over each slice, releasing the GIL
+    Py_BEGIN_ALLOW_THREADS
+    for (int64_t i = 0; x_iter->index < x_iter->size; i++) {
+        gather(x_iter->dataptr, x_stride, n, x);
+        values[i] = mad_in_place(x, n, NULL, &ws->random_state);
+        PyArray_ITER_NEXT(x_iter);
+    }
+    Py_END_ALLOW_THREADS
+
+cleanup:
+    if (ws != NULL && !release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
+    Py_XDECREF(x_iter);
+    Py_DECREF(x_array);
+
+    return values_array == NULL ? NULL : PyArray_Return(values_array);
+}
+
+static PyObject *robustats_robust_zscore(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *out_obj, *axis_obj, *workspace_obj;
+    double scale;
+    int axis = 0;
+    uint64_t seed;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OOOdOO&", &x_obj, &out_obj, &axis_obj, &scale, &workspace_obj, parse_seed, &seed))
+        return NULL;
+    if (axis_obj != Py_None) {
+        axis = (int)PyLong_AsLong(axis_obj);
+        if (axis == -1 && PyErr_Occurred())
+            return NULL;
+    }
+
+    // Interpret the input object as a numpy array, without copying it, and
+    // the whole array as a single slice if no axis is given
+    PyArrayObject *x_array = parse_axis_array(x_obj, &axis);
+    if (x_array == NULL)
+        return NULL;
+
+    // Output array of the shape of the input array, given or created
+    PyArrayObject *out_array = NULL;
+    if (out_obj != Py_None) {
+        if (!PyArray_Check(out_obj) || PyArray_TYPE((PyArrayObject*)out_obj) != NPY_DOUBLE ||
+            !PyArray_ISWRITEABLE((PyArrayObject*)out_obj) || !PyArray_ISALIGNED((PyArrayObject*)out_obj) ||
+            !PyArray_SAMESHAPE(x_array, (PyArrayObject*)out_obj)) {
+            PyErr_SetString(PyExc_ValueError,
+                            "The output must be a writeable array of float64 of the shape of the data sample.");
+            Py_DECREF(x_array);
+            return NULL;
+        }
+        out_array = (PyArrayObject*)out_obj;
+        Py_INCREF(out_array);
+    }
+    else {
+        out_array = (PyArrayObject*)PyArray_SimpleNew(PyArray_NDIM(x_array), PyArray_DIMS(x_array), NPY_DOUBLE);
+        if (out_array == NULL) {
+            Py_DECREF(x_array);
+            return NULL;
+        }
+    }
+
+    // Slices along the axis, or a single slice of all the data points, and
+    // number of data points of each slice
+    PyArrayIterObject *x_iter, *out_iter;
+    int64_t n;
+    if (axis_obj != Py_None) {
+        x_iter = (PyArrayIterObject*)PyArray_IterAllButAxis((PyObject*)x_array, &axis);
+        out_iter = (PyArrayIterObject*)PyArray_IterAllButAxis((PyObject*)out_array, &axis);
+        n = (int64_t)PyArray_DIM(x_array, axis);
+    }
+    else {
+        x_iter = (PyArrayIterObject*)PyArray_IterNew((PyObject*)x_array);
+        out_iter = (PyArrayIterObject*)PyArray_IterNew((PyObject*)out_array);
+        n = (int64_t)PyArray_SIZE(x_array);
+    }
+
+    // Buffer of data points in the workspace, reused for all the slices
+    workspace temporary;
+    workspace *ws = NULL;
+    double *x = NULL;
+    if (x_iter != NULL && out_iter != NULL) {
+        ws = acquire_workspace(workspace_obj, workspace_array_size(n * sizeof(double)), &temporary);
+        if (ws != NULL) {
+            workspace_seed(ws, seed);
+            x = workspace_alloc(ws, n * sizeof(double));
+        }
+    }
+
+    if (x == NULL) {
+        if (ws != NULL)
+            ws->failed = 1;
+        Py_CLEAR(out_array);
+        goto cleanup;
+    }
+
+    // Call the external C function over each slice, releasing the GIL
+    Py_BEGIN_ALLOW_THREADS
+    if (axis_obj != Py_None) {
+        npy_intp x_stride = PyArray_STRIDE(x_array, axis);
+        npy_intp out_stride = PyArray_STRIDE(out_array, axis);
+        while (x_iter->index < x_iter->size) {
+            double median;
+            gather(x_iter->dataptr, x_stride, n, x);
+            double deviation = scale * mad_in_place(x, n, &median, &ws->random_state);
+            for (int64_t i = 0; i < n; i++)
+                *(double*)(out_iter->dataptr + i * out_stride) =
+                    (*(double*)(x_iter->dataptr + i * x_stride) - median) / deviation;
+            PyArray_ITER_NEXT(x_iter);
+            PyArray_ITER_NEXT(out_iter);
+        }
     }
+    else {
+        double median;
+        for (int64_t i = 0; i < n; i++) {
+            x[i] = *(double*)x_iter->dataptr;
+            PyArray_ITER_NEXT(x_iter);
+        }
+        double deviation = scale * mad_in_place(x, n, &median, &ws->random_state);
+        PyArray_ITER_RESET(x_iter);
+        for (int64_t i = 0; i < n; i++) {
+            *(double*)out_iter->dataptr = (*(double*)x_iter->dataptr - median) / deviation;
+            PyArray_ITER_NEXT(x_iter);
+            PyArray_ITER_NEXT(out_iter);
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+cleanup:
+    if (ws != NULL && !release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(out_array);
+    Py_XDECREF(x_iter);
+    Py_XDECREF(out_iter);
+    Py_DECREF(x_array);
+
+    return (PyObject*)out_array;
+}
+
+static PyObject *robustats_rolling_medcouple(PyObject *self, PyObject *args)
+{
+    double epsilon1, epsilon2;
+    PyObject *x_obj, *workspace_obj;
+    Py_ssize_t window;
+    uint64_t seed;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OddnOO&", &x_obj, &epsilon1, &epsilon2, &window, &workspace_obj, parse_seed,
+                          &seed))
+        return NULL;
+
+    // Interpret the input object as a numpy array
+    PyObject *x_array = PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+
+    // If that didn't work, throw an exception
+    if (x_array == NULL)
+        return NULL;
 
     // Number of data points
-    int64_t n = (int64_t)PyArray_DIM(x_array, 0);
+    int64_t n = (int64_t)PyArray_SIZE((PyArrayObject*)x_array);
+
+    if (window < 1 || window > n) {
+        PyErr_SetString(PyExc_ValueError, "The window must be between 1 and the length of the data sample.");
+        Py_DECREF(x_array);
+        return NULL;
+    }
+
+    // Create the output array
+    npy_intp dims[1] = {(npy_intp)(n - window + 1)};
+    PyObject *values_array = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (values_array == NULL) {
+        Py_DECREF(x_array);
+        return NULL;
+    }
 
     // Get pointers to the data as C-types
-    double *x = (double*)PyArray_DATA(x_array);
-    double *w = (double*)PyArray_DATA(w_array);
+    double *x = (double*)PyArray_DATA((PyArrayObject*)x_array);
+    double *values = (double*)PyArray_DATA((PyArrayObject*)values_array);
+
+    // Acquire the workspace of the temporary arrays
+    workspace temporary;
+    workspace *ws = acquire_workspace(workspace_obj, rolling_medcouple_workspace_size((int64_t)window), &temporary);
+    if (ws == NULL) {
+        Py_DECREF(x_array);
+        Py_DECREF(values_array);
+        return NULL;
+    }
+    workspace_seed(ws, seed);
 
-    // Call the external C function to compute the chi-squared
-    double value = weighted_median(x, w, 0, n - 1);
+    // Call the external C function, releasing the GIL during the computation
+    Py_BEGIN_ALLOW_THREADS
+    rolling_medcouple(x, n, (int64_t)window, epsilon1, epsilon2, values, ws);
+    Py_END_ALLOW_THREADS
 
     // Clean up
+    if (!release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
     Py_DECREF(x_array);
-    Py_DECREF(w_array);
 
-    // Build the output tuple
-    PyObject *ret = Py_BuildValue("d", value);
-    return ret;
+    return values_array;
 }
 
-static PyObject *robustats_medcouple(PyObject *self, PyObject *args)
+static PyObject *robustats_rolling_weighted_median(PyObject *self, PyObject *args)
 {
-    double epsilon1, epsilon2;
-    PyObject *x_obj;
+    PyObject *x_obj, *w_obj, *workspace_obj;
+    Py_ssize_t window;
 
     // Parse the input tuple
-    if (!PyArg_ParseTuple(args, "Odd", &x_obj, &epsilon1, &epsilon2))
+    if (!PyArg_ParseTuple(args, "OOnO", &x_obj, &w_obj, &window, &workspace_obj))
         return NULL;
 
     // Interpret the input objects as numpy arrays
-    PyObject *x_array = PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_IN_ARRAY);
+    PyObject *x_array = PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+    PyObject *w_array = PyArray_FROM_OTF(w_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
 
     // If that didn't work, throw an exception
-    if (x_array == NULL) {
+    if (x_array == NULL || w_array == NULL) {
         Py_XDECREF(x_array);
+        Py_XDECREF(w_array);
         return NULL;
     }
 
     // Number of data points
-    int64_t n = (int64_t)PyArray_DIM(x_array, 0);
+    int64_t n = (int64_t)PyArray_SIZE((PyArrayObject*)x_array);
+
+    PyObject *values_array = NULL;
+    if (PyArray_SIZE((PyArrayObject*)w_array) != n) {
+        PyErr_SetString(PyExc_ValueError, "The data sample and the weights have different lengths.");
+        goto cleanup;
+    }
+    if (window < 1 || window > n) {
+        PyErr_SetString(PyExc_ValueError, "The window must be between 1 and the length of the data sample.");
+        goto cleanup;
+    }
+
+    // Create the output array
+    npy_intp dims[1] = {(npy_intp)(n - window + 1)};
+    values_array = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (values_array == NULL)
+        goto cleanup;
 
     // Get pointers to the data as C-types
-    double *x = (double*)PyArray_DATA(x_array);
+    double *x = (double*)PyArray_DATA((PyArrayObject*)x_array);
+    double *w = (double*)PyArray_DATA((PyArrayObject*)w_array);
+    double *values = (double*)PyArray_DATA((PyArrayObject*)values_array);
 
-    // Call the external C function to compute the chi-squared
-    double value = medcouple(x, n, epsilon1, epsilon2);
+    // Acquire the workspace of the temporary arrays
+    workspace temporary;
+    workspace *ws = acquire_workspace(workspace_obj, rolling_weighted_median_workspace_size(n), &temporary);
+    if (ws == NULL) {
+        Py_DECREF(values_array);
+        values_array = NULL;
+        goto cleanup;
+    }
 
-    // Clean up
+    // Call the external C function, releasing the GIL during the computation
+    Py_BEGIN_ALLOW_THREADS
+    rolling_weighted_median(x, w, n, (int64_t)window, values, ws);
+    Py_END_ALLOW_THREADS
+
+    if (!release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
+
+cleanup:
     Py_DECREF(x_array);
+    Py_DECREF(w_array);
 
-    // Build the output tuple
-    PyObject *ret = Py_BuildValue("d", value);
-    return ret;
+    return values_array;
 }
 
-static PyObject *robustats_mode(PyObject *self, PyObject *args)
+static PyObject *robustats_rolling_mode(PyObject *self, PyObject *args)
 {
-    PyObject *x_obj;
+    PyObject *x_obj, *workspace_obj;
+    Py_ssize_t window;
 
     // Parse the input tuple
-    if (!PyArg_ParseTuple(args, "O", &x_obj))
+    if (!PyArg_ParseTuple(args, "OnO", &x_obj, &window, &workspace_obj))
         return NULL;
 
-    // Interpret the input objects as numpy arrays
-    PyObject *x_array = PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_IN_ARRAY);
+    // Interpret the input object as a numpy array
+    PyObject *x_array = PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
 
     // If that didn't work, throw an exception
-    if (x_array == NULL) {
-        Py_XDECREF(x_array);
+    if (x_array == NULL)
         return NULL;
-    }
 
     // Number of data points
-    int64_t n = (int64_t)PyArray_DIM(x_array, 0);
+    int64_t n = (int64_t)PyArray_SIZE((PyArrayObject*)x_array);
+
+    if (window < 1 || window > n) {
+        PyErr_SetString(PyExc_ValueError, "The window must be between 1 and the length of the data sample.");
+        Py_DECREF(x_array);
+        return NULL;
+    }
+
+    // Create the output array
+    npy_intp dims[1] = {(npy_intp)(n - window + 1)};
+    PyObject *values_array = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+    if (values_array == NULL) {
+        Py_DECREF(x_array);
+        return NULL;
+    }
 
     // Get pointers to the data as C-types
-    double *x = (double*)PyArray_DATA(x_array);
+    double *x = (double*)PyArray_DATA((PyArrayObject*)x_array);
+    double *values = (double*)PyArray_DATA((PyArrayObject*)values_array);
+
+    // Acquire the workspace of the sorted window
+    workspace temporary;
+    workspace *ws = acquire_workspace(workspace_obj, rolling_mode_workspace_size((int64_t)window), &temporary);
+    if (ws == NULL) {
+        Py_DECREF(x_array);
+        Py_DECREF(values_array);
+        return NULL;
+    }
 
-    // Call the external C function to compute the chi-squared
-    double value = mode(x, n);
+    // Call the external C function, releasing the GIL during the computation
+    Py_BEGIN_ALLOW_THREADS
+    rolling_mode(x, n, (int64_t)window, values, ws);
+    Py_END_ALLOW_THREADS
 
     // Clean up
+    if (!release_workspace(workspace_obj, ws, &temporary))
+        Py_CLEAR(values_array);
     Py_DECREF(x_array);
 
-    // Build the output tuple
-    PyObject *ret = Py_BuildValue("d", value);
+    return values_array;
+}
+
+// Data sample that does not fit in memory, read from a file of raw native
+// float64 values given its path, or from an object exposing its values, such
+// as a memory-mapped array, which is then read without copying it if it is a
+// contiguous array of float64 values
+typedef struct {
+    external_array a;
+    sample x;
+} external_sample;
+
+// Interpret an object as a data sample that does not fit in memory. The sample
+// is released with function 'release_external_sample'.
+static int parse_external_sample(PyObject *obj, external_sample *x)
+{
+    x->a.file = NULL;
+    x->a.data = NULL;
+    x->x.array = NULL;
+    x->x.view.obj = NULL;
+    x->x.scratch = SCRATCH_NONE;
+
+    if (!PyUnicode_Check(obj) && !PyBytes_Check(obj)) {
+        if (!parse_sample(obj, 0, NATIVE_FLOAT64, &x->x))
+            return 0;
+        x->a.data = x->x.x;
+        x->a.n = x->x.n;
+        return 1;
+    }
+
+    PyObject *path;
+    if (!PyUnicode_FSConverter(obj, &path))
+        return 0;
+    x->a.file = fopen(PyBytes_AS_STRING(path), "rb");
+    Py_DECREF(path);
+    if (x->a.file == NULL) {
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, obj);
+        return 0;
+    }
+
+    int64_t size = external_file_size(x->a.file);
+    if (size < 0 || size % (int64_t)sizeof(double) != 0) {
+        PyErr_SetString(PyExc_ValueError, "The file of the data sample does not hold float64 values.");
+        fclose(x->a.file);
+        return 0;
+    }
+    x->a.n = size / (int64_t)sizeof(double);
+
+    return 1;
+}
+
+static void release_external_sample(external_sample *x)
+{
+    if (x->a.file != NULL)
+        fclose(x->a.file);
+    else
+        release_sample(&x->x);
+}
+
+// Raise the exception of a failed estimator over samples that do not fit in
+// memory
+static void set_external_error(int status)
+{
+    if (status == EXTERNAL_ERROR_MEMORY)
+        PyErr_NoMemory();
+    else if (status == EXTERNAL_ERROR_SIZE)
+        PyErr_SetString(PyExc_ValueError, "The data sample has too many pairs of data points for the medcouple.");
+    else
+        PyErr_SetString(PyExc_OSError, "Cannot read the data sample or write the scratch files.");
+}
+
+// Open the scratch files of an estimator, emptying them
+static int open_scratch_files(PyObject **paths, FILE **scratch)
+{
+    for (int i = 0; i < 2; i++) {
+        PyObject *path;
+        if (!PyUnicode_FSConverter(paths[i], &path))
+            return 0;
+        scratch[i] = fopen(PyBytes_AS_STRING(path), "w+b");
+        Py_DECREF(path);
+        if (scratch[i] == NULL) {
+            PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, paths[i]);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void close_scratch_files(FILE **scratch)
+{
+    for (int i = 0; i < 2; i++)
+        if (scratch[i] != NULL)
+            fclose(scratch[i]);
+}
+
+static PyObject *robustats_weighted_median_external(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *w_obj;
+    Py_ssize_t memory;
+    uint64_t seed;
+    external_sample x, w;
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OOnO&", &x_obj, &w_obj, &memory, parse_seed, &seed))
+        return NULL;
+
+    // Open the files or interpret the input objects as data samples
+    if (!parse_external_sample(x_obj, &x))
+        return NULL;
+    if (!parse_external_sample(w_obj, &w)) {
+        release_external_sample(&x);
+        return NULL;
+    }
+
+    PyObject *ret = NULL;
+    if (x.a.n != w.a.n) {
+        PyErr_SetString(PyExc_ValueError, "The data sample and the weights have different lengths.");
+        goto cleanup;
+    }
+
+    uint64_t random_state;
+    random_seed(&random_state, seed);
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = weighted_median_external(&x.a, &w.a, (size_t)memory, &value, &random_state);
+    Py_END_ALLOW_THREADS
+
+    if (status != EXTERNAL_OK)
+        set_external_error(status);
+    else
+        ret = Py_BuildValue("d", value);
+
+cleanup:
+    release_external_sample(&x);
+    release_external_sample(&w);
+    return ret;
+}
+
+static PyObject *robustats_mode_external(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *scratch_objs[2];
+    Py_ssize_t memory;
+    external_sample x;
+    FILE *scratch[2] = {NULL, NULL};
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OnOO", &x_obj, &memory, &scratch_objs[0], &scratch_objs[1]))
+        return NULL;
+
+    // Open the file or interpret the input object as a data sample
+    if (!parse_external_sample(x_obj, &x))
+        return NULL;
+
+    PyObject *ret = NULL;
+    if (!open_scratch_files(scratch_objs, scratch))
+        goto cleanup;
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = mode_external(&x.a, scratch, (size_t)memory, &value);
+    Py_END_ALLOW_THREADS
+
+    if (status != EXTERNAL_OK)
+        set_external_error(status);
+    else
+        ret = Py_BuildValue("d", value);
+
+cleanup:
+    close_scratch_files(scratch);
+    release_external_sample(&x);
+    return ret;
+}
+
+static PyObject *robustats_medcouple_external(PyObject *self, PyObject *args)
+{
+    PyObject *x_obj, *scratch_objs[2];
+    Py_ssize_t memory;
+    uint64_t seed;
+    external_sample x;
+    FILE *scratch[2] = {NULL, NULL};
+
+    // Parse the input tuple
+    if (!PyArg_ParseTuple(args, "OnOOO&", &x_obj, &memory, &scratch_objs[0], &scratch_objs[1], parse_seed, &seed))
+        return NULL;
+
+    // Open the file or interpret the input object as a data sample
+    if (!parse_external_sample(x_obj, &x))
+        return NULL;
+
+    PyObject *ret = NULL;
+    if (!open_scratch_files(scratch_objs, scratch))
+        goto cleanup;
+
+    uint64_t random_state;
+    random_seed(&random_state, seed);
+
+    // Call the external C function, releasing the GIL during the computation
+    double value;
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = medcouple_external(&x.a, scratch, (size_t)memory, &value, &random_state);
+    Py_END_ALLOW_THREADS
+
+    if (status != EXTERNAL_OK)
+        set_external_error(status);
+    else
+        ret = Py_BuildValue("d", value);
+
+cleanup:
+    close_scratch_files(scratch);
+    release_external_sample(&x);
     return ret;
 }
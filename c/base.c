@@ -1,6 +1,8 @@
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "base.h"
 
 /**
@@ -95,32 +97,6 @@ void swap(double *x, int64_t i, int64_t j)
    x[j] = temp;
 }
 
-/**
- * Swap two columns of a 2D array.
- * 
- * For example, swapping the first and second columns of
- * {{1, 4}, {2, 5}, {3, 6}}
- * gives
- * {{2, 5}, {1, 4}, {3, 6}}
- * 
- * Arguments:
- *    x: 2D array.
- *    n2: Length of the 2D array along the second axis.
- *    i: First row of elements to swap.
- *    j: Second row of elements to swap.
- */
-void swap_2d(double **x, int64_t n2, int64_t i, int64_t j)
-{
-   double temp;
-
-   for (int64_t k = 0; k < n2; k++)
-   {
-      temp = x[i][k];
-      x[i][k] = x[j][k];
-      x[j][k] = temp;
-   }
-}
-
 /**
  * Compare two elements of an array to be sorted ascendingly.
  * 
@@ -172,82 +148,86 @@ int compare_descending(const void *i, const void* j)
 }
 
 /**
- * Compare two elements of a 2D array to be sorted ascendingly in the first axis.
+ * Seed a pseudo-random number generator.
  * 
- * This function can be used in combination with qsort to sort a 2D array.
+ * The seed is scrambled with a splitmix64 step, so that close seeds, such as
+ * consecutive indices, give unrelated sequences, and so that the state is
+ * never zero.
  * 
  * Arguments:
- *    i: First 1D array.
- *    j: Second 1D array.
- *    k: Element along the second axis of the array to compare.
- * 
- * Returns:
- *    Floor difference between the k-th element of the i-th and j-th 1D arrays.
+ *    state: State of the generator.
+ *    seed: Seed.
  */
-int compare_ascending_2d(const void *i, const void *j, int64_t k)
+void random_seed(uint64_t *state, uint64_t seed)
 {
-   double *a = *(double **)i;
-   double *b = *(double **)j;
+   uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
 
-   if (a[k] > b[k])
-      return 1;
-   else if (a[k] < b[k])
-      return -1;
-   else
-      return 0;
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   z ^= z >> 31;
+
+   *state = z != 0 ? z : 0x9E3779B97F4A7C15ULL;
 }
 
 /**
- * Compare two elements of a 2D array to be sorted descendingly in the first axis.
+ * Returns the next pseudo-random number of a xorshift64* generator.
  * 
- * This function can be used in combination with qsort to sort a 2D array.
+ * Unlike rand(), the generator has no global state, so that each thread or
+ * workspace can own one, without locks, and its sequence does not depend on
+ * the other users of the generator.
  * 
  * Arguments:
- *    i: First 1D array.
- *    j: Second 1D array.
- *    k: Element along the second axis of the array to compare.
+ *    state: State of the generator, seeded with function 'random_seed'.
  * 
  * Returns:
- *    Floor difference between the k-th element of the j-th and i-th 1D arrays.
+ *    Pseudo-random number uniformly distributed over 64 bits.
  */
-int compare_descending_2d(const void *i, const void *j, int64_t k)
+uint64_t random_next(uint64_t *state)
 {
-   double *a = *(double **)i;
-   double *b = *(double **)j;
-
-   if (a[k] > b[k])
-      return -1;
-   else if (a[k] < b[k])
-      return 1;
-   else
-      return 0;
+   *state ^= *state >> 12;
+   *state ^= *state << 25;
+   *state ^= *state >> 27;
+   return *state * 0x2545F4914F6CDD1DULL;
 }
 
 /**
- * Returns a random double in range [0, 1).
+ * Returns a random integer between 'begin' and 'end', extremes included.
+ * 
+ * Arguments:
+ *    state: State of the generator, seeded with function 'random_seed'.
+ *    begin: Lowest integer.
+ *    end: Highest integer.
  */
-double random_0_to_1()
+int64_t random_range(uint64_t *state, int64_t begin, int64_t end)
 {
-   return (double)rand() / (double)RAND_MAX;
+   // The 53 highest bits, as a double in range [0, 1)
+   double r = (double)(random_next(state) >> 11) / 9007199254740992.;
+   return begin + (int64_t)(r * (double)(end - begin + 1));
 }
 
 /**
- * Returns a random integer between 'begin' and 'end', extremes included.
+ * Fill an array of integers with a single value.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    value: Value to fill the array with.
  */
-int64_t random_range(int64_t begin, int64_t end)
+void fill_array_int(int64_t *x, int64_t n, int64_t value)
 {
-   return begin + (int64_t)(random_0_to_1() * (end - begin + 1));
+   for (int64_t i = 0; i < n; i++)
+      x[i] = value;
 }
 
 /**
- * Fill an array of integers with a single value.
+ * Fill an array of doubles with a single value.
  * 
  * Arguments:
  *    x: Array.
  *    n: Length of the array.
  *    value: Value to fill the array with.
  */
-void fill_array_int(int64_t *x, int64_t n, int64_t value)
+void fill_array_double(double *x, int64_t n, double value)
 {
    for (int64_t i = 0; i < n; i++)
       x[i] = value;
@@ -268,71 +248,316 @@ void copy_array_int(int64_t *x, int64_t *y, int64_t n)
 }
 
 /**
- * Zip two arrays of the same length.
+ * Search the position of a value in an array sorted descendingly.
+ * 
+ * Arguments:
+ *    x: Array sorted descendingly.
+ *    n: Length of the array.
+ *    value: Value to search.
+ * 
+ * Returns:
+ *    Index of the first element lower than or equal to the value, or n if all
+ *       the elements are greater than the value.
+ */
+int64_t search_sorted_descending(double *x, int64_t n, double value)
+{
+   int64_t begin = 0;
+   int64_t end = n;
+   int64_t middle;
+
+   while (begin < end)
+   {
+      middle = begin + (end - begin) / 2;
+
+      if (x[middle] > value)
+         begin = middle + 1;
+      else
+         end = middle;
+   }
+
+   return begin;
+}
+
+/**
+ * Replace an element of an array sorted descendingly, keeping it sorted.
+ * 
+ * Only the elements between the positions of the old and of the new value are
+ * shifted, so that the array stays sorted.
  * 
- * Example:
- *    array_a = {1, 2, 3}
- *    array_b = {4, 5, 6}
- *    zipped_array = {{1, 4}, {2, 5}, {3, 6}}
+ * For example, replacing 6 with 2 in
+ * {9, 7, 6, 4, 3, 1}
+ * gives
+ * {9, 7, 4, 3, 2, 1}
+ * 
+ * Arguments:
+ *    x: Array sorted descendingly.
+ *    n: Length of the array.
+ *    old_value: Value to remove, which must be in the array.
+ *    new_value: Value to insert.
+ */
+void replace_sorted_descending(double *x, int64_t n, double old_value, double new_value)
+{
+   int64_t i = search_sorted_descending(x, n, old_value);
+   int64_t j;
+
+   if (new_value > old_value)
+   {
+      // Shift right the elements between the new and the old positions
+      j = search_sorted_descending(x, i, new_value);
+      memmove(x + j + 1, x + j, (i - j) * sizeof(double));
+      x[j] = new_value;
+   }
+   else
+   {
+      // Shift left the elements between the old and the new positions
+      j = i + 1 + search_sorted_descending(x + i + 1, n - i - 1, new_value);
+      memmove(x + i, x + i + 1, (j - i - 1) * sizeof(double));
+      x[j - 1] = new_value;
+   }
+}
+
+/**
+ * Search the position of a value in an array sorted ascendingly.
  * 
  * Arguments:
- *    array_a: First array.
- *    array_b: Second array.
+ *    x: Array sorted ascendingly.
  *    n: Length of the array.
+ *    value: Value to search.
  * 
  * Returns:
- *    Zipped array.
+ *    Index of the first element greater than or equal to the value, or n if
+ *       all the elements are lower than the value.
  */
-double **zip(double *array_a, double *array_b, int64_t n)
+int64_t search_sorted_ascending(double *x, int64_t n, double value)
 {
-   double **zip_arr = (double**)malloc(n * sizeof(double*));
+   int64_t begin = 0;
+   int64_t end = n;
+   int64_t middle;
+
+   while (begin < end)
+   {
+      middle = begin + (end - begin) / 2;
 
-   for(int64_t i = 0; i < n; i++) {
-      zip_arr[i] = (double*)malloc(2 * sizeof(double));
-      zip_arr[i][0] = array_a[i];
-      zip_arr[i][1] = array_b[i];
+      if (x[middle] < value)
+         begin = middle + 1;
+      else
+         end = middle;
    }
 
-   return zip_arr;
+   return begin;
 }
 
 /**
- * Free the memory allocated the a zipped array.
+ * Replace an element of an array sorted ascendingly, keeping it sorted.
+ * 
+ * Only the elements between the positions of the old and of the new value are
+ * shifted, so that the array stays sorted.
+ * 
+ * For example, replacing 6 with 2 in
+ * {1, 3, 4, 6, 7, 9}
+ * gives
+ * {1, 2, 3, 4, 7, 9}
  * 
  * Arguments:
- *    zip_arr: Zipped array obtained with function 'zip' above.
- *    n: Length of the zipped array.
+ *    x: Array sorted ascendingly.
+ *    n: Length of the array.
+ *    old_value: Value to remove, which must be in the array.
+ *    new_value: Value to insert.
  */
-void free_zip_memory(double **zip_array, int64_t n)
+void replace_sorted_ascending(double *x, int64_t n, double old_value, double new_value)
 {
-   for (int64_t i = 0; i < n; i++)
-      free(zip_array[i]);
+   int64_t i = search_sorted_ascending(x, n, old_value);
+   int64_t j;
 
-   free(zip_array);
+   if (new_value < old_value)
+   {
+      // Shift right the elements between the new and the old positions
+      j = search_sorted_ascending(x, i, new_value);
+      memmove(x + j + 1, x + j, (i - j) * sizeof(double));
+      x[j] = new_value;
+   }
+   else
+   {
+      // Shift left the elements between the old and the new positions
+      j = i + 1 + search_sorted_ascending(x + i + 1, n - i - 1, new_value);
+      memmove(x + i, x + i + 1, (j - i - 1) * sizeof(double));
+      x[j - 1] = new_value;
+   }
 }
 
 /**
- * Partition an array according to a value.
+ * Number of leaves of a sum tree holding a given number of values.
  * 
- * The partition function rearranges an array in-place into a region lower than
- * the value and a region greater than or equal to the value.
+ * A sum tree is a complete binary tree stored in an array of twice its number
+ * of leaves, where the element 1 is the root, the children of element i are
+ * elements 2i and 2i + 1, and the leaves start at the number of leaves. Each
+ * node holds the sum of its children.
  * 
- * For example, partitioning
- * {6, 1, 2, 4, 3, 5, 3}
- * according to value 3 gives
- * {1, 2, 6, 4, 3, 5, 3}
- * and the function returns index 2 along the array.
+ * Arguments:
+ *    n: Number of values.
+ * 
+ * Returns:
+ *    Lowest power of two greater than or equal to n.
+ */
+int64_t sum_tree_size(int64_t n)
+{
+   int64_t size = 1;
+
+   while (size < n)
+      size *= 2;
+
+   return size;
+}
+
+/**
+ * Set a value of a sum tree, updating the sums of its ancestors.
+ * 
+ * The sums are computed again from the children, rather than updated by
+ * difference, so that removing a value does not leave rounding residuals.
  * 
  * Arguments:
- *    x: Array.
- *    begin: Index where to begin partitioning.
- *    end: Index where to end partitioning.
- *    value: Value of the pivot around which to partition the array.
+ *    tree: Sum tree.
+ *    size: Number of leaves of the sum tree.
+ *    i: Index of the value.
+ *    value: New value.
+ */
+void sum_tree_set(double *tree, int64_t size, int64_t i, double value)
+{
+   i += size;
+   tree[i] = value;
+
+   for (i /= 2; i >= 1; i /= 2)
+      tree[i] = tree[2 * i] + tree[2 * i + 1];
+}
+
+/**
+ * Search the first value of a sum tree whose cumulative sum reaches a target.
+ * 
+ * Arguments:
+ *    tree: Sum tree of non-negative values.
+ *    size: Number of leaves of the sum tree.
+ *    target: Positive target of the cumulative sum, not greater than the sum
+ *       of all the values.
  * 
  * Returns:
- *    Starting index of the region greater than or equal to the pivot.
+ *    Lowest index of the values whose cumulative sum is greater than or equal
+ *       to the target.
  */
-int64_t partition_on_value(double *x, int64_t begin, int64_t end, double value)
+int64_t sum_tree_search(double *tree, int64_t size, double target)
+{
+   int64_t i = 1;
+
+   while (i < size)
+   {
+      if (tree[2 * i] >= target)
+         i = 2 * i;
+      else
+      {
+         target -= tree[2 * i];
+         i = 2 * i + 1;
+      }
+   }
+
+   return i - size;
+}
+
+/**
+ * Search the first value of a sum tree whose cumulative sum exceeds a target.
+ * 
+ * Arguments:
+ *    tree: Sum tree of non-negative values.
+ *    size: Number of leaves of the sum tree.
+ *    target: Non-negative target of the cumulative sum, lower than the sum of
+ *       all the values.
+ * 
+ * Returns:
+ *    Lowest index of the values whose cumulative sum is greater than the
+ *       target.
+ */
+int64_t sum_tree_search_above(double *tree, int64_t size, double target)
+{
+   int64_t i = 1;
+
+   while (i < size)
+   {
+      if (tree[2 * i] > target)
+         i = 2 * i;
+      else
+      {
+         target -= tree[2 * i];
+         i = 2 * i + 1;
+      }
+   }
+
+   return i - size;
+}
+
+/**
+ * Cumulative sum of the values of a sum tree up to a given index.
+ * 
+ * Arguments:
+ *    tree: Sum tree.
+ *    size: Number of leaves of the sum tree.
+ *    i: Index of the last value of the sum.
+ * 
+ * Returns:
+ *    Sum of the values of indices from 0 to i.
+ */
+double sum_tree_cumulative(double *tree, int64_t size, int64_t i)
+{
+   i += size;
+   double sum = tree[i];
+
+   for (; i > 1; i /= 2)
+      if (i % 2 == 1)
+         sum += tree[i - 1];
+
+   return sum;
+}
+
+/**
+ * Rank of the weighted median of function 'weighted_median' when the
+ * cumulative weight of its lower weighted median is exactly half of the total
+ * weight.
+ * 
+ * Function 'weighted_median' bisects the ranks of the sorted data sample,
+ * keeping the upper half while the weight below its middle element is at most
+ * half of the total weight, down to two elements, of which it returns the
+ * lower one. On such a tie, it keeps the upper half at every middle rank up to
+ * that of the next value of positive weight, so that its result only depends
+ * on that rank. It lies between the lower weighted median and that next value.
+ * 
+ * Arguments:
+ *    n: Length of the data sample.
+ *    next: Rank of the lowest value of positive weight above the lower
+ *       weighted median.
+ * 
+ * Returns:
+ *    Rank of the weighted median, in ascending order of the values.
+ */
+int64_t weighted_median_tie_rank(int64_t n, int64_t next)
+{
+   int64_t begin = 0;
+   int64_t end = n - 1;
+
+   while (end - begin > 1)
+   {
+      int64_t middle = begin + (end - begin) / 2;
+      if (middle <= next)
+         begin = middle;
+      else
+         end = middle;
+   }
+
+   return begin;
+}
+
+/**
+ * Partition an array according to a value, one element at a time.
+ * 
+ * See function 'partition_on_value'.
+ */
+static int64_t partition_on_value_scalar(double *x, int64_t begin, int64_t end, double value)
 {
    int64_t i = begin;
    int64_t j = begin;
@@ -352,100 +577,506 @@ int64_t partition_on_value(double *x, int64_t begin, int64_t end, double value)
 }
 
 /**
- * Partition an array around a pivot given by its k-th element.
+ * Partition an array of floats according to a value, one element at a time.
  * 
- * The partition function rearranges an array in-place into a region lower than
- * the pivot value and a region greater than the pivot value, separated by the
- * pivot.
+ * See function 'partition_on_value'.
+ */
+static int64_t partition_on_value_float32_scalar(float *x, int64_t begin, int64_t end, float value)
+{
+   int64_t i = begin;
+   int64_t j = begin;
+   float temp;
+
+   while (i <= end)
+   {
+      if (x[i] < value)
+      {
+         temp = x[j];
+         x[j] = x[i];
+         x[i] = temp;
+         j++;
+      }
+
+      i++;
+   }
+
+   return j;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PARTITION_SIMD
+#include <immintrin.h>
+
+/*
+ * Vectorized partitions.
  * 
- * For example, partitioning
- * {6, 1, 2, 4, 3, 5, 3}
- * according to value of the 4-th element, which is 3, gives
- * {1, 2, 3, 4, 3, 5, 6}
- * and the function returns index 2 along the array.
+ * The vectorized partitions rearrange an array of n elements in-place without
+ * branches, one vector of W elements at a time: the elements of each vector
+ * that are lower than the value are written, contiguously, at the end of the
+ * lower region growing from the beginning of the array, and the other ones at
+ * the beginning of the upper region growing from the end of the array.
  * 
- * Arguments:
- *    x: Array.
- *    begin: Index where to begin partitioning.
- *    end: Index where to end partitioning.
- *    k: Position in the array of the element to use as a pivot around which to
- *       partition the array.
+ * The first and the last vectors of the array are loaded beforehand, so that
+ * there are 2W free positions between the written regions and the unread
+ * elements. Vectors are then read from the side with fewer free positions, so
+ * that both sides have at least W free positions when the vector is written.
+ * The elements left over, fewer than W, are partitioned one at a time, and the
+ * first and the last vectors are written last, in the 2W free positions left.
+ */
+
+// Permutations of the lanes of a vector of 4 doubles, as pairs of lanes of 32
+// bits, moving the lanes of each 4-bit mask first and the others last
+static const int32_t partition_permutations_pd[16][8] = {
+   {0, 1, 2, 3, 4, 5, 6, 7},
+   {0, 1, 2, 3, 4, 5, 6, 7},
+   {2, 3, 0, 1, 4, 5, 6, 7},
+   {0, 1, 2, 3, 4, 5, 6, 7},
+   {4, 5, 0, 1, 2, 3, 6, 7},
+   {0, 1, 4, 5, 2, 3, 6, 7},
+   {2, 3, 4, 5, 0, 1, 6, 7},
+   {0, 1, 2, 3, 4, 5, 6, 7},
+   {6, 7, 0, 1, 2, 3, 4, 5},
+   {0, 1, 6, 7, 2, 3, 4, 5},
+   {2, 3, 6, 7, 0, 1, 4, 5},
+   {0, 1, 2, 3, 6, 7, 4, 5},
+   {4, 5, 6, 7, 0, 1, 2, 3},
+   {0, 1, 4, 5, 6, 7, 2, 3},
+   {2, 3, 4, 5, 6, 7, 0, 1},
+   {0, 1, 2, 3, 4, 5, 6, 7}
+};
+
+// Permutations of the lanes of a vector of 4 floats, moving the lanes of each
+// 4-bit mask first and the others last
+static const int32_t partition_permutations_ps[16][4] = {
+   {0, 1, 2, 3},
+   {0, 1, 2, 3},
+   {1, 0, 2, 3},
+   {0, 1, 2, 3},
+   {2, 0, 1, 3},
+   {0, 2, 1, 3},
+   {1, 2, 0, 3},
+   {0, 1, 2, 3},
+   {3, 0, 1, 2},
+   {0, 3, 1, 2},
+   {1, 3, 0, 2},
+   {0, 1, 3, 2},
+   {2, 3, 0, 1},
+   {0, 2, 3, 1},
+   {1, 2, 3, 0},
+   {0, 1, 2, 3}
+};
+
+// Masks of the last 4 - k lanes of a vector of 4 elements of 64 and 32 bits
+static const int64_t partition_upper_masks_pd[5][4] = {
+   {-1, -1, -1, -1},
+   {0, -1, -1, -1},
+   {0, 0, -1, -1},
+   {0, 0, 0, -1},
+   {0, 0, 0, 0}
+};
+static const int32_t partition_upper_masks_ps[5][4] = {
+   {-1, -1, -1, -1},
+   {0, -1, -1, -1},
+   {0, 0, -1, -1},
+   {0, 0, 0, -1},
+   {0, 0, 0, 0}
+};
+
+/**
+ * Partition the elements left over by a vectorized partition, fewer than a
+ * vector, one at a time.
+ */
+static void partition_left_over(
+   double *x, int64_t left, int64_t right, double value, int64_t *lower, int64_t *upper)
+{
+   double left_over[8];
+
+   memcpy(left_over, x + left, (right - left) * sizeof(double));
+   for (int64_t i = 0; i < right - left; i++)
+   {
+      if (left_over[i] < value)
+         x[(*lower)++] = left_over[i];
+      else
+         x[--(*upper)] = left_over[i];
+   }
+}
+
+/**
+ * Partition the elements of floats left over by a vectorized partition, fewer
+ * than a vector, one at a time.
+ */
+static void partition_left_over_float32(
+   float *x, int64_t left, int64_t right, float value, int64_t *lower, int64_t *upper)
+{
+   float left_over[16];
+
+   memcpy(left_over, x + left, (right - left) * sizeof(float));
+   for (int64_t i = 0; i < right - left; i++)
+   {
+      if (left_over[i] < value)
+         x[(*lower)++] = left_over[i];
+      else
+         x[--(*upper)] = left_over[i];
+   }
+}
+
+/**
+ * Write a vector of 4 doubles into the lower and the upper regions.
+ */
+__attribute__((target("avx2")))
+static inline void partition_vector_avx2(
+   double *x, __m256d v, __m256d pivot, int64_t *lower, int64_t *upper)
+{
+   int mask = _mm256_movemask_pd(_mm256_cmp_pd(v, pivot, _CMP_LT_OQ));
+   int k = __builtin_popcount(mask);
+
+   __m256i permutation = _mm256_loadu_si256((const __m256i *)partition_permutations_pd[mask]);
+   __m256d p = _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(v), permutation));
+
+   _mm256_storeu_pd(x + *lower, p);
+   _mm256_maskstore_pd(
+      x + *upper - 4, _mm256_loadu_si256((const __m256i *)partition_upper_masks_pd[k]), p);
+
+   *lower += k;
+   *upper -= 4 - k;
+}
+
+/**
+ * Partition an array according to a value with AVX2 instructions.
  * 
- * Returns:
- *    Index of the pivot, separating the lower and the higher regions.
+ * See function 'partition_on_value'.
  */
-int64_t partition_on_kth_element(double *x, int64_t begin, int64_t end, int64_t k)
+__attribute__((target("avx2")))
+static int64_t partition_on_value_avx2(double *x, int64_t begin, int64_t end, double value)
 {
-   double value = x[k];
+   int64_t n = end - begin + 1;
+   if (n < 8)
+      return partition_on_value_scalar(x, begin, end, value);
 
-   swap(x, k, end);
+   x += begin;
+   __m256d pivot = _mm256_set1_pd(value);
+   __m256d first = _mm256_loadu_pd(x);
+   __m256d last = _mm256_loadu_pd(x + n - 4);
 
-   int64_t i = begin;
-   for (int64_t j = begin; j < end; j++)
+   int64_t left = 4, right = n - 4;  // Unread elements
+   int64_t lower = 0, upper = n;  // Ends of the lower and of the upper regions
+   __m256d v;
+
+   while (right - left >= 4)
    {
-      if (x[j] < value)
+      if (left - lower <= upper - right)
+      {
+         v = _mm256_loadu_pd(x + left);
+         left += 4;
+      }
+      else
       {
-         swap(x, i, j);
-         i++;
+         right -= 4;
+         v = _mm256_loadu_pd(x + right);
       }
+      partition_vector_avx2(x, v, pivot, &lower, &upper);
    }
 
-   swap(x, i, end);
+   partition_left_over(x, left, right, value, &lower, &upper);
+   partition_vector_avx2(x, first, pivot, &lower, &upper);
+   partition_vector_avx2(x, last, pivot, &lower, &upper);
 
-   return i;
+   return begin + lower;
 }
 
 /**
- * Partition a 2D array around a pivot given by its k-th element.
- * 
- * The partition function rearranges an array in-place into a region lower than
- * the pivot value and a region greater than the pivot value, separated by the
- * pivot.
+ * Write a vector of 4 floats into the lower and the upper regions.
+ */
+__attribute__((target("avx2")))
+static inline void partition_vector_float32_avx2(
+   float *x, __m128 v, __m128 pivot, int64_t *lower, int64_t *upper)
+{
+   int mask = _mm_movemask_ps(_mm_cmp_ps(v, pivot, _CMP_LT_OQ));
+   int k = __builtin_popcount(mask);
+
+   __m128 p = _mm_permutevar_ps(v, _mm_loadu_si128((const __m128i *)partition_permutations_ps[mask]));
+
+   _mm_storeu_ps(x + *lower, p);
+   _mm_maskstore_ps(x + *upper - 4, _mm_loadu_si128((const __m128i *)partition_upper_masks_ps[k]), p);
+
+   *lower += k;
+   *upper -= 4 - k;
+}
+
+/**
+ * Partition an array of floats according to a value with AVX2 instructions.
  * 
- * For example, partitioning
- * {{6, 0}, {1, 1}, {2, 2}, {4, 3}, {3, 4}, {5, 5}, {3, 6}}
- * according to value of the 4-th element, which is {3, 4}, gives
- * {{1, 1}, {2, 2}, {3, 4}, {4, 3}, {3, 6}, {5, 5}, {6, 0}}
- * and the function returns index 2 along the array.
+ * See function 'partition_on_value'.
+ */
+__attribute__((target("avx2")))
+static int64_t partition_on_value_float32_avx2(float *x, int64_t begin, int64_t end, float value)
+{
+   int64_t n = end - begin + 1;
+   if (n < 8)
+      return partition_on_value_float32_scalar(x, begin, end, value);
+
+   x += begin;
+   __m128 pivot = _mm_set1_ps(value);
+   __m128 first = _mm_loadu_ps(x);
+   __m128 last = _mm_loadu_ps(x + n - 4);
+
+   int64_t left = 4, right = n - 4;  // Unread elements
+   int64_t lower = 0, upper = n;  // Ends of the lower and of the upper regions
+   __m128 v;
+
+   while (right - left >= 4)
+   {
+      if (left - lower <= upper - right)
+      {
+         v = _mm_loadu_ps(x + left);
+         left += 4;
+      }
+      else
+      {
+         right -= 4;
+         v = _mm_loadu_ps(x + right);
+      }
+      partition_vector_float32_avx2(x, v, pivot, &lower, &upper);
+   }
+
+   partition_left_over_float32(x, left, right, value, &lower, &upper);
+   partition_vector_float32_avx2(x, first, pivot, &lower, &upper);
+   partition_vector_float32_avx2(x, last, pivot, &lower, &upper);
+
+   return begin + lower;
+}
+
+/**
+ * Write a vector of 8 doubles into the lower and the upper regions.
+ */
+__attribute__((target("avx512f")))
+static inline void partition_vector_avx512(
+   double *x, __m512d v, __m512d pivot, int64_t *lower, int64_t *upper)
+{
+   __mmask8 mask = _mm512_cmp_pd_mask(v, pivot, _CMP_LT_OQ);
+   int k = __builtin_popcount(mask);
+
+   _mm512_mask_storeu_pd(x + *lower, (__mmask8)((1u << k) - 1), _mm512_maskz_compress_pd(mask, v));
+   _mm512_mask_storeu_pd(
+      x + *upper - (8 - k), (__mmask8)((1u << (8 - k)) - 1), _mm512_maskz_compress_pd((__mmask8)~mask, v));
+
+   *lower += k;
+   *upper -= 8 - k;
+}
+
+/**
+ * Partition an array according to a value with AVX-512 instructions.
  * 
- * Arguments:
- *    x: 2D array.
- *    begin: Index along the first axis where to begin partitioning.
- *    end: Index along the first axis where to end partitioning.
- *    m: Position along the columns (second axis) of the array over which to
- *       carry out the partition.
- *    n2: Length of the array along the second axis.
- *    k: Position along the first axis of the array of the element to use as a
- *       pivot around which to partition the array.
+ * See function 'partition_on_value'.
+ */
+__attribute__((target("avx512f")))
+static int64_t partition_on_value_avx512(double *x, int64_t begin, int64_t end, double value)
+{
+   int64_t n = end - begin + 1;
+   if (n < 16)
+      return partition_on_value_scalar(x, begin, end, value);
+
+   x += begin;
+   __m512d pivot = _mm512_set1_pd(value);
+   __m512d first = _mm512_loadu_pd(x);
+   __m512d last = _mm512_loadu_pd(x + n - 8);
+
+   int64_t left = 8, right = n - 8;  // Unread elements
+   int64_t lower = 0, upper = n;  // Ends of the lower and of the upper regions
+   __m512d v;
+
+   while (right - left >= 8)
+   {
+      if (left - lower <= upper - right)
+      {
+         v = _mm512_loadu_pd(x + left);
+         left += 8;
+      }
+      else
+      {
+         right -= 8;
+         v = _mm512_loadu_pd(x + right);
+      }
+      partition_vector_avx512(x, v, pivot, &lower, &upper);
+   }
+
+   partition_left_over(x, left, right, value, &lower, &upper);
+   partition_vector_avx512(x, first, pivot, &lower, &upper);
+   partition_vector_avx512(x, last, pivot, &lower, &upper);
+
+   return begin + lower;
+}
+
+/**
+ * Write a vector of 16 floats into the lower and the upper regions.
+ */
+__attribute__((target("avx512f")))
+static inline void partition_vector_float32_avx512(
+   float *x, __m512 v, __m512 pivot, int64_t *lower, int64_t *upper)
+{
+   __mmask16 mask = _mm512_cmp_ps_mask(v, pivot, _CMP_LT_OQ);
+   int k = __builtin_popcount(mask);
+
+   _mm512_mask_storeu_ps(x + *lower, (__mmask16)((1u << k) - 1), _mm512_maskz_compress_ps(mask, v));
+   _mm512_mask_storeu_ps(
+      x + *upper - (16 - k), (__mmask16)((1u << (16 - k)) - 1), _mm512_maskz_compress_ps((__mmask16)~mask, v));
+
+   *lower += k;
+   *upper -= 16 - k;
+}
+
+/**
+ * Partition an array of floats according to a value with AVX-512
+ * instructions.
  * 
- * Returns:
- *    Index of the pivot, separating the lower and the higher regions.
+ * See function 'partition_on_value'.
  */
-int64_t partition_on_kth_element_2d(double **x, int64_t begin, int64_t end, int64_t n2, int64_t m, int64_t k)
+__attribute__((target("avx512f")))
+static int64_t partition_on_value_float32_avx512(float *x, int64_t begin, int64_t end, float value)
 {
-   double value = x[k][m];
+   int64_t n = end - begin + 1;
+   if (n < 32)
+      return partition_on_value_float32_scalar(x, begin, end, value);
 
-   swap_2d(x, n2, k, end);
+   x += begin;
+   __m512 pivot = _mm512_set1_ps(value);
+   __m512 first = _mm512_loadu_ps(x);
+   __m512 last = _mm512_loadu_ps(x + n - 16);
 
-   int64_t i = begin;
-   for (int64_t j = begin; j < end; j++)
+   int64_t left = 16, right = n - 16;  // Unread elements
+   int64_t lower = 0, upper = n;  // Ends of the lower and of the upper regions
+   __m512 v;
+
+   while (right - left >= 16)
    {
-      if (x[j][m] < value)
+      if (left - lower <= upper - right)
+      {
+         v = _mm512_loadu_ps(x + left);
+         left += 16;
+      }
+      else
       {
-         swap_2d(x, n2, i, j);
-         i++;
+         right -= 16;
+         v = _mm512_loadu_ps(x + right);
       }
+      partition_vector_float32_avx512(x, v, pivot, &lower, &upper);
    }
 
-   swap_2d(x, n2, i, end);
+   partition_left_over_float32(x, left, right, value, &lower, &upper);
+   partition_vector_float32_avx512(x, first, pivot, &lower, &upper);
+   partition_vector_float32_avx512(x, last, pivot, &lower, &upper);
 
-   return i;
+   return begin + lower;
 }
 
+#endif
+
 /**
- * Partition an array around a pivot given by its k-th smallest element.
+ * Returns the most efficient instruction set supported by the processor for
+ * the vectorized kernels, detected at runtime.
  * 
- * This function returns the value of the k-th smallest element.
+ * Returns:
+ *    INSTRUCTION_SET_AVX512, INSTRUCTION_SET_AVX2 or INSTRUCTION_SET_SCALAR.
+ */
+int supported_instruction_set()
+{
+#ifdef PARTITION_SIMD
+   if (__builtin_cpu_supports("avx512f"))
+      return INSTRUCTION_SET_AVX512;
+   if (__builtin_cpu_supports("avx2"))
+      return INSTRUCTION_SET_AVX2;
+#endif
+   return INSTRUCTION_SET_SCALAR;
+}
+
+/**
+ * Partition an array according to a value, with a given instruction set.
+ * 
+ * See function 'partition_on_value'. Instruction sets that are not supported
+ * by the processor must not be used.
+ * 
+ * Arguments:
+ *    instruction_set: Instruction set, as returned by function
+ *       'supported_instruction_set', or a less efficient one.
+ *    x: Array.
+ *    begin: Index where to begin partitioning.
+ *    end: Index where to end partitioning.
+ *    value: Value of the pivot around which to partition the array.
+ * 
+ * Returns:
+ *    Starting index of the region greater than or equal to the pivot.
+ */
+int64_t partition_on_value_using(int instruction_set, double *x, int64_t begin, int64_t end, double value)
+{
+#ifdef PARTITION_SIMD
+   if (instruction_set == INSTRUCTION_SET_AVX512)
+      return partition_on_value_avx512(x, begin, end, value);
+   if (instruction_set == INSTRUCTION_SET_AVX2)
+      return partition_on_value_avx2(x, begin, end, value);
+#endif
+   return partition_on_value_scalar(x, begin, end, value);
+}
+
+/**
+ * Partition an array of floats according to a value, with a given instruction
+ * set.
+ * 
+ * See function 'partition_on_value_using'.
+ */
+int64_t partition_on_value_float32_using(int instruction_set, float *x, int64_t begin, int64_t end, float value)
+{
+#ifdef PARTITION_SIMD
+   if (instruction_set == INSTRUCTION_SET_AVX512)
+      return partition_on_value_float32_avx512(x, begin, end, value);
+   if (instruction_set == INSTRUCTION_SET_AVX2)
+      return partition_on_value_float32_avx2(x, begin, end, value);
+#endif
+   return partition_on_value_float32_scalar(x, begin, end, value);
+}
+
+/**
+ * Partition an array according to a value.
+ * 
+ * The partition function rearranges an array in-place into a region lower than
+ * the value and a region greater than or equal to the value. The order of the
+ * elements within each region is unspecified.
+ * 
+ * For example, partitioning
+ * {6, 1, 2, 4, 3, 5, 3}
+ * according to value 3 gives, for instance,
+ * {1, 2, 6, 4, 3, 5, 3}
+ * and the function returns index 2 along the array.
+ * 
+ * The partition is vectorized with the most efficient instruction set
+ * supported by the processor, among AVX-512 and AVX2, falling back to a scalar
+ * partition on other processors.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    begin: Index where to begin partitioning.
+ *    end: Index where to end partitioning.
+ *    value: Value of the pivot around which to partition the array.
+ * 
+ * Returns:
+ *    Starting index of the region greater than or equal to the pivot.
+ */
+int64_t partition_on_value(double *x, int64_t begin, int64_t end, double value)
+{
+   return partition_on_value_using(supported_instruction_set(), x, begin, end, value);
+}
+
+/**
+ * Partition an array of floats according to a value.
+ * 
+ * See function 'partition_on_value'.
+ */
+int64_t partition_on_value_float32(float *x, int64_t begin, int64_t end, float value)
+{
+   return partition_on_value_float32_using(supported_instruction_set(), x, begin, end, value);
+}
+
+/**
+ * Partition an array around a pivot given by its k-th element.
  * 
  * The partition function rearranges an array in-place into a region lower than
  * the pivot value and a region greater than the pivot value, separated by the
@@ -453,37 +1084,109 @@ int64_t partition_on_kth_element_2d(double **x, int64_t begin, int64_t end, int6
  * 
  * For example, partitioning
  * {6, 1, 2, 4, 3, 5, 3}
- * according to value of the 5-th smallest element gives
+ * according to value of the 4-th element, which is 3, gives
  * {1, 2, 3, 4, 3, 5, 6}
- * and the function returns 5, which is the pivot and the 5-th smallest element.
+ * and the function returns index 2 along the array.
  * 
  * Arguments:
  *    x: Array.
  *    begin: Index where to begin partitioning.
  *    end: Index where to end partitioning.
- *    k: Number denoting the k-th smallest element.
+ *    k: Position in the array of the element to use as a pivot around which to
+ *       partition the array.
  * 
  * Returns:
- *    Value of the pivot, separating the lower and the higher regions. The
- *       pivot is the k-th smallest element of the array.
+ *    Index of the pivot, separating the lower and the higher regions.
  */
-double partition_on_kth_smallest(double *x, int64_t begin, int64_t end, int64_t k)
+int64_t partition_on_kth_element(double *x, int64_t begin, int64_t end, int64_t k)
 {
-   while (1)
+   double value = x[k];
+
+   swap(x, k, end);
+   int64_t i = partition_on_value(x, begin, end - 1, value);
+   swap(x, i, end);
+
+   return i;
+}
+
+/**
+ * Partition an array into three regions around a value: lower than, equal to,
+ * and greater than the value.
+ * 
+ * For example, partitioning
+ * {6, 1, 3, 4, 3, 5, 2}
+ * according to value 3 gives, for instance,
+ * {1, 2, 3, 3, 6, 4, 5}
+ * with the region equal to the value between indices 2 and 3.
+ * 
+ * The values lower than the value are separated first, then the values lower
+ * than or equal to it, that is, lower than the next representable value, both
+ * with the vectorized partition of function 'partition_on_value'.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    begin: Index where to begin partitioning.
+ *    end: Index where to end partitioning.
+ *    value: Value of the pivot around which to partition the array.
+ *    lower: Output starting index of the region equal to the value.
+ *    upper: Output ending index of the region equal to the value.
+ */
+void partition_three_way(double *x, int64_t begin, int64_t end, double value, int64_t *lower, int64_t *upper)
+{
+   *lower = partition_on_value(x, begin, end, value);
+   *upper = partition_on_value(x, *lower, end, nextafter(value, INFINITY)) - 1;
+
+   // Infinite or NaN pivots have no next value, all the remaining values being
+   // equal to them
+   if (*upper < *lower)
+      *upper = end;
+}
+
+/**
+ * Partition an array of floats into three regions around a value.
+ * 
+ * See function 'partition_three_way'.
+ */
+void partition_three_way_float32(float *x, int64_t begin, int64_t end, float value, int64_t *lower, int64_t *upper)
+{
+   *lower = partition_on_value_float32(x, begin, end, value);
+   *upper = partition_on_value_float32(x, *lower, end, nextafterf(value, INFINITY)) - 1;
+
+   if (*upper < *lower)
+      *upper = end;
+}
+
+/**
+ * Pivot of an array given by the median of medians of groups of 5 elements,
+ * which is greater than and lower than at least 30% of the elements each.
+ * 
+ * The medians of the groups are moved to the beginning of the array, where
+ * their median is selected.
+ * 
+ * Returns:
+ *    Index of the pivot.
+ */
+static int64_t median_of_medians(double *x, int64_t begin, int64_t end, uint64_t *random_state)
+{
+   int64_t n_groups = 0;
+
+   for (int64_t i = begin; i <= end; i += 5)
    {
-      if (begin == end)
-         return x[begin];
+      int64_t last = i + 4 <= end ? i + 4 : end;
 
-      int64_t pivot_index = random_range(begin, end);
-      pivot_index = partition_on_kth_element(x, begin, end, pivot_index);
+      // Insertion sort of the group
+      for (int64_t j = i + 1; j <= last; j++)
+         for (int64_t l = j; l > i && x[l] < x[l - 1]; l--)
+            swap(x, l, l - 1);
 
-      if (k == pivot_index)
-         return x[k];
-      else if (k < pivot_index)
-         end = pivot_index - 1;
-      else
-         begin = pivot_index + 1; 
+      swap(x, begin + n_groups, i + (last - i) / 2);
+      n_groups++;
    }
+
+   int64_t median_index = begin + (n_groups - 1) / 2;
+   partition_on_kth_smallest(x, begin, begin + n_groups - 1, median_index, random_state);
+
+   return median_index;
 }
 
 /**
@@ -492,8 +1195,8 @@ double partition_on_kth_smallest(double *x, int64_t begin, int64_t end, int64_t
  * This function returns the value of the k-th smallest element.
  * 
  * The partition function rearranges an array in-place into a region lower than
- * the pivot value and a region greater than the pivot value, separated by the
- * pivot.
+ * the pivot value and a region greater than or equal to the pivot value,
+ * starting with the pivot.
  * 
  * For example, partitioning
  * {6, 1, 2, 4, 3, 5, 3}
@@ -501,36 +1204,48 @@ double partition_on_kth_smallest(double *x, int64_t begin, int64_t end, int64_t
  * {1, 2, 3, 4, 3, 5, 6}
  * and the function returns 5, which is the pivot and the 5-th smallest element.
  * 
+ * This is an introselect: pivots are chosen at random, with three-way
+ * partitions that exclude all the duplicates of the pivot at once, while the
+ * number of elements partitioned remains within a linear budget, after which
+ * pivots are chosen by the median of medians. The selection is thus linear in
+ * the worst case, including on adversarial inputs.
+ * 
  * Arguments:
- *    x: 2D array.
- *    n1: Length of the array along the first axis.
- *    n2: Length of the array along the second axis.
- *    begin: Index along the first axis where to begin partitioning.
- *    end: Index along the first axis where to end partitioning.
- *    m: Position along the columns (second axis) of the array over which to
- *       carry out the partition.
- *    k: Number denoting the k-th smallest element along the m-th row.
+ *    x: Array.
+ *    begin: Index where to begin partitioning.
+ *    end: Index where to end partitioning.
+ *    k: Number denoting the k-th smallest element.
+ *    random_state: State of the generator of the pivots.
  * 
  * Returns:
  *    Value of the pivot, separating the lower and the higher regions. The
- *       pivot is the k-th smallest element of the m-th row of the array.
+ *       pivot is the k-th smallest element of the array.
  */
-double partition_on_kth_smallest_2d(double **x, int64_t begin, int64_t end, int64_t n2, int64_t m, int64_t k)
+double partition_on_kth_smallest(double *x, int64_t begin, int64_t end, int64_t k, uint64_t *random_state)
 {
+   int64_t budget = SELECTION_BUDGET * (end - begin + 1);
+   int64_t pivot_index, lower, upper;
+
    while (1)
    {
       if (begin == end)
-         return x[begin][m];
+         return x[begin];
+
+      if (budget > 0)
+         pivot_index = random_range(random_state, begin, end);
+      else
+         pivot_index = median_of_medians(x, begin, end, random_state);
+      budget -= end - begin + 1;
 
-      int64_t pivot_index = random_range(begin, end);
-      pivot_index = partition_on_kth_element_2d(x, begin, end, n2, m, pivot_index);
+      double value = x[pivot_index];
+      partition_three_way(x, begin, end, value, &lower, &upper);
 
-      if (k == pivot_index)
-         return x[k][m];
-      else if (k < pivot_index)
-         end = pivot_index - 1;
+      if (k < lower)
+         end = lower - 1;
+      else if (k > upper)
+         begin = upper + 1;
       else
-         begin = pivot_index + 1;
+         return value;
    }
 }
 
@@ -541,19 +1256,23 @@ double partition_on_kth_smallest_2d(double **x, int64_t begin, int64_t end, int6
  *    x: Array.
  *    n: Length of the array.
  *    k: Number of the smallest element to look for in the array.
+ *    random_state: State of the generator of the pivots.
  * 
  * Returns:
- *    K-th smallest element of the array.
+ *    K-th smallest element of the array, or NaN if the memory of its copy
+ *       could not be allocated.
  */
-double select_kth_smallest(double *x, int64_t n, int64_t k)
+double select_kth_smallest(double *x, int64_t n, int64_t k, uint64_t *random_state)
 {
    double *x_copy = malloc(n * sizeof(double));
+   if (x_copy == NULL)
+      return NAN;
    for (int64_t i = 0; i < n; i++)
    {
       x_copy[i] = x[i];
    }
 
-   double kth_smallest = partition_on_kth_smallest(x_copy, 0, n - 1, k);
+   double kth_smallest = partition_on_kth_smallest(x_copy, 0, n - 1, k, random_state);
    free(x_copy);
 
    return kth_smallest;
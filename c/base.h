@@ -5,23 +5,46 @@ double sign(double x);
 int64_t sum_int(int64_t *x, int64_t n);
 double sum_double(double *x, int64_t n);
 void swap(double *x, int64_t i, int64_t j);
-void swap_2d(double **x, int64_t n2, int64_t i, int64_t j);
 int compare_ascending(const void *i, const void *j);
 int compare_descending(const void *i, const void *j);
-int compare_ascending_2d(const void *i, const void *j, int64_t k);
-int compare_descending_2d(const void *i, const void *j, int64_t k);
 
-double random_0_to_1();
-int64_t random_range(int64_t begin, int64_t end);
+// Seed of the generators of the pivots when none is given
+#define RANDOM_DEFAULT_SEED 0
+
+void random_seed(uint64_t *state, uint64_t seed);
+uint64_t random_next(uint64_t *state);
+int64_t random_range(uint64_t *state, int64_t begin, int64_t end);
 
 void fill_array_int(int64_t *x, int64_t n, int64_t value);
+void fill_array_double(double *x, int64_t n, double value);
 void copy_array_int(int64_t *x, int64_t *y, int64_t n);
-double **zip(double *array_a, double *array_b, int64_t n);
-void free_zip_memory(double **zip_array, int64_t n);
+int64_t search_sorted_descending(double *x, int64_t n, double value);
+void replace_sorted_descending(double *x, int64_t n, double old_value, double new_value);
+int64_t search_sorted_ascending(double *x, int64_t n, double value);
+void replace_sorted_ascending(double *x, int64_t n, double old_value, double new_value);
+int64_t sum_tree_size(int64_t n);
+void sum_tree_set(double *tree, int64_t size, int64_t i, double value);
+int64_t sum_tree_search(double *tree, int64_t size, double target);
+int64_t sum_tree_search_above(double *tree, int64_t size, double target);
+double sum_tree_cumulative(double *tree, int64_t size, int64_t i);
+int64_t weighted_median_tie_rank(int64_t n, int64_t next);
+
+#define INSTRUCTION_SET_SCALAR 0
+#define INSTRUCTION_SET_AVX2 1
+#define INSTRUCTION_SET_AVX512 2
 
+int supported_instruction_set();
+int64_t partition_on_value_using(int instruction_set, double *x, int64_t begin, int64_t end, double value);
+int64_t partition_on_value_float32_using(int instruction_set, float *x, int64_t begin, int64_t end, float value);
 int64_t partition_on_value(double *x, int64_t begin, int64_t end, double value);
+int64_t partition_on_value_float32(float *x, int64_t begin, int64_t end, float value);
+void partition_three_way(double *x, int64_t begin, int64_t end, double value, int64_t *lower, int64_t *upper);
+void partition_three_way_float32(float *x, int64_t begin, int64_t end, float value, int64_t *lower, int64_t *upper);
 int64_t partition_on_kth_element(double *x, int64_t begin, int64_t end, int64_t k);
-int64_t partition_on_kth_element_2d(double **x, int64_t begin, int64_t end, int64_t n2, int64_t m, int64_t k);
-double partition_on_kth_smallest(double *x, int64_t begin, int64_t end, int64_t k);
-double partition_on_kth_smallest_2d(double **x, int64_t begin, int64_t end, int64_t n2, int64_t m, int64_t k);
-double select_kth_smallest(double *x, int64_t n, int64_t k);
+
+// Number of elements, relative to the length of the array, that the selections
+// may partition around random pivots before choosing them by median of medians
+#define SELECTION_BUDGET 4
+
+double partition_on_kth_smallest(double *x, int64_t begin, int64_t end, int64_t k, uint64_t *random_state);
+double select_kth_smallest(double *x, int64_t n, int64_t k, uint64_t *random_state);
@@ -0,0 +1,112 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "counters.h"
+
+#ifdef ROBUSTATS_COUNTERS
+// Counters attached to each thread, into which its work is recorded
+COUNTERS_THREAD_LOCAL counters *attached_counters = NULL;
+#endif
+
+/**
+ * Whether the library records the counters, that is, whether it was compiled
+ * with ROBUSTATS_COUNTERS defined.
+ * 
+ * Returns:
+ *    1 if the counters are recorded, 0 otherwise.
+ */
+int counters_enabled()
+{
+#ifdef ROBUSTATS_COUNTERS
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+/**
+ * Set all the counters to zero.
+ * 
+ * Arguments:
+ *    c: Counters.
+ */
+void counters_reset(counters *c)
+{
+   memset(c, 0, sizeof(counters));
+}
+
+/**
+ * Add counters to others, as those of the threads of a parallel loop to those
+ * of the calling thread.
+ * 
+ * Arguments:
+ *    c: Counters to which to add.
+ *    other: Counters to add.
+ */
+void counters_add(counters *c, counters *other)
+{
+   c->iterations += other->iterations;
+   c->partitions += other->partitions;
+   c->comparisons += other->comparisons;
+   c->swaps += other->swaps;
+   c->bytes_allocated += other->bytes_allocated;
+   for (int phase = 0; phase < N_PHASES; phase++)
+      c->seconds[phase] += other->seconds[phase];
+}
+
+/**
+ * Attach counters to the calling thread, into which its work is then recorded
+ * until other counters are attached. Nothing is recorded if the library is not
+ * compiled with ROBUSTATS_COUNTERS defined.
+ * 
+ * Arguments:
+ *    c: Counters, or NULL to stop recording.
+ */
+void counters_attach(counters *c)
+{
+#ifdef ROBUSTATS_COUNTERS
+   attached_counters = c;
+#endif
+}
+
+/**
+ * Counters attached to the calling thread.
+ * 
+ * Returns:
+ *    Counters, or NULL if none are attached or if the library is not compiled
+ *       with ROBUSTATS_COUNTERS defined.
+ */
+counters *counters_attached()
+{
+#ifdef ROBUSTATS_COUNTERS
+   return attached_counters;
+#else
+   return NULL;
+#endif
+}
+
+/**
+ * Current time of a monotonic clock, from which to time the phases.
+ * 
+ * Returns:
+ *    Time in seconds.
+ */
+double counters_now()
+{
+#ifdef _WIN32
+   LARGE_INTEGER count, frequency;
+   QueryPerformanceCounter(&count);
+   QueryPerformanceFrequency(&frequency);
+   return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+#endif
+}
@@ -0,0 +1,55 @@
+#include <stdint.h>
+
+// Phases of the estimators whose time is recorded by the counters: the sorts,
+// the iterations of the selections over implicit matrices, the weighted medians
+// of their rows within the iterations, and the selections among the entries
+// remaining after the iterations
+#define PHASE_SORT 0
+#define PHASE_MATRIX 1
+#define PHASE_WEIGHTED_MEDIAN 2
+#define PHASE_REMAINING 3
+#define N_PHASES 4
+
+typedef struct
+{
+   int64_t iterations;  // Iterations of the selections over implicit matrices
+   int64_t partitions;  // Partitions of the selections of the k-th smallest elements
+   int64_t comparisons;  // Comparisons of elements with the pivots of the partitions and of the matrices
+   int64_t swaps;  // Elements moved below the pivots by the partitions
+   int64_t bytes_allocated;  // Bytes allocated from workspaces
+   double seconds[N_PHASES];  // Time spent in each phase, summed over the threads
+} counters;
+
+int counters_enabled();
+void counters_reset(counters *c);
+void counters_add(counters *c, counters *other);
+void counters_attach(counters *c);
+counters *counters_attached();
+double counters_now();
+
+// The counters are only recorded if the library is compiled with
+// ROBUSTATS_COUNTERS defined, into the counters attached to the calling thread
+// if any, and the macros recording them otherwise compile to nothing
+#ifdef ROBUSTATS_COUNTERS
+
+#ifdef _MSC_VER
+#define COUNTERS_THREAD_LOCAL __declspec(thread)
+#else
+#define COUNTERS_THREAD_LOCAL __thread
+#endif
+
+extern COUNTERS_THREAD_LOCAL counters *attached_counters;
+
+#define COUNT(field, value) \
+   do { if (attached_counters != NULL) attached_counters->field += (value); } while (0)
+#define COUNT_TIME_BEGIN(start) double start = attached_counters != NULL ? counters_now() : 0.
+#define COUNT_TIME_END(phase, start) \
+   do { if (attached_counters != NULL) attached_counters->seconds[phase] += counters_now() - (start); } while (0)
+
+#else
+
+#define COUNT(field, value) ((void)0)
+#define COUNT_TIME_BEGIN(start) ((void)0)
+#define COUNT_TIME_END(phase, start) ((void)0)
+
+#endif
@@ -0,0 +1,1236 @@
+#ifndef _WIN32
+#undef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+#endif
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "base.h"
+#include "external.h"
+#include "robustats.h"
+
+// Number of bits of the keys of the values by which each pass of the weighted
+// median narrows the candidates, into as many buckets of a histogram
+#define EXTERNAL_HISTOGRAM_BITS 16
+#define EXTERNAL_BUCKETS ((int64_t)1 << EXTERNAL_HISTOGRAM_BITS)
+
+// Smallest number of values read or written at a time
+#define EXTERNAL_MIN_CHUNK 1024
+
+// Largest number of sorted runs merged at a time by the external sort
+#define EXTERNAL_MAX_FAN_IN 256
+
+// Largest number of entries sampled by each pass of the medcouple
+#define EXTERNAL_SAMPLE 16384
+
+typedef struct
+{
+   double *buffer;  // Values of the run read ahead
+   int64_t length;  // Number of values in the buffer
+   int64_t position;  // Position in the buffer of the next value to merge
+   int64_t next;  // Position in the file of the next value to read ahead
+   int64_t end;  // Position in the file past the last value of the run
+} merge_run;
+
+/**
+ * Move to a position in a file, beyond 2 GB if need be.
+ * 
+ * Returns:
+ *    0 on success, non-zero otherwise.
+ */
+static int seek(FILE *file, int64_t position)
+{
+#ifdef _WIN32
+   return _fseeki64(file, position, SEEK_SET);
+#else
+   return fseeko(file, (off_t)position, SEEK_SET);
+#endif
+}
+
+/**
+ * Size of a file.
+ * 
+ * Arguments:
+ *    file: File opened in binary mode.
+ * 
+ * Returns:
+ *    Size in bytes, or -1 if it cannot be determined.
+ */
+int64_t external_file_size(FILE *file)
+{
+#ifdef _WIN32
+   if (_fseeki64(file, 0, SEEK_END) != 0)
+      return -1;
+   return (int64_t)_ftelli64(file);
+#else
+   if (fseeko(file, 0, SEEK_END) != 0)
+      return -1;
+   return (int64_t)ftello(file);
+#endif
+}
+
+/**
+ * Read consecutive values of an array, from its file or from memory.
+ * 
+ * Arguments:
+ *    a: Array.
+ *    begin: Position of the first value.
+ *    count: Number of values.
+ *    buffer: Array of length at least 'count' into which to read the values if
+ *       they are in a file.
+ * 
+ * Returns:
+ *    Pointer to the values, either in the buffer or in the memory of the array,
+ *       or NULL if they cannot be read.
+ */
+static const double *read_values(external_array *a, int64_t begin, int64_t count, double *buffer)
+{
+   if (a->file == NULL)
+      return a->data + begin;
+   if (seek(a->file, begin * (int64_t)sizeof(double)) != 0
+      || fread(buffer, sizeof(double), (size_t)count, a->file) != (size_t)count)
+      return NULL;
+   return buffer;
+}
+
+/**
+ * Write consecutive values to a file.
+ * 
+ * Returns:
+ *    1 on success, 0 otherwise.
+ */
+static int write_values(FILE *file, int64_t begin, const double *x, int64_t count)
+{
+   return seek(file, begin * (int64_t)sizeof(double)) == 0
+      && fwrite(x, sizeof(double), (size_t)count, file) == (size_t)count;
+}
+
+/**
+ * Key of a value, as an unsigned integer in the same order as the values.
+ */
+static inline uint64_t value_to_key(double value)
+{
+   uint64_t bits;
+   memcpy(&bits, &value, sizeof(bits));
+   return bits >> 63 ? ~bits : bits | ((uint64_t)1 << 63);
+}
+
+/**
+ * Value of a key, the inverse of function 'value_to_key'.
+ */
+static inline double key_to_value(uint64_t key)
+{
+   double value;
+   uint64_t bits = key >> 63 ? key & ~((uint64_t)1 << 63) : ~key;
+   memcpy(&value, &bits, sizeof(bits));
+   return value;
+}
+
+/**
+ * Buffers of the passes of functions 'narrow_weighted_quantile' and
+ * 'weighted_median_external'.
+ */
+typedef struct
+{
+   int64_t chunk;  // Number of values read at a time
+   int64_t capacity;  // Largest number of candidates gathered in memory
+   double *x;  // Chunk of values
+   double *w;  // Chunk of weights
+   int64_t *counts;  // Numbers of values of the buckets of the histogram
+   double *weights;  // Weights of the buckets of the histogram
+} narrowing_buffers;
+
+/**
+ * Lower weighted quantile of a data sample that does not fit in memory, that
+ * is, the lowest value whose cumulative weight reaches a target, read
+ * sequentially from files or from memory-mapped arrays.
+ * 
+ * Each pass over the data builds a histogram of the values whose keys (their
+ * bits, in the order of the values) share the leading bits of the bucket of
+ * the quantile found so far, bucketed by their next EXTERNAL_HISTOGRAM_BITS
+ * bits, and keeps the bucket reaching the target. It stops once the bucket
+ * holds few enough values to be gathered in memory, where their lower weighted
+ * quantile is selected, or once it holds a single distinct value, so that
+ * there are at most five passes.
+ * 
+ * Arguments:
+ *    x: Array of values, not NaN, of at least one value.
+ *    w: Array of non-negative weights, of the same length, or NULL for weights
+ *       of 1, in which case the quantile reaching a target k is the value of
+ *       rank k - 1.
+ *    target: Positive target of the cumulative weight, or 0 for half of the
+ *       total weight, which the first pass sums.
+ *    buffers: Buffers of the passes.
+ *    quantile: Where to write the quantile, NaN if the weights sum to 0.
+ *    w_total: Where to write the total weight.
+ *    w_through: Where to write the cumulative weight of the quantile, that is,
+ *       the total weight of the values lower than or equal to it.
+ *    random_state: State of the generator of the pivots.
+ * 
+ * Returns:
+ *    EXTERNAL_OK, or EXTERNAL_ERROR_MEMORY or EXTERNAL_ERROR_IO on failure.
+ */
+static int narrow_weighted_quantile(
+   external_array *x, external_array *w, double target, narrowing_buffers *buffers, double *quantile,
+   double *w_total, double *w_through, uint64_t *random_state)
+{
+   int64_t n = x->n;
+   int64_t chunk = buffers->chunk;
+   int64_t *counts = buffers->counts;
+   double *weights = buffers->weights;
+   int status = EXTERNAL_OK;
+
+   *quantile = NAN;
+
+   // Lowest key of the candidates, and number of bits of their keys below the
+   // buckets of the histogram
+   uint64_t low = 0;
+   int shift = 64 - EXTERNAL_HISTOGRAM_BITS;
+   double w_below = 0.;
+   int64_t b;
+
+   while (1)
+   {
+      *w_total = 0.;
+      memset(counts, 0, EXTERNAL_BUCKETS * sizeof(int64_t));
+      memset(weights, 0, EXTERNAL_BUCKETS * sizeof(double));
+
+      for (int64_t begin = 0; begin < n; begin += chunk)
+      {
+         int64_t count = n - begin < chunk ? n - begin : chunk;
+         const double *xs = read_values(x, begin, count, buffers->x);
+         const double *ws = w != NULL ? read_values(w, begin, count, buffers->w) : NULL;
+         if (xs == NULL || (w != NULL && ws == NULL))
+            return EXTERNAL_ERROR_IO;
+
+         for (int64_t i = 0; i < count; i++)
+         {
+            // Keys below the candidates wrap around beyond the last bucket
+            double weight = ws != NULL ? ws[i] : 1.;
+            uint64_t bucket = (value_to_key(xs[i]) - low) >> shift;
+            if (bucket < (uint64_t)EXTERNAL_BUCKETS)
+            {
+               counts[bucket]++;
+               weights[bucket] += weight;
+            }
+            *w_total += weight;
+         }
+      }
+
+      if (target == 0.)
+      {
+         target = 0.5 * *w_total;
+         if (!(target > 0.))
+            return EXTERNAL_OK;
+      }
+
+      // Bucket reaching the target, or the last one if rounding errors keep
+      // the cumulative weight below it
+      int64_t b_last = -1;
+      for (b = 0; b < EXTERNAL_BUCKETS; b++)
+      {
+         if (counts[b] == 0)
+            continue;
+         b_last = b;
+         if (w_below + weights[b] >= target)
+            break;
+         w_below += weights[b];
+      }
+      if (b == EXTERNAL_BUCKETS)
+      {
+         b = b_last;
+         w_below -= weights[b];
+      }
+      low += (uint64_t)b << shift;
+
+      if (shift == 0)
+      {
+         *quantile = key_to_value(low);
+         *w_through = w_below + weights[b];
+         return EXTERNAL_OK;
+      }
+
+      if (counts[b] <= buffers->capacity)
+         break;
+
+      shift -= EXTERNAL_HISTOGRAM_BITS;
+   }
+
+   // Gather the candidates of the bucket
+   int64_t n_candidates = 0;
+   double *candidates = malloc(counts[b] * sizeof(double));
+   double *candidate_weights = malloc(counts[b] * sizeof(double));
+   if (candidates == NULL || candidate_weights == NULL)
+   {
+      free(candidates);
+      free(candidate_weights);
+      return EXTERNAL_ERROR_MEMORY;
+   }
+
+   for (int64_t begin = 0; begin < n && status == EXTERNAL_OK; begin += chunk)
+   {
+      int64_t count = n - begin < chunk ? n - begin : chunk;
+      const double *xs = read_values(x, begin, count, buffers->x);
+      const double *ws = w != NULL ? read_values(w, begin, count, buffers->w) : NULL;
+      if (xs == NULL || (w != NULL && ws == NULL))
+      {
+         status = EXTERNAL_ERROR_IO;
+         break;
+      }
+
+      for (int64_t i = 0; i < count; i++)
+         if ((value_to_key(xs[i]) - low) >> shift == 0 && n_candidates < counts[b])
+         {
+            candidates[n_candidates] = xs[i];
+            candidate_weights[n_candidates++] = ws != NULL ? ws[i] : 1.;
+         }
+   }
+
+   // The data changed between the passes if the bucket does not hold as many
+   // values as counted
+   if (status == EXTERNAL_OK && n_candidates != counts[b])
+      status = EXTERNAL_ERROR_IO;
+   if (status == EXTERNAL_OK)
+   {
+      weighted_quantiles_above_in_place(
+         candidates, candidate_weights, n_candidates, w_below, &target, 1, random_state);
+      *quantile = target;
+
+      *w_through = w_below;
+      for (int64_t i = 0; i < n_candidates; i++)
+         if (candidates[i] <= *quantile)
+            *w_through += candidate_weights[i];
+   }
+
+   free(candidates);
+   free(candidate_weights);
+   return status;
+}
+
+/**
+ * Weighted median of a data sample that does not fit in memory, read
+ * sequentially from files or from memory-mapped arrays.
+ * 
+ * The lower weighted median, at half the total weight, is found by function
+ * 'narrow_weighted_quantile'. The result is the weighted median returned by
+ * function 'weighted_median', ties included: when the cumulative weight of the
+ * lower weighted median is exactly half of the total weight, two more passes
+ * rank the next value of positive weight, from which function
+ * 'weighted_median_tie_rank' gives the rank of the weighted median, which is
+ * selected by rank if it is neither of those two values.
+ * 
+ * Arguments:
+ *    x: Array of values, not NaN.
+ *    w: Array of non-negative weights, of the same length.
+ *    memory: Number of bytes of memory to use, besides a histogram of 1 MB.
+ *    median: Where to write the median, NaN if the sample is empty or if the
+ *       weights sum to 0.
+ *    random_state: State of the generator of the pivots.
+ * 
+ * Returns:
+ *    EXTERNAL_OK, or EXTERNAL_ERROR_MEMORY or EXTERNAL_ERROR_IO on failure.
+ */
+int weighted_median_external(
+   external_array *x, external_array *w, size_t memory, double *median, uint64_t *random_state)
+{
+   int64_t n = x->n;
+   int status = EXTERNAL_OK;
+   narrowing_buffers buffers;
+   double w_total, w_through;
+
+   // Half of the memory holds the chunks of values and weights being read, and
+   // the other half the values and weights gathered by the last pass
+   buffers.chunk = (int64_t)(memory / (4 * sizeof(double)));
+   buffers.capacity = (int64_t)(memory / (4 * sizeof(double)));
+   buffers.chunk = buffers.chunk < EXTERNAL_MIN_CHUNK ? EXTERNAL_MIN_CHUNK : buffers.chunk;
+   buffers.capacity = buffers.capacity < EXTERNAL_MIN_CHUNK ? EXTERNAL_MIN_CHUNK : buffers.capacity;
+
+   *median = NAN;
+   if (n == 0)
+      return EXTERNAL_OK;
+
+   int64_t chunk = buffers.chunk;
+   buffers.x = malloc(chunk * sizeof(double));
+   buffers.w = malloc(chunk * sizeof(double));
+   buffers.counts = malloc(EXTERNAL_BUCKETS * sizeof(int64_t));
+   buffers.weights = malloc(EXTERNAL_BUCKETS * sizeof(double));
+   if (buffers.x == NULL || buffers.w == NULL || buffers.counts == NULL || buffers.weights == NULL)
+   {
+      status = EXTERNAL_ERROR_MEMORY;
+      goto done;
+   }
+
+   status = narrow_weighted_quantile(x, w, 0., &buffers, median, &w_total, &w_through, random_state);
+   if (status != EXTERNAL_OK || isnan(*median) || w_through != 0.5 * w_total)
+      goto done;
+
+   // Number of values up to the lower weighted median, and next value of
+   // positive weight
+   double lower = *median, next = INFINITY;
+   int64_t n_through = 0, next_rank = 0;
+   for (int64_t begin = 0; begin < n; begin += chunk)
+   {
+      int64_t count = n - begin < chunk ? n - begin : chunk;
+      const double *xs = read_values(x, begin, count, buffers.x);
+      const double *ws = read_values(w, begin, count, buffers.w);
+      if (xs == NULL || ws == NULL)
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+
+      for (int64_t i = 0; i < count; i++)
+      {
+         if (xs[i] <= lower)
+            n_through++;
+         else if (ws[i] > 0. && xs[i] < next)
+            next = xs[i];
+      }
+   }
+
+   // Rank of the next value of positive weight
+   for (int64_t begin = 0; begin < n; begin += chunk)
+   {
+      int64_t count = n - begin < chunk ? n - begin : chunk;
+      const double *xs = read_values(x, begin, count, buffers.x);
+      if (xs == NULL)
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+
+      for (int64_t i = 0; i < count; i++)
+         next_rank += xs[i] < next;
+   }
+
+   int64_t rank = weighted_median_tie_rank(n, next_rank);
+   if (rank >= next_rank)
+      *median = next;
+   else if (rank >= n_through)
+      status = narrow_weighted_quantile(
+         x, NULL, (double)(rank + 1), &buffers, median, &w_total, &w_through, random_state);
+
+done:
+   free(buffers.x);
+   free(buffers.w);
+   free(buffers.counts);
+   free(buffers.weights);
+   return status;
+}
+
+/**
+ * Read ahead the next values of a run being merged, once all the values of its
+ * buffer are merged.
+ * 
+ * Returns:
+ *    1 on success, 0 otherwise.
+ */
+static int read_ahead(external_array *source, merge_run *run, int64_t length)
+{
+   if (run->position < run->length || run->next == run->end)
+      return 1;
+
+   int64_t count = run->end - run->next < length ? run->end - run->next : length;
+   if (read_values(source, run->next, count, run->buffer) == NULL)
+      return 0;
+   run->length = count;
+   run->position = 0;
+   run->next += count;
+   return 1;
+}
+
+/**
+ * Restore the order of a heap of runs on their next values, from a run whose
+ * next value increased.
+ */
+static void sift_down(merge_run *runs, int *heap, int n, int i)
+{
+   while (1)
+   {
+      int smallest = i;
+      int left = 2 * i + 1;
+      int right = left + 1;
+
+      if (left < n && runs[heap[left]].buffer[runs[heap[left]].position]
+         < runs[heap[smallest]].buffer[runs[heap[smallest]].position])
+         smallest = left;
+      if (right < n && runs[heap[right]].buffer[runs[heap[right]].position]
+         < runs[heap[smallest]].buffer[runs[heap[smallest]].position])
+         smallest = right;
+      if (smallest == i)
+         return;
+
+      int swap = heap[i];
+      heap[i] = heap[smallest];
+      heap[smallest] = swap;
+      i = smallest;
+   }
+}
+
+/**
+ * Merge consecutive sorted runs of a file into a single run, at the same
+ * position of another file.
+ * 
+ * Arguments:
+ *    source: File of the runs.
+ *    destination: File into which to write the merged run.
+ *    run_begins: Positions of the first values of the runs, followed by the
+ *       position past the last value of the last run.
+ *    k: Number of runs, at most EXTERNAL_MAX_FAN_IN.
+ *    block: Memory of the buffers of the runs and of the merged run.
+ *    block_length: Number of values of the memory.
+ * 
+ * Returns:
+ *    1 on success, 0 otherwise.
+ */
+static int merge(external_array *source, FILE *destination, int64_t *run_begins, int k, double *block,
+   int64_t block_length)
+{
+   merge_run runs[EXTERNAL_MAX_FAN_IN];
+   int heap[EXTERNAL_MAX_FAN_IN];
+   int n_heap = 0;
+
+   int64_t length = block_length / (k + 1);
+   double *output = block + k * length;
+   int64_t n_output = 0;
+   int64_t position = run_begins[0];
+
+   for (int r = 0; r < k; r++)
+   {
+      runs[r].buffer = block + r * length;
+      runs[r].length = 0;
+      runs[r].position = 0;
+      runs[r].next = run_begins[r];
+      runs[r].end = run_begins[r + 1];
+      if (!read_ahead(source, &runs[r], length))
+         return 0;
+      if (runs[r].length > 0)
+         heap[n_heap++] = r;
+   }
+   for (int i = n_heap / 2 - 1; i >= 0; i--)
+      sift_down(runs, heap, n_heap, i);
+
+   while (n_heap > 0)
+   {
+      merge_run *run = &runs[heap[0]];
+      output[n_output++] = run->buffer[run->position++];
+      if (n_output == length)
+      {
+         if (!write_values(destination, position, output, n_output))
+            return 0;
+         position += n_output;
+         n_output = 0;
+      }
+
+      if (!read_ahead(source, run, length))
+         return 0;
+      if (run->position == run->length)
+         heap[0] = heap[--n_heap];
+      sift_down(runs, heap, n_heap, 0);
+   }
+
+   return write_values(destination, position, output, n_output);
+}
+
+/**
+ * Sort a data sample that does not fit in memory ascendingly, by an external
+ * merge sort: runs sorted in memory are written to a first scratch file, then
+ * merged up to EXTERNAL_MAX_FAN_IN at a time back and forth between the scratch
+ * files.
+ * 
+ * Arguments:
+ *    x: Array of values, not NaN, longer than half of the memory.
+ *    scratch: Two files opened for update in binary mode, each of which can
+ *       grow to the size of the data sample.
+ *    block: Memory of the runs and of the buffers of the merges.
+ *    block_length: Number of values of the memory.
+ *    sorted: Where to write the index of the scratch file holding the sorted
+ *       values.
+ * 
+ * Returns:
+ *    EXTERNAL_OK, or EXTERNAL_ERROR_MEMORY or EXTERNAL_ERROR_IO on failure.
+ */
+static int external_sort(external_array *x, FILE *scratch[2], double *block, int64_t block_length, int *sorted)
+{
+   int64_t n = x->n;
+   int status = EXTERNAL_OK;
+
+   // Half of the memory holds the runs being sorted, and the other half the
+   // buffer of the sort
+   int64_t run_length = block_length / 2;
+   int64_t n_runs = (n + run_length - 1) / run_length;
+   int64_t fan_in = block_length / EXTERNAL_MIN_CHUNK - 1;
+   fan_in = fan_in > EXTERNAL_MAX_FAN_IN ? EXTERNAL_MAX_FAN_IN : fan_in;
+
+   int64_t *run_begins = malloc((n_runs + 1) * sizeof(int64_t));
+   if (run_begins == NULL)
+      return EXTERNAL_ERROR_MEMORY;
+
+   for (int64_t r = 0; r < n_runs; r++)
+   {
+      int64_t begin = r * run_length;
+      int64_t count = n - begin < run_length ? n - begin : run_length;
+      const double *xs = read_values(x, begin, count, block);
+      if (xs == NULL)
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+      if (xs != block)
+         memcpy(block, xs, count * sizeof(double));
+      sort(block, count, 0, NULL);
+      if (!write_values(scratch[0], begin, block, count))
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+      run_begins[r] = begin;
+   }
+   run_begins[n_runs] = n;
+
+   // Each pass merges groups of runs into the other scratch file, writing the
+   // boundaries of the merged runs over those of the first run of each group
+   int source = 0;
+   while (n_runs > 1)
+   {
+      int64_t n_merged = 0;
+      external_array runs = {scratch[source], NULL, n};
+      for (int64_t r = 0; r < n_runs; r += fan_in)
+      {
+         int k = (int)(n_runs - r < fan_in ? n_runs - r : fan_in);
+         if (!merge(&runs, scratch[1 - source], run_begins + r, k, block, block_length))
+         {
+            status = EXTERNAL_ERROR_IO;
+            goto done;
+         }
+         run_begins[n_merged++] = run_begins[r];
+      }
+      run_begins[n_merged] = n;
+      n_runs = n_merged;
+      source = 1 - source;
+   }
+   *sorted = source;
+
+done:
+   free(run_begins);
+   return status;
+}
+
+/**
+ * Half-sample mode of a data sample that does not fit in memory, read
+ * sequentially from a file or from a memory-mapped array.
+ * 
+ * The data sample is sorted by function 'external_sort'. The iterations of the
+ * half-sample mode then scan the sorted file with two sequential readers
+ * until the half sample fits in memory, where the mode is computed as by
+ * function 'mode_sorted', so that the result is the same as that of function
+ * 'mode'.
+ * 
+ * Arguments:
+ *    x: Array of values, not NaN.
+ *    scratch: Two files opened for update in binary mode, each of which can
+ *       grow to the size of the data sample.
+ *    memory: Number of bytes of memory to use.
+ *    mode: Where to write the mode, NaN if the sample is empty.
+ * 
+ * Returns:
+ *    EXTERNAL_OK, or EXTERNAL_ERROR_MEMORY or EXTERNAL_ERROR_IO on failure.
+ */
+int mode_external(external_array *x, FILE *scratch[2], size_t memory, double *mode)
+{
+   int64_t n = x->n;
+   int status = EXTERNAL_OK;
+   int source;
+
+   int64_t block_length = (int64_t)(memory / sizeof(double));
+   block_length = block_length < 2 * EXTERNAL_MIN_CHUNK ? 2 * EXTERNAL_MIN_CHUNK : block_length;
+
+   *mode = NAN;
+   if (n == 0)
+      return EXTERNAL_OK;
+
+   double *block = malloc(block_length * sizeof(double));
+   if (block == NULL)
+      return EXTERNAL_ERROR_MEMORY;
+
+   // Samples that fit in half of the memory are sorted in memory
+   if (n <= block_length / 2)
+   {
+      const double *xs = read_values(x, 0, n, block);
+      if (xs == NULL)
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+      if (xs != block)
+         memcpy(block, xs, n * sizeof(double));
+      sort(block, n, 0, NULL);
+      *mode = mode_sorted(block, n);
+      goto done;
+   }
+
+   status = external_sort(x, scratch, block, block_length, &source);
+   if (status != EXTERNAL_OK)
+      goto done;
+
+   external_array sorted = {scratch[source], NULL, n};
+   int64_t half_length = block_length / 2;
+   int64_t begin = 0;
+   int64_t end = n - 1;
+
+   while (end - begin + 1 > block_length)
+   {
+      int64_t m = end - begin + 1;
+      int64_t m_half = (m + 1) / 2;
+      int64_t j = begin;
+
+      const double *first = read_values(&sorted, begin, 1, block);
+      double first_value = first != NULL ? *first : 0.;
+      const double *last = read_values(&sorted, end, 1, block);
+      if (first == NULL || last == NULL)
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+      double min_width = *last - first_value;
+
+      for (int64_t i = begin; i <= begin + m - m_half; i += half_length)
+      {
+         int64_t count = begin + m - m_half - i + 1 < half_length ? begin + m - m_half - i + 1 : half_length;
+         const double *lower = read_values(&sorted, i, count, block);
+         const double *upper = read_values(&sorted, i + m_half - 1, count, block + half_length);
+         if (lower == NULL || upper == NULL)
+         {
+            status = EXTERNAL_ERROR_IO;
+            goto done;
+         }
+
+         for (int64_t t = 0; t < count; t++)
+         {
+            double width = upper[t] - lower[t];
+            if (width < min_width)
+            {
+               min_width = width;
+               j = i + t;
+            }
+         }
+      }
+
+      begin = j;
+      end = j + m_half - 1;
+   }
+
+   if (read_values(&sorted, begin, end - begin + 1, block) == NULL)
+   {
+      status = EXTERNAL_ERROR_IO;
+      goto done;
+   }
+   *mode = mode_sorted(block, end - begin + 1);
+
+done:
+   free(block);
+   return status;
+}
+
+typedef struct
+{
+   external_array *a;
+   double *buffer;
+   int64_t length;  // Number of values of the buffer
+   const double *values;  // Values read, in the buffer or in the memory of the array
+   int64_t begin;  // Position in the array of the first value read
+   int64_t count;  // Number of values read
+   int direction;  // 1 if the positions read increase, -1 if they decrease
+   int failed;  // 1 if a read failed
+} external_cursor;
+
+typedef struct
+{
+   double a;  // Data point of the row, z_plus[i]
+   int64_t i;  // Row
+   int64_t j;  // Column
+} sampled_entry;
+
+/**
+ * Initialize a cursor over an array, reading ahead a given number of values at
+ * a time in a given direction.
+ */
+static void cursor_init(external_cursor *c, external_array *a, double *buffer, int64_t length, int direction)
+{
+   c->a = a;
+   c->buffer = buffer;
+   c->length = length;
+   c->values = NULL;
+   c->begin = 0;
+   c->count = 0;
+   c->direction = direction;
+   c->failed = 0;
+}
+
+/**
+ * Value of an array at a position, read through a cursor, which reads ahead
+ * from the position in its direction if the value was not read yet. If the
+ * read fails, the cursor is marked as failed and 0 is returned.
+ */
+static inline double cursor_get(external_cursor *c, int64_t position)
+{
+   if (position < c->begin || position >= c->begin + c->count)
+   {
+      int64_t begin = c->direction > 0 ? position : position - c->length + 1;
+      begin = begin + c->length > c->a->n ? c->a->n - c->length : begin;
+      begin = begin < 0 ? 0 : begin;
+      int64_t count = c->a->n - begin < c->length ? c->a->n - begin : c->length;
+
+      c->values = read_values(c->a, begin, count, c->buffer);
+      if (c->values == NULL)
+      {
+         c->failed = 1;
+         c->count = 0;
+         return 0.;
+      }
+      c->begin = begin;
+      c->count = count;
+   }
+
+   return c->values[position - c->begin];
+}
+
+/**
+ * Implicit matrix of the kernel of the medcouple, whose rows and columns are
+ * indexed by the scaled data points above and below the median, z_plus and
+ * z_minus, which are computed from a sorted file when read.
+ */
+typedef struct
+{
+   int64_t n;  // Number of data points
+   int64_t n_plus;  // Number of rows
+   int64_t n_minus;  // Number of columns
+   int64_t minus_begin;  // Position in the sorted file of the data point of the first column
+   double median;
+   double scale;
+   double epsilon;  // Smallest representable positive number, for the kernel
+} external_matrix;
+
+/**
+ * Scaled data point of a row, z_plus[i], that of the i-th largest data point.
+ */
+static inline double row_point(external_matrix *m, external_cursor *c, int64_t i)
+{
+   return (cursor_get(c, m->n - 1 - i) - m->median) / m->scale;
+}
+
+/**
+ * Entry of the matrix, as function 'h_kernel' of c/kernels.h, from the scaled
+ * data point of its row.
+ */
+static inline double matrix_entry(external_matrix *m, external_cursor *c, double a, int64_t i, int64_t j)
+{
+   double b = (cursor_get(c, m->minus_begin - j) - m->median) / m->scale;
+
+   if (fabs(a - b) <= 2 * m->epsilon)
+      return sign((double)(m->n_plus - i - j - 1));
+   else
+      return (a + b) / (a - b);
+}
+
+/**
+ * Pseudo-random number uniformly distributed in (0, 1].
+ */
+static inline double random_uniform(uint64_t *random_state)
+{
+   return (double)((random_next(random_state) >> 11) + 1) / 9007199254740992.;
+}
+
+/**
+ * Position in the stream of the candidates of the next one to enter a sample,
+ * by the algorithm L of Li, once a given candidate is sampled.
+ * 
+ * Arguments:
+ *    index: Position of the candidate sampled.
+ *    size: Size of the sample.
+ *    w: State of the algorithm.
+ *    random_state: State of the generator.
+ * 
+ * Returns:
+ *    Position of the next candidate to sample.
+ */
+static int64_t reservoir_next(int64_t index, int64_t size, double *w, uint64_t *random_state)
+{
+   if (index + 1 < size)
+      return index + 1;
+
+   if (index + 1 == size)
+      *w = exp(log(random_uniform(random_state)) / (double)size);
+   else
+      *w *= exp(log(random_uniform(random_state)) / (double)size);
+
+   double skip = floor(log(random_uniform(random_state)) / log(1. - *w));
+   return index + 1 + (skip < 4e18 ? (int64_t)skip : (int64_t)4e18);
+}
+
+/**
+ * Pass over the matrix of the medcouple.
+ * 
+ * The rows are walked down with two columns moving left, as function
+ * 'where_h_less_than_u', to count the entries not lower than each of two
+ * bounds, so that the borders of the candidates, the entries not lower than
+ * the lower bound and lower than the upper one, are never stored: they are
+ * found again by each pass, which reads the file sequentially. The candidates
+ * are either gathered, or sampled uniformly, the data point of the column of
+ * each sampled entry being read after the pass.
+ * 
+ * Arguments:
+ *    m: Matrix.
+ *    cursors: Cursors over the file of the data points, for the rows, the
+ *       columns of both bounds and the gathered candidates.
+ *    lower: Lower bound.
+ *    upper: Upper bound, not lower than the lower one.
+ *    n_upper: Where to write the number of entries not lower than the upper
+ *       bound.
+ *    n_lower: Where to write the number of entries not lower than the lower
+ *       bound.
+ *    gathered: Array into which to gather the candidates, or NULL to sample
+ *       them.
+ *    sample: Array of the sample.
+ *    size: Size of the sample, or number of values of the gathered array.
+ *    n_candidates: Where to write the number of candidates.
+ *    random_state: State of the generator of the sample.
+ */
+static void medcouple_pass(
+   external_matrix *m, external_cursor *cursors, double lower, double upper, int64_t *n_upper, int64_t *n_lower,
+   double *gathered, sampled_entry *sample, int64_t size, int64_t *n_candidates, uint64_t *random_state)
+{
+   int64_t j_upper = m->n_minus, j_lower = m->n_minus;
+   int64_t seen = 0, next = 0;
+   double w = 0.;
+
+   *n_upper = 0;
+   *n_lower = 0;
+   for (int64_t i = 0; i < m->n_plus; i++)
+   {
+      double a = row_point(m, &cursors[0], i);
+      while (j_upper > 0 && matrix_entry(m, &cursors[1], a, i, j_upper - 1) < upper)
+         j_upper--;
+      while (j_lower > 0 && matrix_entry(m, &cursors[2], a, i, j_lower - 1) < lower)
+         j_lower--;
+      *n_upper += j_upper;
+      *n_lower += j_lower;
+
+      // The candidates of the row are the entries between the two columns,
+      // gathered in the order of the file
+      int64_t row_end = j_lower > j_upper ? seen + j_lower - j_upper : seen;
+      if (gathered != NULL)
+         for (int64_t j = j_lower - 1; j >= j_upper && seen < size; j--)
+            gathered[seen++] = matrix_entry(m, &cursors[3], a, i, j);
+      else
+      {
+         for (; next < row_end; next = reservoir_next(next, size, &w, random_state))
+         {
+            sampled_entry *entry = next < size ? &sample[next] : &sample[random_range(random_state, 0, size - 1)];
+            entry->a = a;
+            entry->i = i;
+            entry->j = j_upper + next - seen;
+         }
+         seen = row_end;
+      }
+   }
+
+   *n_candidates = seen;
+}
+
+/**
+ * Comparison function for sorting sampled entries by descending column.
+ */
+static int compare_sampled_columns(const void *a, const void *b)
+{
+   int64_t j_a = ((const sampled_entry*)a)->j;
+   int64_t j_b = ((const sampled_entry*)b)->j;
+   return (j_a < j_b) - (j_a > j_b);
+}
+
+/**
+ * Read a single value of an array.
+ * 
+ * Returns:
+ *    1 on success, 0 otherwise.
+ */
+static int read_value(external_array *a, int64_t position, double *value)
+{
+   const double *read = read_values(a, position, 1, value);
+   if (read == NULL)
+      return 0;
+   *value = *read;
+   return 1;
+}
+
+/**
+ * Medcouple of a data sample that does not fit in memory, read sequentially
+ * from a file or from a memory-mapped array.
+ * 
+ * The data sample is sorted by function 'external_sort', and the medcouple is
+ * then selected from the implicit matrix of its kernel, whose rows and columns
+ * are read from the sorted file. Instead of the borders of the rows of
+ * function 'typed_select_matrix', which take memory proportional to the data
+ * sample, the candidates are bounded by two values: each pass over the file
+ * counts the entries not lower than bounds chosen from a uniform sample of
+ * the candidates of the previous pass, so as to keep the medcouple between
+ * them with high probability, while sampling the candidates between them. The
+ * number of candidates shrinks by about a quarter of the square root of the
+ * sample size at each pass, until they fit in the sample or in memory, from
+ * which the medcouple is selected exactly. Data samples that fit in memory,
+ * with the arrays of function 'medcouple', are computed by it.
+ * 
+ * Arguments:
+ *    x: Array of values, not NaN, such that the number of pairs of data points
+ *       above and below the median is less than 2^63.
+ *    scratch: Two files opened for update in binary mode, each of which can
+ *       grow to the size of the data sample.
+ *    memory: Number of bytes of memory to use.
+ *    medcouple_: Where to write the medcouple.
+ *    random_state: State of the generator of the samples and of the pivots.
+ * 
+ * Returns:
+ *    EXTERNAL_OK, or EXTERNAL_ERROR_MEMORY, EXTERNAL_ERROR_IO or
+ *       EXTERNAL_ERROR_SIZE on failure.
+ */
+int medcouple_external(
+   external_array *x, FILE *scratch[2], size_t memory, double *medcouple_, uint64_t *random_state)
+{
+   int64_t n = x->n;
+   int status = EXTERNAL_OK;
+   int source;
+
+   int64_t block_length = (int64_t)(memory / sizeof(double));
+   block_length = block_length < 16 * EXTERNAL_MIN_CHUNK ? 16 * EXTERNAL_MIN_CHUNK : block_length;
+
+   *medcouple_ = 0.;
+   if (n < 3)
+      return EXTERNAL_OK;
+
+   double *block = malloc(block_length * sizeof(double));
+   if (block == NULL)
+      return EXTERNAL_ERROR_MEMORY;
+
+   // Samples that fit in memory are computed in the block, whose values after
+   // the data sample hold the workspace of the medcouple
+   if (n * sizeof(double) + medcouple_workspace_size(n) <= block_length * sizeof(double))
+   {
+      const double *xs = read_values(x, 0, n, block);
+      if (xs == NULL)
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+      if (xs != block)
+         memcpy(block, xs, n * sizeof(double));
+
+      workspace ws;
+      workspace_init(&ws);
+      ws.memory = (char *)(block + n);
+      ws.size = (block_length - n) * sizeof(double);
+      *medcouple_ = medcouple(block, n, DBL_EPSILON, DBL_MIN, &ws);
+      if (ws.failed)
+         status = EXTERNAL_ERROR_MEMORY;
+      goto done;
+   }
+
+   status = external_sort(x, scratch, block, block_length, &source);
+   if (status != EXTERNAL_OK)
+      goto done;
+   external_array sorted = {scratch[source], NULL, n};
+
+   // Median and edges of the data points sorted descendingly, as in function
+   // 'typed_medcouple_sorted'
+   double median, highest, lowest;
+   if (!read_value(&sorted, n - 1 - n / 2, &median) || !read_value(&sorted, n - 1, &highest)
+      || !read_value(&sorted, 0, &lowest))
+   {
+      status = EXTERNAL_ERROR_IO;
+      goto done;
+   }
+   if (fabs(highest - median) < DBL_EPSILON * (DBL_EPSILON + fabs(median)))
+   {
+      *medcouple_ = -1.;
+      goto done;
+   }
+   if (fabs(lowest - median) < DBL_EPSILON * (DBL_EPSILON + fabs(median)))
+   {
+      *medcouple_ = 1.;
+      goto done;
+   }
+
+   // First and last positions of the data points equal to the median, found by
+   // bisection
+   int64_t first = 0, last = n - 1 - n / 2;
+   while (first < last)
+   {
+      int64_t middle = first + (last - first) / 2;
+      double value;
+      if (!read_value(&sorted, middle, &value))
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+      if (value < median)
+         first = middle + 1;
+      else
+         last = middle;
+   }
+   int64_t lowest_median = first;
+   first = n - 1 - n / 2;
+   last = n - 1;
+   while (first < last)
+   {
+      int64_t middle = last - (last - first) / 2;
+      double value;
+      if (!read_value(&sorted, middle, &value))
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+      if (value > median)
+         last = middle - 1;
+      else
+         first = middle;
+   }
+
+   external_matrix m;
+   m.n = n;
+   m.n_plus = n - lowest_median;
+   m.n_minus = last + 1;
+   m.minus_begin = last;
+   m.median = median;
+   m.scale = 2 * max_(highest - median, median - lowest);
+   m.epsilon = DBL_MIN;
+   if (m.n_plus > INT64_MAX / m.n_minus)
+   {
+      status = EXTERNAL_ERROR_SIZE;
+      goto done;
+   }
+   int64_t k = m.n_plus * m.n_minus / 2;
+
+   // The block holds, one after the other, the buffers of the cursors, in at
+   // most 5/16 of it, the gathered candidates, which also hold the values of
+   // the sampled entries, in a quarter, and the sample in another quarter
+   external_cursor cursors[5];
+   int64_t cursor_length = block_length / 16;
+   cursor_init(&cursors[0], &sorted, block, cursor_length, -1);
+   cursor_init(&cursors[1], &sorted, block + cursor_length, cursor_length, 1);
+   cursor_init(&cursors[2], &sorted, block + 2 * cursor_length, cursor_length, 1);
+   cursor_init(&cursors[3], &sorted, block + 3 * cursor_length, cursor_length, 1);
+   cursor_init(&cursors[4], &sorted, block + 4 * cursor_length, EXTERNAL_MIN_CHUNK, 1);
+   int64_t capacity = block_length / 4;
+   int64_t sample_size = block_length / 4 * sizeof(double) / sizeof(sampled_entry);
+   sample_size = sample_size > EXTERNAL_SAMPLE ? EXTERNAL_SAMPLE : sample_size;
+   double *gathered = block + 4 * cursor_length + EXTERNAL_MIN_CHUNK;
+   sampled_entry *sample = (sampled_entry *)(gathered + capacity);
+   double *sampled = gathered;
+
+   // The medcouple is the k-th largest entry: there are at most k entries not
+   // lower than the upper bound, and more than k not lower than the lower one
+   double lower = -INFINITY, upper = INFINITY;
+   int64_t n_upper = 0, n_lower = m.n_plus * m.n_minus;
+   int64_t n_sampled = 0;
+   while (1)
+   {
+      int64_t n_candidates = n_lower - n_upper;
+      int64_t pass_upper, pass_lower;
+
+      // The candidates all equal the lower bound if no other value lies
+      // between the bounds
+      if (nextafter(lower, INFINITY) == upper)
+      {
+         *medcouple_ = lower;
+         goto done;
+      }
+
+      if (n_candidates <= capacity)
+      {
+         medcouple_pass(
+            &m, cursors, lower, upper, &pass_upper, &pass_lower, gathered, NULL, capacity, &n_candidates,
+            random_state);
+         if (cursors[0].failed || cursors[1].failed || cursors[2].failed || cursors[3].failed)
+         {
+            status = EXTERNAL_ERROR_IO;
+            goto done;
+         }
+         *medcouple_ = partition_on_kth_smallest(
+            gathered, 0, n_candidates - 1, n_candidates - 1 - (k - n_upper), random_state);
+         goto done;
+      }
+
+      // Bounds around the rank of the medcouple in the sample of the
+      // candidates, if any, sorted descendingly. Those equal to the lower
+      // bound are moved up to the next value, so that each pass moves a bound
+      double pass_lower_bound = lower, pass_upper_bound = upper;
+      if (n_sampled > 0)
+      {
+         double rank = (double)(k - n_upper) / (double)n_candidates * (double)n_sampled;
+         double margin = 2. * sqrt((double)n_sampled);
+         sort(sampled, n_sampled, 1, NULL);
+         if (rank - margin >= 0.)
+            pass_upper_bound = sampled[(int64_t)(rank - margin)];
+         if (ceil(rank + margin) < (double)n_sampled)
+            pass_lower_bound = sampled[(int64_t)ceil(rank + margin)];
+         if (pass_upper_bound == lower)
+            pass_upper_bound = nextafter(lower, INFINITY);
+         if (pass_lower_bound == lower)
+            pass_lower_bound = nextafter(lower, INFINITY);
+      }
+
+      medcouple_pass(
+         &m, cursors, pass_lower_bound, pass_upper_bound, &pass_upper, &pass_lower, NULL, sample, sample_size,
+         &n_candidates, random_state);
+
+      // Entries of the sample, read in the order of the file
+      n_sampled = n_candidates < sample_size ? n_candidates : sample_size;
+      qsort(sample, n_sampled, sizeof(sampled_entry), compare_sampled_columns);
+      for (int64_t r = 0; r < n_sampled; r++)
+         sampled[r] = matrix_entry(&m, &cursors[4], sample[r].a, sample[r].i, sample[r].j);
+      if (cursors[0].failed || cursors[1].failed || cursors[2].failed || cursors[4].failed)
+      {
+         status = EXTERNAL_ERROR_IO;
+         goto done;
+      }
+
+      if (pass_upper > k)
+      {
+         // The medcouple is not lower than the upper bound of the pass
+         lower = pass_upper_bound;
+         n_lower = pass_upper;
+         n_sampled = 0;
+      }
+      else if (pass_lower <= k)
+      {
+         // The medcouple is lower than the lower bound of the pass
+         upper = pass_lower_bound;
+         n_upper = pass_lower;
+         n_sampled = 0;
+      }
+      else
+      {
+         lower = pass_lower_bound;
+         upper = pass_upper_bound;
+         n_lower = pass_lower;
+         n_upper = pass_upper;
+
+         // The sample holds all the candidates if there are few of them
+         if (n_candidates <= sample_size)
+         {
+            *medcouple_ = partition_on_kth_smallest(
+               sampled, 0, n_sampled - 1, n_sampled - 1 - (k - n_upper), random_state);
+            goto done;
+         }
+      }
+   }
+
+done:
+   free(block);
+   return status;
+}
@@ -0,0 +1,23 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Statuses of the estimators over data samples that do not fit in memory
+#define EXTERNAL_OK 0
+#define EXTERNAL_ERROR_MEMORY 1
+#define EXTERNAL_ERROR_IO 2
+#define EXTERNAL_ERROR_SIZE 3
+
+typedef struct
+{
+   FILE *file;  // File of raw native float64 values, or NULL if the values are in memory
+   const double *data;  // Values, if they are in memory or mapped into it
+   int64_t n;  // Number of values
+} external_array;
+
+int64_t external_file_size(FILE *file);
+int weighted_median_external(
+   external_array *x, external_array *w, size_t memory, double *median, uint64_t *random_state);
+int mode_external(external_array *x, FILE *scratch[2], size_t memory, double *mode);
+int medcouple_external(
+   external_array *x, FILE *scratch[2], size_t memory, double *medcouple_, uint64_t *random_state);
@@ -0,0 +1,80 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+#include "counters.h"
+#include "parallel.h"
+#include "robustats.h"
+
+/**
+ * Kernels of the estimators, generated from template kernels.h for each type
+ * of array. The kernels over doubles have no suffix, being the ones used by
+ * the rest of the library.
+ */
+
+// Length of the arrays from which the sort is a radix sort, rather than a
+// quicksort
+#define SORT_RADIX_LENGTH 2048
+
+// Length of the arrays that the quicksort sorts by insertion, and from which
+// its pivot is the median of 3 medians of 3
+#define SORT_INSERTION_LENGTH 24
+#define SORT_NINTHER_LENGTH 128
+
+// Number of moves after which the quicksort abandons an insertion sort over
+// an array that looks sorted
+#define SORT_PARTIAL_INSERTION_MOVES 8
+
+// Length of the arrays from which function 'sort_parallel' splits the sort
+// between threads, and number of rows of the matrix of the medcouple from which
+// function 'medcouple_parallel' splits its iterations between threads
+#define SORT_PARALLEL_LENGTH 65536
+#define MEDCOUPLE_PARALLEL_ROWS 16384
+
+// Kinds of the implicit matrices from which entries are selected: the kernel of
+// the medcouple, the pairwise differences of the Qn estimator, and the pairwise
+// sums of the Hodges-Lehmann estimator
+#define MATRIX_MEDCOUPLE 0
+#define MATRIX_DIFFERENCES 1
+#define MATRIX_SUMS 2
+
+#define KERNEL_TYPE double
+#define KERNEL_KEY_TYPE uint64_t
+#define KERNEL_SUFFIX
+#define KERNEL_FLOATING 1
+#include "kernels.h"
+#undef KERNEL_TYPE
+#undef KERNEL_KEY_TYPE
+#undef KERNEL_SUFFIX
+#undef KERNEL_FLOATING
+
+#define KERNEL_TYPE float
+#define KERNEL_KEY_TYPE uint32_t
+#define KERNEL_SUFFIX _float32
+#define KERNEL_FLOATING 1
+#include "kernels.h"
+#undef KERNEL_TYPE
+#undef KERNEL_KEY_TYPE
+#undef KERNEL_SUFFIX
+#undef KERNEL_FLOATING
+
+#define KERNEL_TYPE int32_t
+#define KERNEL_KEY_TYPE uint32_t
+#define KERNEL_SUFFIX _int32
+#define KERNEL_FLOATING 0
+#include "kernels.h"
+#undef KERNEL_TYPE
+#undef KERNEL_KEY_TYPE
+#undef KERNEL_SUFFIX
+#undef KERNEL_FLOATING
+
+#define KERNEL_TYPE int64_t
+#define KERNEL_KEY_TYPE uint64_t
+#define KERNEL_SUFFIX _int64
+#define KERNEL_FLOATING 0
+#include "kernels.h"
+#undef KERNEL_TYPE
+#undef KERNEL_KEY_TYPE
+#undef KERNEL_SUFFIX
+#undef KERNEL_FLOATING
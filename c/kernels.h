@@ -0,0 +1,2494 @@
+/**
+ * Kernels of the estimators over arrays of a given type.
+ * 
+ * This file is a template, included once for each type by kernels.c, with the
+ * following macros defined:
+ *    KERNEL_TYPE: Type of the elements of the arrays.
+ *    KERNEL_SUFFIX: Suffix of the names of the kernels of the type.
+ *    KERNEL_FLOATING: 1 if the type is a floating-point type, 0 otherwise.
+ *    KERNEL_KEY_TYPE: Unsigned integer type of the same size as the type.
+ * 
+ * Weights are always doubles and results are returned as doubles, whatever the
+ * type of the arrays.
+ */
+#define KERNEL_CONCAT_(name, suffix) name##suffix
+#define KERNEL_CONCAT(name, suffix) KERNEL_CONCAT_(name, suffix)
+#define KERNEL(name) KERNEL_CONCAT(name, KERNEL_SUFFIX)
+
+// Type of the difference between two elements, and difference between two
+// elements a <= b, exact also for the integers whose difference overflows
+#if KERNEL_FLOATING
+#define KERNEL_WIDTH_TYPE KERNEL_TYPE
+#define KERNEL_WIDTH(a, b) ((b) - (a))
+#else
+#define KERNEL_WIDTH_TYPE uint64_t
+#define KERNEL_WIDTH(a, b) ((uint64_t)(b) - (uint64_t)(a))
+#endif
+
+/**
+ * Swap two elements of an array of values and, if given, of the parallel array
+ * of weights.
+ */
+static void KERNEL(typed_swap_pair)(KERNEL_TYPE *x, double *w, int64_t i, int64_t j)
+{
+   KERNEL_TYPE temp = x[i];
+   x[i] = x[j];
+   x[j] = temp;
+
+   if (w != NULL)
+   {
+      double w_temp = w[i];
+      w[i] = w[j];
+      w[j] = w_temp;
+   }
+}
+
+/**
+ * Key of a value for the radix sort: the bits of the value, as an unsigned
+ * integer of the same size, ordered as the values.
+ * 
+ * The sign bit of integers is flipped. The bits of negative floating-point
+ * values are all flipped, ordering them reversely, and the sign bit of the
+ * other ones is set, ordering them after the negative values.
+ */
+static inline KERNEL_KEY_TYPE KERNEL(typed_to_key)(KERNEL_TYPE value)
+{
+   const KERNEL_KEY_TYPE sign = (KERNEL_KEY_TYPE)1 << (8 * sizeof(KERNEL_KEY_TYPE) - 1);
+   KERNEL_KEY_TYPE key;
+
+   memcpy(&key, &value, sizeof(key));
+#if KERNEL_FLOATING
+   return key & sign ? ~key : key | sign;
+#else
+   return key ^ sign;
+#endif
+}
+
+/**
+ * Value of a key of the radix sort, as function 'typed_to_key' reversed.
+ */
+static inline KERNEL_TYPE KERNEL(typed_from_key)(KERNEL_KEY_TYPE key)
+{
+   const KERNEL_KEY_TYPE sign = (KERNEL_KEY_TYPE)1 << (8 * sizeof(KERNEL_KEY_TYPE) - 1);
+   KERNEL_TYPE value;
+
+#if KERNEL_FLOATING
+   key = key & sign ? key ^ sign : ~key;
+#else
+   key ^= sign;
+#endif
+   memcpy(&value, &key, sizeof(value));
+   return value;
+}
+
+/**
+ * Sort an array with a least significant digit radix sort over the keys of
+ * its values, one byte at a time.
+ * 
+ * The bytes of all the keys are counted in a single pass, which also turns the
+ * values into their keys in-place, and the passes over the bytes that are the
+ * same for all the keys are skipped. The keys are complemented to sort
+ * descendingly.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    descending: Whether to sort descendingly.
+ *    buffer: Buffer of n elements.
+ */
+static void KERNEL(typed_radix_sort)(KERNEL_TYPE *x, int64_t n, int descending, KERNEL_TYPE *buffer)
+{
+   enum {N_BYTES = sizeof(KERNEL_KEY_TYPE)};
+   const KERNEL_KEY_TYPE mask = descending ? ~(KERNEL_KEY_TYPE)0 : 0;
+   int64_t counts[N_BYTES][256];
+   KERNEL_KEY_TYPE key;
+   int64_t i;
+   int b;
+
+   memset(counts, 0, sizeof(counts));
+   for (i = 0; i < n; i++)
+   {
+      key = KERNEL(typed_to_key)(x[i]) ^ mask;
+      memcpy(&x[i], &key, sizeof(key));
+      for (b = 0; b < N_BYTES; b++)
+         counts[b][(key >> (8 * b)) & 0xFF]++;
+   }
+
+   KERNEL_TYPE *source = x;
+   KERNEL_TYPE *destination = buffer;
+   for (b = 0; b < N_BYTES; b++)
+   {
+      // Skip the bytes that are the same for all the keys
+      int64_t *count = counts[b];
+      memcpy(&key, &source[0], sizeof(key));
+      if (count[(key >> (8 * b)) & 0xFF] == n)
+         continue;
+
+      // Offsets of the buckets of the byte
+      int64_t offset = 0, bucket_size;
+      for (i = 0; i < 256; i++)
+      {
+         bucket_size = count[i];
+         count[i] = offset;
+         offset += bucket_size;
+      }
+
+      for (i = 0; i < n; i++)
+      {
+         memcpy(&key, &source[i], sizeof(key));
+         memcpy(&destination[count[(key >> (8 * b)) & 0xFF]++], &key, sizeof(key));
+      }
+
+      KERNEL_TYPE *swap_ = source;
+      source = destination;
+      destination = swap_;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      memcpy(&key, &source[i], sizeof(key));
+      x[i] = KERNEL(typed_from_key)(key ^ mask);
+   }
+}
+
+/**
+ * Sort a short array ascendingly by insertion.
+ */
+static void KERNEL(typed_sort_insertion)(KERNEL_TYPE *x, int64_t begin, int64_t end)
+{
+   for (int64_t i = begin + 1; i <= end; i++)
+   {
+      KERNEL_TYPE value = x[i];
+      int64_t j = i;
+      for (; j > begin && value < x[j - 1]; j--)
+         x[j] = x[j - 1];
+      x[j] = value;
+   }
+}
+
+/**
+ * Sort an array ascendingly by insertion, unless it takes more than a few
+ * moves, in which case the sort is abandoned.
+ * 
+ * Returns:
+ *    1 if the array was sorted, 0 otherwise.
+ */
+static int KERNEL(typed_sort_partial_insertion)(KERNEL_TYPE *x, int64_t begin, int64_t end)
+{
+   int64_t moves = 0;
+
+   for (int64_t i = begin + 1; i <= end; i++)
+   {
+      KERNEL_TYPE value = x[i];
+      int64_t j = i;
+      for (; j > begin && value < x[j - 1]; j--)
+         x[j] = x[j - 1];
+      x[j] = value;
+
+      moves += i - j;
+      if (moves > SORT_PARTIAL_INSERTION_MOVES)
+         return 0;
+   }
+
+   return 1;
+}
+
+/**
+ * Move down an element of a heap, stored as an array, to its place.
+ */
+static void KERNEL(typed_sift_down)(KERNEL_TYPE *heap, int64_t parent, int64_t size)
+{
+   KERNEL_TYPE value = heap[parent];
+   int64_t child;
+
+   while ((child = 2 * parent + 1) < size)
+   {
+      if (child + 1 < size && heap[child] < heap[child + 1])
+         child++;
+      if (!(value < heap[child]))
+         break;
+      heap[parent] = heap[child];
+      parent = child;
+   }
+
+   heap[parent] = value;
+}
+
+/**
+ * Sort an array ascendingly with a heap sort, when the quicksort keeps
+ * choosing bad pivots.
+ */
+static void KERNEL(typed_sort_heap)(KERNEL_TYPE *x, int64_t begin, int64_t end)
+{
+   KERNEL_TYPE *heap = x + begin;
+   int64_t n = end - begin + 1;
+   int64_t i;
+
+   for (i = n / 2 - 1; i >= 0; i--)
+      KERNEL(typed_sift_down)(heap, i, n);
+
+   for (i = n - 1; i > 0; i--)
+   {
+      KERNEL(typed_swap_pair)(heap, NULL, 0, i);
+      KERNEL(typed_sift_down)(heap, 0, i);
+   }
+}
+
+/**
+ * Sort three elements of an array ascendingly.
+ */
+static void KERNEL(typed_sort_3)(KERNEL_TYPE *x, int64_t a, int64_t b, int64_t c)
+{
+   if (x[b] < x[a])
+      KERNEL(typed_swap_pair)(x, NULL, a, b);
+   if (x[c] < x[b])
+   {
+      KERNEL(typed_swap_pair)(x, NULL, b, c);
+      if (x[b] < x[a])
+         KERNEL(typed_swap_pair)(x, NULL, a, b);
+   }
+}
+
+/**
+ * Pattern-defeating quicksort of an array, ascendingly.
+ * 
+ * The pivot is the median of 3 elements, or of 3 medians of 3 for long arrays.
+ * A pivot equal to the element preceding the array, which is lower than or
+ * equal to all of its elements, puts the elements equal to it on its left, so
+ * that runs of duplicates are sorted in a single partition. Partitions with no
+ * element to swap try an insertion sort, which sorts ordered arrays in linear
+ * time. Unbalanced partitions shuffle a few elements to break the patterns
+ * that produce them and, when there are too many of them, the array is heap
+ * sorted instead.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    begin: Index where to begin sorting.
+ *    end: Index where to end sorting.
+ *    bad_allowed: Number of unbalanced partitions allowed before heap sorting.
+ *    leftmost: Whether the array has no preceding element.
+ */
+static void KERNEL(typed_quick_sort)(KERNEL_TYPE *x, int64_t begin, int64_t end, int bad_allowed, int leftmost)
+{
+   while (1)
+   {
+      int64_t n = end - begin + 1;
+      if (n <= SORT_INSERTION_LENGTH)
+      {
+         KERNEL(typed_sort_insertion)(x, begin, end);
+         return;
+      }
+
+      // Move the pivot to the beginning of the array
+      int64_t middle = begin + n / 2;
+      if (n > SORT_NINTHER_LENGTH)
+      {
+         KERNEL(typed_sort_3)(x, begin, middle, end);
+         KERNEL(typed_sort_3)(x, begin + 1, middle - 1, end - 1);
+         KERNEL(typed_sort_3)(x, begin + 2, middle + 1, end - 2);
+         KERNEL(typed_sort_3)(x, middle - 1, middle, middle + 1);
+         KERNEL(typed_swap_pair)(x, NULL, begin, middle);
+      }
+      else
+         KERNEL(typed_sort_3)(x, middle, begin, end);
+
+      KERNEL_TYPE pivot = x[begin];
+      int64_t first = begin;
+      int64_t last = end + 1;
+
+      if (!leftmost && !(x[begin - 1] < pivot))
+      {
+         // The pivot is the lowest value: put the elements equal to it on its
+         // left, and sort the elements greater than it
+         while (pivot < x[--last]);
+         if (last == end)
+            while (first < last && !(pivot < x[++first]));
+         else
+            while (!(pivot < x[++first]));
+
+         while (first < last)
+         {
+            KERNEL(typed_swap_pair)(x, NULL, first, last);
+            while (pivot < x[--last]);
+            while (!(pivot < x[++first]));
+         }
+
+         x[begin] = x[last];
+         x[last] = pivot;
+         begin = last + 1;
+         continue;
+      }
+
+      // Partition the elements lower than the pivot on its left, and the
+      // other ones on its right
+      while (x[++first] < pivot);
+      if (first - 1 == begin)
+         while (first < last && !(x[--last] < pivot));
+      else
+         while (!(x[--last] < pivot));
+
+      int already_partitioned = first >= last;
+      while (first < last)
+      {
+         KERNEL(typed_swap_pair)(x, NULL, first, last);
+         while (x[++first] < pivot);
+         while (!(x[--last] < pivot));
+      }
+
+      int64_t pivot_index = first - 1;
+      x[begin] = x[pivot_index];
+      x[pivot_index] = pivot;
+
+      int64_t left = pivot_index - begin;
+      int64_t right = end - pivot_index;
+
+      if (left < n / 8 || right < n / 8)
+      {
+         if (--bad_allowed == 0)
+         {
+            KERNEL(typed_sort_heap)(x, begin, end);
+            return;
+         }
+
+         // Shuffle a few elements of both sides
+         if (left >= SORT_INSERTION_LENGTH)
+         {
+            KERNEL(typed_swap_pair)(x, NULL, begin, begin + left / 4);
+            KERNEL(typed_swap_pair)(x, NULL, pivot_index - 1, pivot_index - left / 4);
+         }
+         if (right >= SORT_INSERTION_LENGTH)
+         {
+            KERNEL(typed_swap_pair)(x, NULL, pivot_index + 1, pivot_index + 1 + right / 4);
+            KERNEL(typed_swap_pair)(x, NULL, end, end - right / 4);
+         }
+      }
+      else if (already_partitioned
+         && KERNEL(typed_sort_partial_insertion)(x, begin, pivot_index - 1)
+         && KERNEL(typed_sort_partial_insertion)(x, pivot_index + 1, end))
+         return;
+
+      // Sort the left side recursively and the right side iteratively
+      KERNEL(typed_quick_sort)(x, begin, pivot_index - 1, bad_allowed, leftmost);
+      begin = pivot_index + 1;
+      leftmost = 0;
+   }
+}
+
+/**
+ * Sort an array.
+ * 
+ * Long arrays are sorted with a radix sort over the bits of their values, in
+ * linear time, and the other ones with a pattern-defeating quicksort, without
+ * the indirect calls to a comparison function of qsort. Descending order is
+ * given by the keys of the radix sort, or by reversing the array sorted
+ * ascendingly by the quicksort.
+ * 
+ * Floating-point values are ordered as by the comparison operators, except
+ * that the radix sort orders -0 before 0.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    descending: Whether to sort descendingly.
+ *    ws: Workspace from which to allocate the buffer of the radix sort, or
+ *       NULL to allocate it from the heap.
+ */
+void KERNEL(sort)(KERNEL_TYPE *x, int64_t n, int descending, workspace *ws)
+{
+   COUNT_TIME_BEGIN(start);
+
+   if (n >= SORT_RADIX_LENGTH)
+   {
+      workspace temporary;
+      ws = workspace_or_temporary(ws, &temporary, sort_workspace_size(n));
+      size_t mark = ws->used;
+
+      KERNEL_TYPE *buffer = workspace_alloc(ws, n * sizeof(KERNEL_TYPE));
+      if (buffer != NULL)
+         KERNEL(typed_radix_sort)(x, n, descending, buffer);
+
+      workspace_done(ws, &temporary, mark);
+      if (buffer != NULL)
+      {
+         COUNT_TIME_END(PHASE_SORT, start);
+         return;
+      }
+   }
+
+   if (n > 1)
+   {
+      // Number of unbalanced partitions allowed, the logarithm of n
+      int bad_allowed = 0;
+      for (int64_t m = n; m > 0; m >>= 1)
+         bad_allowed++;
+
+      KERNEL(typed_quick_sort)(x, 0, n - 1, bad_allowed, 1);
+   }
+
+   if (descending)
+      for (int64_t i = 0, j = n - 1; i < j; i++, j--)
+         KERNEL(typed_swap_pair)(x, NULL, i, j);
+
+   COUNT_TIME_END(PHASE_SORT, start);
+}
+
+/**
+ * State of a parallel radix sort, shared by its tasks, each of which works on
+ * a chunk of the array.
+ */
+typedef struct
+{
+   KERNEL_TYPE *x;  // Array
+   KERNEL_TYPE *source;  // Array or buffer holding the keys of the current pass
+   KERNEL_TYPE *destination;  // The other one
+   int64_t n;  // Length of the array
+   int64_t n_chunks;
+   KERNEL_KEY_TYPE mask;  // Mask of the keys, complementing them to sort descendingly
+   int byte;  // Byte of the keys of the current pass
+   int64_t *counts;  // Counts of the bytes of each chunk, turned into the offsets of their buckets
+} KERNEL(typed_radix_sort_context);
+
+/**
+ * Counts of a byte of the keys of a chunk of a parallel radix sort.
+ */
+static inline int64_t *KERNEL(typed_radix_counts)(KERNEL(typed_radix_sort_context) *radix, int64_t chunk, int b)
+{
+   return radix->counts + (chunk * sizeof(KERNEL_KEY_TYPE) + b) * 256;
+}
+
+/**
+ * Task of a parallel radix sort, turning the values of a chunk into their keys
+ * in-place and counting all their bytes.
+ */
+static void KERNEL(typed_radix_keys_task)(void *context, int64_t chunk, int64_t thread)
+{
+   KERNEL(typed_radix_sort_context) *radix = context;
+   int64_t begin = chunk * radix->n / radix->n_chunks;
+   int64_t end = (chunk + 1) * radix->n / radix->n_chunks;
+   int64_t *counts = KERNEL(typed_radix_counts)(radix, chunk, 0);
+   KERNEL_KEY_TYPE key;
+
+   memset(counts, 0, sizeof(KERNEL_KEY_TYPE) * 256 * sizeof(int64_t));
+   for (int64_t i = begin; i < end; i++)
+   {
+      key = KERNEL(typed_to_key)(radix->x[i]) ^ radix->mask;
+      memcpy(&radix->x[i], &key, sizeof(key));
+      for (int b = 0; b < (int)sizeof(KERNEL_KEY_TYPE); b++)
+         counts[b * 256 + ((key >> (8 * b)) & 0xFF)]++;
+   }
+}
+
+/**
+ * Task of a parallel radix sort, counting the byte of the current pass of the
+ * keys of a chunk.
+ */
+static void KERNEL(typed_radix_count_task)(void *context, int64_t chunk, int64_t thread)
+{
+   KERNEL(typed_radix_sort_context) *radix = context;
+   int64_t begin = chunk * radix->n / radix->n_chunks;
+   int64_t end = (chunk + 1) * radix->n / radix->n_chunks;
+   int64_t *count = KERNEL(typed_radix_counts)(radix, chunk, radix->byte);
+   KERNEL_KEY_TYPE key;
+
+   memset(count, 0, 256 * sizeof(int64_t));
+   for (int64_t i = begin; i < end; i++)
+   {
+      memcpy(&key, &radix->source[i], sizeof(key));
+      count[(key >> (8 * radix->byte)) & 0xFF]++;
+   }
+}
+
+/**
+ * Task of a parallel radix sort, moving the keys of a chunk to the buckets of
+ * the byte of the current pass.
+ */
+static void KERNEL(typed_radix_scatter_task)(void *context, int64_t chunk, int64_t thread)
+{
+   KERNEL(typed_radix_sort_context) *radix = context;
+   int64_t begin = chunk * radix->n / radix->n_chunks;
+   int64_t end = (chunk + 1) * radix->n / radix->n_chunks;
+   int64_t *offset = KERNEL(typed_radix_counts)(radix, chunk, radix->byte);
+   KERNEL_KEY_TYPE key;
+
+   for (int64_t i = begin; i < end; i++)
+   {
+      memcpy(&key, &radix->source[i], sizeof(key));
+      memcpy(&radix->destination[offset[(key >> (8 * radix->byte)) & 0xFF]++], &key, sizeof(key));
+   }
+}
+
+/**
+ * Task of a parallel radix sort, turning the sorted keys of a chunk back into
+ * their values.
+ */
+static void KERNEL(typed_radix_values_task)(void *context, int64_t chunk, int64_t thread)
+{
+   KERNEL(typed_radix_sort_context) *radix = context;
+   int64_t begin = chunk * radix->n / radix->n_chunks;
+   int64_t end = (chunk + 1) * radix->n / radix->n_chunks;
+   KERNEL_KEY_TYPE key;
+
+   for (int64_t i = begin; i < end; i++)
+   {
+      memcpy(&key, &radix->source[i], sizeof(key));
+      radix->x[i] = KERNEL(typed_from_key)(key ^ radix->mask);
+   }
+}
+
+/**
+ * Sort an array over several threads.
+ * 
+ * The array is split into one chunk per thread, and each pass of the radix sort
+ * of function 'sort' is split between the chunks: the threads count the bytes
+ * of their chunks, from which the buckets of each chunk are given their
+ * offsets, and then move the keys of their chunks to their buckets. Since the
+ * radix sort is stable, the array is sorted exactly as by function 'sort'.
+ * Arrays shorter than SORT_PARALLEL_LENGTH are sorted by function 'sort'.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    descending: Whether to sort descendingly.
+ *    n_threads: Number of threads, including the calling thread.
+ *    ws: Workspace from which to allocate the buffer and the counts of the
+ *       radix sort, or NULL to allocate them from the heap.
+ */
+void KERNEL(sort_parallel)(KERNEL_TYPE *x, int64_t n, int descending, int64_t n_threads, workspace *ws)
+{
+   enum {N_BYTES = sizeof(KERNEL_KEY_TYPE)};
+
+   if (n_threads <= 1 || n < SORT_PARALLEL_LENGTH)
+   {
+      KERNEL(sort)(x, n, descending, ws);
+      return;
+   }
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, sort_parallel_workspace_size(n, n_threads));
+   size_t mark = ws->used;
+
+   KERNEL(typed_radix_sort_context) radix;
+   radix.x = x;
+   radix.n = n;
+   radix.n_chunks = n_threads;
+   radix.mask = descending ? ~(KERNEL_KEY_TYPE)0 : 0;
+   radix.counts = workspace_alloc(ws, n_threads * N_BYTES * 256 * sizeof(int64_t));
+   KERNEL_TYPE *buffer = workspace_alloc(ws, n * sizeof(KERNEL_TYPE));
+   if (radix.counts == NULL || buffer == NULL)
+   {
+      workspace_done(ws, &temporary, mark);
+      KERNEL(sort)(x, n, descending, ws);
+      return;
+   }
+
+   COUNT_TIME_BEGIN(start);
+   parallel_for(KERNEL(typed_radix_keys_task), &radix, n_threads, n_threads);
+
+   // The bytes that are the same for all the keys are skipped, as found from
+   // the counts of the first pass, which hold for the whole array whatever the
+   // order of the keys. These counts are also those of the chunks of the first
+   // byte that is not skipped, since the keys have not been moved yet
+   int skip[N_BYTES];
+   int64_t chunk, total;
+   int b, digit;
+   for (b = 0; b < N_BYTES; b++)
+   {
+      skip[b] = 0;
+      for (digit = 0; digit < 256; digit++)
+      {
+         total = 0;
+         for (chunk = 0; chunk < n_threads; chunk++)
+            total += KERNEL(typed_radix_counts)(&radix, chunk, b)[digit];
+         if (total == n)
+            skip[b] = 1;
+      }
+   }
+
+   radix.source = x;
+   radix.destination = buffer;
+   int first_pass = 1;
+   for (b = 0; b < N_BYTES; b++)
+   {
+      if (skip[b])
+         continue;
+
+      radix.byte = b;
+      if (!first_pass)
+         parallel_for(KERNEL(typed_radix_count_task), &radix, n_threads, n_threads);
+      first_pass = 0;
+
+      // Offsets of the buckets of each chunk, the keys of a bucket being ordered
+      // by chunk
+      int64_t offset = 0, bucket_size;
+      for (digit = 0; digit < 256; digit++)
+         for (chunk = 0; chunk < n_threads; chunk++)
+         {
+            int64_t *count = KERNEL(typed_radix_counts)(&radix, chunk, b);
+            bucket_size = count[digit];
+            count[digit] = offset;
+            offset += bucket_size;
+         }
+
+      parallel_for(KERNEL(typed_radix_scatter_task), &radix, n_threads, n_threads);
+
+      KERNEL_TYPE *swap_ = radix.source;
+      radix.source = radix.destination;
+      radix.destination = swap_;
+   }
+
+   parallel_for(KERNEL(typed_radix_values_task), &radix, n_threads, n_threads);
+   COUNT_TIME_END(PHASE_SORT, start);
+
+   workspace_done(ws, &temporary, mark);
+}
+
+/**
+ * Partition an array of values and, if given, the parallel array of weights
+ * into three regions around a pivot: lower than, equal to, and greater than
+ * the pivot value.
+ * 
+ * Equal values are gathered in a region of their own, so that a selection
+ * over a sample with many duplicates excludes all of them at once, instead of
+ * moving them to one side of the partition. Without weights, floating-point
+ * values are partitioned with function 'partition_three_way' of base.c.
+ * Otherwise, the values are partitioned around the pivot as in function
+ * 'partition_on_kth_element', counting the values equal to it on the way, and
+ * only if there are any is a second pass made to gather them after the pivot.
+ * 
+ * Arguments:
+ *    x: Array of values, over which to carry out the partition.
+ *    w: Array of weights, parallel to x, or NULL.
+ *    begin: Index where to begin partitioning.
+ *    end: Index where to end partitioning.
+ *    k: Position in the arrays of the element to use as a pivot.
+ *    lower: Output starting index of the region equal to the pivot.
+ *    upper: Output ending index of the region equal to the pivot.
+ */
+static void KERNEL(typed_partition_three_way)(
+   KERNEL_TYPE *x, double *w, int64_t begin, int64_t end, int64_t k, int64_t *lower, int64_t *upper)
+{
+   KERNEL_TYPE value = x[k];
+
+   // Every element is compared with the pivot, and those lower than it are
+   // moved below it
+   COUNT(partitions, 1);
+   COUNT(comparisons, end - begin + 1);
+
+#if KERNEL_FLOATING
+   if (w == NULL)
+   {
+      KERNEL(partition_three_way)(x, begin, end, value, lower, upper);
+      COUNT(swaps, *lower - begin);
+      return;
+   }
+#endif
+
+   KERNEL(typed_swap_pair)(x, w, k, end);
+
+   int64_t i = begin;
+   int64_t n_equal = 0;
+   for (int64_t j = begin; j < end; j++)
+   {
+      if (x[j] < value)
+      {
+         KERNEL(typed_swap_pair)(x, w, i, j);
+         i++;
+      }
+      else if (!(value < x[j]))
+         n_equal++;
+   }
+
+   KERNEL(typed_swap_pair)(x, w, i, end);
+   COUNT(swaps, i - begin);
+
+   *lower = i;
+   *upper = i;
+   if (n_equal > 0)
+   {
+      for (int64_t j = i + 1; j <= end; j++)
+         if (!(value < x[j]))
+            KERNEL(typed_swap_pair)(x, w, ++(*upper), j);
+   }
+}
+
+/**
+ * Sort a short array of values and, if given, the parallel array of weights
+ * by insertion.
+ */
+static void KERNEL(typed_insertion_sort)(KERNEL_TYPE *x, double *w, int64_t begin, int64_t end)
+{
+   for (int64_t i = begin + 1; i <= end; i++)
+      for (int64_t j = i; j > begin && x[j] < x[j - 1]; j--)
+         KERNEL(typed_swap_pair)(x, w, j, j - 1);
+}
+
+static KERNEL_TYPE KERNEL(typed_select_in_place)(
+   KERNEL_TYPE *x, double *w, int64_t begin, int64_t end, int64_t k, uint64_t *random_state);
+
+/**
+ * Pivot of an array given by the median of medians of groups of 5 values,
+ * which is greater than and lower than at least 30% of the values each.
+ * 
+ * The medians of the groups are moved to the beginning of the array, where
+ * their median is selected.
+ * 
+ * Returns:
+ *    Index of the pivot.
+ */
+static int64_t KERNEL(typed_median_of_medians)(
+   KERNEL_TYPE *x, double *w, int64_t begin, int64_t end, uint64_t *random_state)
+{
+   int64_t n_groups = 0;
+
+   for (int64_t i = begin; i <= end; i += 5)
+   {
+      int64_t last = i + 4 <= end ? i + 4 : end;
+      KERNEL(typed_insertion_sort)(x, w, i, last);
+      KERNEL(typed_swap_pair)(x, w, begin + n_groups, i + (last - i) / 2);
+      n_groups++;
+   }
+
+   int64_t median_index = begin + (n_groups - 1) / 2;
+   KERNEL(typed_select_in_place)(x, w, begin, begin + n_groups - 1, median_index, random_state);
+
+   return median_index;
+}
+
+/**
+ * Select the k-th smallest value of an array of values and, if given, of the
+ * parallel array of weights, partitioning them in-place around it.
+ * 
+ * This is an introselect: pivots are chosen at random, with three-way
+ * partitions, while the number of elements partitioned remains within a
+ * linear budget, after which pivots are chosen by the median of medians. The
+ * selection is thus linear in the worst case, including on adversarial inputs,
+ * while the random pivots keep it fast on the other ones.
+ * 
+ * Arguments:
+ *    x: Array of values, over which to carry out the selection.
+ *    w: Array of weights, parallel to x, or NULL.
+ *    begin: Index where to begin partitioning.
+ *    end: Index where to end partitioning.
+ *    k: Number denoting the k-th smallest value.
+ *    random_state: State of the generator of the pivots.
+ * 
+ * Returns:
+ *    K-th smallest value, which is at index k of the partitioned array.
+ */
+static KERNEL_TYPE KERNEL(typed_select_in_place)(
+   KERNEL_TYPE *x, double *w, int64_t begin, int64_t end, int64_t k, uint64_t *random_state)
+{
+   int64_t budget = SELECTION_BUDGET * (end - begin + 1);
+   int64_t pivot_index, lower, upper;
+
+   while (1)
+   {
+      if (begin == end)
+         return x[begin];
+
+      if (budget > 0)
+         pivot_index = random_range(random_state, begin, end);
+      else
+         pivot_index = KERNEL(typed_median_of_medians)(x, w, begin, end, random_state);
+      budget -= end - begin + 1;
+
+      KERNEL(typed_partition_three_way)(x, w, begin, end, pivot_index, &lower, &upper);
+
+      if (k < lower)
+         end = lower - 1;
+      else if (k > upper)
+         begin = upper + 1;
+      else
+         return x[k];
+   }
+}
+
+/**
+ * Weighted quantile, computed in-place.
+ * 
+ * The weighted quantile of order q is the element such that the weights of
+ * the elements before it add up to less than q times the total weight, and
+ * those of the elements after it to less than 1 - q times the total weight.
+ * The weighted median is the weighted quantile of order 0.5.
+ * 
+ * The values and the weights are partitioned in-place as parallel arrays, and
+ * the weights of the elements at the quantile positions are modified, so the
+ * content of both arrays is not preserved.
+ * 
+ * Arguments:
+ *    x: array of values
+ *    w: array of weights
+ *    begin: Beginning index of the sub-array over which to calculate the
+ *       weighted quantile.
+ *    end: Ending index of the sub-array over which to calculate the weighted
+ *       quantile.
+ *    q: Order of the quantile, between 0 and 1.
+ *    random_state: State of the generator of the pivots.
+ * 
+ * Returns:
+ *    Weighted quantile.
+*/
+double KERNEL(weighted_quantile_in_place)(
+   KERNEL_TYPE *x, double *w, int64_t begin, int64_t end, double q, uint64_t *random_state)
+{
+   int64_t n, i, median_index;
+   KERNEL_TYPE median;
+   double w_lower_sum, w_lower_sum_norm, w_higher_sum, w_higher_sum_norm;
+
+   double w_sum = sum_double(w + begin, end - begin + 1);
+
+   while (1)
+   {
+      n = end - begin + 1; // Length between begin and end
+
+      if (n == 1)
+         return (double)x[begin];
+      else if (n == 2)
+      {
+         // A pair of the whole array has not been partitioned yet
+         if (x[end] < x[begin])
+            KERNEL(typed_swap_pair)(x, w, begin, end);
+
+         if (w[begin] * (1. - q) >= w[end] * q)
+            return (double)x[begin];
+         else
+            return (double)x[end];
+      }
+      else
+      {
+         median_index = begin + (n - 1) / 2;  // Lower median index
+         median = KERNEL(typed_select_in_place)(x, w, begin, end, median_index, random_state);
+
+         w_lower_sum = 0.;
+         for (i = begin; i < median_index; i++)
+            w_lower_sum += w[i];
+         w_lower_sum_norm = w_lower_sum / w_sum;
+
+         w_higher_sum = 0.;
+         for (i = median_index + 1; i <= end; i++)
+            w_higher_sum += w[i];
+         w_higher_sum_norm = w_higher_sum / w_sum;
+
+         if (w_lower_sum_norm < q && w_higher_sum_norm < 1. - q)
+            return (double)median;
+         else if (w_lower_sum_norm > q)
+         {
+            w[median_index] = w[median_index] + w_higher_sum;
+            end = median_index;
+         }
+         else
+         {
+            w[median_index] = w[median_index] + w_lower_sum;
+            begin = median_index;
+         }
+      }
+   }
+}
+
+/**
+ * Weighted median, computed in-place.
+ * 
+ * For arrays with an even number of elements, this function calculates the
+ * lower weighted median.
+ * 
+ * The values and the weights are partitioned in-place as parallel arrays, and
+ * the weights of the elements at the median positions are modified, so the
+ * content of both arrays is not preserved.
+ * 
+ * Arguments:
+ *    x: array of values
+ *    w: array of weights
+ *    begin: Beginning index of the sub-array over which to calculate the
+ *       weighted median.
+ *    end: Ending index of the sub-array over which to calculate the weighted
+ *       median.
+ *    random_state: State of the generator of the pivots.
+ * 
+ * Returns:
+ *    Weighted median.
+*/
+double KERNEL(weighted_median_in_place)(
+   KERNEL_TYPE *x, double *w, int64_t begin, int64_t end, uint64_t *random_state)
+{
+   return KERNEL(weighted_quantile_in_place)(x, w, begin, end, 0.5, random_state);
+}
+
+/**
+ * Lower weighted quantiles of a sub-array, for targets of cumulative weight
+ * sorted ascendingly, computed in-place.
+ * 
+ * The sub-array is partitioned around its median, which is the quantile of the
+ * targets within its weight, and the targets below and above it are found in
+ * the lower and the upper part of the sub-array. The partitions of the
+ * selections are thus shared by all the targets, and each part is only
+ * partitioned further while it holds any of them.
+ * 
+ * Arguments:
+ *    x: Array of values.
+ *    w: Array of weights, parallel to x.
+ *    begin: Beginning index of the sub-array.
+ *    end: Ending index of the sub-array.
+ *    w_below: Total weight of the elements lower than the sub-array.
+ *    quantiles: Array of targets, each of which is replaced by the lowest value
+ *       whose cumulative weight reaches it, among the values of positive
+ *       weight.
+ *    n_targets: Number of targets.
+ *    random_state: State of the generator of the pivots.
+ */
+static void KERNEL(typed_weighted_quantiles)(
+   KERNEL_TYPE *x, double *w, int64_t begin, int64_t end, double w_below, double *quantiles, int64_t n_targets,
+   uint64_t *random_state)
+{
+   int64_t i, pivot_index, n_lower, n_through;
+   double w_lower, w_through;
+
+   while (n_targets > 0)
+   {
+      if (begin == end)
+      {
+         for (i = 0; i < n_targets; i++)
+            quantiles[i] = (double)x[begin];
+         return;
+      }
+
+      pivot_index = begin + (end - begin) / 2;  // Lower median index
+      KERNEL_TYPE pivot = KERNEL(typed_select_in_place)(x, w, begin, end, pivot_index, random_state);
+
+      w_lower = w_below + sum_double(w + begin, pivot_index - begin);
+      w_through = w_lower + w[pivot_index];
+
+      // Targets reached below the pivot, and at the pivot
+      n_lower = 0;
+      while (n_lower < n_targets && quantiles[n_lower] <= w_lower && w_below < w_lower)
+         n_lower++;
+      n_through = n_lower;
+      while (n_through < n_targets && quantiles[n_through] <= w_through && w_lower < w_through)
+         n_through++;
+
+      for (i = n_lower; i < n_through; i++)
+         quantiles[i] = (double)pivot;
+
+      KERNEL(typed_weighted_quantiles)(x, w, begin, pivot_index - 1, w_below, quantiles, n_lower, random_state);
+
+      begin = pivot_index + 1;
+      w_below = w_through;
+      quantiles += n_through;
+      n_targets -= n_through;
+   }
+}
+
+/**
+ * Weighted quantiles of several orders, computed in-place in a single
+ * multi-selection.
+ * 
+ * The lower weighted quantile of order q is the lowest value whose cumulative
+ * weight, in ascending order of the values, reaches q times the total weight,
+ * among the values of positive weight. For q = 0.5, the quantile is the value
+ * returned by function 'weighted_median', which is the lower weighted quantile
+ * except when the cumulative weight of a value is exactly half of the total
+ * weight: the weighted median is then found again by function
+ * 'weighted_median_in_place', which may return a higher value.
+ * 
+ * The values and the weights are partitioned in-place as parallel arrays, and
+ * the weights are modified when the weighted median is found again, so the
+ * content of both arrays is not preserved.
+ * 
+ * Arguments:
+ *    x: Array of values.
+ *    w: Array of non-negative weights.
+ *    n: Length of the arrays.
+ *    qs: Orders of the quantiles, between 0 and 1, sorted ascendingly.
+ *    n_qs: Number of orders.
+ *    quantiles: Output array of n_qs weighted quantiles, in the order of qs,
+ *       which are NaN if the weights are all zero.
+ *    random_state: State of the generator of the pivots.
+ */
+void KERNEL(weighted_quantiles_in_place)(
+   KERNEL_TYPE *x, double *w, int64_t n, double *qs, int64_t n_qs, double *quantiles, uint64_t *random_state)
+{
+   int64_t i, j;
+   double w_sum = sum_double(w, n);
+
+   if (!(w_sum > 0.))
+   {
+      for (i = 0; i < n_qs; i++)
+         quantiles[i] = NAN;
+      return;
+   }
+
+   for (i = 0; i < n_qs; i++)
+      quantiles[i] = qs[i] * w_sum;
+
+   KERNEL(typed_weighted_quantiles)(x, w, 0, n - 1, 0., quantiles, n_qs, random_state);
+
+   // Weighted median, on a tie of the cumulative weight of the lower one
+   for (i = 0; i < n_qs && qs[i] < 0.5; i++)
+      ;
+   if (i < n_qs && qs[i] == 0.5)
+   {
+      double w_through = 0.;
+      for (j = 0; j < n; j++)
+         if ((double)x[j] <= quantiles[i])
+            w_through += w[j];
+
+      if (w_through == 0.5 * w_sum)
+      {
+         double median = KERNEL(weighted_median_in_place)(x, w, 0, n - 1, random_state);
+         for (; i < n_qs && qs[i] == 0.5; i++)
+            quantiles[i] = median;
+      }
+   }
+}
+
+/**
+ * Lower weighted quantiles of the values of a data sample lying above values
+ * of known total weight, computed in-place, as when the values were gathered
+ * from a data sample that does not fit in memory.
+ * 
+ * Arguments:
+ *    x: Array of values.
+ *    w: Array of non-negative weights.
+ *    n: Length of the arrays, at least 1.
+ *    w_below: Total weight of the values of the data sample lower than those
+ *       of the array.
+ *    targets: Array of targets of cumulative weight in the data sample,
+ *       sorted ascendingly, each of which is replaced by the lowest value whose
+ *       cumulative weight reaches it, or by the highest value if none does.
+ *    n_targets: Number of targets.
+ *    random_state: State of the generator of the pivots.
+ */
+void KERNEL(weighted_quantiles_above_in_place)(
+   KERNEL_TYPE *x, double *w, int64_t n, double w_below, double *targets, int64_t n_targets,
+   uint64_t *random_state)
+{
+   KERNEL(typed_weighted_quantiles)(x, w, 0, n - 1, w_below, targets, n_targets, random_state);
+}
+
+/**
+ * Select elements of given ranks of a sub-array, sorted ascendingly, so that
+ * each of them is at the index of its rank, as in a sorted array.
+ * 
+ * The middle rank is selected first, and the lower and upper ranks are then
+ * selected in the parts of the sub-array below and above it.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    begin: Beginning index of the sub-array.
+ *    end: Ending index of the sub-array.
+ *    ranks: Array of ranks in the sub-array, sorted ascendingly without
+ *       repetitions.
+ *    n_ranks: Number of ranks.
+ *    random_state: State of the generator of the pivots.
+ */
+static void KERNEL(typed_select_ranks)(
+   KERNEL_TYPE *x, int64_t begin, int64_t end, int64_t *ranks, int64_t n_ranks, uint64_t *random_state)
+{
+   int64_t i, middle, k;
+
+   while (n_ranks > 0)
+   {
+      middle = n_ranks / 2;
+      k = ranks[middle];
+
+      // The lowest element, often the successor of a selected rank, is found
+      // in a single pass
+      if (k == begin)
+      {
+         for (i = begin + 1; i <= end; i++)
+            if (x[i] < x[begin])
+               KERNEL(typed_swap_pair)(x, NULL, begin, i);
+      }
+      else
+         KERNEL(typed_select_in_place)(x, NULL, begin, end, k, random_state);
+
+      KERNEL(typed_select_ranks)(x, begin, k - 1, ranks, middle, random_state);
+
+      begin = k + 1;
+      ranks += middle + 1;
+      n_ranks -= middle + 1;
+   }
+}
+
+/**
+ * Linear interpolation between two values a <= b at a fraction t of the way,
+ * from the closer of the two, as numpy.quantile.
+ */
+static double KERNEL(typed_interpolate)(KERNEL_TYPE a, KERNEL_TYPE b, double t)
+{
+   double width = (double)KERNEL_WIDTH(a, b);
+
+   if (t == 0.)
+      return (double)a;
+   else if (t < 0.5)
+      return (double)a + width * t;
+   else
+      return (double)b - width * (1. - t);
+}
+
+/**
+ * Quantiles of several orders, computed in-place in a single multi-selection.
+ * 
+ * The quantile of order q is interpolated linearly between the elements of
+ * ranks floor(h) and floor(h) + 1, where h = (n - 1) q, as the default method
+ * of numpy.quantile. The elements of all the ranks are selected at once, with
+ * the partitions of the selections shared by all of them.
+ * 
+ * Arguments:
+ *    x: Array, partitioned in-place, so its order is not preserved.
+ *    n: Length of the array.
+ *    qs: Orders of the quantiles, between 0 and 1, sorted ascendingly.
+ *    n_qs: Number of orders.
+ *    quantiles: Output array of n_qs quantiles, in the order of qs, which are
+ *       NaN if the memory could not be allocated.
+ *    ws: Workspace from which to allocate the ranks, or NULL to allocate them
+ *       from the heap.
+ */
+void KERNEL(quantiles_in_place)(KERNEL_TYPE *x, int64_t n, double *qs, int64_t n_qs, double *quantiles, workspace *ws)
+{
+   int64_t i, low;
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, quantiles_workspace_size(n_qs));
+   size_t mark = ws->used;
+
+   // Ranks of the elements between which to interpolate, without repetitions
+   int64_t *ranks = workspace_alloc(ws, 2 * n_qs * sizeof(int64_t));
+   if (ranks == NULL)
+   {
+      ws->failed = 1;
+      for (i = 0; i < n_qs; i++)
+         quantiles[i] = NAN;
+      workspace_done(ws, &temporary, mark);
+      return;
+   }
+
+   int64_t n_ranks = 0;
+   for (i = 0; i < n_qs; i++)
+   {
+      low = (int64_t)floor((double)(n - 1) * qs[i]);
+      if (n_ranks == 0 || low > ranks[n_ranks - 1])
+         ranks[n_ranks++] = low;
+      if (low + 1 < n && low + 1 > ranks[n_ranks - 1])
+         ranks[n_ranks++] = low + 1;
+   }
+
+   KERNEL(typed_select_ranks)(x, 0, n - 1, ranks, n_ranks, &ws->random_state);
+
+   for (i = 0; i < n_qs; i++)
+   {
+      double h = (double)(n - 1) * qs[i];
+      low = (int64_t)floor(h);
+      if (low + 1 >= n)
+         quantiles[i] = (double)x[low];
+      else
+         quantiles[i] = KERNEL(typed_interpolate)(x[low], x[low + 1], h - (double)low);
+   }
+
+   workspace_done(ws, &temporary, mark);
+}
+
+#if KERNEL_FLOATING
+
+// The medcouple is defined for floating-point types only
+
+/**
+ * Function used in function 'medcouple'.
+ */
+static KERNEL_TYPE KERNEL(h_kernel)(
+   int64_t i, int64_t j, KERNEL_TYPE *z_plus, int64_t n_plus, KERNEL_TYPE *z_minus, int64_t n_minus,
+   double epsilon
+   )
+{
+   KERNEL_TYPE a = z_plus[i];
+   KERNEL_TYPE b = z_minus[j];
+
+   if (fabs(a - b) <= 2 * epsilon)
+      return (KERNEL_TYPE)sign(n_plus - i - j - 1);
+   else
+      return (a + b) / (a - b);
+}
+
+/**
+ * Implicit matrix whose entries do not increase along its rows nor along its
+ * columns, from which function 'typed_select_matrix' selects an entry without
+ * computing the whole matrix.
+ * 
+ * The entries are those of the kernel of the medcouple, between the scaled
+ * data points above and below the median, the pairwise differences x[i] -
+ * x[n - 1 - j] of an array x sorted descendingly, for the Qn estimator, or the
+ * pairwise sums x[i] + x[i + j], for the Hodges-Lehmann estimator. The matrix
+ * of the sums is triangular: row i only has its first n - i columns, which
+ * hold the sums of each pair of data points once.
+ */
+typedef struct
+{
+   int kind;  // MATRIX_MEDCOUPLE, MATRIX_DIFFERENCES or MATRIX_SUMS
+   KERNEL_TYPE *rows;  // Values indexing the rows
+   int64_t n_rows;
+   KERNEL_TYPE *columns;  // Values indexing the columns
+   int64_t n_columns;
+   double epsilon;  // Smallest representable positive number, for the kernel of the medcouple
+} KERNEL(typed_matrix);
+
+/**
+ * Entry of an implicit matrix.
+ */
+static inline KERNEL_TYPE KERNEL(typed_matrix_entry)(KERNEL(typed_matrix) *m, int64_t i, int64_t j)
+{
+   if (m->kind == MATRIX_DIFFERENCES)
+      return m->rows[i] - m->columns[m->n_columns - 1 - j];
+   else if (m->kind == MATRIX_SUMS)
+      return m->rows[i] + m->rows[i + j];
+   else
+      return KERNEL(h_kernel)(i, j, m->rows, m->n_rows, m->columns, m->n_columns, m->epsilon);
+}
+
+/**
+ * Number of columns of a row of an implicit matrix.
+ */
+static inline int64_t KERNEL(typed_matrix_row_length)(KERNEL(typed_matrix) *m, int64_t i)
+{
+   return m->kind == MATRIX_SUMS ? m->n_columns - i : m->n_columns;
+}
+
+/**
+ * Function used in function 'typed_select_matrix'.
+ * 
+ * Walks down the rows between i_begin and i_end, starting from column j of row
+ * i_end, and adds the changes of the borders to those previously in p. When
+ * resuming a walk over rows already walked from another column, the walk stops
+ * at the first row whose border is unchanged, since the borders of the
+ * following rows are then unchanged too.
+ * 
+ * Returns:
+ *    Sum of the changes of the borders.
+ */
+static int64_t KERNEL(where_h_greater_than_u)(
+   int64_t *p, int64_t i_begin, int64_t i_end, int64_t j_begin, int resume, KERNEL(typed_matrix) *m,
+   KERNEL_TYPE u, double epsilon
+   )
+{
+   int64_t i, j = j_begin;
+   int64_t change = 0;
+
+   for (i = i_end; i >= i_begin; i--)
+   {
+      int64_t length = KERNEL(typed_matrix_row_length)(m, i);
+      while (j < length && KERNEL(typed_matrix_entry)(m, i, j) - u > epsilon)
+         j++;
+
+      if (resume && p[i] == j - 1)
+         break;
+      change += j - 1 - p[i];
+      p[i] = j - 1;
+   }
+
+   // One entry is compared for each column walked past, and one more per row
+   COUNT(comparisons, j - j_begin + i_end - i + (i >= i_begin));
+
+   return change;
+}
+
+/**
+ * Function used in function 'typed_select_matrix'.
+ * 
+ * Walks up the rows between i_begin and i_end, starting from column j of row
+ * i_begin, as function 'where_h_greater_than_u'.
+ * 
+ * Returns:
+ *    Sum of the changes of the borders.
+ */
+static int64_t KERNEL(where_h_less_than_u)(
+   int64_t *q, int64_t i_begin, int64_t i_end, int64_t j_begin, int resume, KERNEL(typed_matrix) *m,
+   KERNEL_TYPE u, double epsilon
+   )
+{
+   int64_t i, j = j_begin;
+   int64_t change = 0;
+
+   for (i = i_begin; i <= i_end; i++)
+   {
+      // The rows get shorter downwards in a triangular matrix, whose columns
+      // beyond their ends are skipped without being compared
+      int64_t length = KERNEL(typed_matrix_row_length)(m, i);
+      if (j >= length)
+      {
+         COUNT(comparisons, length - 1 - j);
+         j = length - 1;
+      }
+      while (j >= 0 && KERNEL(typed_matrix_entry)(m, i, j) - u < -epsilon)
+         j--;
+
+      if (resume && q[i] == j + 1)
+         break;
+      change += j + 1 - q[i];
+      q[i] = j + 1;
+   }
+
+   COUNT(comparisons, j_begin - j + i - i_begin + (i <= i_end));
+
+   return change;
+}
+
+/**
+ * State of the iterations of function 'typed_select_matrix', shared by the
+ * tasks over the blocks of rows of the matrix, when they are split between
+ * threads.
+ */
+typedef struct
+{
+   KERNEL(typed_matrix) *m;
+   int64_t n_blocks;
+   int64_t *left_border;
+   int64_t *right_border;
+   KERNEL_TYPE *row_medians;
+   double *weights;
+   int64_t *row_offsets;  // Index of the first row median of each block
+   KERNEL_TYPE w_median;
+   double wm_epsilon;
+   int64_t *left_border_tent;
+   int64_t *right_border_tent;
+   int64_t *left_changes;  // Sum of the tentative borders of each block
+   int64_t *right_changes;
+} KERNEL(typed_select_matrix_context);
+
+/**
+ * Task of function 'typed_select_matrix', counting the rows of a block that
+ * have entries between their borders.
+ */
+static void KERNEL(typed_select_matrix_count_task)(void *context, int64_t block, int64_t thread)
+{
+   KERNEL(typed_select_matrix_context) *sm = context;
+   int64_t begin = block * sm->m->n_rows / sm->n_blocks;
+   int64_t end = (block + 1) * sm->m->n_rows / sm->n_blocks;
+
+   int64_t n_middle_indices = 0;
+   for (int64_t i = begin; i < end; i++)
+      if (sm->left_border[i] <= sm->right_border[i])
+         n_middle_indices++;
+
+   sm->row_offsets[block] = n_middle_indices;
+}
+
+/**
+ * Task of function 'typed_select_matrix', computing the medians of the entries
+ * between the borders of the rows of a block, weighted by their number.
+ */
+static void KERNEL(typed_select_matrix_rows_task)(void *context, int64_t block, int64_t thread)
+{
+   KERNEL(typed_select_matrix_context) *sm = context;
+   int64_t begin = block * sm->m->n_rows / sm->n_blocks;
+   int64_t end = (block + 1) * sm->m->n_rows / sm->n_blocks;
+   int64_t mid_border;
+
+   int64_t j = sm->row_offsets[block];
+   for (int64_t i = begin; i < end; i++)
+      if (sm->left_border[i] <= sm->right_border[i])
+      {
+         mid_border = (sm->left_border[i] + sm->right_border[i]) / 2;
+         sm->row_medians[j] = KERNEL(typed_matrix_entry)(sm->m, i, mid_border);
+         sm->weights[j] = sm->right_border[i] - sm->left_border[i] + 1;
+         j++;
+      }
+}
+
+/**
+ * Task of function 'typed_select_matrix', computing the tentative borders of
+ * the rows of a block, walking from the first column for the right borders and
+ * from the last one for the left borders.
+ */
+static void KERNEL(typed_select_matrix_borders_task)(void *context, int64_t block, int64_t thread)
+{
+   KERNEL(typed_select_matrix_context) *sm = context;
+   int64_t begin = block * sm->m->n_rows / sm->n_blocks;
+   int64_t end = (block + 1) * sm->m->n_rows / sm->n_blocks;
+
+   fill_array_int(sm->right_border_tent + begin, end - begin, 0);
+   sm->right_changes[block] = KERNEL(where_h_greater_than_u)(
+      sm->right_border_tent, begin, end - 1, 0, 0, sm->m, sm->w_median, sm->wm_epsilon);
+
+   fill_array_int(sm->left_border_tent + begin, end - begin, 0);
+   sm->left_changes[block] = KERNEL(where_h_less_than_u)(
+      sm->left_border_tent, begin, end - 1, sm->m->n_columns - 1, 0, sm->m, sm->w_median, sm->wm_epsilon);
+}
+
+/**
+ * Run a task of function 'typed_select_matrix' over all the blocks of rows, in
+ * parallel if there are several blocks.
+ */
+static void KERNEL(typed_select_matrix_run)(parallel_task task, KERNEL(typed_select_matrix_context) *sm)
+{
+   if (sm->n_blocks > 1)
+      parallel_for(task, sm, sm->n_blocks, sm->n_blocks);
+   else
+      task(sm, 0, 0);
+}
+
+/**
+ * Select the k-th largest entry of an implicit matrix, with the rows of the
+ * matrix split between threads.
+ * 
+ * This is the selection of Johnson and Mizoguchi: the entries of each row
+ * between a left and a right border remain candidates, and at each iteration,
+ * the weighted median of the medians of the candidates of the rows, weighted by
+ * their number, gives tentative borders of the entries greater and lower than
+ * it, one of which halves about a quarter of the candidates, until as many
+ * candidates remain as rows, from which the entry is selected.
+ * 
+ * The medians of the rows and the tentative borders are computed over blocks
+ * of rows, one per thread. Since the walk over the rows of a block cannot start
+ * from the border of the previous block, each walk starts from the first (or
+ * last) column, and the blocks are then walked again in order from the border
+ * of their previous block, only until the borders no longer change, which
+ * gives the borders of the walk over all the rows. The result is thus the same
+ * whatever the number of threads.
+ * 
+ * Arguments:
+ *    m: Implicit matrix.
+ *    k: Index of the entry in the entries sorted descendingly.
+ *    epsilon1: Relative precision at which entries are compared with the
+ *       weighted medians, the machine epsilon for the kernel of the medcouple.
+ *    n_threads: Number of threads, including the calling thread. The rows are
+ *       only split if there are at least MEDCOUPLE_PARALLEL_ROWS of them.
+ *    ws: Workspace from which to allocate the temporary arrays.
+ * 
+ * Returns:
+ *    K-th largest entry, or NaN if the memory could not be allocated.
+ */
+static KERNEL_TYPE KERNEL(typed_select_matrix)(
+   KERNEL(typed_matrix) *m, int64_t k, double epsilon1, int64_t n_threads, workspace *ws)
+{
+   int64_t i, j, block;
+   int64_t n_rows = m->n_rows;
+   size_t mark = ws->used;
+
+   int64_t *left_border = workspace_alloc(ws, n_rows * sizeof(int64_t));
+   int64_t *right_border = workspace_alloc(ws, n_rows * sizeof(int64_t));
+   if (left_border == NULL || right_border == NULL)
+      goto failed;
+   fill_array_int(left_border, n_rows, 0);
+   
+   // Number of entries to the left of the right boundary
+   int64_t right_total = 0;
+
+   for (i = 0; i < n_rows; i++)
+   {
+      right_border[i] = KERNEL(typed_matrix_row_length)(m, i) - 1;
+      right_total += right_border[i] + 1;
+   }
+
+   // Number of entries to the left of the left border
+   int64_t left_total = 0;
+
+   // Iterate while the number of entries between the boundaries is greater
+   // than the number of rows in the matrix
+   int64_t right_tent_total, left_tent_total;
+   size_t loop_mark = ws->used;
+   KERNEL(typed_select_matrix_context) sm;
+   sm.m = m;
+   sm.n_blocks = n_threads > 1 && n_rows >= MEDCOUPLE_PARALLEL_ROWS ? n_threads : 1;
+   sm.left_border = left_border;
+   sm.right_border = right_border;
+   sm.row_medians = workspace_alloc(ws, n_rows * sizeof(KERNEL_TYPE));
+   sm.weights = workspace_alloc(ws, n_rows * sizeof(double));
+   sm.left_border_tent = workspace_alloc(ws, n_rows * sizeof(int64_t));  // Tentative border
+   sm.right_border_tent = workspace_alloc(ws, n_rows * sizeof(int64_t));  // Tentative border
+   int64_t one_block[3];  // Arrays of the blocks when there is only one
+   sm.row_offsets = sm.n_blocks > 1 ? workspace_alloc(ws, 3 * sm.n_blocks * sizeof(int64_t)) : one_block;
+   if (sm.row_medians == NULL || sm.weights == NULL || sm.left_border_tent == NULL || sm.right_border_tent == NULL
+       || sm.row_offsets == NULL)
+      goto failed;
+   sm.left_changes = sm.row_offsets + sm.n_blocks;
+   sm.right_changes = sm.left_changes + sm.n_blocks;
+   COUNT_TIME_BEGIN(matrix_start);
+   while (right_total - left_total > n_rows)
+   {
+      COUNT(iterations, 1);
+      KERNEL(typed_select_matrix_run)(KERNEL(typed_select_matrix_count_task), &sm);
+      int64_t n_middle_indices = 0, block_size;
+      for (block = 0; block < sm.n_blocks; block++)
+      {
+         block_size = sm.row_offsets[block];
+         sm.row_offsets[block] = n_middle_indices;
+         n_middle_indices += block_size;
+      }
+
+      KERNEL(typed_select_matrix_run)(KERNEL(typed_select_matrix_rows_task), &sm);
+
+      // The row medians and their weights are rebuilt at each iteration, so
+      // they can be partitioned in-place
+      COUNT_TIME_BEGIN(weighted_median_start);
+      sm.w_median = (KERNEL_TYPE)KERNEL(weighted_median_in_place)(
+         sm.row_medians, sm.weights, 0, n_middle_indices - 1, &ws->random_state);
+      COUNT_TIME_END(PHASE_WEIGHTED_MEDIAN, weighted_median_start);
+
+      // New tentative right and left boundaries
+      sm.wm_epsilon = epsilon1 * (epsilon1 + fabs(sm.w_median));
+      KERNEL(typed_select_matrix_run)(KERNEL(typed_select_matrix_borders_task), &sm);
+
+      right_tent_total = n_rows;
+      left_tent_total = 0;
+      for (block = 0; block < sm.n_blocks; block++)
+      {
+         right_tent_total += sm.right_changes[block];
+         left_tent_total += sm.left_changes[block];
+      }
+
+      // Walk the blocks again from the borders of their previous blocks
+      for (block = sm.n_blocks - 2; block >= 0; block--)
+      {
+         int64_t end = (block + 1) * n_rows / sm.n_blocks;
+         right_tent_total += KERNEL(where_h_greater_than_u)(
+            sm.right_border_tent, block * n_rows / sm.n_blocks, end - 1, sm.right_border_tent[end] + 1, 1, m,
+            sm.w_median, sm.wm_epsilon);
+      }
+      for (block = 1; block < sm.n_blocks; block++)
+      {
+         int64_t begin = block * n_rows / sm.n_blocks;
+         left_tent_total += KERNEL(where_h_less_than_u)(
+            sm.left_border_tent, begin, (block + 1) * n_rows / sm.n_blocks - 1, sm.left_border_tent[begin - 1] - 1, 1,
+            m, sm.w_median, sm.wm_epsilon);
+      }
+
+      if (k <= right_tent_total - 1)
+      {
+         copy_array_int(sm.right_border_tent, right_border, n_rows);
+         right_total = right_tent_total;
+      }
+      else
+      {
+         if (k > left_tent_total - 1)
+         {
+            copy_array_int(sm.left_border_tent, left_border, n_rows);
+            left_total = left_tent_total;
+         }
+         else
+         {
+            COUNT_TIME_END(PHASE_MATRIX, matrix_start);
+            workspace_release(ws, mark);
+
+            return sm.w_median;
+         }
+      }
+   }
+   COUNT_TIME_END(PHASE_MATRIX, matrix_start);
+
+   // The remaining entries take the place of the arrays of the loop
+   COUNT_TIME_BEGIN(remaining_start);
+   workspace_release(ws, loop_mark);
+
+   int64_t n_remaining = 0;
+   for (i = 0; i < n_rows; i++)
+   {
+      for (j = left_border[i]; j <= right_border[i]; j++)
+         n_remaining++;
+   }
+   
+   KERNEL_TYPE *remaining = workspace_alloc(ws, n_remaining * sizeof(KERNEL_TYPE));
+   if (remaining == NULL)
+      goto failed;
+   
+   int64_t r = 0;
+   for (i = 0; i < n_rows; i++)
+      for (j = left_border[i]; j <= right_border[i]; j++)
+      {
+         remaining[r] = - KERNEL(typed_matrix_entry)(m, i, j);
+         r++;
+      }
+
+   KERNEL_TYPE kth_largest = - KERNEL(typed_select_in_place)(
+      remaining, NULL, 0, n_remaining - 1, k - left_total, &ws->random_state);
+   COUNT_TIME_END(PHASE_REMAINING, remaining_start);
+
+   workspace_release(ws, mark);
+
+   return kth_largest;
+
+failed:
+   ws->failed = 1;
+   workspace_release(ws, mark);
+
+   return (KERNEL_TYPE)NAN;
+}
+
+/**
+ * Medcouple of an array sorted descendingly, with the rows of the matrix split
+ * between threads.
+ * 
+ * The medcouple is the median of the matrix of the kernel between the data
+ * points above and below the median, selected by function
+ * 'typed_select_matrix'. The result is the same whatever the number of
+ * threads.
+ * 
+ * Arguments:
+ *    x: Array sorted descendingly.
+ *    n: Length of the array.
+ *    epsilon1: Machine epsilon of the type.
+ *    epsilon2: The smallest representable positive number of the type.
+ *    n_threads: Number of threads, including the calling thread. The rows are
+ *       only split if there are at least MEDCOUPLE_PARALLEL_ROWS of them.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Medcouple, or NaN if the memory could not be allocated.
+ */
+static double KERNEL(typed_medcouple_sorted)(
+   KERNEL_TYPE *x, int64_t n, double epsilon1, double epsilon2, int64_t n_threads, workspace *ws)
+{
+   int64_t i;
+
+   if (n < 3)
+      return 0.;
+
+   int64_t median_index = n / 2;  // Lower median because sorted descendingly
+   KERNEL_TYPE median = x[median_index];
+
+   // Check if the median is at the edges up to relative epsilon
+   if (fabs(x[0] - median) < epsilon1 * (epsilon1 + fabs(median)))
+      return -1.0;
+   if (fabs(x[n - 1] - median) < epsilon1 * (epsilon1 + fabs(median)))
+      return 1.0;
+
+   // To rescale z_minus and z_plus inside [-0.5, 0.5], for greater numerical
+   // stability.
+   KERNEL_TYPE scale_factor = 2 * (KERNEL_TYPE)max_(x[0] - median, median - x[n - 1]);
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, medcouple_parallel_workspace_size(n, n_threads));
+   size_t mark = ws->used;
+
+   // Sizes of z_plus and z_minus
+   int64_t lowest_median_index = median_index;
+   KERNEL_TYPE lowest_median = median;
+   while(lowest_median == median)
+   {
+      lowest_median_index++;
+      lowest_median = x[lowest_median_index];
+   }
+   lowest_median_index--;
+   int64_t n_plus = lowest_median_index + 1;
+
+   int64_t highest_median_index = median_index;
+   KERNEL_TYPE highest_median = median;
+   while(highest_median == median)
+   {
+      highest_median_index--;
+      highest_median = x[highest_median_index];
+   }
+   highest_median_index++;
+   int64_t n_minus = n - highest_median_index;
+
+   KERNEL_TYPE *z_plus = workspace_alloc(ws, n_plus * sizeof(KERNEL_TYPE));
+   KERNEL_TYPE *z_minus = workspace_alloc(ws, n_minus * sizeof(KERNEL_TYPE));
+   if (z_plus == NULL || z_minus == NULL)
+   {
+      ws->failed = 1;
+      workspace_done(ws, &temporary, mark);
+      return NAN;
+   }
+
+   // Create z_plus
+   for (i = 0; i < n_plus; i++)
+      z_plus[i] = (x[i] - median) / scale_factor;
+   
+   // Create z_minus
+   for (i = 0; i < n_minus; i++)
+      z_minus[i] = (x[highest_median_index + i] - median) / scale_factor;
+   
+   KERNEL(typed_matrix) m = {MATRIX_MEDCOUPLE, z_plus, n_plus, z_minus, n_minus, epsilon2};
+   double medcouple_ = (double)KERNEL(typed_select_matrix)(&m, n_plus * n_minus / 2, epsilon1, n_threads, ws);
+
+   workspace_done(ws, &temporary, mark);
+
+   return medcouple_;
+}
+
+/**
+ * Medcouple of an array sorted descendingly.
+ * 
+ * The array is not modified.
+ * 
+ * Arguments:
+ *    x: Array sorted descendingly.
+ *    n: Length of the array.
+ *    epsilon1: Machine epsilon of the type. The smallest representable
+ *       positive number such that 1.0 + epsilon != 1.0.
+ *    epsilon2: The smallest representable positive number of the type.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Medcouple.
+ */
+double KERNEL(medcouple_sorted)(KERNEL_TYPE *x, int64_t n, double epsilon1, double epsilon2, workspace *ws)
+{
+   return KERNEL(typed_medcouple_sorted)(x, n, epsilon1, epsilon2, 1, ws);
+}
+
+/**
+ * Medcouple.
+ * 
+ * The array is sorted in-place.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    epsilon1: Machine epsilon of the type. The smallest representable
+ *       positive number such that 1.0 + epsilon != 1.0.
+ *    epsilon2: The smallest representable positive number of the type.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Medcouple.
+ */
+double KERNEL(medcouple)(KERNEL_TYPE *x, int64_t n, double epsilon1, double epsilon2, workspace *ws)
+{
+   // Sort x descendingly
+   KERNEL(sort)(x, n, 1, ws);
+
+   return KERNEL(typed_medcouple_sorted)(x, n, epsilon1, epsilon2, 1, ws);
+}
+
+/**
+ * Medcouple, computed over several threads.
+ * 
+ * The array is sorted in-place by function 'sort_parallel', and the
+ * iterations over the rows of the matrix are split between the threads as in
+ * function 'typed_medcouple_sorted'. The result is the same as that of
+ * function 'medcouple'.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    epsilon1: Machine epsilon of the type. The smallest representable
+ *       positive number such that 1.0 + epsilon != 1.0.
+ *    epsilon2: The smallest representable positive number of the type.
+ *    n_threads: Number of threads, including the calling thread.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Medcouple.
+ */
+double KERNEL(medcouple_parallel)(
+   KERNEL_TYPE *x, int64_t n, double epsilon1, double epsilon2, int64_t n_threads, workspace *ws)
+{
+   // Sort x descendingly
+   KERNEL(sort_parallel)(x, n, 1, n_threads, ws);
+
+   return KERNEL(typed_medcouple_sorted)(x, n, epsilon1, epsilon2, n_threads, ws);
+}
+
+/**
+ * Blocks of the data points above or below the median, for function
+ * 'medcouple_approximate': the data points are split into blocks of equal
+ * sizes, up to one, by selecting their first elements, so that the blocks are
+ * ordered but not sorted.
+ */
+typedef struct
+{
+   int64_t begin;  // Index of the first data point
+   int64_t n;  // Number of data points
+   int64_t n_blocks;
+   double *edges;  // Scaled lowest value of each block, then highest value of the last one
+   double *suffix_sizes;  // Number of data points from each block to the last one
+} KERNEL(typed_medcouple_blocks);
+
+/**
+ * Index of the first data point of a block.
+ */
+static inline int64_t KERNEL(typed_block_begin)(KERNEL(typed_medcouple_blocks) *blocks, int64_t i)
+{
+   return blocks->begin + i * blocks->n / blocks->n_blocks;
+}
+
+/**
+ * Split the data points of blocks further, into n_blocks blocks, selecting the
+ * first elements of the new blocks within the previous blocks, and rescale their
+ * edges as the values of the rows or columns of the matrix of the medcouple.
+ */
+static void KERNEL(typed_split_blocks)(
+   KERNEL(typed_medcouple_blocks) *blocks, KERNEL_TYPE *x, int64_t n_blocks, KERNEL_TYPE median,
+   KERNEL_TYPE scale_factor, KERNEL_TYPE highest, uint64_t *random_state)
+{
+   KERNEL(typed_medcouple_blocks) previous = *blocks;
+   blocks->n_blocks = n_blocks;
+
+   int64_t i = 0;  // Previous block
+   int64_t selected = previous.begin - 1;  // Last selected data point of the previous block
+   for (int64_t j = 0; j < n_blocks; j++)
+   {
+      int64_t k = KERNEL(typed_block_begin)(blocks, j);
+      while (KERNEL(typed_block_begin)(&previous, i + 1) <= k)
+         i++;
+
+      int64_t begin = KERNEL(typed_block_begin)(&previous, i);
+      if (k > begin)
+      {
+         if (selected < begin)
+            selected = begin;
+         KERNEL(typed_select_in_place)(x, NULL, selected, KERNEL(typed_block_begin)(&previous, i + 1) - 1, k,
+            random_state);
+         selected = k + 1;
+      }
+
+      blocks->edges[j] = ((double)x[k] - (double)median) / (double)scale_factor;
+   }
+   blocks->edges[n_blocks] = ((double)highest - (double)median) / (double)scale_factor;
+
+   blocks->suffix_sizes[n_blocks] = 0.;
+   for (int64_t j = n_blocks - 1; j >= 0; j--)
+      blocks->suffix_sizes[j] = blocks->suffix_sizes[j + 1]
+         + (double)(KERNEL(typed_block_begin)(blocks, j + 1) - KERNEL(typed_block_begin)(blocks, j));
+}
+
+/**
+ * Number of entries of the matrix of the medcouple not lower than a value, with
+ * the entries of each pair of blocks taken as the kernel of their lowest
+ * values, or of their highest ones, the kernel being non-decreasing in both.
+ * The entries of the data points equal to the median are given as the numbers
+ * of entries equal to 1, 0 and -1.
+ */
+static double KERNEL(typed_count_not_lower)(
+   KERNEL(typed_medcouple_blocks) *plus, KERNEL(typed_medcouple_blocks) *minus, int highest, double u,
+   double n_ones, double n_zeros, double n_minus_ones)
+{
+   double count = (u <= 1. ? n_ones : 0.) + (u <= 0. ? n_zeros : 0.) + (u <= -1. ? n_minus_ones : 0.);
+   double a, b;
+
+   int64_t j = minus->n_blocks;
+   for (int64_t i = 0; i < plus->n_blocks; i++)
+   {
+      a = plus->edges[i + highest];
+      while (j > 0)
+      {
+         b = minus->edges[j - 1 + highest];
+         if ((a + b) / (a - b) < u)
+            break;
+         j--;
+      }
+
+      count += (plus->suffix_sizes[i] - plus->suffix_sizes[i + 1]) * minus->suffix_sizes[j];
+   }
+
+   return count;
+}
+
+/**
+ * Bound of the entry of a rank of the matrix of the medcouple, found by
+ * bisection up to a precision: a lower bound over the lowest values of the
+ * blocks, or an upper bound over their highest ones.
+ */
+static double KERNEL(typed_bound_entry)(
+   KERNEL(typed_medcouple_blocks) *plus, KERNEL(typed_medcouple_blocks) *minus, int highest, double rank,
+   double precision, double n_ones, double n_zeros, double n_minus_ones)
+{
+   // There are more than rank entries not lower than lower, but not higher
+   double lower = -1., higher = 2., middle;
+
+   while (higher - lower > precision)
+   {
+      middle = (lower + higher) / 2.;
+      if (KERNEL(typed_count_not_lower)(plus, minus, highest, middle, n_ones, n_zeros, n_minus_ones) > rank)
+         lower = middle;
+      else
+         higher = middle;
+   }
+
+   return highest ? higher : lower;
+}
+
+/**
+ * Approximate medcouple, within a tolerance of the medcouple.
+ * 
+ * Instead of sorting the array, the data points above and below the median are
+ * split into blocks of equal sizes by selection, without sorting the blocks.
+ * Since the kernel of the medcouple is non-decreasing in both the data points
+ * above the median and those below it, taking the entries of each pair of
+ * blocks as the kernel of their lowest values gives a lower bound of the
+ * medcouple, and as the kernel of their highest values an upper bound. The
+ * blocks are halved until the bounds are within twice the tolerance of each
+ * other, and their middle is returned. If the blocks cannot be halved further,
+ * the medcouple is computed exactly by function 'medcouple'. So is it if any
+ * data point is infinite or NaN, since the blocks then give no bounds.
+ * 
+ * The array is reordered in-place.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    epsilon1: Machine epsilon of the type.
+ *    epsilon2: The smallest representable positive number of the type.
+ *    tolerance: Maximum absolute difference between the result and the
+ *       medcouple, positive.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Approximate medcouple.
+ */
+double KERNEL(medcouple_approximate)(
+   KERNEL_TYPE *x, int64_t n, double epsilon1, double epsilon2, double tolerance, workspace *ws)
+{
+   int64_t i;
+
+   if (n < 3)
+      return 0.;
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, medcouple_workspace_size(n));
+   size_t mark = ws->used;
+   double result;
+
+   for (i = 0; i < n; i++)
+      if (!isfinite((double)x[i]))
+      {
+         result = KERNEL(medcouple)(x, n, epsilon1, epsilon2, ws);
+         workspace_done(ws, &temporary, mark);
+         return result;
+      }
+
+   // Lower median of the array sorted descendingly, and the data points below,
+   // equal to and above it
+   int64_t median_index = n - 1 - n / 2;
+   KERNEL_TYPE median = KERNEL(typed_select_in_place)(x, NULL, 0, n - 1, median_index, &ws->random_state);
+   int64_t lower, upper;
+   KERNEL(typed_partition_three_way)(x, NULL, 0, n - 1, median_index, &lower, &upper);
+
+   KERNEL_TYPE lowest = x[0], highest = x[n - 1];
+   for (i = 0; i < lower; i++)
+      if (x[i] < lowest)
+         lowest = x[i];
+   for (i = upper + 1; i < n; i++)
+      if (x[i] > highest)
+         highest = x[i];
+
+   // Check if the median is at the edges up to relative epsilon
+   if (fabs(highest - median) < epsilon1 * (epsilon1 + fabs(median)))
+      result = -1.0;
+   else if (fabs(lowest - median) < epsilon1 * (epsilon1 + fabs(median)))
+      result = 1.0;
+   else
+   {
+      KERNEL_TYPE scale_factor = 2 * (KERNEL_TYPE)max_(highest - median, median - lowest);
+
+      // Entries of the data points equal to the median, whose kernel is 1 with
+      // the data points above the median, -1 with those below it, and the sign
+      // of their order between themselves
+      double n_equal = (double)(upper - lower + 1);
+      double n_ones = (double)(n - 1 - upper) * n_equal + n_equal * (n_equal - 1.) / 2.;
+      double n_minus_ones = (double)lower * n_equal + n_equal * (n_equal - 1.) / 2.;
+
+      // Rank of the medcouple among the entries sorted descendingly
+      int64_t n_plus = n - lower;
+      int64_t n_minus = upper + 1;
+      double rank = (double)(n_plus * n_minus / 2);
+
+      // Blocks of the data points above and below the median, starting with
+      // one block each, led by its lowest value
+      KERNEL_TYPE below = x[0];
+      int64_t lowest_index = 0, lowest_above_index = upper + 1;
+      for (i = 0; i < lower; i++)
+      {
+         if (x[i] > below)
+            below = x[i];
+         if (x[i] < x[lowest_index])
+            lowest_index = i;
+      }
+      for (i = upper + 1; i < n; i++)
+         if (x[i] < x[lowest_above_index])
+            lowest_above_index = i;
+      KERNEL(typed_swap_pair)(x, NULL, 0, lowest_index);
+      KERNEL(typed_swap_pair)(x, NULL, upper + 1, lowest_above_index);
+
+      KERNEL(typed_medcouple_blocks) plus, minus;
+      plus.begin = upper + 1;
+      plus.n = n - 1 - upper;
+      plus.n_blocks = 1;
+      plus.edges = workspace_alloc(ws, (plus.n + 1) * sizeof(double));
+      plus.suffix_sizes = workspace_alloc(ws, (plus.n + 1) * sizeof(double));
+      minus.begin = 0;
+      minus.n = lower;
+      minus.n_blocks = 1;
+      minus.edges = workspace_alloc(ws, (minus.n + 1) * sizeof(double));
+      minus.suffix_sizes = workspace_alloc(ws, (minus.n + 1) * sizeof(double));
+      if (plus.edges == NULL || plus.suffix_sizes == NULL || minus.edges == NULL || minus.suffix_sizes == NULL)
+      {
+         ws->failed = 1;
+         workspace_done(ws, &temporary, mark);
+         return NAN;
+      }
+
+      // The blocks are halved one level at a time, so that each level selects
+      // at most two data points in each previous block. The bounds are within
+      // about the fraction of the entries of the pairs of blocks along the
+      // staircase of the medcouple, so they are first computed for about one
+      // block over the tolerance
+      int64_t n_blocks = 1;
+      while (1)
+      {
+         n_blocks *= 2;
+         KERNEL(typed_split_blocks)(
+            &plus, x, n_blocks < plus.n ? n_blocks : plus.n, median, scale_factor, highest, &ws->random_state);
+         KERNEL(typed_split_blocks)(
+            &minus, x, n_blocks < minus.n ? n_blocks : minus.n, median, scale_factor, below, &ws->random_state);
+         if (n_blocks * tolerance < 1. && (plus.n_blocks < plus.n || minus.n_blocks < minus.n))
+            continue;
+
+         double low = KERNEL(typed_bound_entry)(
+            &plus, &minus, 0, rank, tolerance / 4., n_ones, n_equal, n_minus_ones);
+         double high = KERNEL(typed_bound_entry)(
+            &plus, &minus, 1, rank, tolerance / 4., n_ones, n_equal, n_minus_ones);
+
+         if (high - low <= 2. * tolerance)
+         {
+            result = (low + high) / 2.;
+            break;
+         }
+         if (plus.n_blocks == plus.n && minus.n_blocks == minus.n)
+         {
+            workspace_release(ws, mark);
+            result = KERNEL(medcouple)(x, n, epsilon1, epsilon2, ws);
+            break;
+         }
+      }
+   }
+
+   workspace_done(ws, &temporary, mark);
+
+   return result;
+}
+
+/**
+ * Adjusted boxplot of Hubert and Vandervieren, which flags as outliers the
+ * data points outside fences skewed by the medcouple MC:
+ *    [Q1 - f e^(-4 MC) IQR, Q3 + f e^(3 MC) IQR] if MC >= 0,
+ *    [Q1 - f e^(-3 MC) IQR, Q3 + f e^(4 MC) IQR] otherwise,
+ * where Q1 and Q3 are the quartiles, IQR = Q3 - Q1 and f is a factor, 1.5 by
+ * default.
+ * 
+ * The data points are copied and sorted once for the medcouple, and the
+ * quartiles are then read from the sorted copy, interpolated as by
+ * numpy.quantile.
+ * 
+ * Arguments:
+ *    x: Array, which is not modified.
+ *    n: Length of the array.
+ *    factor: Factor f of the fences.
+ *    epsilon1: Machine epsilon of the type. The smallest representable
+ *       positive number such that 1.0 + epsilon != 1.0.
+ *    epsilon2: The smallest representable positive number of the type.
+ *    n_threads: Number of threads of the medcouple.
+ *    bounds: Output array of the first quartile, the third quartile, the lower
+ *       fence and the upper fence.
+ *    outliers: Output array of length n, where the i-th element is 1 if the
+ *       i-th data point is outside the fences, and 0 otherwise.
+ *    ws: Workspace from which to allocate the copy and the temporary arrays, or
+ *       NULL to allocate them from the heap.
+ * 
+ * Returns:
+ *    Medcouple, or NaN, as well as the bounds, if the memory could not be
+ *       allocated.
+ */
+double KERNEL(adjusted_boxplot)(
+   KERNEL_TYPE *x, int64_t n, double factor, double epsilon1, double epsilon2, int64_t n_threads, double *bounds,
+   uint8_t *outliers, workspace *ws)
+{
+   int64_t i;
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, adjusted_boxplot_workspace_size(n, n_threads));
+   size_t mark = ws->used;
+
+   KERNEL_TYPE *sorted = workspace_alloc(ws, n * sizeof(KERNEL_TYPE));
+   if (sorted == NULL)
+   {
+      ws->failed = 1;
+      for (i = 0; i < 4; i++)
+         bounds[i] = NAN;
+      memset(outliers, 0, n);
+      workspace_done(ws, &temporary, mark);
+      return NAN;
+   }
+   memcpy(sorted, x, n * sizeof(KERNEL_TYPE));
+   double mc = KERNEL(medcouple_parallel)(sorted, n, epsilon1, epsilon2, n_threads, ws);
+
+   // Quartiles, the element of ascending rank r being at index n - 1 - r
+   for (i = 0; i < 2; i++)
+   {
+      double h = (double)(n - 1) * (i == 0 ? 0.25 : 0.75);
+      int64_t low = (int64_t)floor(h);
+      if (low + 1 >= n)
+         bounds[i] = (double)sorted[n - 1 - low];
+      else
+         bounds[i] = KERNEL(typed_interpolate)(sorted[n - 1 - low], sorted[n - 2 - low], h - (double)low);
+   }
+
+   double iqr = bounds[1] - bounds[0];
+   if (mc >= 0.)
+   {
+      bounds[2] = bounds[0] - factor * exp(-4. * mc) * iqr;
+      bounds[3] = bounds[1] + factor * exp(3. * mc) * iqr;
+   }
+   else
+   {
+      bounds[2] = bounds[0] - factor * exp(-3. * mc) * iqr;
+      bounds[3] = bounds[1] + factor * exp(4. * mc) * iqr;
+   }
+
+   for (i = 0; i < n; i++)
+      outliers[i] = (double)x[i] < bounds[2] || (double)x[i] > bounds[3];
+
+   workspace_done(ws, &temporary, mark);
+
+   return mc;
+}
+
+/**
+ * Qn estimator of scale of Rousseeuw and Croux.
+ * 
+ * Qn is the k-th smallest of the n (n - 1) / 2 distances |x[i] - x[j]| between
+ * the data points, i < j, where k = h (h - 1) / 2 and h = n / 2 + 1, scaled by
+ * 2.2219 and by the finite sample correction of Croux and Rousseeuw, so as to
+ * estimate the standard deviation of normal data.
+ * 
+ * The distance is selected by function 'typed_select_matrix' from the matrix
+ * of the pairwise differences of the data points sorted descendingly, in
+ * O(n log n) time and O(n) memory. The array is sorted in-place.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Qn, or NaN if there are less than 2 data points or if the memory could not
+ *       be allocated.
+ */
+double KERNEL(qn)(KERNEL_TYPE *x, int64_t n, workspace *ws)
+{
+   static const double corrections[] = {0.399, 0.994, 0.512, 0.844, 0.611, 0.857, 0.669, 0.872};
+
+   if (n < 2)
+      return NAN;
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, qn_workspace_size(n));
+   size_t mark = ws->used;
+
+   KERNEL(sort)(x, n, 1, ws);
+
+   // The matrix holds all the n^2 differences, of which the n (n - 1) / 2
+   // positive distances come first in descending order
+   int64_t h = n / 2 + 1;
+   int64_t k = h * (h - 1) / 2;
+   KERNEL(typed_matrix) m = {MATRIX_DIFFERENCES, x, n, x, n, 0.};
+   double distance = (double)KERNEL(typed_select_matrix)(&m, n * (n - 1) / 2 - k, 0., 1, ws);
+
+   workspace_done(ws, &temporary, mark);
+
+   double correction;
+   if (n <= 9)
+      correction = corrections[n - 2];
+   else if (n % 2 == 1)
+      correction = n / (n + 1.4);
+   else
+      correction = n / (n + 3.8);
+
+   return 2.2219 * correction * distance;
+}
+
+/**
+ * High median of the distances from a data point to the others, for function
+ * 'sn': the m-th smallest of the distances to the lower data points and of
+ * those to the higher ones, which are both sorted, found by bisection on the
+ * number of them taken from the lower data points.
+ */
+static KERNEL_TYPE KERNEL(typed_sn_distance)(KERNEL_TYPE *x, int64_t n, int64_t i, int64_t m)
+{
+   int64_t low = m - (n - 1 - i) > 0 ? m - (n - 1 - i) : 0;
+   int64_t high = m < i ? m : i;
+
+   // Lowest number a of distances to the lower data points such that the next
+   // one is not lower than the last of the m - a distances to the higher ones
+   while (low < high)
+   {
+      int64_t a = low + (high - low) / 2;
+      if (x[i] - x[i - a - 1] >= x[i + m - a] - x[i])
+         high = a;
+      else
+         low = a + 1;
+   }
+
+   if (low == 0)
+      return x[i + m] - x[i];
+   if (low == m)
+      return x[i] - x[i - m];
+
+   KERNEL_TYPE lower = x[i] - x[i - low];
+   KERNEL_TYPE higher = x[i + m - low] - x[i];
+   return lower > higher ? lower : higher;
+}
+
+/**
+ * Sn estimator of scale of Rousseeuw and Croux.
+ * 
+ * Sn is the low median over the data points of the high median of their
+ * distances to all the data points, scaled by 1.1926 and by the finite sample
+ * correction of Croux and Rousseeuw, so as to estimate the standard deviation
+ * of normal data.
+ * 
+ * The data points are sorted, so that the distances from each data point to
+ * the lower and to the higher ones are both sorted, and their high median is
+ * found by bisection, in O(n log n) time and O(n) memory. The array is sorted
+ * in-place.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Sn, or NaN if there are less than 2 data points or if the memory could not
+ *       be allocated.
+ */
+double KERNEL(sn)(KERNEL_TYPE *x, int64_t n, workspace *ws)
+{
+   static const double corrections[] = {0.743, 1.851, 0.954, 1.351, 0.993, 1.198, 1.005, 1.131};
+
+   if (n < 2)
+      return NAN;
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, sn_workspace_size(n));
+   size_t mark = ws->used;
+
+   KERNEL(sort)(x, n, 0, ws);
+
+   // The high median of the n distances, including the distance of 0 of each
+   // data point to itself, is the (n / 2)-th smallest distance to the others
+   KERNEL_TYPE *distances = workspace_alloc(ws, n * sizeof(KERNEL_TYPE));
+   if (distances == NULL)
+   {
+      ws->failed = 1;
+      workspace_done(ws, &temporary, mark);
+      return NAN;
+   }
+   for (int64_t i = 0; i < n; i++)
+      distances[i] = KERNEL(typed_sn_distance)(x, n, i, n / 2);
+
+   double distance = (double)KERNEL(typed_select_in_place)(
+      distances, NULL, 0, n - 1, (n + 1) / 2 - 1, &ws->random_state);
+
+   workspace_done(ws, &temporary, mark);
+
+   double correction;
+   if (n <= 9)
+      correction = corrections[n - 2];
+   else if (n % 2 == 1)
+      correction = n / (n - 0.9);
+   else
+      correction = 1.;
+
+   return 1.1926 * correction * distance;
+}
+
+/**
+ * Hodges-Lehmann estimator of location.
+ * 
+ * The estimator is the median of the n (n + 1) / 2 Walsh averages
+ * (x[i] + x[j]) / 2 of the data points, i <= j, that is, the average of the
+ * two middle ones for an even number of averages.
+ * 
+ * The middle sums are selected by function 'typed_select_matrix' from the
+ * triangular matrix of the pairwise sums of the data points sorted
+ * descendingly, in O(n log n) time and O(n) memory. The array is sorted
+ * in-place.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    Hodges-Lehmann estimator, or NaN if the array is empty or if the memory
+ *       could not be allocated.
+ */
+double KERNEL(hodges_lehmann)(KERNEL_TYPE *x, int64_t n, workspace *ws)
+{
+   if (n < 1)
+      return NAN;
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, hodges_lehmann_workspace_size(n));
+   size_t mark = ws->used;
+
+   KERNEL(sort)(x, n, 1, ws);
+
+   // The middle sums are the k-th largest ones, for the two middle values of k
+   int64_t n_sums = n * (n + 1) / 2;
+   KERNEL(typed_matrix) m = {MATRIX_SUMS, x, n, x, n, 0.};
+   double high = (double)KERNEL(typed_select_matrix)(&m, (n_sums - 1) / 2, 0., 1, ws);
+   double low = high;
+   if (n_sums % 2 == 0)
+      low = (double)KERNEL(typed_select_matrix)(&m, n_sums / 2, 0., 1, ws);
+
+   workspace_done(ws, &temporary, mark);
+
+   return (low + high) / 4.;
+}
+
+/**
+ * Median of an array, that is, the average of the two middle values for an
+ * even number of values, partitioning the array in-place around it.
+ */
+static double KERNEL(typed_median_in_place)(KERNEL_TYPE *x, int64_t n, uint64_t *random_state)
+{
+   double high = (double)KERNEL(typed_select_in_place)(x, NULL, 0, n - 1, n / 2, random_state);
+   if (n % 2 == 1)
+      return high;
+
+   // The lower middle value is the highest of the lower half
+   KERNEL_TYPE low = x[0];
+   for (int64_t i = 1; i < n / 2; i++)
+      if (x[i] > low)
+         low = x[i];
+
+   return ((double)low + high) / 2.;
+}
+
+/**
+ * Median absolute deviation.
+ * 
+ * The median absolute deviation is the median of the absolute deviations
+ * |x[i] - m| of the data points from their median m. Both medians are found by
+ * selections in the array itself, the deviations replacing the data points,
+ * in O(n) time and without any memory.
+ * 
+ * Arguments:
+ *    x: Array, which is overwritten by the absolute deviations.
+ *    n: Length of the array.
+ *    median: Output median of the data points, or NULL.
+ *    random_state: State of the generator of the pivots.
+ * 
+ * Returns:
+ *    Median absolute deviation, or NaN, as well as the median, if the array is
+ *       empty.
+ */
+double KERNEL(mad_in_place)(KERNEL_TYPE *x, int64_t n, double *median, uint64_t *random_state)
+{
+   if (n < 1)
+   {
+      if (median != NULL)
+         *median = NAN;
+      return NAN;
+   }
+
+   double m = KERNEL(typed_median_in_place)(x, n, random_state);
+   for (int64_t i = 0; i < n; i++)
+      x[i] = (KERNEL_TYPE)fabs((double)x[i] - m);
+
+   if (median != NULL)
+      *median = m;
+
+   return KERNEL(typed_median_in_place)(x, n, random_state);
+}
+
+#endif
+
+/**
+ * Mode of an array sorted ascendingly.
+ * 
+ * The array is not modified.
+ * 
+ * Arguments:
+ *    x: Array sorted ascendingly.
+ *    n: Length of the array.
+ * 
+ * Returns:
+ *    Mode.
+ */
+double KERNEL(mode_sorted)(KERNEL_TYPE *x, int64_t n)
+{
+   int64_t m, m_half, i, j;
+   KERNEL_WIDTH_TYPE width, min_width;
+
+   int64_t begin = 0;
+   int64_t end = n - 1;
+
+   while(1)
+   {
+      m = end - begin + 1;
+
+      if (m == 1)
+         return (double)x[begin];
+      else if (m == 2)
+         return ((double)x[begin] + (double)x[end]) / 2.;
+      else if (m == 3)
+      {
+         KERNEL_WIDTH_TYPE lower_width = KERNEL_WIDTH(x[begin], x[begin + 1]);
+         KERNEL_WIDTH_TYPE upper_width = KERNEL_WIDTH(x[begin + 1], x[end]);
+
+         if (lower_width < upper_width)
+            return ((double)x[begin] + (double)x[begin + 1]) / 2.;
+         else if (lower_width > upper_width)
+            return ((double)x[begin + 1] + (double)x[end]) / 2.;
+         else
+            return (double)x[begin + 1];
+      }
+      else
+      {
+         min_width = KERNEL_WIDTH(x[begin], x[end]);
+
+         m_half = (m + 1) / 2;
+
+         j = begin;
+         for (i = begin; i <= begin + m - m_half; i++)
+         {
+            width = KERNEL_WIDTH(x[i], x[i + m_half - 1]);
+
+            if (width < min_width)
+            {
+               min_width = width;
+               j = i;
+            }
+         }
+
+         begin = j;
+         end = j + m_half - 1;
+      }
+   }
+}
+
+/**
+ * Mode.
+ * 
+ * The array is sorted in-place.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    ws: Workspace from which to allocate the buffer of the sort, or NULL to
+ *       allocate it from the heap.
+ * 
+ * Returns:
+ *    Mode.
+ */
+double KERNEL(mode)(KERNEL_TYPE *x, int64_t n, workspace *ws)
+{
+   // Sort x ascendingly
+   KERNEL(sort)(x, n, 0, ws);
+
+   return KERNEL(mode_sorted)(x, n);
+}
+
+#undef KERNEL_WIDTH
+#undef KERNEL_WIDTH_TYPE
+#undef KERNEL
+#undef KERNEL_CONCAT
+#undef KERNEL_CONCAT_
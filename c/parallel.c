@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "counters.h"
+#include "parallel.h"
+
+/**
+ * State shared by the worker threads of a parallel loop.
+ */
+typedef struct
+{
+   parallel_task task;
+   void *context;
+   int64_t n_tasks;
+   int64_t next_task;  // Index of the next task to be picked up by a worker
+#ifdef _WIN32
+   CRITICAL_SECTION lock;
+#else
+   pthread_mutex_t lock;
+#endif
+} parallel_loop;
+
+/**
+ * Worker thread of a parallel loop.
+ */
+typedef struct
+{
+   parallel_loop *loop;
+   int64_t thread;  // Index of the thread in the pool
+   counters *attached;  // Counters attached to the thread, or NULL if the calling thread has none
+   counters counts;
+} parallel_worker;
+
+/**
+ * Pick up the index of the next task of a parallel loop.
+ * 
+ * Arguments:
+ *    loop: Parallel loop.
+ * 
+ * Returns:
+ *    Index of the next task, or the number of tasks if there are no tasks
+ *       left.
+ */
+static int64_t next_task(parallel_loop *loop)
+{
+   int64_t i;
+
+#ifdef _WIN32
+   EnterCriticalSection(&loop->lock);
+#else
+   pthread_mutex_lock(&loop->lock);
+#endif
+
+   i = loop->next_task;
+   if (i < loop->n_tasks)
+      loop->next_task++;
+
+#ifdef _WIN32
+   LeaveCriticalSection(&loop->lock);
+#else
+   pthread_mutex_unlock(&loop->lock);
+#endif
+
+   return i;
+}
+
+/**
+ * Worker of a parallel loop, running tasks until there are none left.
+ * 
+ * Arguments:
+ *    worker: Worker thread.
+ */
+static void run_tasks(parallel_worker *worker)
+{
+   int64_t i;
+   parallel_loop *loop = worker->loop;
+
+   if (worker->thread > 0)
+      counters_attach(worker->attached);
+
+   while ((i = next_task(loop)) < loop->n_tasks)
+      loop->task(loop->context, i, worker->thread);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID worker)
+{
+   run_tasks((parallel_worker *)worker);
+   return 0;
+}
+#else
+static void *worker_main(void *worker)
+{
+   run_tasks((parallel_worker *)worker);
+   return NULL;
+}
+#endif
+
+/**
+ * Run the tasks of a loop in parallel over a pool of threads.
+ * 
+ * The tasks are picked up dynamically by the threads of the pool, one at a
+ * time, so that tasks of different durations are balanced among the threads.
+ * The calling thread is part of the pool, and the function returns when all
+ * the tasks have been completed. If a thread cannot be created, its share of
+ * the tasks is run by the other threads, and if the memory of the pool cannot
+ * be allocated, all the tasks are run by the calling thread.
+ * 
+ * Each task is also passed the index of the thread running it, between 0 and
+ * n_threads - 1, with 0 being the calling thread, so that the tasks can use
+ * resources owned by each thread, such as workspaces. The work of all the
+ * threads is recorded into the counters attached to the calling thread, if
+ * any.
+ * 
+ * Arguments:
+ *    task: Function called with the context, the index of each task and the
+ *       index of the thread running it.
+ *    context: Context passed to each task.
+ *    n_tasks: Number of tasks, with indices going from 0 to n_tasks - 1.
+ *    n_threads: Number of threads, including the calling thread.
+ */
+void parallel_for(parallel_task task, void *context, int64_t n_tasks, int64_t n_threads)
+{
+   int64_t i;
+
+   if (n_threads > n_tasks)
+      n_threads = n_tasks;
+
+   if (n_threads <= 1)
+   {
+      for (i = 0; i < n_tasks; i++)
+         task(context, i, 0);
+      return;
+   }
+
+   parallel_loop loop = {task, context, n_tasks, 0};
+   parallel_worker *workers = malloc(n_threads * sizeof(parallel_worker));
+#ifdef _WIN32
+   HANDLE *threads = malloc((n_threads - 1) * sizeof(HANDLE));
+#else
+   pthread_t *threads = malloc((n_threads - 1) * sizeof(pthread_t));
+#endif
+   int *started = malloc((n_threads - 1) * sizeof(int));
+   if (workers == NULL || threads == NULL || started == NULL)
+   {
+      free(workers);
+      free(threads);
+      free(started);
+      for (i = 0; i < n_tasks; i++)
+         task(context, i, 0);
+      return;
+   }
+
+   // The work of the other threads is recorded into counters of their own,
+   // added to those of the calling thread once they are done
+   counters *caller_counters = counters_attached();
+   for (i = 0; i < n_threads; i++)
+   {
+      workers[i].loop = &loop;
+      workers[i].thread = i;
+      workers[i].attached = caller_counters != NULL ? &workers[i].counts : NULL;
+      counters_reset(&workers[i].counts);
+   }
+
+#ifdef _WIN32
+   InitializeCriticalSection(&loop.lock);
+#else
+   pthread_mutex_init(&loop.lock, NULL);
+#endif
+
+   for (i = 0; i < n_threads - 1; i++)
+   {
+#ifdef _WIN32
+      threads[i] = CreateThread(NULL, 0, worker_main, &workers[i + 1], 0, NULL);
+      started[i] = threads[i] != NULL;
+#else
+      started[i] = pthread_create(&threads[i], NULL, worker_main, &workers[i + 1]) == 0;
+#endif
+   }
+
+   run_tasks(&workers[0]);
+
+   for (i = 0; i < n_threads - 1; i++)
+   {
+      if (!started[i])
+         continue;
+#ifdef _WIN32
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+#else
+      pthread_join(threads[i], NULL);
+#endif
+      if (caller_counters != NULL)
+         counters_add(caller_counters, &workers[i + 1].counts);
+   }
+
+#ifdef _WIN32
+   DeleteCriticalSection(&loop.lock);
+#else
+   pthread_mutex_destroy(&loop.lock);
+#endif
+
+   free(started);
+   free(threads);
+   free(workers);
+}
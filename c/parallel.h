@@ -0,0 +1,5 @@
+#include <stdint.h>
+
+typedef void (*parallel_task)(void *context, int64_t i, int64_t thread);
+
+void parallel_for(parallel_task task, void *context, int64_t n_tasks, int64_t n_threads);
@@ -1,6 +1,7 @@
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "base.h"
 #include "robustats.h"
 
@@ -10,6 +11,10 @@
  * For arrays with an even number of elements, this function calculates the
  * lower weighted median.
  * 
+ * The input arrays are not modified: values and weights are copied into a
+ * single contiguous buffer, holding the values followed by the weights, over
+ * which the weighted median is computed in-place.
+ * 
  * Arguments:
  *    x: array of values
  *    w: array of weights
@@ -17,383 +22,982 @@
  *       weighted median.
  *    end: Ending index of the sub-array over which to calculate the weighted
  *       median.
+ *    ws: Workspace from which to allocate the buffer, or NULL to allocate it
+ *       from the heap.
  * 
  * Returns:
- *    Weighted median.
+ *    Weighted median, or NaN if the memory could not be allocated.
 */
-double weighted_median(double *x, double *w, int64_t begin, int64_t end)
+double weighted_median(double *x, double *w, int64_t begin, int64_t end, workspace *ws)
 {
-   int64_t xw_n, n, i, median_index;
-   double median;
-   double w_lower_sum, w_lower_sum_norm, w_higher_sum, w_higher_sum_norm;
-   
-   xw_n = end - begin + 1;  // Length between begin and end
-   double **xw = zip(x, w, xw_n);
+   int64_t n = end - begin + 1;  // Length between begin and end
 
-   double w_sum = sum_double(w, xw_n);
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, weighted_median_workspace_size(n));
+   size_t mark = ws->used;
 
-   while (1)
+   double *xw = workspace_alloc(ws, 2 * n * sizeof(double));
+   if (xw == NULL)
+   {
+      ws->failed = 1;
+      workspace_done(ws, &temporary, mark);
+      return NAN;
+   }
+   double *x_copy = xw;
+   double *w_copy = xw + n;
+   for (int64_t i = 0; i < n; i++)
    {
-      n = end - begin + 1; // Length between begin and end
+      x_copy[i] = x[begin + i];
+      w_copy[i] = w[begin + i];
+   }
 
-      if (n == 1)
-      {
-         free_zip_memory(xw, xw_n);
-         return x[begin];
-      }
-      else if (n == 2)
+   double median = weighted_median_in_place(x_copy, w_copy, 0, n - 1, &ws->random_state);
+   workspace_done(ws, &temporary, mark);
+
+   return median;
+}
+
+/**
+ * Size of the workspace used by function 'weighted_median'.
+ * 
+ * Arguments:
+ *    n: Length of the arrays.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t weighted_median_workspace_size(int64_t n)
+{
+   return workspace_array_size(2 * n * sizeof(double));
+}
+
+/**
+ * Size of the workspace used by function 'quantiles_in_place'.
+ * 
+ * Arguments:
+ *    n_qs: Number of orders of the quantiles.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t quantiles_workspace_size(int64_t n_qs)
+{
+   return workspace_array_size(2 * n_qs * sizeof(int64_t));
+}
+
+/**
+ * Size of the workspace used by function 'sort'.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t sort_workspace_size(int64_t n)
+{
+   return workspace_array_size(n * sizeof(double));
+}
+
+/**
+ * Size of the workspace used by function 'sort_parallel'.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ *    n_threads: Number of threads.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t sort_parallel_workspace_size(int64_t n, int64_t n_threads)
+{
+   if (n_threads <= 1)
+      return sort_workspace_size(n);
+
+   // Counts of the 256 values of each of the 8 bytes, at most, of the keys of
+   // each chunk
+   return sort_workspace_size(n) + workspace_array_size(n_threads * 8 * 256 * sizeof(int64_t));
+}
+
+/**
+ * Data point of a sample, used to rank the data points by value.
+ */
+typedef struct
+{
+   double value;
+   int64_t index;
+} ranked_value;
+
+/**
+ * Compare two data points by value and, for equal values, by index, NaN being
+ * higher than any value.
+ */
+static int compare_ranked_values(const void *i, const void *j)
+{
+   const ranked_value *a = (const ranked_value *)i;
+   const ranked_value *b = (const ranked_value *)j;
+
+   if (isnan(a->value) != isnan(b->value))
+      return isnan(a->value) ? 1 : -1;
+   else if (a->value > b->value)
+      return 1;
+   else if (a->value < b->value)
+      return -1;
+   else if (a->index > b->index)
+      return 1;
+   else if (a->index < b->index)
+      return -1;
+   else
+      return 0;
+}
+
+/**
+ * Rolling weighted median over a sliding window.
+ * 
+ * The weights of the data points in the window are kept in a sum tree indexed
+ * by the rank of the data points in the whole array, so that moving the window
+ * by one step updates two leaves of the tree, and the weighted median is found
+ * by descending the tree, both in logarithmic time. A second sum tree counts
+ * the data points in the window, to rank them within it.
+ * 
+ * For each window, this function calculates the weighted median returned by
+ * function 'weighted_median', ties included: this is the lower weighted
+ * median, that is, the lowest value whose cumulative weight reaches half of
+ * the total weight of the window, except when that cumulative weight is
+ * exactly half of the total weight, in which case the rank of the weighted
+ * median in the window is given by function 'weighted_median_tie_rank'.
+ * Windows whose weights are all zero, or holding a NaN value, have a weighted
+ * median of NaN. NaN values are counted in the window, and kept out of the
+ * sum trees.
+ * 
+ * Arguments:
+ *    x: array of values
+ *    w: array of non-negative weights
+ *    n: Length of the arrays.
+ *    window: Length of the sliding window, between 1 and n.
+ *    medians: Output array of length n - window + 1, where the i-th element is
+ *       the weighted median of the window of x starting at index i, or NaN if
+ *       the memory could not be allocated.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ */
+void rolling_weighted_median(double *x, double *w, int64_t n, int64_t window, double *medians, workspace *ws)
+{
+   int64_t i;
+
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, rolling_weighted_median_workspace_size(n));
+   size_t mark = ws->used;
+
+   int64_t size = sum_tree_size(n);
+   ranked_value *ranked = workspace_alloc(ws, n * sizeof(ranked_value));
+   int64_t *rank = workspace_alloc(ws, n * sizeof(int64_t));
+   double *tree = workspace_alloc(ws, 2 * size * sizeof(double));
+   double *counts = workspace_alloc(ws, 2 * size * sizeof(double));
+   if (ranked == NULL || rank == NULL || tree == NULL || counts == NULL)
+   {
+      ws->failed = 1;
+      fill_array_double(medians, n - window + 1, NAN);
+      workspace_done(ws, &temporary, mark);
+      return;
+   }
+
+   // Rank the data points by value
+   for (i = 0; i < n; i++)
+   {
+      ranked[i].value = x[i];
+      ranked[i].index = i;
+   }
+   qsort(ranked, n, sizeof(ranked_value), compare_ranked_values);
+
+   for (i = 0; i < n; i++)
+      rank[ranked[i].index] = i;
+
+   // Sum trees over the ranks, holding the weights and the counts of the data
+   // points in the window
+   memset(tree, 0, 2 * size * sizeof(double));
+   memset(counts, 0, 2 * size * sizeof(double));
+
+   int64_t n_nan = 0;
+   for (i = 0; i < n; i++)
+   {
+      if (i >= window)
       {
-         free_zip_memory(xw, xw_n);
-         if (w[begin] >= w[end])
-            return x[begin];
+         if (isnan(x[i - window]))
+            n_nan--;
          else
-            return x[end];
+         {
+            sum_tree_set(tree, size, rank[i - window], 0.);
+            sum_tree_set(counts, size, rank[i - window], 0.);
+         }
       }
+      if (isnan(x[i]))
+         n_nan++;
       else
       {
-         median_index = begin + (n - 1) / 2;  // Lower median index
-         median = partition_on_kth_smallest_2d(xw, begin, end, 2, 0, median_index);
-
-         w_lower_sum = 0.;
-         for (i = begin; i < median_index; i++)
-            w_lower_sum += xw[i][1];
-         w_lower_sum_norm = w_lower_sum / w_sum;
-
-         w_higher_sum = 0.;
-         for (i = median_index + 1; i <= end; i++)
-            w_higher_sum += xw[i][1];
-         w_higher_sum_norm = w_higher_sum / w_sum;
-         
-         if (w_lower_sum_norm < 0.5 && w_higher_sum_norm < 0.5)
-         {
-            free_zip_memory(xw, xw_n);
-            return median;
-         }
-         else if (w_lower_sum_norm > 0.5)
+         sum_tree_set(tree, size, rank[i], w[i]);
+         sum_tree_set(counts, size, rank[i], 1.);
+      }
+
+      if (i >= window - 1)
+      {
+         double half = tree[1] / 2.;
+         if (n_nan == 0 && tree[1] > 0.)
          {
-            xw[median_index][1] = xw[median_index][1] + w_higher_sum;
-            end = median_index;
+            int64_t median = sum_tree_search(tree, size, half);
+            if (sum_tree_cumulative(tree, size, median) == half)
+            {
+               int64_t next = sum_tree_search_above(tree, size, half);
+               int64_t next_rank = (int64_t)sum_tree_cumulative(counts, size, next) - 1;
+               int64_t median_rank = weighted_median_tie_rank(window, next_rank);
+               median = sum_tree_search(counts, size, (double)(median_rank + 1));
+            }
+            medians[i - window + 1] = ranked[median].value;
          }
          else
-         {
-            xw[median_index][1] = xw[median_index][1] + w_lower_sum;
-            begin = median_index;
-         }
+            medians[i - window + 1] = NAN;
       }
    }
+
+   workspace_done(ws, &temporary, mark);
 }
 
 /**
- * Function used in function 'medcouple'.
+ * Size of the workspace used by function 'rolling_weighted_median'.
+ * 
+ * Arguments:
+ *    n: Length of the arrays.
+ * 
+ * Returns:
+ *    Size in bytes.
  */
-double h_kernel(
-   int64_t i, int64_t j, double *z_plus, int64_t n_plus, double *z_minus, int64_t n_minus,
-   double epsilon
-   )
+size_t rolling_weighted_median_workspace_size(int64_t n)
 {
-   double a = z_plus[i];
-   double b = z_minus[j];
+   return workspace_array_size(n * sizeof(ranked_value))
+      + workspace_array_size(n * sizeof(int64_t))
+      + 2 * workspace_array_size(2 * sum_tree_size(n) * sizeof(double));
+}
 
-   if (fabs(a - b) <= 2 * epsilon)
-      return sign(n_plus - i - j - 1);
+/**
+ * Size of the workspace used by functions 'medcouple_sorted' and 'medcouple'.
+ * 
+ * The arrays of the data points above and below the median have at most n
+ * elements each, and the remaining entries of the last step take the place of
+ * the four arrays of the iterations, of n_plus elements each. The buffer of
+ * the sort of function 'medcouple' is released before they are allocated.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t medcouple_workspace_size(int64_t n)
+{
+   return 2 * workspace_array_size(n * sizeof(double))
+      + 2 * workspace_array_size(n * sizeof(int64_t))
+      + 2 * workspace_array_size(n * sizeof(double))
+      + 2 * workspace_array_size(n * sizeof(int64_t));
+}
+
+/**
+ * Size of the workspace used by function 'medcouple_parallel'.
+ * 
+ * On top of the arrays of function 'medcouple', the counts of the parallel
+ * sort are allocated along its buffer, and are then released before the few
+ * sums of the blocks of rows are allocated.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ *    n_threads: Number of threads.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t medcouple_parallel_workspace_size(int64_t n, int64_t n_threads)
+{
+   return medcouple_workspace_size(n) + sort_parallel_workspace_size(n, n_threads) - sort_workspace_size(n);
+}
+
+/**
+ * Size of the workspace used by function 'adjusted_boxplot'.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ *    n_threads: Number of threads.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t adjusted_boxplot_workspace_size(int64_t n, int64_t n_threads)
+{
+   return workspace_array_size(n * sizeof(double)) + medcouple_parallel_workspace_size(n, n_threads);
+}
+
+/**
+ * Size of the workspace used by function 'qn'.
+ * 
+ * The six arrays of the selection over the rows of the matrix take the place
+ * of the buffer of the sort.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t qn_workspace_size(int64_t n)
+{
+   return 6 * workspace_array_size(n * sizeof(int64_t));
+}
+
+/**
+ * Size of the workspace used by function 'sn'.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t sn_workspace_size(int64_t n)
+{
+   return workspace_array_size(n * sizeof(double)) + sort_workspace_size(n);
+}
+
+/**
+ * Size of the workspace used by function 'hodges_lehmann'.
+ * 
+ * The six arrays of the selection over the rows of the matrix take the place
+ * of the buffer of the sort.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t hodges_lehmann_workspace_size(int64_t n)
+{
+   return 6 * workspace_array_size(n * sizeof(int64_t));
+}
+
+/**
+ * Data point of a regression.
+ */
+typedef struct
+{
+   double x;
+   double y;
+} point;
+
+/**
+ * Compare two data points by abscissa and, for equal abscissas, by ordinate.
+ */
+static int compare_points(const void *i, const void *j)
+{
+   const point *a = (const point *)i;
+   const point *b = (const point *)j;
+
+   if (a->x > b->x)
+      return 1;
+   else if (a->x < b->x)
+      return -1;
+   else if (a->y > b->y)
+      return 1;
+   else if (a->y < b->y)
+      return -1;
    else
-      return (a + b) / (a - b);
+      return 0;
 }
 
 /**
- * Function used in function 'medcouple'.
+ * Arrays of the slope selection of the Theil-Sen estimator.
  */
-void where_h_greater_than_u(
-   int64_t *p, int64_t n_p, double *z_plus, int64_t n_plus, double *z_minus, int64_t n_minus,
-   double u, double epsilon, double k_epsilon
-   )
+typedef struct
 {
-   fill_array_int(p, n_p, 0);
+   point *points;  // Data points, sorted by abscissa and then by ordinate
+   int64_t n;
+   ranked_value *ranked;  // Residuals of the data points for a given slope
+   int64_t *sequence;  // Ranks whose inversions are counted
+   int64_t *buffer;  // Buffer of the merges
+} theil_sen_arrays;
 
-   double h;
-   int64_t j = 0;
+/**
+ * Reverse the order of the groups of data points of equal abscissas of a
+ * sequence of data points ordered by abscissa, keeping the order of the data
+ * points of each group.
+ * 
+ * Arguments:
+ *    a: Arrays of the slope selection.
+ *    order: Indices of the data points, in order.
+ *    begin: Beginning index of the sequence.
+ *    end: Ending index of the sequence.
+ */
+static void theil_sen_reverse_groups(theil_sen_arrays *a, int64_t *order, int64_t begin, int64_t end)
+{
+   int64_t i, j, k = 0;
+   int64_t *groups = a->buffer;
 
-   for (int64_t i = n_plus - 1; i >= 0; i--)
-   {  
-      h = h_kernel(i, j, z_plus, n_plus, z_minus, n_minus, k_epsilon);
+   for (i = end; i >= begin; i = j)
+   {
+      for (j = i - 1; j >= begin && a->points[order[j]].x == a->points[order[i]].x; j--)
+         ;
+      for (int64_t l = j + 1; l <= i; l++)
+         groups[k++] = order[l];
+   }
+   memcpy(order + begin, groups, k * sizeof(int64_t));
+}
 
-      while (j < n_minus && h - u > epsilon)
+/**
+ * Order the data points by their residual y - t x for a slope t.
+ * 
+ * The pair of data points i < j, with x[i] < x[j], has a slope lower than t
+ * exactly when data point j comes before data point i in this order. The data
+ * points of equal residuals are ordered by index, or, to also count the pairs
+ * of a slope of t, by descending abscissa and then by index. The pairs of data
+ * points of equal abscissas, ordered by ordinate and then by index, thus keep
+ * their order for every slope, so that they never count. For a slope of -inf,
+ * the data points keep their order, and for a slope of +inf, all the pairs of
+ * different abscissas are swapped.
+ * 
+ * Arguments:
+ *    a: Arrays of the slope selection.
+ *    t: Slope.
+ *    inclusive: Whether the pairs of a slope of t count as lower than t.
+ *    order: Output array of the indices of the data points, in order.
+ */
+static void theil_sen_order(theil_sen_arrays *a, double t, int inclusive, int64_t *order)
+{
+   int64_t i, j, n = a->n;
+
+   if (t == -INFINITY)
+   {
+      for (i = 0; i < n; i++)
+         order[i] = i;
+   }
+   else if (t == INFINITY)
+   {
+      for (i = 0; i < n; i++)
+         order[i] = i;
+      theil_sen_reverse_groups(a, order, 0, n - 1);
+   }
+   else
+   {
+      for (i = 0; i < n; i++)
       {
-         j++;
-         h = h_kernel(i, j, z_plus, n_plus, z_minus, n_minus, k_epsilon);
+         a->ranked[i].value = a->points[i].y - t * a->points[i].x;
+         a->ranked[i].index = i;
+      }
+      qsort(a->ranked, n, sizeof(ranked_value), compare_ranked_values);
+      for (i = 0; i < n; i++)
+         order[i] = a->ranked[i].index;
+
+      if (inclusive)
+      {
+         for (i = 0; i < n; i = j)
+         {
+            for (j = i + 1; j < n && a->ranked[j].value == a->ranked[i].value; j++)
+               ;
+            if (j - i > 1)
+               theil_sen_reverse_groups(a, order, i, j - 1);
+         }
       }
-      
-      p[i] = j - 1;
    }
 }
 
 /**
- * Function used in function 'medcouple'.
+ * Count the pairs of data points whose slopes lie between two slopes, and
+ * find the slopes of some of them.
+ * 
+ * Those are the pairs swapped between the orders of the data points for the
+ * two slopes, that is, the inversions of the ranks in the higher order of the
+ * data points taken in the lower order, counted by a merge sort in
+ * O(n log n) time. The inversions are numbered in the order of the merges, and
+ * those of the given numbers are picked as the merges go.
+ * 
+ * Arguments:
+ *    a: Arrays of the slope selection.
+ *    lower_order: Order of the data points for the lower slope.
+ *    higher_order: Order of the data points for the higher slope.
+ *    numbers: Ascending numbers of the pairs whose slopes to find.
+ *    n_numbers: Number of those.
+ *    slopes: Output array of the slopes of those pairs.
+ * 
+ * Returns:
+ *    Number of pairs whose slopes lie between the two slopes, each bound
+ *    included or not as by the orders.
  */
-void where_h_less_than_u(
-   int64_t *q, int64_t n_q, double *z_plus, int64_t n_plus, double *z_minus, int64_t n_minus,
-   double u, double epsilon, double k_epsilon
-   )
+static int64_t theil_sen_pairs(
+   theil_sen_arrays *a, int64_t *lower_order, int64_t *higher_order, int64_t *numbers, int64_t n_numbers,
+   double *slopes)
 {
-   fill_array_int(q, n_q, 0);
-
-   double h;
-   int64_t j = n_minus - 1;
+   int64_t i, n = a->n, *s = a->sequence, *buffer = a->buffer;
 
-   for (int64_t i = 0; i < n_plus; i++)
-   {  
-      h = h_kernel(i, j, z_plus, n_plus, z_minus, n_minus, k_epsilon);
+   for (i = 0; i < n; i++)
+      buffer[higher_order[i]] = i;
+   for (i = 0; i < n; i++)
+      s[i] = buffer[lower_order[i]];
 
-      while (j >= 0 && h - u < -epsilon)
+   int64_t count = 0, k = 0;
+   for (int64_t width = 1; width < n; width *= 2)
+   {
+      for (int64_t begin = 0; begin < n - width; begin += 2 * width)
       {
-         j--;
-         h = h_kernel(i, j, z_plus, n_plus, z_minus, n_minus, k_epsilon);
+         int64_t middle = begin + width;
+         int64_t end = middle + width < n ? middle + width : n;
+         int64_t l = begin, r = middle, o = begin;
+
+         while (l < middle && r < end)
+         {
+            if (s[r] < s[l])
+            {
+               // The element of the right run forms an inversion with each of
+               // the remaining elements of the left run
+               while (k < n_numbers && numbers[k] < count + middle - l)
+               {
+                  point *p = &a->points[higher_order[s[l + numbers[k] - count]]];
+                  point *q = &a->points[higher_order[s[r]]];
+                  slopes[k++] = (q->y - p->y) / (q->x - p->x);
+               }
+               count += middle - l;
+               buffer[o++] = s[r++];
+            }
+            else
+               buffer[o++] = s[l++];
+         }
+         while (l < middle)
+            buffer[o++] = s[l++];
+         while (r < end)
+            buffer[o++] = s[r++];
+
+         memcpy(s + begin, buffer + begin, (end - begin) * sizeof(int64_t));
       }
-      
-      q[i] = j + 1;
    }
+
+   return count;
 }
 
 /**
- * Medcouple.
+ * Number of slopes enumerated by the slope selection of the Theil-Sen
+ * estimator, from a sample of a quarter of them.
+ */
+static int64_t theil_sen_capacity(int64_t n)
+{
+   return 4 * n > 4096 ? 4 * n : 4096;
+}
+
+/**
+ * Theil-Sen estimator of a simple linear regression.
+ * 
+ * The slope is the median of the slopes (y[j] - y[i]) / (x[j] - x[i]) of the
+ * pairs of data points of different abscissas, that is, the average of the two
+ * middle ones for an even number of pairs. The intercept is the median of the
+ * residuals y - slope x.
+ * 
+ * The slopes do not form a sorted matrix, unlike the pairwise differences of a
+ * single sorted array, so that the median slope is found by a randomized slope
+ * selection: the number of slopes lower than a given slope is the number of
+ * pairs of data points swapped between their order by abscissa and their order
+ * by residual, counted by a merge sort. The interval of slopes holding the
+ * middle ones is narrowed around two quantiles of a sample of the slopes in
+ * the interval, drawn by number during the same merge sort, until it holds at
+ * most 4 n slopes, or a few thousand, which are then enumerated. This takes
+ * O(n log n) expected time and O(n) memory. If the rounding of the residuals
+ * stops the narrowing first, all the slopes of the interval are enumerated
+ * anyway, taking more memory.
  * 
  * Arguments:
- *    x: Array.
- *    n: Length of the array.
- *    epsilon1: Machine epsilon. The smallest representable positive number
- *       such that 1.0 + epsilon != 1.0.
- *    epsilon2: The smallest representable number.
+ *    x: Array of the abscissas.
+ *    y: Array of the ordinates.
+ *    n: Length of the arrays.
+ *    intercept: Output intercept.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
  * 
  * Returns:
- *    Medcouple.
+ *    Slope, or NaN, as well as the intercept, if all the abscissas are equal or
+ *       if the memory could not be allocated.
  */
-double medcouple(double *x, int64_t n, double epsilon1, double epsilon2)
+double theil_sen(double *x, double *y, int64_t n, double *intercept, workspace *ws)
 {
    int64_t i, j;
 
-   if (n < 3)
-      return 0.;
-   
-   // Sort x descendingly
-   qsort(x, n, sizeof(double), compare_descending);
-
-   int64_t median_index = n / 2;  // Lower median because sorted descendingly
-   double median = x[median_index];
-
-   // Check if the median is at the edges up to relative epsilon
-   if (fabs(x[0] - median) < epsilon1 * (epsilon1 + fabs(median)))
-      return -1.0;
-   if (fabs(x[n - 1] - median) < epsilon1 * (epsilon1 + fabs(median)))
-      return 1.0;
-
-   // To rescale z_minus and z_plus inside [-0.5, 0.5], for greater numerical
-   // stability.
-   double scale_factor = 2 * max_(x[0] - median, median - x[n - 1]);
-
-   // Create z_plus
-   int64_t lowest_median_index = median_index;
-   double lowest_median = median;
-   while(lowest_median == median)
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, theil_sen_workspace_size(n));
+   size_t mark = ws->used;
+
+   theil_sen_arrays a;
+   a.n = n;
+   a.points = workspace_alloc(ws, n * sizeof(point));
+   a.ranked = workspace_alloc(ws, n * sizeof(ranked_value));
+   a.sequence = workspace_alloc(ws, n * sizeof(int64_t));
+   a.buffer = workspace_alloc(ws, n * sizeof(int64_t));
+   if (a.points == NULL || a.ranked == NULL || a.sequence == NULL || a.buffer == NULL)
+      goto failed;
+   for (i = 0; i < n; i++)
    {
-      lowest_median_index++;
-      lowest_median = x[lowest_median_index];
+      a.points[i].x = x[i];
+      a.points[i].y = y[i];
    }
-   lowest_median_index--;
-   int64_t n_plus = lowest_median_index + 1;
-   double *z_plus = malloc(n_plus * sizeof(double));
-   for (i = 0; i < n_plus; i++)
-      z_plus[i] = (x[i] - median) / scale_factor;
-   
-   // Create z_minus
-   int64_t highest_median_index = median_index;
-   double highest_median = median;
-   while(highest_median == median)
+   qsort(a.points, n, sizeof(point), compare_points);
+
+   // Number of pairs of data points of different abscissas
+   int64_t total = n * (n - 1) / 2;
+   for (i = 0; i < n; i = j)
    {
-      highest_median_index--;
-      highest_median = x[highest_median_index];
+      for (j = i + 1; j < n && a.points[j].x == a.points[i].x; j++)
+         ;
+      total -= (j - i) * (j - i - 1) / 2;
    }
-   highest_median_index++;
-   int64_t n_minus = n - highest_median_index;
-   double *z_minus = malloc(n_minus * sizeof(double));
-   for (i = 0; i < n_minus; i++)
-      z_minus[i] = (x[highest_median_index + i] - median) / scale_factor;
-   
-   int64_t *left_border = malloc(n_plus * sizeof(int64_t));
-   fill_array_int(left_border, n_plus, 0);
-   
-   int64_t *right_border = malloc(n_plus * sizeof(int64_t));
-   fill_array_int(right_border, n_plus, n_minus - 1);
-
-   // Number of entries to the left of the left border
-   int64_t left_total = 0;
-
-   // Number of entries to the left of the right boundary
-   int64_t right_total = n_minus * n_plus;
-
-   int64_t medcouple_index = right_total / 2;
-
-   // Iterate while the number of entries between the boundaries is greater
-   // than the number of rows in the matrix
-   int64_t mid_border;
-   int64_t right_tent_total, left_tent_total;
-   double *row_medians = malloc(n_plus * sizeof(double));
-   double *weights = malloc(n_plus * sizeof(double));
-   double w_median, wm_epsilon;
-   int64_t *left_border_tent = malloc(n_plus * sizeof(int64_t));  // Tentative border
-   int64_t *right_border_tent = malloc(n_plus * sizeof(int64_t));  // Tentative border
-   while (right_total - left_total > n_plus)
-   {
-      int64_t n_middle_indices = 0;
-      for (i = 0; i < n_plus; i++)
-         if (left_border[i] <= right_border[i])
-            n_middle_indices++;
-      
-      j = 0;
-      for (i = 0; i < n_plus; i++)
-         if (left_border[i] <= right_border[i])
-         {
-            mid_border = (left_border[i] + right_border[i]) / 2;
-            row_medians[j] = h_kernel(
-               i, mid_border, z_plus, n_plus, z_minus, n_minus, epsilon2);
-            weights[j] = right_border[i] - left_border[i] + 1;
-            j++;
-         }
-
-      w_median = weighted_median(
-         row_medians, weights, 0, n_middle_indices - 1);
-
-      // New tentative right and left boundaries
-      wm_epsilon = epsilon1 * (epsilon1 + fabs(w_median));
-      where_h_greater_than_u(
-         right_border_tent, n_plus, z_plus, n_plus, z_minus, n_minus, w_median,
-         wm_epsilon, epsilon2);
-      where_h_less_than_u(
-         left_border_tent, n_plus, z_plus, n_plus, z_minus, n_minus, w_median,
-         wm_epsilon, epsilon2);
 
-      right_tent_total = sum_int(right_border_tent, n_plus) + n_plus;
-      left_tent_total = sum_int(left_border_tent, n_plus);
+   if (total == 0)
+   {
+      workspace_done(ws, &temporary, mark);
+      *intercept = NAN;
+      return NAN;
+   }
 
-      if (medcouple_index <= right_tent_total - 1)
-      {
-         copy_array_int(right_border_tent, right_border, n_plus);
-         right_total = right_tent_total;
-      }
-      else
+   // Ranks of the two middle slopes
+   int64_t k_low = (total - 1) / 2, k_high = total / 2;
+
+   // Interval of slopes [lower, higher] holding the middle ones, and numbers of
+   // slopes lower than its lower bound and up to its higher bound
+   double lower = -INFINITY, higher = INFINITY;
+   int64_t n_lower = 0, n_higher = total;
+   int64_t *identity = workspace_alloc(ws, n * sizeof(int64_t));
+   int64_t *lower_order = workspace_alloc(ws, n * sizeof(int64_t));
+   int64_t *higher_order = workspace_alloc(ws, n * sizeof(int64_t));
+   int64_t *trial_order = workspace_alloc(ws, n * sizeof(int64_t));
+   int64_t capacity = theil_sen_capacity(n), n_sample = capacity / 4;
+   int64_t *numbers = workspace_alloc(ws, capacity * sizeof(int64_t));
+   double *slopes = workspace_alloc(ws, capacity * sizeof(double));
+   if (identity == NULL || lower_order == NULL || higher_order == NULL || trial_order == NULL || numbers == NULL
+       || slopes == NULL)
+      goto failed;
+   theil_sen_order(&a, -INFINITY, 0, identity);
+   theil_sen_order(&a, -INFINITY, 0, lower_order);
+   theil_sen_order(&a, INFINITY, 1, higher_order);
+
+   // The counts are only exact up to the rounding of the residuals, so that the
+   // number of rounds is bounded, though a few of them narrow the interval
+   // enough with a high probability
+   for (int64_t step = 0; step < 64 && n_higher - n_lower > capacity && lower < higher; step++)
+   {
+      // Sample of the slopes in the interval
+      int64_t n_slopes = n_higher - n_lower;
+      for (i = 0; i < n_sample; i++)
+         numbers[i] = random_range(&ws->random_state, 0, n_slopes - 1);
+      sort_int64(numbers, n_sample, 0, ws);
+      int64_t count = theil_sen_pairs(&a, lower_order, higher_order, numbers, n_sample, slopes);
+
+      // The last numbers may lie beyond the pairs of the interval
+      int64_t m = n_sample;
+      while (m > 0 && numbers[m - 1] >= count)
+         m--;
+      if (m == 0)
+         break;
+      sort(slopes, m, 0, ws);
+
+      // Quantiles of the sample around the middle slopes, with a margin of a
+      // few standard deviations of the ranks in the sample
+      int64_t margin = 2 * (int64_t)sqrt((double)m) + 1;
+      int64_t low = (int64_t)((double)(k_low - n_lower) / n_slopes * m) - margin;
+      int64_t high = (int64_t)((double)(k_high - n_lower + 1) / n_slopes * m) + margin;
+
+      if (low >= 0 && slopes[low] > lower)
       {
-         if (medcouple_index > left_tent_total - 1)
+         theil_sen_order(&a, slopes[low], 0, trial_order);
+         count = theil_sen_pairs(&a, identity, trial_order, NULL, 0, NULL);
+         if (count <= k_low)
          {
-            copy_array_int(left_border_tent, left_border, n_plus);
-            left_total = left_tent_total;
+            int64_t *swapped = lower_order;
+            lower_order = trial_order;
+            trial_order = swapped;
+            lower = slopes[low];
+            n_lower = count;
          }
-         else
+      }
+      if (high < m && slopes[high] < higher)
+      {
+         theil_sen_order(&a, slopes[high], 1, trial_order);
+         count = theil_sen_pairs(&a, identity, trial_order, NULL, 0, NULL);
+         if (count > k_high)
          {
-            free(row_medians);
-            free(weights);
-            free(right_border_tent);
-            free(left_border_tent);
-            free(z_minus);
-            free(z_plus);
-            free(left_border);
-            free(right_border);
-
-            return w_median;
+            int64_t *swapped = higher_order;
+            higher_order = trial_order;
+            trial_order = swapped;
+            higher = slopes[high];
+            n_higher = count;
          }
       }
    }
-   free(row_medians);
-   free(weights);
-   free(right_border_tent);
-   free(left_border_tent);
 
-   int64_t n_remaining = 0;
-   for (i = 0; i < n_plus; i++)
+   // Enumerate the slopes of the interval, bounding their ranks. If the
+   // narrowing stopped with more of them than the capacity, they are all
+   // enumerated again into larger arrays
+   double slope = lower;
+   int64_t n_slopes = 0;
+   if (lower < higher)
    {
-      for (j = left_border[i]; j <= right_border[i]; j++)
-         n_remaining++;
-   }
-   
-   double *remaining = malloc(n_remaining * sizeof(double));
-   
-   int64_t k = 0;
-   for (i = 0; i < n_plus; i++)
-      for (j = left_border[i]; j <= right_border[i]; j++)
+      for (i = 0; i < capacity; i++)
+         numbers[i] = i;
+      n_slopes = theil_sen_pairs(&a, lower_order, higher_order, numbers, capacity, slopes);
+      if (n_slopes > capacity)
       {
-         remaining[k] = - h_kernel(
-            i, j, z_plus, n_plus, z_minus, n_minus, epsilon2);
-         k++;
+         numbers = workspace_alloc(ws, n_slopes * sizeof(int64_t));
+         slopes = workspace_alloc(ws, n_slopes * sizeof(double));
+         if (numbers == NULL || slopes == NULL)
+            goto failed;
+         for (i = 0; i < n_slopes; i++)
+            numbers[i] = i;
+         theil_sen_pairs(&a, lower_order, higher_order, numbers, n_slopes, slopes);
       }
+   }
+   if (n_slopes > 0)
+   {
+      int64_t low = k_low - n_lower < n_slopes ? k_low - n_lower : n_slopes - 1;
+      int64_t high = k_high - n_lower < n_slopes ? k_high - n_lower : n_slopes - 1;
+      double slope_high = partition_on_kth_smallest(slopes, 0, n_slopes - 1, high, &ws->random_state);
+      double slope_low = partition_on_kth_smallest(slopes, 0, high, low, &ws->random_state);
+      slope = (slope_low + slope_high) / 2.;
+   }
+
+   // Median of the residuals
+   double *residuals = slopes;
+   for (i = 0; i < n; i++)
+      residuals[i] = y[i] - slope * x[i];
+   double high = partition_on_kth_smallest(residuals, 0, n - 1, n / 2, &ws->random_state);
+   double low = n % 2 == 0 ? partition_on_kth_smallest(residuals, 0, n / 2 - 1, n / 2 - 1, &ws->random_state) : high;
+   *intercept = (low + high) / 2.;
 
-   double medcouple_ = - select_kth_smallest(
-      remaining, n_remaining, medcouple_index - left_total);
+   workspace_done(ws, &temporary, mark);
 
-   free(z_minus);
-   free(z_plus);
-   free(left_border);
-   free(right_border);
-   free(remaining);
+   return slope;
 
-   return medcouple_;
+failed:
+   ws->failed = 1;
+   workspace_done(ws, &temporary, mark);
+   *intercept = NAN;
+   return NAN;
 }
 
 /**
- * Mode.
+ * Size of the workspace used by function 'theil_sen'.
  * 
  * Arguments:
- *    x: Array.
- *    x: Length of the array.
+ *    n: Length of the arrays.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t theil_sen_workspace_size(int64_t n)
+{
+   return workspace_array_size(n * sizeof(point))
+      + workspace_array_size(n * sizeof(ranked_value))
+      + 6 * workspace_array_size(n * sizeof(int64_t))
+      + workspace_array_size(theil_sen_capacity(n) * sizeof(int64_t))
+      + workspace_array_size(theil_sen_capacity(n) * sizeof(double))
+      + sort_workspace_size(theil_sen_capacity(n) / 4);
+}
+
+/**
+ * Replace the element leaving a sliding window by the one entering it, in the
+ * sorted array of the values of the window that are not NaN.
+ * 
+ * A NaN value leaving or entering the window only changes the length of the
+ * array: a value entering the window replaces an infinite value appended at
+ * the end of the array, where it sorts last, and a value leaving it is
+ * replaced by such an infinite value, which is then dropped from the end.
+ * 
+ * Arguments:
+ *    x: Array sorted ascendingly or descendingly, with room for one more
+ *       element.
+ *    n: Length of the array.
+ *    old_value: Value leaving the window, which must be in the array unless it
+ *       is NaN.
+ *    new_value: Value entering the window.
+ *    descending: Whether the array is sorted descendingly.
  * 
  * Returns:
- *    Mode.
+ *    New length of the array.
  */
-double mode(double *x, int64_t n)
+static int64_t rolling_replace_sorted(double *x, int64_t n, double old_value, double new_value, int descending)
 {
-   int64_t m, m_half, i, j;
-   double width, min_width;
+   double last = descending ? -INFINITY : INFINITY;
+   int64_t new_n = n;
 
-   // Sort x ascendingly
-   qsort(x, n, sizeof(double), compare_ascending);
+   if (isnan(old_value) && isnan(new_value))
+      return n;
+   else if (isnan(old_value))
+   {
+      x[n++] = last;
+      old_value = last;
+      new_n = n;
+   }
+   else if (isnan(new_value))
+   {
+      new_value = last;
+      new_n = n - 1;
+   }
 
-   int64_t begin = 0;
-   int64_t end = n - 1;
+   if (descending)
+      replace_sorted_descending(x, n, old_value, new_value);
+   else
+      replace_sorted_ascending(x, n, old_value, new_value);
+
+   return new_n;
+}
 
-   while(1)
+/**
+ * Rolling medcouple over a sliding window.
+ * 
+ * The window is kept sorted descendingly between steps: at each step, the
+ * element leaving the window is replaced by the one entering it, shifting
+ * only the elements that lie between the two, instead of sorting the whole
+ * window again.
+ * 
+ * NaN values are counted rather than kept in the sorted window, where they
+ * would break its order, and the medcouple of a window holding any of them is
+ * NaN.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    window: Length of the sliding window, between 1 and n.
+ *    epsilon1: Machine epsilon. The smallest representable positive number
+ *       such that 1.0 + epsilon != 1.0.
+ *    epsilon2: The smallest representable number.
+ *    medcouples: Output array of length n - window + 1, where the i-th element
+ *       is the medcouple of the window of x starting at index i, or NaN if the
+ *       memory could not be allocated.
+ *    ws: Workspace from which to allocate the temporary arrays, or NULL to
+ *       allocate them from the heap.
+ */
+void rolling_medcouple(
+   double *x, int64_t n, int64_t window, double epsilon1, double epsilon2, double *medcouples,
+   workspace *ws)
+{
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, rolling_medcouple_workspace_size(window));
+   size_t mark = ws->used;
+
+   double *sorted_window = workspace_alloc(ws, window * sizeof(double));
+   if (sorted_window == NULL)
    {
-      m = end - begin + 1;
+      ws->failed = 1;
+      fill_array_double(medcouples, n - window + 1, NAN);
+      workspace_done(ws, &temporary, mark);
+      return;
+   }
+   int64_t n_sorted = 0;
+   for (int64_t i = 0; i < window; i++)
+      if (!isnan(x[i]))
+         sorted_window[n_sorted++] = x[i];
+   sort(sorted_window, n_sorted, 1, ws);
 
-      if (m == 1)
-         return x[begin];
-      else if (m == 2)
-         return (x[begin] + x[end]) / 2.;
-      else if (m == 3)
-      {
-         if (x[begin + 1] - x[begin] < x[end] - x[begin + 1])
-            return (x[begin] + x[begin + 1]) / 2.;
-         else if (x[begin + 1] - x[begin] > x[end] - x[begin + 1])
-            return (x[begin + 1] + x[end]) / 2.;
-         else
-            return x[begin + 1];
-      }
-      else
-      {
-         min_width = x[end] - x[begin];
+   medcouples[0] = n_sorted < window ? NAN : medcouple_sorted(sorted_window, window, epsilon1, epsilon2, ws);
 
-         m_half = (m + 1) / 2;
+   for (int64_t i = window; i < n; i++)
+   {
+      n_sorted = rolling_replace_sorted(sorted_window, n_sorted, x[i - window], x[i], 1);
+      medcouples[i - window + 1] =
+         n_sorted < window ? NAN : medcouple_sorted(sorted_window, window, epsilon1, epsilon2, ws);
+   }
 
-         j = begin;
-         for (i = begin; i <= begin + m - m_half; i++)
-         {
-            width = x[i + m_half - 1] - x[i];
+   workspace_done(ws, &temporary, mark);
+}
 
-            if (width < min_width)
-            {
-               min_width = width;
-               j = i;
-            }
-         }
+/**
+ * Size of the workspace used by function 'rolling_medcouple'.
+ * 
+ * Arguments:
+ *    window: Length of the sliding window.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t rolling_medcouple_workspace_size(int64_t window)
+{
+   return workspace_array_size(window * sizeof(double)) + medcouple_workspace_size(window);
+}
 
-         begin = j;
-         end = j + m_half - 1;
-      }
+/**
+ * Rolling mode over a sliding window.
+ * 
+ * The window is kept sorted ascendingly between steps: at each step, the
+ * element leaving the window is replaced by the one entering it, shifting
+ * only the elements that lie between the two, instead of sorting the whole
+ * window again.
+ * 
+ * NaN values are counted rather than kept in the sorted window, where they
+ * would break its order, and the mode of a window holding any of them is NaN.
+ * 
+ * Arguments:
+ *    x: Array.
+ *    n: Length of the array.
+ *    window: Length of the sliding window, between 1 and n.
+ *    modes: Output array of length n - window + 1, where the i-th element is
+ *       the mode of the window of x starting at index i, or NaN if the memory
+ *       could not be allocated.
+ *    ws: Workspace from which to allocate the sorted window and the buffer of
+ *       its sort, or NULL to allocate them from the heap.
+ */
+void rolling_mode(double *x, int64_t n, int64_t window, double *modes, workspace *ws)
+{
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, rolling_mode_workspace_size(window));
+   size_t mark = ws->used;
+
+   double *sorted_window = workspace_alloc(ws, window * sizeof(double));
+   if (sorted_window == NULL)
+   {
+      ws->failed = 1;
+      fill_array_double(modes, n - window + 1, NAN);
+      workspace_done(ws, &temporary, mark);
+      return;
+   }
+   int64_t n_sorted = 0;
+   for (int64_t i = 0; i < window; i++)
+      if (!isnan(x[i]))
+         sorted_window[n_sorted++] = x[i];
+   sort(sorted_window, n_sorted, 0, ws);
+
+   modes[0] = n_sorted < window ? NAN : mode_sorted(sorted_window, window);
+
+   for (int64_t i = window; i < n; i++)
+   {
+      n_sorted = rolling_replace_sorted(sorted_window, n_sorted, x[i - window], x[i], 0);
+      modes[i - window + 1] = n_sorted < window ? NAN : mode_sorted(sorted_window, window);
    }
+
+   workspace_done(ws, &temporary, mark);
+}
+
+/**
+ * Size of the workspace used by function 'rolling_mode'.
+ * 
+ * Arguments:
+ *    window: Length of the sliding window.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t rolling_mode_workspace_size(int64_t window)
+{
+   return workspace_array_size(window * sizeof(double)) + sort_workspace_size(window);
+}
+
+/**
+ * Size of the workspace used by function 'mode'.
+ * 
+ * Arguments:
+ *    n: Length of the array.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t mode_workspace_size(int64_t n)
+{
+   return sort_workspace_size(n);
 }
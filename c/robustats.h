@@ -1,5 +1,72 @@
+#include <stddef.h>
 #include <stdint.h>
+#include "workspace.h"
 
-double weighted_median(double *x, double *w, int64_t begin, int64_t end);
-double medcouple(double *x, int64_t n, double eps1, double eps2);
-double mode(double *x, int64_t n);
+void sort(double *x, int64_t n, int descending, workspace *ws);
+void sort_float32(float *x, int64_t n, int descending, workspace *ws);
+void sort_int32(int32_t *x, int64_t n, int descending, workspace *ws);
+void sort_int64(int64_t *x, int64_t n, int descending, workspace *ws);
+size_t sort_workspace_size(int64_t n);
+void sort_parallel(double *x, int64_t n, int descending, int64_t n_threads, workspace *ws);
+void sort_parallel_float32(float *x, int64_t n, int descending, int64_t n_threads, workspace *ws);
+void sort_parallel_int32(int32_t *x, int64_t n, int descending, int64_t n_threads, workspace *ws);
+void sort_parallel_int64(int64_t *x, int64_t n, int descending, int64_t n_threads, workspace *ws);
+size_t sort_parallel_workspace_size(int64_t n, int64_t n_threads);
+double weighted_quantile_in_place(double *x, double *w, int64_t begin, int64_t end, double q, uint64_t *random_state);
+double weighted_median_in_place(double *x, double *w, int64_t begin, int64_t end, uint64_t *random_state);
+double weighted_median_in_place_float32(float *x, double *w, int64_t begin, int64_t end, uint64_t *random_state);
+double weighted_median_in_place_int32(int32_t *x, double *w, int64_t begin, int64_t end, uint64_t *random_state);
+double weighted_median_in_place_int64(int64_t *x, double *w, int64_t begin, int64_t end, uint64_t *random_state);
+double weighted_median(double *x, double *w, int64_t begin, int64_t end, workspace *ws);
+void weighted_quantiles_in_place(double *x, double *w, int64_t n, double *qs, int64_t n_qs, double *quantiles, uint64_t *random_state);
+void weighted_quantiles_in_place_float32(float *x, double *w, int64_t n, double *qs, int64_t n_qs, double *quantiles, uint64_t *random_state);
+void weighted_quantiles_in_place_int32(int32_t *x, double *w, int64_t n, double *qs, int64_t n_qs, double *quantiles, uint64_t *random_state);
+void weighted_quantiles_in_place_int64(int64_t *x, double *w, int64_t n, double *qs, int64_t n_qs, double *quantiles, uint64_t *random_state);
+void weighted_quantiles_above_in_place(double *x, double *w, int64_t n, double w_below, double *targets, int64_t n_targets, uint64_t *random_state);
+void quantiles_in_place(double *x, int64_t n, double *qs, int64_t n_qs, double *quantiles, workspace *ws);
+void quantiles_in_place_float32(float *x, int64_t n, double *qs, int64_t n_qs, double *quantiles, workspace *ws);
+void quantiles_in_place_int32(int32_t *x, int64_t n, double *qs, int64_t n_qs, double *quantiles, workspace *ws);
+void quantiles_in_place_int64(int64_t *x, int64_t n, double *qs, int64_t n_qs, double *quantiles, workspace *ws);
+size_t quantiles_workspace_size(int64_t n_qs);
+size_t weighted_median_workspace_size(int64_t n);
+void rolling_weighted_median(double *x, double *w, int64_t n, int64_t window, double *medians, workspace *ws);
+size_t rolling_weighted_median_workspace_size(int64_t n);
+double medcouple_sorted(double *x, int64_t n, double eps1, double eps2, workspace *ws);
+double medcouple_sorted_float32(float *x, int64_t n, double eps1, double eps2, workspace *ws);
+double medcouple(double *x, int64_t n, double eps1, double eps2, workspace *ws);
+double medcouple_float32(float *x, int64_t n, double eps1, double eps2, workspace *ws);
+size_t medcouple_workspace_size(int64_t n);
+double medcouple_parallel(double *x, int64_t n, double eps1, double eps2, int64_t n_threads, workspace *ws);
+double medcouple_parallel_float32(float *x, int64_t n, double eps1, double eps2, int64_t n_threads, workspace *ws);
+size_t medcouple_parallel_workspace_size(int64_t n, int64_t n_threads);
+double medcouple_approximate(double *x, int64_t n, double eps1, double eps2, double tolerance, workspace *ws);
+double medcouple_approximate_float32(float *x, int64_t n, double eps1, double eps2, double tolerance, workspace *ws);
+double adjusted_boxplot(double *x, int64_t n, double factor, double eps1, double eps2, int64_t n_threads, double *bounds, uint8_t *outliers, workspace *ws);
+double adjusted_boxplot_float32(float *x, int64_t n, double factor, double eps1, double eps2, int64_t n_threads, double *bounds, uint8_t *outliers, workspace *ws);
+size_t adjusted_boxplot_workspace_size(int64_t n, int64_t n_threads);
+double qn(double *x, int64_t n, workspace *ws);
+double qn_float32(float *x, int64_t n, workspace *ws);
+size_t qn_workspace_size(int64_t n);
+double sn(double *x, int64_t n, workspace *ws);
+double sn_float32(float *x, int64_t n, workspace *ws);
+size_t sn_workspace_size(int64_t n);
+double hodges_lehmann(double *x, int64_t n, workspace *ws);
+double hodges_lehmann_float32(float *x, int64_t n, workspace *ws);
+size_t hodges_lehmann_workspace_size(int64_t n);
+double mad_in_place(double *x, int64_t n, double *median, uint64_t *random_state);
+double mad_in_place_float32(float *x, int64_t n, double *median, uint64_t *random_state);
+double theil_sen(double *x, double *y, int64_t n, double *intercept, workspace *ws);
+size_t theil_sen_workspace_size(int64_t n);
+void rolling_medcouple(double *x, int64_t n, int64_t window, double eps1, double eps2, double *medcouples, workspace *ws);
+size_t rolling_medcouple_workspace_size(int64_t window);
+double mode_sorted(double *x, int64_t n);
+double mode_sorted_float32(float *x, int64_t n);
+double mode_sorted_int32(int32_t *x, int64_t n);
+double mode_sorted_int64(int64_t *x, int64_t n);
+double mode(double *x, int64_t n, workspace *ws);
+size_t mode_workspace_size(int64_t n);
+double mode_float32(float *x, int64_t n, workspace *ws);
+double mode_int32(int32_t *x, int64_t n, workspace *ws);
+double mode_int64(int64_t *x, int64_t n, workspace *ws);
+void rolling_mode(double *x, int64_t n, int64_t window, double *modes, workspace *ws);
+size_t rolling_mode_workspace_size(int64_t window);
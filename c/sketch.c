@@ -0,0 +1,353 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+#include "robustats.h"
+#include "sketch.h"
+
+// Version of the serialization format
+#define SKETCH_VERSION 1
+
+// Number of 64-bit integers of the header of a serialized sketch: the version,
+// the size, whether the sketch is exact and the number of items
+#define SKETCH_HEADER_LENGTH 4
+
+/**
+ * Initialize an empty sketch.
+ * 
+ * A sketch summarizes a weighted data sample with at most a given number of
+ * items, each of which is a value with a weight, so that the weighted
+ * quantiles of the sample can be estimated from the sketch, and sketches of
+ * different samples can be merged into the sketch of their union.
+ * 
+ * The items are the data points themselves, and the quantiles are exact, as
+ * long as there are at most 'size' of them. Beyond that, the items are sorted
+ * and adjacent items are merged into items of at most about 4 / size of the
+ * total weight, leaving at most size / 2 items. A merged item takes the value
+ * of the weighted median of its items, so that the values of the items are
+ * always values of the data points, and its weight is the sum of their
+ * weights. Each compression moves the data points of a merged item by at most
+ * the weight of the item in the order of the data points, but these moves add
+ * up over the compressions, so that the error of the quantiles is not
+ * bounded, unlike that of a KLL sketch. It is typically within about 5 / size
+ * of the total weight, even after many merges.
+ * 
+ * Arguments:
+ *    s: Sketch.
+ *    size: Maximum number of items, at least 8.
+ */
+void sketch_init(sketch *s, int64_t size)
+{
+   s->items = NULL;
+   s->n = 0;
+   s->allocated = 0;
+   s->size = size;
+   s->exact = 1;
+}
+
+/**
+ * Free the memory of a sketch, leaving it empty.
+ * 
+ * Arguments:
+ *    s: Sketch.
+ */
+void sketch_free(sketch *s)
+{
+   free(s->items);
+   sketch_init(s, s->size);
+}
+
+/**
+ * Make sure that a sketch can hold a given number of items.
+ * 
+ * Returns:
+ *    1 on success, 0 if the memory could not be allocated.
+ */
+static int sketch_reserve(sketch *s, int64_t n)
+{
+   if (n <= s->allocated)
+      return 1;
+
+   sketch_item *items = realloc(s->items, n * sizeof(sketch_item));
+   if (items == NULL)
+      return 0;
+
+   s->items = items;
+   s->allocated = n;
+
+   return 1;
+}
+
+/**
+ * Compare two items by value.
+ */
+static int compare_items(const void *i, const void *j)
+{
+   const sketch_item *a = (const sketch_item *)i;
+   const sketch_item *b = (const sketch_item *)j;
+
+   if (a->value > b->value)
+      return 1;
+   else if (a->value < b->value)
+      return -1;
+   else
+      return 0;
+}
+
+/**
+ * Compress the items of a sketch into at most size / 2 items.
+ * 
+ * The items are sorted, and then merged from the lowest one on into groups of
+ * adjacent items weighing at most 4 / (size - 2) of the total weight, each
+ * group weighing more than that with the next one, so that there are at most
+ * size / 2 groups.
+ * 
+ * Arguments:
+ *    s: Sketch.
+ */
+static void sketch_compress(sketch *s)
+{
+   int64_t i, j, k, begin;
+   double group_weight, half_weight;
+
+   qsort(s->items, s->n, sizeof(sketch_item), compare_items);
+
+   double max_weight = 4. * sketch_total_weight(s) / (double)(s->size - 2);
+
+   k = 0;
+   for (i = 0; i < s->n; i = j)
+   {
+      // Group of the items from i to j - 1
+      begin = i;
+      group_weight = s->items[i].weight;
+      for (j = i + 1; j < s->n && group_weight + s->items[j].weight <= max_weight; j++)
+         group_weight += s->items[j].weight;
+
+      // Weighted median of the group, which is sorted
+      half_weight = 0.;
+      while (begin < j - 1 && half_weight + s->items[begin].weight < group_weight / 2.)
+      {
+         half_weight += s->items[begin].weight;
+         begin++;
+      }
+
+      s->items[k].value = s->items[begin].value;
+      s->items[k].weight = group_weight;
+      k++;
+   }
+
+   s->n = k;
+   s->exact = 0;
+}
+
+/**
+ * Append items to a sketch, compressing them whenever there are more than
+ * 'size' of them.
+ * 
+ * Returns:
+ *    1 on success, 0 if the memory could not be allocated.
+ */
+static int sketch_append(sketch *s, double *x, double *w, sketch_item *items, int64_t n)
+{
+   if (!sketch_reserve(s, s->size + 1))
+      return 0;
+
+   for (int64_t i = 0; i < n; i++)
+   {
+      if (s->n == s->size + 1)
+         sketch_compress(s);
+
+      if (items != NULL)
+         s->items[s->n] = items[i];
+      else
+      {
+         s->items[s->n].value = x[i];
+         s->items[s->n].weight = w[i];
+      }
+      s->n++;
+   }
+
+   if (s->n > s->size)
+      sketch_compress(s);
+
+   return 1;
+}
+
+/**
+ * Add a weighted data sample to a sketch.
+ * 
+ * Arguments:
+ *    s: Sketch.
+ *    x: Array of values.
+ *    w: Array of non-negative weights.
+ *    n: Length of the arrays.
+ * 
+ * Returns:
+ *    1 on success, 0 if the memory could not be allocated.
+ */
+int sketch_add(sketch *s, double *x, double *w, int64_t n)
+{
+   return sketch_append(s, x, w, NULL, n);
+}
+
+/**
+ * Merge a sketch into another one, which then summarizes the union of their
+ * data samples.
+ * 
+ * Arguments:
+ *    s: Sketch into which to merge the other one.
+ *    other: Other sketch to merge, which is not modified.
+ * 
+ * Returns:
+ *    1 on success, 0 if the memory could not be allocated.
+ */
+int sketch_merge(sketch *s, sketch *other)
+{
+   if (!other->exact)
+      s->exact = 0;
+
+   return sketch_append(s, NULL, NULL, other->items, other->n);
+}
+
+/**
+ * Total weight of the items of a sketch.
+ * 
+ * Arguments:
+ *    s: Sketch.
+ * 
+ * Returns:
+ *    Total weight.
+ */
+double sketch_total_weight(sketch *s)
+{
+   double total = 0.;
+   for (int64_t i = 0; i < s->n; i++)
+      total += s->items[i].weight;
+
+   return total;
+}
+
+/**
+ * Weighted quantile of the items of a sketch, as by function
+ * 'weighted_quantiles_in_place': the lowest value of positive weight whose
+ * cumulative weight reaches q times the total weight, except for order 0.5,
+ * which is the weighted median of function 'weighted_median', ties included.
+ * For an exact sketch, this is the weighted quantile returned by function
+ * 'weighted_quantiles' for its data sample.
+ * 
+ * Arguments:
+ *    s: Sketch, with at least one item.
+ *    q: Order of the quantile, between 0 and 1.
+ *    quantile: Where to write the weighted quantile, NaN if the weights are
+ *       all zero.
+ *    ws: Workspace from which to allocate the copies of the items, or NULL to
+ *       allocate them from the heap.
+ * 
+ * Returns:
+ *    1 on success, 0 if the memory could not be allocated.
+ */
+int sketch_quantile(sketch *s, double q, double *quantile, workspace *ws)
+{
+   workspace temporary;
+   ws = workspace_or_temporary(ws, &temporary, weighted_median_workspace_size(s->n));
+   size_t mark = ws->used;
+
+   double *x = workspace_alloc(ws, 2 * s->n * sizeof(double));
+   if (x == NULL)
+   {
+      ws->failed = 1;
+      workspace_done(ws, &temporary, mark);
+      return 0;
+   }
+   double *w = x + s->n;
+   for (int64_t i = 0; i < s->n; i++)
+   {
+      x[i] = s->items[i].value;
+      w[i] = s->items[i].weight;
+   }
+
+   weighted_quantiles_in_place(x, w, s->n, &q, 1, quantile, &ws->random_state);
+   workspace_done(ws, &temporary, mark);
+
+   return 1;
+}
+
+/**
+ * Size of a sketch serialized by function 'sketch_serialize'.
+ * 
+ * Arguments:
+ *    s: Sketch.
+ * 
+ * Returns:
+ *    Size in bytes.
+ */
+size_t sketch_serialized_size(sketch *s)
+{
+   return SKETCH_HEADER_LENGTH * sizeof(int64_t) + s->n * 2 * sizeof(double);
+}
+
+/**
+ * Serialize a sketch into a buffer, as a header of 64-bit integers followed
+ * by the values and weights of the items, in the native byte order.
+ * 
+ * Arguments:
+ *    s: Sketch.
+ *    buffer: Buffer of sketch_serialized_size(s) bytes.
+ */
+void sketch_serialize(sketch *s, char *buffer)
+{
+   int64_t header[SKETCH_HEADER_LENGTH] = {SKETCH_VERSION, s->size, s->exact, s->n};
+
+   memcpy(buffer, header, sizeof(header));
+   buffer += sizeof(header);
+   for (int64_t i = 0; i < s->n; i++)
+   {
+      memcpy(buffer, &s->items[i].value, sizeof(double));
+      memcpy(buffer + sizeof(double), &s->items[i].weight, sizeof(double));
+      buffer += 2 * sizeof(double);
+   }
+}
+
+/**
+ * Deserialize a sketch serialized by function 'sketch_serialize' into an empty
+ * sketch.
+ * 
+ * Arguments:
+ *    s: Empty sketch.
+ *    buffer: Buffer.
+ *    length: Length of the buffer in bytes.
+ * 
+ * Returns:
+ *    1 on success, 0 if the buffer is not a serialized sketch, -1 if the
+ *       memory could not be allocated.
+ */
+int sketch_deserialize(sketch *s, const char *buffer, size_t length)
+{
+   int64_t header[SKETCH_HEADER_LENGTH];
+
+   if (length < sizeof(header))
+      return 0;
+   memcpy(header, buffer, sizeof(header));
+   buffer += sizeof(header);
+
+   int64_t size = header[1], n = header[3];
+   if (header[0] != SKETCH_VERSION || size < 8 || n < 0 || n > size || (header[2] != 0 && header[2] != 1)
+      || length != sizeof(header) + (size_t)n * 2 * sizeof(double))
+      return 0;
+
+   sketch_init(s, size);
+   if (!sketch_reserve(s, size + 1))
+      return -1;
+
+   for (int64_t i = 0; i < n; i++)
+   {
+      memcpy(&s->items[i].value, buffer, sizeof(double));
+      memcpy(&s->items[i].weight, buffer + sizeof(double), sizeof(double));
+      buffer += 2 * sizeof(double);
+   }
+   s->n = n;
+   s->exact = (int)header[2];
+
+   return 1;
+}
@@ -0,0 +1,27 @@
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+   double value;
+   double weight;
+} sketch_item;
+
+typedef struct
+{
+   sketch_item *items;
+   int64_t n;  // Number of items
+   int64_t allocated;  // Number of items allocated
+   int64_t size;  // Number of items beyond which the items are compressed
+   int exact;  // 1 if the items are the data points, 0 if they were compressed
+} sketch;
+
+void sketch_init(sketch *s, int64_t size);
+void sketch_free(sketch *s);
+int sketch_add(sketch *s, double *x, double *w, int64_t n);
+int sketch_merge(sketch *s, sketch *other);
+double sketch_total_weight(sketch *s);
+int sketch_quantile(sketch *s, double q, double *quantile, workspace *ws);
+size_t sketch_serialized_size(sketch *s);
+void sketch_serialize(sketch *s, char *buffer);
+int sketch_deserialize(sketch *s, const char *buffer, size_t length);
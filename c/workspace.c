@@ -0,0 +1,251 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "base.h"
+#include "counters.h"
+#include "workspace.h"
+
+// Allocation sizes are rounded up to the size of a cache line
+#define WORKSPACE_ALIGNMENT 64
+
+/**
+ * Header of an overflow block, allocated when the main block is exhausted.
+ */
+typedef struct overflow_block
+{
+   struct overflow_block *next;
+   char padding[WORKSPACE_ALIGNMENT - sizeof(struct overflow_block *)];
+} overflow_block;
+
+/**
+ * Size taken in a workspace by an allocation, rounded up to a multiple of the
+ * alignment.
+ * 
+ * Arguments:
+ *    size: Size of the allocation in bytes.
+ * 
+ * Returns:
+ *    Size taken in the workspace in bytes.
+ */
+size_t workspace_array_size(size_t size)
+{
+   return (size + WORKSPACE_ALIGNMENT - 1) / WORKSPACE_ALIGNMENT * WORKSPACE_ALIGNMENT;
+}
+
+/**
+ * Free the overflow blocks of a workspace.
+ */
+static void free_overflow(workspace *ws)
+{
+   overflow_block *block = (overflow_block *)ws->overflow;
+   overflow_block *next;
+
+   while (block != NULL)
+   {
+      next = block->next;
+      free(block);
+      block = next;
+   }
+
+   ws->overflow = NULL;
+   ws->overflow_size = 0;
+}
+
+/**
+ * Initialize an empty workspace.
+ * 
+ * A workspace is an arena of memory from which the estimators allocate their
+ * temporary arrays. Allocations are bump allocations from a main block, and
+ * are released all together by moving back the mark of the memory in use, so
+ * that repeated calls do not allocate memory from the heap once the main block
+ * is large enough.
+ * 
+ * The workspace also holds the state of the generator of the pivots of the
+ * selections, seeded with the default seed, and the flag set by the functions
+ * that could not allocate their memory, which then return NaN.
+ * 
+ * Arguments:
+ *    ws: Workspace.
+ */
+void workspace_init(workspace *ws)
+{
+   ws->memory = NULL;
+   ws->size = 0;
+   ws->used = 0;
+   ws->overflow = NULL;
+   ws->overflow_size = 0;
+   random_seed(&ws->random_state, RANDOM_DEFAULT_SEED);
+   ws->failed = 0;
+}
+
+/**
+ * Seed the generator of the pivots of a workspace, so that the functions using
+ * it choose the same pivots for the same seed.
+ * 
+ * Arguments:
+ *    ws: Workspace.
+ *    seed: Seed.
+ */
+void workspace_seed(workspace *ws, uint64_t seed)
+{
+   random_seed(&ws->random_state, seed);
+}
+
+/**
+ * Make sure that the main block of an unused workspace has at least a given
+ * size, growing it if necessary.
+ * 
+ * Arguments:
+ *    ws: Workspace, with no memory in use.
+ *    size: Size in bytes.
+ * 
+ * Returns:
+ *    1 if the main block has at least the given size, 0 if the memory could
+ *       not be allocated, in which case the workspace is left unchanged.
+ */
+int workspace_reserve(workspace *ws, size_t size)
+{
+   if (size <= ws->size)
+      return 1;
+
+   size = workspace_array_size(size);
+   char *memory = malloc(size);
+   if (memory == NULL)
+      return 0;
+
+   free(ws->memory);
+   ws->memory = memory;
+   ws->size = size;
+
+   return 1;
+}
+
+/**
+ * Release all the memory in use in a workspace, and clear its flag of failed
+ * allocations.
+ * 
+ * If the previous allocations overflowed the main block, the main block is
+ * grown to hold all of them, so that the same allocations fit in the main
+ * block next time.
+ * 
+ * Arguments:
+ *    ws: Workspace.
+ */
+void workspace_reset(workspace *ws)
+{
+   size_t size = ws->size + ws->overflow_size;
+
+   free_overflow(ws);
+   ws->used = 0;
+   ws->failed = 0;
+   workspace_reserve(ws, size);
+}
+
+/**
+ * Free all the memory of a workspace, leaving it empty.
+ * 
+ * Arguments:
+ *    ws: Workspace.
+ */
+void workspace_free(workspace *ws)
+{
+   free_overflow(ws);
+   free(ws->memory);
+   workspace_init(ws);
+}
+
+/**
+ * Allocate memory from a workspace.
+ * 
+ * The memory is taken from the main block if there is enough room left, and
+ * from the heap otherwise, even for zero bytes when the workspace has no main
+ * block, so that only a failure returns NULL. A function that cannot do without the memory sets
+ * the flag 'failed' of the workspace, releases its allocations and returns NaN.
+ * 
+ * Arguments:
+ *    ws: Workspace.
+ *    size: Size in bytes.
+ * 
+ * Returns:
+ *    Pointer to the memory, suitably aligned for any type, or NULL if the
+ *       memory could not be allocated.
+ */
+void *workspace_alloc(workspace *ws, size_t size)
+{
+   size = workspace_array_size(size);
+   COUNT(bytes_allocated, (int64_t)size);
+
+   if (ws->memory != NULL && ws->used + size <= ws->size)
+   {
+      void *memory = ws->memory + ws->used;
+      ws->used += size;
+      return memory;
+   }
+
+   overflow_block *block = malloc(sizeof(overflow_block) + size);
+   if (block == NULL)
+      return NULL;
+
+   block->next = (overflow_block *)ws->overflow;
+   ws->overflow = block;
+   ws->overflow_size += size;
+
+   return block + 1;
+}
+
+/**
+ * Release the memory allocated from the main block of a workspace after a
+ * mark, obtained as the value of 'used' before the allocations.
+ * 
+ * Overflow blocks are only released when the workspace is reset.
+ * 
+ * Arguments:
+ *    ws: Workspace.
+ *    mark: Bytes of the main block in use before the allocations to release.
+ */
+void workspace_release(workspace *ws, size_t mark)
+{
+   ws->used = mark;
+}
+
+/**
+ * Workspace of a function, which is the given workspace or, if NULL, a
+ * temporary workspace with a main block of the given size.
+ * 
+ * Arguments:
+ *    ws: Workspace, or NULL.
+ *    temporary: Temporary workspace, used if ws is NULL.
+ *    size: Size in bytes of the main block of the temporary workspace.
+ * 
+ * Returns:
+ *    Workspace of the function, to be passed to 'workspace_done' together with
+ *       the value of its 'used' field before the allocations.
+ */
+workspace *workspace_or_temporary(workspace *ws, workspace *temporary, size_t size)
+{
+   if (ws != NULL)
+      return ws;
+
+   workspace_init(temporary);
+   workspace_reserve(temporary, size);
+
+   return temporary;
+}
+
+/**
+ * Release the memory allocated by a function from its workspace, obtained with
+ * 'workspace_or_temporary', freeing it if temporary.
+ * 
+ * Arguments:
+ *    ws: Workspace of the function.
+ *    temporary: Temporary workspace.
+ *    mark: Bytes of the main block in use before the allocations of the
+ *       function.
+ */
+void workspace_done(workspace *ws, workspace *temporary, size_t mark)
+{
+   if (ws == temporary)
+      workspace_free(temporary);
+   else
+      workspace_release(ws, mark);
+}
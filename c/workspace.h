@@ -0,0 +1,24 @@
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+   char *memory;  // Main block of memory
+   size_t size;  // Size of the main block in bytes
+   size_t used;  // Bytes of the main block in use
+   void *overflow;  // Linked list of the blocks allocated beyond the main one
+   size_t overflow_size;  // Total size of the overflow blocks in bytes
+   uint64_t random_state;  // State of the generator of the pivots
+   int failed;  // Whether a function could not allocate its memory since the last reset
+} workspace;
+
+size_t workspace_array_size(size_t size);
+void workspace_init(workspace *ws);
+void workspace_seed(workspace *ws, uint64_t seed);
+int workspace_reserve(workspace *ws, size_t size);
+void workspace_reset(workspace *ws);
+void workspace_free(workspace *ws);
+void *workspace_alloc(workspace *ws, size_t size);
+void workspace_release(workspace *ws, size_t mark);
+workspace *workspace_or_temporary(workspace *ws, workspace *temporary, size_t size);
+void workspace_done(workspace *ws, workspace *temporary, size_t mark);
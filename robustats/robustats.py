@@ -1,23 +1,169 @@
+import os
 import sys
-from typing import List, Union
+import tempfile
+from contextlib import contextmanager
+from typing import Iterable, Iterator, List, NamedTuple, Optional, Sequence, Union
 
 import numpy as np
 
 import _robustats
 
 
-def weighted_median(x: Union[List[float], np.ndarray], weights: Union[List[float], np.ndarray]) -> float:
+class Workspace(_robustats.Workspace):
+    """Memory reused by the estimators across calls.
+
+    A workspace holds a single block of memory, from which the estimators
+    take the copies of their input and all their temporary arrays. The block
+    grows to the largest size used by a call, so that repeated calls over
+    samples of similar size do not allocate any memory.
+
+    A workspace can be used by one call at a time; calls that are not given a
+    workspace share a default one.
+
+    Args:
+        n: Number of data points of the samples for which to preallocate the
+            memory. By default, the memory is allocated by the first call.
+        counters: Whether to record the counters of the work of each call,
+            which requires the library to be built with the environment
+            variable ROBUSTATS_COUNTERS=1. Otherwise, the counters are not
+            compiled, and setting it raises a RuntimeError.
+
+    Attributes:
+        size: Size of the memory of the workspace in bytes. Method 'clear'
+            frees it.
+        counters: Counters of the work of the last call given the workspace,
+            or None if they are not recorded, as a dictionary of: the
+            iterations of the selections over the matrices of the pairwise
+            estimators, such as the medcouple; the partitions of the
+            selections of the k-th smallest elements; the comparisons of
+            elements with the pivots of the partitions and of the matrices;
+            the elements moved by the partitions ('swaps'); the bytes
+            allocated from the workspace; and the time in seconds spent
+            sorting ('sort_seconds'), iterating over the matrices
+            ('matrix_seconds'), of which in the weighted medians of their rows
+            ('weighted_median_seconds'), and selecting among the entries
+            remaining after the iterations ('remaining_seconds'). The counts
+            and times of several threads are summed.
+
+    Examples:
+        >>> workspace = Workspace(n=1000)
+        >>> medcouple(x=[1., 2., 2., 2., 3., 4., 5., 6.], workspace=workspace)
+        1.0
+    """
+
+
+class Sketch(_robustats.Sketch):
+    """Mergeable summary of a weighted data sample, from which to estimate weighted quantiles.
+
+    A sketch holds at most 'size' items, each of which is a value with a
+    weight. As long as at most 'size' data points were added, the items are
+    the data points themselves, and the quantile of order q is that of function
+    'weighted_quantiles': the lowest value of positive weight whose cumulative
+    weight reaches q times the total weight, except for q = 0.5, which is the
+    weighted median of function 'weighted_median', ties included. Beyond that,
+    the items are sorted and adjacent items are merged into items of at most
+    about 4 / size of the total weight, as the clusters of a t-digest rather
+    than the compactors of a KLL sketch. The error of the quantiles, as a
+    fraction of the total weight, is thus not bounded: it is typically within
+    about 5 / size, and it may grow with the number of compressions and
+    merges, though only slowly.
+
+    Sketches of different data samples, such as the shards of a distributed
+    data set, can be merged into the sketch of their union, and serialized
+    into bytes with method 'to_bytes' and back with method 'from_bytes'.
+
+    Args:
+        size: Maximum number of items, at least 8.
+
+    Attributes:
+        size: Maximum number of items.
+        n_items: Number of items.
+        total_weight: Total weight of the data points.
+        exact: Whether the items are the data points, so that the quantiles
+            are exact.
+
+    Examples:
+        >>> sketch = Sketch(size=100)
+        >>> sketch.add([1., 2., 3.], [3., 1., 1.])
+        >>> sketch.median()
+        1.0
+        >>> other = Sketch(size=100)
+        >>> other.add([4., 5.], [2., 2.])
+        >>> sketch.merge(other)
+        >>> sketch.median()
+        3.0
+        >>> Sketch.from_bytes(sketch.to_bytes()).quantile(0.9)
+        5.0
+    """
+
+    def add(self, x: Union[List[float], np.ndarray], weights: Union[List[float], np.ndarray]) -> None:
+        """Add a data sample with respective weights to the sketch.
+
+        Args:
+            x: List or Numpy array.
+            weights: List or Numpy array of non-negative weights related to
+                'x'.
+        """
+        super().add(x, weights)
+
+    def quantile(self, q: float) -> float:
+        """Estimate a weighted quantile of the data points of the sketch.
+
+        Args:
+            q: Order of the quantile, between 0 and 1.
+
+        Returns:
+            Weighted quantile, which is a value of the data points, as by
+            function 'weighted_quantiles' for an exact sketch.
+        """
+        return super().quantile(q)
+
+    def median(self) -> float:
+        """Estimate the weighted median of the data points of the sketch.
+
+        Returns:
+            Weighted median, as by function 'weighted_median' for an exact
+            sketch.
+        """
+        return super().quantile(0.5)
+
+
+def weighted_median(
+    x: Union[List[float], np.ndarray],
+    weights: Union[List[float], np.ndarray],
+    axis: Optional[int] = None,
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> Union[float, np.ndarray]:
     """Calculate the weighted median of an array with related weights.
 
     For arrays with an even number of elements, this function calculates the
     lower weighted median.
 
+    Numpy arrays 'x' of float32, int32 and int64 values are computed in their
+    own type, without conversion; other values and the weights are converted
+    to float64.
+
+    By default, 'x' and 'weights' are not modified: they are copied once into
+    a workspace that is reused across calls. With 'overwrite_input', Numpy
+    arrays of contiguous values of these types are partitioned in-place
+    instead, without any copy, leaving their content in an unspecified order.
+
     Args:
         x: List or Numpy array.
         weights: List or Numpy of weights related to 'x'.
+        axis: Axis along which to calculate the weighted medians of a
+            multidimensional array. By default, 'x' is a 1D array.
+        overwrite_input: Whether 'x' and 'weights' may be modified in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. The pivots only change the running time, not the
+            result. By default, a fixed seed, so that runs are reproducible.
 
     Returns:
-        Weighted median.
+        Weighted median, or Numpy array of weighted medians if 'axis' is given.
 
     Examples:
         >>> weighted_median(x=[1., 2., 3.], weights=[1., 1., 1.])
@@ -28,18 +174,59 @@ def weighted_median(x: Union[List[float], np.ndarray], weights: Union[List[float
         1.0
         >>> weighted_median(x=[1., 2.], weights=[1., 1.])
         1.0
+        >>> weighted_median(x=[[1., 2., 3.], [1., 2., 3.]], weights=[[3., 1., 1.], [1., 1., 1.]], axis=1)
+        array([1., 2.])
     """
-    return _robustats.weighted_median(x, weights)
+    if axis is not None:
+        return _robustats.weighted_median_axis(x, weights, axis, workspace, seed)
 
+    return _robustats.weighted_median(x, weights, overwrite_input, workspace, seed)
 
-def medcouple(x: Union[List[float], np.ndarray]) -> float:
+
+def medcouple(
+    x: Union[List[float], np.ndarray],
+    axis: Optional[int] = None,
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+    n_threads: int = 1,
+    method: str = "exact",
+    tol: float = 1e-3,
+) -> Union[float, np.ndarray]:
     """Calculate the medcouple of a list of numbers.
 
+    Numpy arrays of float32 values are computed in float32, with the machine
+    epsilon of float32, without conversion; other values are converted to
+    float64.
+
+    By default, 'x' is not modified: it is copied once into a workspace that
+    is reused across calls. With 'overwrite_input', Numpy arrays of contiguous
+    float32 or float64 values are sorted in-place instead, without any copy.
+
     Args:
         x: List or Numpy array.
+        axis: Axis along which to calculate the medcouples of a
+            multidimensional array. By default, 'x' is a 1D array.
+        overwrite_input: Whether 'x' may be sorted in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. The pivots only change the running time, not the
+            result. By default, a fixed seed, so that runs are reproducible.
+        n_threads: Number of threads over which to split the sort and the
+            iterations of a large 1D array. The result is the same whatever
+            the number of threads. Not used with 'axis'.
+        method: "exact" for the medcouple, or "approx" for a medcouple within
+            'tol' of it, computed from blocks of the data points split by
+            selection instead of a sort, much faster over large samples. The
+            data points are then reordered rather than sorted by
+            'overwrite_input'. Samples with infinite or NaN values are
+            computed exactly, since the blocks then bound nothing.
+        tol: Maximum absolute difference between the approximate medcouple and
+            the medcouple, with method "approx".
 
     Returns:
-        Medcouple.
+        Medcouple, or Numpy array of medcouples if 'axis' is given.
 
     Examples:
         >>> medcouple(x=[1., 2., 3.])
@@ -50,29 +237,388 @@ def medcouple(x: Union[List[float], np.ndarray]) -> float:
         1.0
         >>> medcouple(x=[0.2, 0.17, 0.08, 0.16, 0.88, 0.86, 0.09, 0.54, 0.27])
         0.7
+        >>> medcouple(x=[[1., 2., 3., 4., 5., 6.], [1., 2., 3., 4., 10., 20.]], axis=1)
+        array([0.        , 0.55555556])
+        >>> round(medcouple(x=[0.2, 0.17, 0.08, 0.16, 0.88, 0.86, 0.09, 0.54, 0.27], method="approx", tol=0.01), 2)
+        0.7
     """
-    if isinstance(x, list):
-        epsilon1 = sys.float_info.epsilon
-        epsilon2 = sys.float_info.min
-    elif isinstance(x, np.ndarray):
-        epsilon1 = np.finfo(x.dtype).eps
-        epsilon2 = np.finfo(x.dtype).min
-    else:
+    if method not in ("exact", "approx"):
+        raise ValueError("Wrong function argument: the method must be 'exact' or 'approx'.")
+    if method == "approx" and not tol > 0.0:
+        raise ValueError("Wrong function argument: the tolerance must be positive.")
+    tolerance = tol if method == "approx" else 0.0
+
+    if axis is not None:
+        return _robustats.medcouple_axis(
+            x, sys.float_info.epsilon, sys.float_info.min, axis, workspace, seed, tolerance
+        )
+
+    if not isinstance(x, (list, tuple, np.ndarray)) and not _is_buffer(x):
         raise ValueError(
-            "Wrong function argument: array type not supported; please use a " "Python list or a Numpy array."
+            "Wrong function argument: array type not supported; please use a "
+            "Python list, a Numpy array or an object exposing the buffer protocol."
         )
 
-    return _robustats.medcouple(x, epsilon1, epsilon2)
+    return _robustats.medcouple(x, overwrite_input, workspace, seed, _n_threads(n_threads), tolerance)
+
+
+class AdjustedBoxplot(NamedTuple):
+    """Adjusted boxplot of a data sample, returned by function 'adjusted_boxplot'.
+
+    Attributes:
+        lower_fence: Lower fence, below which data points are outliers.
+        upper_fence: Upper fence, above which data points are outliers.
+        medcouple: Medcouple of the data sample.
+        first_quartile: First quartile of the data sample.
+        third_quartile: Third quartile of the data sample.
+        outliers: Boolean Numpy array, True for the data points outside the
+            fences. Their indices are given by 'numpy.flatnonzero(outliers)'.
+    """
+
+    lower_fence: float
+    upper_fence: float
+    medcouple: float
+    first_quartile: float
+    third_quartile: float
+    outliers: np.ndarray
+
+
+def adjusted_boxplot(
+    x: Union[List[float], np.ndarray],
+    factor: float = 1.5,
+    n_threads: int = 1,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> AdjustedBoxplot:
+    """Calculate the adjusted boxplot of Hubert and Vandervieren of a list of numbers.
+
+    The fences of the boxplot are skewed by the medcouple MC of the data
+    sample, as [Q1 - factor * exp(-4 MC) * IQR, Q3 + factor * exp(3 MC) * IQR]
+    if MC >= 0, and [Q1 - factor * exp(-3 MC) * IQR, Q3 + factor * exp(4 MC) *
+    IQR] otherwise, where Q1 and Q3 are the quartiles and IQR = Q3 - Q1.
+
+    The data points are sorted once for the medcouple, and the quartiles,
+    interpolated as by the default method of 'numpy.quantile', are read from
+    the same sorted copy. 'x' is not modified.
+
+    Args:
+        x: List or Numpy array.
+        factor: Factor of the fences, 1.5 for the usual boxplot.
+        n_threads: Number of native threads of the medcouple, as in function
+            'medcouple'.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Fences, medcouple, quartiles and outliers.
+
+    Examples:
+        >>> boxplot = adjusted_boxplot(x=[1., 2., 2., 3., 3., 3., 4., 4., 5., 30.])
+        >>> boxplot.lower_fence, boxplot.upper_fence
+        (-0.375, 6.625)
+        >>> np.flatnonzero(boxplot.outliers)
+        array([9])
+    """
+    if not factor >= 0.0:
+        raise ValueError("Wrong function argument: the factor must be non-negative.")
+
+    return AdjustedBoxplot(*_robustats.adjusted_boxplot(x, factor, _n_threads(n_threads), workspace, seed))
+
+
+def qn(
+    x: Union[List[float], np.ndarray],
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> float:
+    """Calculate the Qn estimator of scale of Rousseeuw and Croux of a list of numbers.
+
+    Qn is the k-th smallest of the distances |x[i] - x[j]| between the data
+    points, i < j, where k = h (h - 1) / 2 and h = n // 2 + 1, scaled by
+    2.2219 and by a finite sample correction, so as to estimate the standard
+    deviation of normal data. It has a breakdown point of 50% and an
+    efficiency of 82% at the normal distribution.
+
+    The distance is selected from the implicit matrix of the pairwise
+    differences in O(n log n) time and O(n) memory, as the medcouple.
+
+    Numpy arrays of float32 values are computed in their own type; other
+    values are converted to float64. Copies are as in function 'medcouple'.
+
+    Args:
+        x: List or Numpy array.
+        overwrite_input: Whether 'x' may be sorted in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Qn, or NaN if there are less than 2 data points.
+
+    Examples:
+        >>> round(qn(x=[1., 2., 3., 4., 5., 6., 7., 8., 9., 10., 100.]), 4)
+        3.9421
+    """
+    return _robustats.qn(x, overwrite_input, workspace, seed)
+
+
+def sn(
+    x: Union[List[float], np.ndarray],
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> float:
+    """Calculate the Sn estimator of scale of Rousseeuw and Croux of a list of numbers.
+
+    Sn is the low median over the data points of the high median of their
+    distances to all the data points, scaled by 1.1926 and by a finite sample
+    correction, so as to estimate the standard deviation of normal data. It
+    has a breakdown point of 50% and an efficiency of 58% at the normal
+    distribution.
+
+    The high medians are found by bisection over the sorted data points, in
+    O(n log n) time and O(n) memory.
 
+    Numpy arrays of float32 values are computed in their own type; other
+    values are converted to float64. Copies are as in function 'medcouple'.
 
-def mode(x: Union[List[float], np.ndarray]) -> float:
+    Args:
+        x: List or Numpy array.
+        overwrite_input: Whether 'x' may be sorted in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Sn, or NaN if there are less than 2 data points.
+
+    Examples:
+        >>> round(sn(x=[1., 2., 3., 4., 5., 6., 7., 8., 9., 10., 100.]), 4)
+        3.8966
+    """
+    return _robustats.sn(x, overwrite_input, workspace, seed)
+
+
+# Scale of the median absolute deviation consistent with the standard deviation
+# of normal data, 1 / Phi^-1(3 / 4)
+_NORMAL_MAD_SCALE = 1.482602218505602
+
+
+def mad(
+    x: Union[List[float], np.ndarray],
+    scale: Union[float, str] = 1.0,
+    axis: Optional[int] = None,
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> Union[float, np.ndarray]:
+    """Calculate the median absolute deviation of a list of numbers.
+
+    The median absolute deviation is the median of the absolute deviations of
+    the data points from their median, multiplied by a scale. The medians are
+    the average of the two middle values for an even number of data points,
+    as with 'numpy.median'.
+
+    Both medians are found by selections in a single buffer, the deviations
+    replacing the data points, in O(n) time.
+
+    Numpy arrays of float32 values are computed in their own type; other
+    values are converted to float64. Copies are as in function 'medcouple',
+    the deviations overwriting 'x' with 'overwrite_input'.
+
+    Args:
+        x: List or Numpy array.
+        scale: Scale by which to multiply the median absolute deviation, or
+            'normal' for the scale of about 1.4826 that makes it estimate the
+            standard deviation of normal data.
+        axis: Axis along which to calculate the median absolute deviations of
+            a multidimensional array. By default, over all the data points.
+        overwrite_input: Whether 'x' may be overwritten. Not used with 'axis'.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Median absolute deviation, or Numpy array of median absolute deviations
+        if 'axis' is given. NaN for an empty list.
+
+    Examples:
+        >>> mad(x=[1., 2., 3., 4., 100.])
+        1.0
+        >>> mad(x=[[1., 2., 3., 4.], [1., 3., 5., 7.]], axis=1)
+        array([1., 2.])
+    """
+    scale = _mad_scale(scale)
+    if axis is not None:
+        return scale * _robustats.mad_axis(x, axis, workspace, seed)
+
+    return scale * _robustats.mad(x, overwrite_input, workspace, seed)
+
+
+def robust_zscore(
+    x: Union[List[float], np.ndarray],
+    axis: Optional[int] = None,
+    out: Optional[np.ndarray] = None,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> np.ndarray:
+    """Calculate the robust z-scores of a list of numbers.
+
+    The robust z-score of a data point is its deviation from the median of the
+    data points, divided by their median absolute deviation scaled to estimate
+    the standard deviation of normal data. Data points whose median absolute
+    deviation is zero have infinite or NaN z-scores.
+
+    The median and the median absolute deviation are found as by function
+    'mad', in a single buffer of the workspace, and the z-scores are written
+    directly into the output array.
+
+    Args:
+        x: List or Numpy array.
+        axis: Axis along which to calculate the medians and the median
+            absolute deviations of a multidimensional array. By default, over
+            all the data points.
+        out: Numpy array of float64 of the shape of 'x' into which to write
+            the z-scores, which may be 'x' itself. By default, a new array.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Numpy array of the z-scores, of the shape of 'x', which is 'out' if
+        given.
+
+    Examples:
+        >>> np.round(robust_zscore(x=[1., 2., 3., 4., 100.]), 4)
+        array([-1.349 , -0.6745,  0.    ,  0.6745, 65.4255])
+    """
+    return _robustats.robust_zscore(x, out, axis, _NORMAL_MAD_SCALE, workspace, seed)
+
+
+def _mad_scale(scale: Union[float, str]) -> float:
+    """Interpret the scale of a median absolute deviation."""
+    if isinstance(scale, str):
+        if scale != "normal":
+            raise ValueError("Wrong function argument: the scale must be a number or 'normal'.")
+        return _NORMAL_MAD_SCALE
+    return float(scale)
+
+
+def hodges_lehmann(
+    x: Union[List[float], np.ndarray],
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> float:
+    """Calculate the Hodges-Lehmann estimator of location of a list of numbers.
+
+    The estimator is the median of the n (n + 1) / 2 Walsh averages
+    (x[i] + x[j]) / 2 of the data points, i <= j. It has a breakdown point of
+    29% and an efficiency of 95% at the normal distribution.
+
+    The middle averages are selected from the implicit triangular matrix of
+    the pairwise sums in O(n log n) time and O(n) memory, as the medcouple.
+
+    Numpy arrays of float32 values are computed in their own type; other
+    values are converted to float64. Copies are as in function 'medcouple'.
+
+    Args:
+        x: List or Numpy array.
+        overwrite_input: Whether 'x' may be sorted in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Hodges-Lehmann estimator, or NaN if the list is empty.
+
+    Examples:
+        >>> hodges_lehmann(x=[1., 2., 3., 4., 100.])
+        3.0
+    """
+    return _robustats.hodges_lehmann(x, overwrite_input, workspace, seed)
+
+
+class TheilSen(NamedTuple):
+    """Theil-Sen regression, returned by function 'theil_sen'.
+
+    Attributes:
+        slope: Median of the slopes of the pairs of data points.
+        intercept: Median of the residuals y - slope x.
+    """
+
+    slope: float
+    intercept: float
+
+
+def theil_sen(
+    x: Union[List[float], np.ndarray],
+    y: Union[List[float], np.ndarray],
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> TheilSen:
+    """Calculate the Theil-Sen estimator of a simple linear regression.
+
+    The slope is the median of the slopes (y[j] - y[i]) / (x[j] - x[i]) of the
+    pairs of data points of different abscissas, and the intercept is the
+    median of the residuals y - slope x. The slope has a breakdown point of
+    29%.
+
+    The median slope is found by a randomized slope selection, counting the
+    slopes below a candidate slope as the pairs of data points swapped
+    between their order by abscissa and their order by residual, in
+    O(n log n) expected time and O(n) memory.
+
+    Args:
+        x: List or Numpy array of the abscissas.
+        y: List or Numpy array of the ordinates, of the same length.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the sample of the slopes.
+            By default, a fixed seed.
+
+    Returns:
+        Slope and intercept, both NaN if all the abscissas are equal.
+
+    Examples:
+        >>> theil_sen(x=[0., 1., 2., 3., 4.], y=[1., 3., 5., 7., 30.])
+        TheilSen(slope=2.0, intercept=1.0)
+    """
+    return TheilSen(*_robustats.theil_sen(x, y, workspace, seed))
+
+
+def mode(
+    x: Union[List[float], np.ndarray],
+    axis: Optional[int] = None,
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+) -> Union[float, np.ndarray]:
     """Calculate the mode of a list of numbers.
 
+    Numpy arrays of float32, int32 and int64 values are computed in their own
+    type, without conversion; other values are converted to float64.
+
+    By default, 'x' is not modified: it is copied once into a workspace that
+    is reused across calls. With 'overwrite_input', Numpy arrays of contiguous
+    values of these types are sorted in-place instead, without any copy.
+
     Args:
         x: List or Numpy array.
+        axis: Axis along which to calculate the modes of a multidimensional
+            array. By default, 'x' is a 1D array.
+        overwrite_input: Whether 'x' may be sorted in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
 
     Returns:
-        Mode.
+        Mode, or Numpy array of modes if 'axis' is given.
 
     Examples:
         >>> mode(x=[1., 2., 3., 4., 5.])
@@ -85,5 +631,504 @@ def mode(x: Union[List[float], np.ndarray]) -> float:
         3.0
         >>> mode(x=[1., 2., 3., 3., 3., 4., 4., 4., 4., 4., 5., 6., 7.])
         4.0
+        >>> mode(x=[[1., 2., 3., 3., 4., 5.], [1., 1., 3., 4., 5., 6.]], axis=1)
+        array([3., 1.])
     """
-    return _robustats.mode(x)
+    if axis is not None:
+        return _robustats.mode_axis(x, axis, workspace)
+
+    return _robustats.mode(x, overwrite_input, workspace)
+
+
+def weighted_quantiles(
+    x: Union[List[float], np.ndarray],
+    weights: Union[List[float], np.ndarray],
+    qs: Union[float, Sequence[float], np.ndarray],
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> Union[float, np.ndarray]:
+    """Calculate the weighted quantiles of several orders of an array with related weights.
+
+    The weighted quantile of order q is the lowest value of positive weight
+    whose cumulative weight, in ascending order of the values, reaches q times
+    the total weight, except for q = 0.5, which is the weighted median of
+    function 'weighted_median', ties included: when the cumulative weight of a
+    value is exactly half of the total weight, 'weighted_median' may return a
+    higher value, which is then found with a second selection.
+
+    All the quantiles are found in a single multi-selection, the partitions
+    made for each of them being reused for the others, at about the cost of a
+    single call of 'weighted_median'. Types and copies are as in function
+    'weighted_median'.
+
+    Args:
+        x: List or Numpy array.
+        weights: List or Numpy array of non-negative weights related to 'x'.
+        qs: Order, or sequence of orders, of the quantiles, between 0 and 1.
+        overwrite_input: Whether 'x' and 'weights' may be modified in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Weighted quantile, or Numpy array of weighted quantiles of the shape
+        of 'qs', which are NaN if the weights are all zero.
+
+    Examples:
+        >>> weighted_quantiles(x=[1., 2., 3., 4.], weights=[1., 1., 1., 1.], qs=[0.25, 0.5, 1.])
+        array([1., 3., 4.])
+        >>> weighted_quantiles(x=[1., 2., 3., 4.], weights=[1., 1., 1., 1.], qs=[0.25, 0.49, 1.])
+        array([1., 2., 4.])
+        >>> weighted_quantiles(x=[1., 2., 3.], weights=[3., 1., 1.], qs=0.7)
+        2.0
+    """
+    sorted_qs, order, shape = _orders(qs)
+    values = np.empty(len(order))
+    values[order] = _robustats.weighted_quantiles(x, weights, sorted_qs, overwrite_input, workspace, seed)
+
+    return values.reshape(shape) if shape else float(values[0])
+
+
+def quantiles(
+    x: Union[List[float], np.ndarray],
+    qs: Union[float, Sequence[float], np.ndarray],
+    overwrite_input: bool = False,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> Union[float, np.ndarray]:
+    """Calculate the quantiles of several orders of a list of numbers.
+
+    The quantiles are interpolated linearly between the data points, as by
+    the default method of 'numpy.quantile'. The data points between which to
+    interpolate are all found in a single multi-selection, the partitions
+    made for each of them being reused for the others, instead of sorting the
+    array.
+
+    Numpy arrays of float32, int32 and int64 values are computed in their own
+    type, without conversion; other values are converted to float64. By
+    default, 'x' is not modified: it is copied once into a workspace that is
+    reused across calls. With 'overwrite_input', Numpy arrays of contiguous
+    values of these types are partitioned in-place instead, without any copy.
+
+    Args:
+        x: List or Numpy array.
+        qs: Order, or sequence of orders, of the quantiles, between 0 and 1.
+        overwrite_input: Whether 'x' may be partitioned in-place.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Quantile, or Numpy array of quantiles of the shape of 'qs'.
+
+    Examples:
+        >>> quantiles(x=[4., 1., 3., 2., 5.], qs=[0., 0.25, 0.5, 0.9])
+        array([1. , 2. , 3. , 4.6])
+        >>> quantiles(x=[1., 2.], qs=0.5)
+        1.5
+    """
+    sorted_qs, order, shape = _orders(qs)
+    values = np.empty(len(order))
+    values[order] = _robustats.quantiles(x, sorted_qs, overwrite_input, workspace, seed)
+
+    return values.reshape(shape) if shape else float(values[0])
+
+
+def rolling_medcouple(
+    x: Union[List[float], np.ndarray],
+    window: int,
+    workspace: Optional[Workspace] = None,
+    seed: Optional[int] = None,
+) -> np.ndarray:
+    """Calculate the medcouple of a list of numbers over a sliding window.
+
+    The window is kept sorted between steps, so that each step only shifts
+    the elements lying between the values leaving and entering the window,
+    instead of sorting the whole window again. The medcouple of a window
+    holding NaN values is NaN.
+
+    Args:
+        x: List or Numpy array.
+        window: Length of the sliding window.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. The pivots only change the running time, not the
+            result. By default, a fixed seed, so that runs are reproducible.
+
+    Returns:
+        Numpy array of length len(x) - window + 1, where the i-th element is
+        the medcouple of x[i:i + window].
+
+    Examples:
+        >>> rolling_medcouple(x=[1., 2., 3., 4., 8., 9., 20.], window=5)
+        array([0.        , 0.42857143, 0.        ])
+    """
+    return _robustats.rolling_medcouple(x, sys.float_info.epsilon, sys.float_info.min, window, workspace, seed)
+
+
+def rolling_weighted_median(
+    x: Union[List[float], np.ndarray],
+    weights: Union[List[float], np.ndarray],
+    window: int,
+    workspace: Optional[Workspace] = None,
+) -> np.ndarray:
+    """Calculate the weighted median of an array with related weights over a sliding window.
+
+    The weights of the window are kept in a tree ordered by value, so that
+    each step updates the tree and finds the weighted median in logarithmic
+    time.
+
+    For each window, this function calculates the weighted median of function
+    'weighted_median', ties included: when the cumulative weight of a value is
+    exactly half of the total weight of the window, the weighted median may be
+    a higher value than the lower weighted median. Windows whose weights are
+    all zero, or holding NaN values, have a weighted median of NaN.
+
+    Args:
+        x: List or Numpy array.
+        weights: List or Numpy of non-negative weights related to 'x'.
+        window: Length of the sliding window.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+
+    Returns:
+        Numpy array of length len(x) - window + 1, where the i-th element is
+        the weighted median of x[i:i + window].
+
+    Examples:
+        >>> rolling_weighted_median(x=[1., 2., 3., 4., 5.], weights=[1., 1., 1., 3., 1.], window=3)
+        array([2., 4., 4.])
+    """
+    return _robustats.rolling_weighted_median(x, weights, window, workspace)
+
+
+def rolling_mode(x: Union[List[float], np.ndarray], window: int, workspace: Optional[Workspace] = None) -> np.ndarray:
+    """Calculate the mode of a list of numbers over a sliding window.
+
+    The window is kept sorted between steps, so that each step only shifts
+    the elements lying between the values leaving and entering the window,
+    instead of sorting the whole window again. The mode of a window holding
+    NaN values is NaN.
+
+    Args:
+        x: List or Numpy array.
+        window: Length of the sliding window.
+        workspace: Workspace from which to allocate the memory of the call. By
+            default, the workspace shared by the calls.
+
+    Returns:
+        Numpy array of length len(x) - window + 1, where the i-th element is
+        the mode of x[i:i + window].
+
+    Examples:
+        >>> rolling_mode(x=[1., 2., 2., 3., 5., 5., 6.], window=4)
+        array([2., 2., 5., 5.])
+    """
+    return _robustats.rolling_mode(x, window, workspace)
+
+
+def weighted_median_external(
+    x: Union[str, os.PathLike, np.ndarray],
+    weights: Union[str, os.PathLike, np.ndarray],
+    memory: int = 1 << 28,
+    seed: Optional[int] = None,
+) -> float:
+    """Calculate the weighted median of a data sample that does not fit in memory.
+
+    The values and the weights are read sequentially, either from files of
+    raw native float64 values given by their paths, as written by
+    'numpy.ndarray.tofile', or from memory-mapped arrays such as
+    'numpy.memmap', which are read without copying them if they hold
+    contiguous float64 values. Each pass over the data narrows down the
+    values that can be the weighted median with a histogram of 2^16 buckets
+    of their leading bits, until the remaining ones fit in memory, so that
+    the data is read at most five times.
+
+    This function returns the weighted median of function 'weighted_median',
+    ties included. This is the lower weighted median, that is, the lowest value
+    of positive weight whose cumulative weight reaches half of the total
+    weight, except when that cumulative weight is exactly half of the total
+    weight, in which case a few more passes find the higher value that
+    'weighted_median' returns.
+
+    Args:
+        x: Path of a file of float64 values, or Numpy array.
+        weights: Path of a file of non-negative float64 weights related to
+            'x', or Numpy array.
+        memory: Number of bytes of memory to use, at least 64 KB, besides a
+            histogram of 1 MB.
+        seed: Seed of the pseudo-random generator of the pivots of the
+            selections. By default, a fixed seed.
+
+    Returns:
+        Weighted median, which is NaN if the weights are all zero.
+
+    Examples:
+        >>> weighted_median_external(x=np.array([1., 2., 3.]), weights=np.array([3., 1., 1.]))
+        1.0
+    """
+    if memory < 1 << 16:
+        raise ValueError("Wrong function argument: the memory must be at least 64 KB.")
+
+    return _robustats.weighted_median_external(_external(x), _external(weights), memory, seed)
+
+
+def mode_external(
+    x: Union[str, os.PathLike, np.ndarray],
+    memory: int = 1 << 28,
+    temporary_directory: Optional[Union[str, os.PathLike]] = None,
+) -> float:
+    """Calculate the mode of a data sample that does not fit in memory.
+
+    The values are read sequentially, either from a file of raw native
+    float64 values given by its path, as written by 'numpy.ndarray.tofile',
+    or from a memory-mapped array such as 'numpy.memmap'. They are sorted by
+    an external merge sort into two scratch files, each of which takes as much
+    disk space as the data, and the half-sample mode is then found by
+    scanning the sorted file, so that the result is that of function 'mode'.
+
+    Args:
+        x: Path of a file of float64 values, or Numpy array.
+        memory: Number of bytes of memory to use, at least 64 KB.
+        temporary_directory: Directory of the scratch files, which are
+            removed once done. By default, the directory of module
+            'tempfile'.
+
+    Returns:
+        Mode.
+
+    Examples:
+        >>> mode_external(x=np.array([1., 2., 3., 3., 4., 5.]))
+        3.0
+    """
+    if memory < 1 << 16:
+        raise ValueError("Wrong function argument: the memory must be at least 64 KB.")
+
+    with _scratch_files(2, temporary_directory) as paths:
+        return _robustats.mode_external(_external(x), memory, paths[0], paths[1])
+
+
+def medcouple_external(
+    x: Union[str, os.PathLike, np.ndarray, Iterable[np.ndarray]],
+    memory: int = 1 << 28,
+    temporary_directory: Optional[Union[str, os.PathLike]] = None,
+    seed: Optional[int] = None,
+) -> float:
+    """Calculate the medcouple of a data sample that does not fit in memory.
+
+    The values are read sequentially, either from a file of raw native
+    float64 values given by its path, as written by 'numpy.ndarray.tofile',
+    from a memory-mapped array such as 'numpy.memmap', or from an iterable of
+    chunks of values, which are first written to a scratch file. They are
+    sorted by an external merge sort into two scratch files, each of which
+    takes as much disk space as the data, and the medcouple is then selected
+    from the matrix of its kernel, whose rows and columns are read from the
+    sorted file.
+
+    Instead of the borders of the rows of function 'medcouple', which take
+    memory proportional to the data, the entries that remain candidates are
+    kept between two bounds, chosen from a uniform sample of the candidates so
+    that each pass over the sorted file keeps about 1 / 32 of them, until they
+    fit in memory. The result is the exact medcouple; data samples small
+    enough for the given memory are computed by function 'medcouple'.
+
+    Args:
+        x: Path of a file of float64 values, Numpy array, or iterable of
+            Numpy arrays.
+        memory: Number of bytes of memory to use, at least 128 KB.
+        temporary_directory: Directory of the scratch files, which are
+            removed once done. By default, the directory of module
+            'tempfile'.
+        seed: Seed of the pseudo-random generator of the samples. The samples
+            only change the running time, not the result. By default, a fixed
+            seed.
+
+    Returns:
+        Medcouple.
+
+    Examples:
+        >>> medcouple_external(x=np.array([1., 2., 3., 4., 5., 6., 7., 8., 9.]))
+        0.0
+        >>> medcouple_external(x=[np.array([1., 2., 3.]), np.array([4., 5., 6., 7., 20.])])
+        0.0
+    """
+    if memory < 1 << 17:
+        raise ValueError("Wrong function argument: the memory must be at least 128 KB.")
+
+    chunked = not isinstance(x, (str, os.PathLike, np.ndarray)) and not _is_buffer(x)
+    with _scratch_files(3 if chunked else 2, temporary_directory) as paths:
+        if chunked:
+            with open(paths[2], "wb") as file:
+                for chunk in x:
+                    np.ascontiguousarray(chunk, dtype=np.float64).tofile(file)
+            x = paths[2]
+        return _robustats.medcouple_external(_external(x), memory, paths[0], paths[1], seed)
+
+
+def weighted_median_batch(
+    xs: Union[Sequence[Union[List[float], np.ndarray]], np.ndarray],
+    weights: Union[Sequence[Union[List[float], np.ndarray]], np.ndarray],
+    axis: int = -1,
+    n_threads: Optional[int] = None,
+    overwrite_input: bool = False,
+    seed: Optional[int] = None,
+) -> np.ndarray:
+    """Calculate the weighted medians of a batch of arrays with related weights, in parallel.
+
+    The computations are distributed over a pool of native threads, without
+    holding the Python global interpreter lock. Each thread allocates memory
+    from its own workspace.
+
+    Args:
+        xs: Sequence of lists or Numpy arrays, or 2D Numpy array.
+        weights: Sequence of lists or Numpy arrays of weights related to 'xs', or 2D Numpy array.
+        axis: Axis along which to calculate the weighted medians, if 'xs' and 'weights' are 2D Numpy arrays.
+        n_threads: Number of threads. By default, the number of CPUs.
+        overwrite_input: Whether the arrays may be modified in-place, as in 'weighted_median'.
+        seed: Seed of the pseudo-random generators of the pivots, as in 'weighted_median'. The generator of each
+            array is seeded from the seed and the index of the array, so that runs are reproducible whatever the
+            number of threads.
+
+    Returns:
+        Numpy array of weighted medians, one for each array of the batch.
+
+    Examples:
+        >>> weighted_median_batch(xs=[[1., 2., 3.], [1., 2.]], weights=[[3., 1., 1.], [1., 1.]])
+        array([1., 1.])
+    """
+    return _robustats.weighted_median_batch(
+        _batch(xs, axis), _batch(weights, axis), _n_threads(n_threads), overwrite_input, seed
+    )
+
+
+def medcouple_batch(
+    xs: Union[Sequence[Union[List[float], np.ndarray]], np.ndarray],
+    axis: int = -1,
+    n_threads: Optional[int] = None,
+    overwrite_input: bool = False,
+    seed: Optional[int] = None,
+) -> np.ndarray:
+    """Calculate the medcouples of a batch of arrays, in parallel.
+
+    The computations are distributed over a pool of native threads, without
+    holding the Python global interpreter lock. Each thread allocates memory
+    from its own workspace.
+
+    Args:
+        xs: Sequence of lists or Numpy arrays, or 2D Numpy array.
+        axis: Axis along which to calculate the medcouples, if 'xs' is a 2D Numpy array.
+        n_threads: Number of threads. By default, the number of CPUs.
+        overwrite_input: Whether the arrays may be sorted in-place, as in 'medcouple'.
+        seed: Seed of the pseudo-random generators of the pivots, as in 'medcouple'. The generator of each array is
+            seeded from the seed and the index of the array, so that runs are reproducible whatever the number of
+            threads.
+
+    Returns:
+        Numpy array of medcouples, one for each array of the batch.
+
+    Examples:
+        >>> medcouple_batch(xs=[[1., 2., 3.], [1., 2., 2., 2., 3., 4., 5., 6.]])
+        array([0., 1.])
+    """
+    epsilon1 = sys.float_info.epsilon
+    epsilon2 = sys.float_info.min
+
+    return _robustats.medcouple_batch(
+        _batch(xs, axis), epsilon1, epsilon2, _n_threads(n_threads), overwrite_input, seed
+    )
+
+
+def mode_batch(
+    xs: Union[Sequence[Union[List[float], np.ndarray]], np.ndarray],
+    axis: int = -1,
+    n_threads: Optional[int] = None,
+    overwrite_input: bool = False,
+) -> np.ndarray:
+    """Calculate the modes of a batch of arrays, in parallel.
+
+    The computations are distributed over a pool of native threads, without
+    holding the Python global interpreter lock. Each thread allocates memory
+    from its own workspace.
+
+    Args:
+        xs: Sequence of lists or Numpy arrays, or 2D Numpy array.
+        axis: Axis along which to calculate the modes, if 'xs' is a 2D Numpy array.
+        n_threads: Number of threads. By default, the number of CPUs.
+        overwrite_input: Whether the arrays may be sorted in-place, as in 'mode'.
+
+    Returns:
+        Numpy array of modes, one for each array of the batch.
+
+    Examples:
+        >>> mode_batch(xs=[[1., 2., 3., 3., 4., 5.], [1., 2., 2., 3., 3., 3., 4., 4., 5.]])
+        array([3., 3.])
+    """
+    return _robustats.mode_batch(_batch(xs, axis), _n_threads(n_threads), overwrite_input)
+
+
+def _batch(
+    xs: Union[Sequence[Union[List[float], np.ndarray]], np.ndarray], axis: int
+) -> Sequence[Union[List[float], np.ndarray]]:
+    """Split a 2D Numpy array into the sequence of its 1D slices along an axis.
+
+    Other sequences of arrays are returned unchanged.
+    """
+    if isinstance(xs, np.ndarray):
+        if xs.ndim != 2:
+            raise ValueError("Wrong function argument: only 2D Numpy arrays are supported as batches.")
+        return list(np.moveaxis(xs, axis, -1))
+
+    return xs
+
+
+def _orders(qs: Union[float, Sequence[float], np.ndarray]):
+    """Return the orders of quantiles sorted ascendingly, their order and their shape."""
+    qs = np.asarray(qs, dtype=np.float64)
+    if not np.all((qs >= 0.0) & (qs <= 1.0)):
+        raise ValueError("Wrong function argument: the orders of the quantiles must be between 0 and 1.")
+    order = np.argsort(qs, axis=None, kind="stable")
+
+    return np.ascontiguousarray(qs.ravel()[order]), order, qs.shape
+
+
+def _external(x):
+    """Return the path of a file as a string, and other objects unchanged."""
+    return os.fspath(x) if isinstance(x, os.PathLike) else x
+
+
+@contextmanager
+def _scratch_files(count: int, directory: Optional[Union[str, os.PathLike]]) -> Iterator[List[str]]:
+    """Create empty scratch files, and remove them once done."""
+    paths: List[str] = []
+    try:
+        for _ in range(count):
+            descriptor, path = tempfile.mkstemp(prefix="robustats-", dir=directory)
+            os.close(descriptor)
+            paths.append(path)
+        yield paths
+    finally:
+        for path in paths:
+            os.remove(path)
+
+
+def _is_buffer(x) -> bool:
+    """Return whether an object exposes the buffer protocol."""
+    try:
+        memoryview(x)
+    except TypeError:
+        return False
+    return True
+
+
+def _n_threads(n_threads: Optional[int]) -> int:
+    """Return the number of threads to use, defaulting to the number of CPUs."""
+    if n_threads is None:
+        return os.cpu_count() or 1
+    if n_threads < 1:
+        raise ValueError("Wrong function argument: the number of threads must be positive.")
+
+    return n_threads
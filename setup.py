@@ -1,3 +1,6 @@
+import os
+import sys
+
 from setuptools import Extension, setup
 
 try:
@@ -32,8 +35,21 @@ setup(
     ext_modules=[
         Extension(
             name="_robustats",
-            sources=["c/_robustats.c", "c/robustats.c", "c/base.c"],
+            sources=[
+                "c/_robustats.c",
+                "c/robustats.c",
+                "c/base.c",
+                "c/parallel.c",
+                "c/workspace.c",
+                "c/kernels.c",
+                "c/sketch.c",
+                "c/counters.c",
+                "c/external.c",
+            ],
             extra_compile_args=["-std=c99"],
+            # Counters of the work of the estimators, off by default
+            define_macros=[("ROBUSTATS_COUNTERS", "1")] if os.environ.get("ROBUSTATS_COUNTERS") == "1" else [],
+            libraries=[] if sys.platform == "win32" else ["pthread"],
             include_dirs=numpy.distutils.misc_util.get_numpy_include_dirs(),
         )
     ],
@@ -1,5 +1,12 @@
+import array
+import itertools
+import os
+import pathlib
+import tempfile
 import unittest
 
+import numpy as np
+
 import robustats
 
 
@@ -28,6 +35,27 @@ class TestWeightedMedian(unittest.TestCase):
         weighted_median = robustats.weighted_median(x, weights)
         self.assertEqual(weighted_median, 1.0)
 
+    def test_permuted_inputs(self):
+        self.assertEqual(robustats.weighted_median([2.0, 1.0], [1.0, 1.0]), 1.0)
+        self.assertEqual(robustats.weighted_median_batch([[2.0, 1.0]], [[1.0, 1.0]]).tolist(), [1.0])
+        rng = np.random.default_rng(0)
+        for n in [2, 3, 4, 5, 6]:
+            for _ in range(20):
+                x = rng.integers(0, 4, size=n).astype(float)
+                weights = rng.integers(0, 3, size=n).astype(float)
+                weights[0] += 1.0
+                expected = robustats.weighted_median(x, weights)
+                for permutation in itertools.permutations(range(n)):
+                    self.assertEqual(
+                        robustats.weighted_median(x[list(permutation)], weights[list(permutation)]), expected
+                    )
+
+    def test_empty(self):
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.weighted_median([], [])
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.weighted_median(np.array([], dtype=np.int32), [])
+
     def test_generic_1(self):
         x = [1.3, 5.1, 2.9, 1.9, 7.4]
         weights = [1.4, 0.9, 0.6, 1.2, 1.7]
@@ -742,3 +770,1083 @@ class TestMode(unittest.TestCase):
         ]
         mode = robustats.mode(x)
         self.assertEqual(mode, 2.98)
+
+    def test_empty(self):
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.mode([])
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.mode(np.array([], dtype=np.float32))
+
+
+class TestBatch(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(0)
+        self.x = rng.gamma(2.0, size=(7, 101))
+        self.weights = rng.uniform(size=(7, 101))
+
+    def test_weighted_median_sequence(self):
+        xs = [self.x[0], self.x[1, :50], [1.0, 2.0, 3.0]]
+        weights = [self.weights[0], self.weights[1, :50], [3.0, 1.0, 1.0]]
+        expected = [robustats.weighted_median(x, w) for x, w in zip(xs, weights)]
+        result = robustats.weighted_median_batch(xs, weights, n_threads=3)
+        self.assertEqual(result.tolist(), expected)
+
+    def test_weighted_median_axis(self):
+        expected = [robustats.weighted_median(x, w) for x, w in zip(self.x.T, self.weights.T)]
+        result = robustats.weighted_median_batch(self.x, self.weights, axis=0, n_threads=4)
+        self.assertEqual(result.tolist(), expected)
+
+    def test_weighted_median_different_lengths(self):
+        with self.assertRaises(ValueError):
+            robustats.weighted_median_batch([[1.0, 2.0]], [[1.0, 2.0, 3.0]])
+
+    def test_medcouple(self):
+        expected = [robustats.medcouple(x.tolist()) for x in self.x]
+        result = robustats.medcouple_batch(self.x.copy(), n_threads=4)
+        self.assertEqual(result.tolist(), expected)
+
+    def test_mode(self):
+        expected = [robustats.mode(x.tolist()) for x in self.x.T]
+        result = robustats.mode_batch(self.x.copy(), axis=0, n_threads=2)
+        self.assertEqual(result.tolist(), expected)
+
+    def test_empty_samples(self):
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.weighted_median_batch([[]], [[]])
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.weighted_median_batch([[1.0], []], [[1.0], []], n_threads=2)
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.mode_batch([[]])
+        with self.assertRaisesRegex(ValueError, "must not be empty"):
+            robustats.mode_batch([[1.0], []], n_threads=2)
+
+
+class TestAxis(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(1)
+        self.x = rng.gamma(2.0, size=(4, 5, 30))
+        self.weights = rng.uniform(size=(4, 5, 30))
+
+    def test_weighted_median(self):
+        for axis in range(self.x.ndim):
+            x = np.moveaxis(self.x, axis, -1)
+            weights = np.moveaxis(self.weights, axis, -1)
+            expected = [
+                robustats.weighted_median(x_slice.tolist(), w_slice.tolist())
+                for x_slice, w_slice in zip(x.reshape(-1, x.shape[-1]), weights.reshape(-1, x.shape[-1]))
+            ]
+            result = robustats.weighted_median(self.x, self.weights, axis=axis)
+            self.assertEqual(result.shape, x.shape[:-1])
+            self.assertEqual(result.ravel().tolist(), expected)
+
+    def test_medcouple(self):
+        for axis in [0, 1, -1]:
+            expected = np.apply_along_axis(lambda x_slice: robustats.medcouple(x_slice.tolist()), axis, self.x)
+            result = robustats.medcouple(self.x, axis=axis)
+            self.assertTrue(np.array_equal(result, expected))
+
+    def test_mode(self):
+        for axis in [0, 1, -1]:
+            expected = np.apply_along_axis(lambda x_slice: robustats.mode(x_slice.tolist()), axis, self.x)
+            result = robustats.mode(self.x, axis=axis)
+            self.assertTrue(np.array_equal(result, expected))
+
+    def test_input_not_modified(self):
+        x = np.asfortranarray(self.x[:, 0, :])
+        x_copy = x.copy()
+        robustats.medcouple(x, axis=0)
+        robustats.mode(x, axis=1)
+        self.assertTrue(np.array_equal(x, x_copy))
+
+    def test_axis_out_of_bounds(self):
+        with self.assertRaises(ValueError):
+            robustats.mode(self.x, axis=3)
+
+
+class TestRollingMedcouple(unittest.TestCase):
+    def test_windows(self):
+        x = np.random.default_rng(2).gamma(2.0, size=200).round(1)
+        for window in [1, 2, 3, 10, 51, 200]:
+            expected = [robustats.medcouple(x[i : i + window].tolist()) for i in range(len(x) - window + 1)]
+            result = robustats.rolling_medcouple(x, window)
+            self.assertEqual(result.tolist(), expected)
+
+    def test_nan(self):
+        result = robustats.rolling_medcouple([1.0, np.nan, 3.0, 4.0, 5.0, 6.0, 7.0], 3)
+        np.testing.assert_array_equal(result, [np.nan, np.nan, 0.0, 0.0, 0.0])
+        x = np.random.default_rng(2).gamma(2.0, size=200).round(1)
+        x[np.random.default_rng(2).uniform(size=200) < 0.05] = np.nan
+        for window in [1, 2, 3, 10, 51]:
+            expected = [
+                np.nan if np.isnan(x[i : i + window]).any() else robustats.medcouple(x[i : i + window])
+                for i in range(len(x) - window + 1)
+            ]
+            np.testing.assert_array_equal(robustats.rolling_medcouple(x, window), expected)
+
+    def test_input_not_modified(self):
+        x = [3.0, 1.0, 2.0, 5.0, 4.0]
+        robustats.rolling_medcouple(x, 3)
+        self.assertEqual(x, [3.0, 1.0, 2.0, 5.0, 4.0])
+
+    def test_wrong_window(self):
+        with self.assertRaises(ValueError):
+            robustats.rolling_medcouple([1.0, 2.0, 3.0], 4)
+
+
+class TestRollingWeightedMedian(unittest.TestCase):
+    def test_windows(self):
+        rng = np.random.default_rng(3)
+        x = rng.normal(size=300)
+        weights = rng.uniform(size=300)
+        for window in [1, 2, 5, 64, 300]:
+            expected = [
+                robustats.weighted_median(x[i : i + window].tolist(), weights[i : i + window].tolist())
+                for i in range(len(x) - window + 1)
+            ]
+            result = robustats.rolling_weighted_median(x, weights, window)
+            self.assertEqual(result.tolist(), expected)
+
+    def test_ties(self):
+        rng = np.random.default_rng(4)
+        x = rng.integers(0, 10, size=100).astype(float)
+        weights = rng.integers(0, 3, size=100).astype(float)
+        window = 6
+        expected = [
+            robustats.weighted_median(x[i : i + window], weights[i : i + window]) for i in range(len(x) - window + 1)
+        ]
+        result = robustats.rolling_weighted_median(x, weights, window)
+        np.testing.assert_array_equal(result, expected)
+        weights = rng.integers(1, 3, size=100).astype(float)
+        for window in [1, 2, 3, 4, 7, 8, 33]:
+            expected = [
+                robustats.weighted_median(x[i : i + window], weights[i : i + window])
+                for i in range(len(x) - window + 1)
+            ]
+            result = robustats.rolling_weighted_median(x, weights, window)
+            np.testing.assert_array_equal(result, expected)
+        result = robustats.rolling_weighted_median([1.0, 2.0, 3.0, 4.0], [1.0, 1.0, 1.0, 1.0], 4)
+        self.assertEqual(result.tolist(), [3.0])
+        result = robustats.rolling_weighted_median([1.0, 2.0, 3.0], [2.0, 1.0, 1.0], 3)
+        self.assertEqual(result.tolist(), [2.0])
+
+    def test_nan(self):
+        result = robustats.rolling_weighted_median([1.0, np.nan, 3.0, 4.0, 5.0, 6.0], [1.0] * 6, 3)
+        np.testing.assert_array_equal(result, [np.nan, np.nan, 4.0, 5.0])
+        rng = np.random.default_rng(5)
+        x = rng.normal(size=300).round(1)
+        x[rng.uniform(size=300) < 0.05] = np.nan
+        weights = rng.integers(1, 4, size=300).astype(float)
+        for window in [1, 2, 3, 4, 64]:
+            expected = [
+                (
+                    np.nan
+                    if np.isnan(x[i : i + window]).any()
+                    else robustats.weighted_median(x[i : i + window], weights[i : i + window])
+                )
+                for i in range(len(x) - window + 1)
+            ]
+            np.testing.assert_array_equal(robustats.rolling_weighted_median(x, weights, window), expected)
+
+    def test_different_lengths(self):
+        with self.assertRaises(ValueError):
+            robustats.rolling_weighted_median([1.0, 2.0, 3.0], [1.0, 1.0], 2)
+
+
+class TestRollingMode(unittest.TestCase):
+    def test_windows(self):
+        x = np.random.default_rng(5).normal(size=300).round(1)
+        for window in [1, 2, 3, 4, 64, 300]:
+            expected = [robustats.mode(x[i : i + window].tolist()) for i in range(len(x) - window + 1)]
+            result = robustats.rolling_mode(x, window)
+            self.assertEqual(result.tolist(), expected)
+
+    def test_nan(self):
+        result = robustats.rolling_mode([1.0, np.nan, 2.0, 2.0, 3.0, 3.0, 3.0], 3)
+        np.testing.assert_array_equal(result, [np.nan, np.nan, 2.0, 3.0, 3.0])
+        x = np.random.default_rng(5).normal(size=300).round(1)
+        x[np.random.default_rng(5).uniform(size=300) < 0.05] = np.nan
+        for window in [1, 2, 3, 4, 64]:
+            expected = [
+                np.nan if np.isnan(x[i : i + window]).any() else robustats.mode(x[i : i + window])
+                for i in range(len(x) - window + 1)
+            ]
+            np.testing.assert_array_equal(robustats.rolling_mode(x, window), expected)
+
+    def test_wrong_window(self):
+        with self.assertRaises(ValueError):
+            robustats.rolling_mode([1.0, 2.0, 3.0], 0)
+
+
+class TestOverwriteInput(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(6)
+        self.x = rng.gamma(2.0, size=101)
+        self.weights = rng.uniform(size=101)
+
+    def test_input_not_modified_by_default(self):
+        x, weights = self.x.copy(), self.weights.copy()
+        robustats.weighted_median(x, weights)
+        robustats.medcouple(x)
+        robustats.mode(x)
+        robustats.medcouple_batch([x], n_threads=1)
+        self.assertTrue(np.array_equal(x, self.x))
+        self.assertTrue(np.array_equal(weights, self.weights))
+
+    def test_array_interface_not_modified(self):
+        class ArrayLike:
+            def __init__(self, data):
+                self.data = data
+
+            def __array__(self, dtype=None, copy=None):
+                return self.data
+
+        x, weights = ArrayLike(self.x.copy()), ArrayLike(self.weights.copy())
+        for estimator in [
+            robustats.mode,
+            robustats.qn,
+            robustats.sn,
+            robustats.mad,
+            robustats.hodges_lehmann,
+            lambda x: robustats.quantiles(x, [0.25, 0.5]),
+        ]:
+            estimator(x)
+            self.assertTrue(np.array_equal(x.data, self.x))
+        robustats.weighted_median(x, weights)
+        robustats.weighted_quantiles(x, weights, [0.25, 0.5])
+        self.assertTrue(np.array_equal(x.data, self.x))
+        self.assertTrue(np.array_equal(weights.data, self.weights))
+
+    def test_overwrite_input(self):
+        for estimator in [robustats.medcouple, robustats.mode]:
+            x = self.x.copy()
+            expected = estimator(self.x)
+            self.assertEqual(estimator(x, overwrite_input=True), expected)
+            self.assertFalse(np.array_equal(x, self.x))
+            self.assertTrue(np.array_equal(np.sort(x), np.sort(self.x)))
+
+    def test_overwrite_input_weighted_median(self):
+        x, weights = self.x.copy(), self.weights.copy()
+        expected = robustats.weighted_median(self.x, self.weights)
+        self.assertEqual(robustats.weighted_median(x, weights, overwrite_input=True), expected)
+        self.assertTrue(np.array_equal(np.sort(x), np.sort(self.x)))
+
+    def test_overwrite_read_only_input(self):
+        x = self.x.copy()
+        x.flags.writeable = False
+        robustats.medcouple(x, overwrite_input=True)
+        self.assertTrue(np.array_equal(x, self.x))
+
+
+class TestWorkspace(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(7)
+        self.xs = [rng.gamma(2.0, size=n) for n in [10, 1000, 100, 1000]]
+        self.weights = [rng.uniform(size=len(x)) for x in self.xs]
+
+    def test_same_results(self):
+        workspace = robustats.Workspace()
+        for x, weights in zip(self.xs, self.weights):
+            self.assertEqual(robustats.medcouple(x, workspace=workspace), robustats.medcouple(x))
+            self.assertEqual(robustats.mode(x, workspace=workspace), robustats.mode(x))
+            self.assertEqual(
+                robustats.weighted_median(x, weights, workspace=workspace), robustats.weighted_median(x, weights)
+            )
+            self.assertTrue(
+                np.array_equal(
+                    robustats.rolling_medcouple(x, 5, workspace=workspace), robustats.rolling_medcouple(x, 5)
+                )
+            )
+
+    def test_memory_reused(self):
+        workspace = robustats.Workspace(n=1000)
+        size = workspace.size
+        self.assertGreater(size, 0)
+        for x in self.xs:
+            robustats.medcouple(x, workspace=workspace)
+            robustats.medcouple(x[:, np.newaxis], axis=0, workspace=workspace)
+        self.assertEqual(workspace.size, size)
+
+    def test_memory_grows(self):
+        workspace = robustats.Workspace()
+        self.assertEqual(workspace.size, 0)
+        robustats.medcouple(self.xs[1], workspace=workspace)
+        self.assertGreater(workspace.size, 0)
+        workspace.clear()
+        self.assertEqual(workspace.size, 0)
+
+    def test_empty_arrays(self):
+        workspace = robustats.Workspace()
+        for function in [robustats.medcouple, robustats.qn, robustats.sn, robustats.hodges_lehmann, robustats.mad]:
+            expected = function([])
+            for x in [np.array([]), np.array([], dtype=np.float32)]:
+                np.testing.assert_equal(function(x), expected)
+                np.testing.assert_equal(function(x, workspace=workspace), expected)
+
+    def test_wrong_workspace(self):
+        with self.assertRaises(TypeError):
+            robustats.medcouple(self.xs[0], workspace=bytearray(10))
+        with self.assertRaises(ValueError):
+            robustats.Workspace(n=-1)
+
+
+class TestDtypes(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(8)
+        self.x = rng.gamma(2.0, size=1001)
+        self.weights = rng.uniform(size=1001)
+        self.integers = rng.integers(-1000, 1000, size=1001)
+
+    def test_float32(self):
+        x = self.x.astype(np.float32)
+        self.assertAlmostEqual(robustats.medcouple(x), robustats.medcouple(self.x), places=5)
+        self.assertEqual(robustats.mode(x), robustats.mode(x.astype(np.float64)))
+        self.assertEqual(
+            robustats.weighted_median(x, self.weights), robustats.weighted_median(x.astype(np.float64), self.weights)
+        )
+
+    def test_integers(self):
+        for dtype in [np.int32, np.int64]:
+            x = self.integers.astype(dtype)
+            self.assertEqual(robustats.mode(x), robustats.mode(x.astype(np.float64)))
+            self.assertEqual(
+                robustats.weighted_median(x, self.weights),
+                robustats.weighted_median(x.astype(np.float64), self.weights),
+            )
+
+    def test_integers_overflow(self):
+        for dtype in [np.int32, np.int64]:
+            info = np.iinfo(dtype)
+            x = np.array([info.min, 0, 1, 2, info.max], dtype=dtype)
+            self.assertEqual(robustats.mode(x), 1.0)
+
+    def test_overwrite_input(self):
+        x = self.x.astype(np.float32)
+        expected = robustats.medcouple(x)
+        self.assertEqual(robustats.medcouple(x, overwrite_input=True), expected)
+        self.assertTrue(np.array_equal(x, np.sort(self.x.astype(np.float32))[::-1]))
+
+    def test_other_dtypes(self):
+        x = np.array([1, 2, 2, 3], dtype=np.uint8)
+        self.assertEqual(robustats.mode(x), 2.0)
+        self.assertEqual(robustats.medcouple(self.x.astype(">f8")), robustats.medcouple(self.x))
+
+
+class TestVectorizedPartitions(unittest.TestCase):
+    def setUp(self):
+        self.rng = np.random.default_rng(9)
+
+    def test_medcouple_invariances(self):
+        # Sizes around the vector widths, with and without ties
+        for n in [7, 15, 16, 17, 31, 32, 33, 100, 1001, 10000]:
+            for x in [self.rng.gamma(2.0, size=n), self.rng.integers(0, 4, size=n).astype(np.float64)]:
+                expected = robustats.medcouple(x)
+                self.assertEqual(robustats.medcouple(x[::-1]), expected)
+                self.assertEqual(robustats.medcouple(self.rng.permutation(x)), expected)
+                self.assertAlmostEqual(robustats.medcouple(x.astype(np.float32)), expected, places=5)
+
+
+class TestSeed(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(10)
+        self.xs = [rng.integers(0, 5, size=n).astype(np.float64) for n in [1, 2, 17, 100, 1001]]
+        self.weights = [rng.uniform(size=len(x)) for x in self.xs]
+
+    def test_same_results(self):
+        for x, weights in zip(self.xs, self.weights):
+            expected = robustats.weighted_median(x, weights)
+            for seed in [0, 1, -1, 2**70]:
+                self.assertEqual(robustats.weighted_median(x, weights, seed=seed), expected)
+            expected = robustats.medcouple(x)
+            for seed in [0, 1, -1, 2**70]:
+                self.assertEqual(robustats.medcouple(x, seed=seed), expected)
+
+    def test_batch_independent_of_threads(self):
+        expected = robustats.medcouple_batch(self.xs, n_threads=1, seed=3)
+        np.testing.assert_array_equal(robustats.medcouple_batch(self.xs, n_threads=4, seed=3), expected)
+        expected = robustats.weighted_median_batch(self.xs, self.weights, n_threads=1, seed=3)
+        np.testing.assert_array_equal(
+            robustats.weighted_median_batch(self.xs, self.weights, n_threads=4, seed=3), expected
+        )
+
+    def test_wrong_seed(self):
+        with self.assertRaises(TypeError):
+            robustats.medcouple(self.xs[2], seed=1.5)
+
+
+class TestDuplicates(unittest.TestCase):
+    def setUp(self):
+        self.rng = np.random.default_rng(11)
+
+    def test_weighted_median(self):
+        for n in [1, 2, 3, 10, 1000, 100000]:
+            for n_values in [1, 2, 16]:
+                x = self.rng.integers(0, n_values, size=n).astype(np.float64)
+                weights = self.rng.uniform(size=n)
+                order = np.argsort(x, kind="stable")
+                cumulative = np.cumsum(weights[order])
+                expected = x[order][np.searchsorted(cumulative, cumulative[-1] / 2)]
+                self.assertEqual(robustats.weighted_median(x, weights), expected)
+
+    def test_constant_sample(self):
+        x = np.ones(1000000)
+        self.assertEqual(robustats.weighted_median(x, x), 1.0)
+        self.assertEqual(robustats.medcouple(np.append(x, 2.0)), 1.0)
+
+
+class TestSort(unittest.TestCase):
+    def setUp(self):
+        self.rng = np.random.default_rng(12)
+
+    def test_sorted_in_place(self):
+        for n in [10, 100, 5000, 100000]:
+            samples = [
+                self.rng.normal(size=n),
+                np.append(self.rng.integers(-4, 4, size=n - 2), [0.0, -0.0]),
+                np.arange(n, dtype=np.float64),
+                -np.arange(n, dtype=np.float64),
+            ]
+            for sample in samples:
+                for dtype in [np.float64, np.float32, np.int32, np.int64]:
+                    x = sample.astype(dtype)
+                    robustats.mode(x, overwrite_input=True)
+                    self.assertTrue(np.array_equal(x, np.sort(sample.astype(dtype))))
+                    if dtype in [np.float64, np.float32]:
+                        robustats.medcouple(x, overwrite_input=True)
+                        self.assertTrue(np.array_equal(x, np.sort(sample.astype(dtype))[::-1]))
+
+    def test_integers_extremes(self):
+        for dtype in [np.int32, np.int64]:
+            info = np.iinfo(dtype)
+            sample = self.rng.integers(info.min, info.max, size=10000, dtype=dtype, endpoint=True)
+            x = np.append(sample, [info.min, info.max, 0, -1]).astype(dtype)
+            robustats.mode(x, overwrite_input=True)
+            self.assertTrue(np.array_equal(x, np.sort(x)))
+
+
+class TestParallelMedcouple(unittest.TestCase):
+    def setUp(self):
+        self.rng = np.random.default_rng(13)
+
+    def test_same_results(self):
+        samples = [
+            self.rng.gamma(2.0, size=300001),
+            self.rng.integers(0, 50, size=200000).astype(np.float64),
+            self.rng.normal(size=100000).astype(np.float32),
+        ]
+        for x in samples:
+            expected = robustats.medcouple(x)
+            for n_threads in [2, 3, 8]:
+                self.assertEqual(robustats.medcouple(x, n_threads=n_threads), expected)
+
+    def test_sorted_in_place(self):
+        x = self.rng.normal(size=100000)
+        robustats.medcouple(x, overwrite_input=True, n_threads=4)
+        self.assertTrue(np.array_equal(x, np.sort(x)[::-1]))
+
+    def test_wrong_n_threads(self):
+        with self.assertRaises(ValueError):
+            robustats.medcouple([1.0, 2.0, 3.0], n_threads=0)
+
+
+class TestApproximateMedcouple(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(14)
+        self.samples = [
+            rng.lognormal(sigma=1.0, size=100000),
+            rng.gamma(0.5, size=50001),
+            -rng.pareto(1.5, size=20000),
+            np.concatenate([rng.exponential(size=30000), np.full(10000, 0.5)]),
+            rng.integers(0, 8, size=30000).astype(np.float64),
+        ]
+
+    def test_error_bound(self):
+        for x in self.samples:
+            expected = robustats.medcouple(x)
+            for tol in [0.1, 0.01, 0.001]:
+                self.assertLessEqual(abs(robustats.medcouple(x, method="approx", tol=tol) - expected), tol)
+
+    def test_float32(self):
+        x = self.samples[0].astype(np.float32)
+        self.assertLessEqual(abs(robustats.medcouple(x, method="approx", tol=0.01) - robustats.medcouple(x)), 0.01)
+
+    def test_axis(self):
+        x = np.stack([sample[:20000] for sample in self.samples])
+        values = robustats.medcouple(x, axis=1, method="approx", tol=0.01)
+        expected = robustats.medcouple(x, axis=1)
+        self.assertTrue(np.all(np.abs(values - expected) <= 0.01))
+
+    def test_small_samples(self):
+        for x in [[1.0], [1.0, 2.0], [1.0, 2.0, 3.0], [1.0, 1.0, 1.0, 2.0], [0.2, 0.17, 0.08, 0.16, 0.88, 0.86, 0.09]]:
+            self.assertLessEqual(abs(robustats.medcouple(x, method="approx", tol=0.01) - robustats.medcouple(x)), 0.01)
+
+    def test_non_finite(self):
+        x = self.samples[0].copy()
+        for value in [np.inf, -np.inf]:
+            x[123] = value
+            self.assertEqual(robustats.medcouple(x, method="approx", tol=0.01), robustats.medcouple(x))
+        self.assertTrue(np.isnan(robustats.medcouple([1.0, np.nan, 3.0], method="approx")))
+        self.assertTrue(np.isnan(robustats.medcouple([1.0, 2.0, np.nan, 3.0, 5.0], method="approx")))
+
+    def test_wrong_arguments(self):
+        with self.assertRaises(ValueError):
+            robustats.medcouple([1.0, 2.0, 3.0], method="sketch")
+        with self.assertRaises(ValueError):
+            robustats.medcouple([1.0, 2.0, 3.0], method="approx", tol=0.0)
+
+
+class TestSketch(unittest.TestCase):
+    def test_exact_median(self):
+        rng = np.random.default_rng(15)
+        for n in [1, 2, 3, 4, 10, 100]:
+            for x, weights in [
+                (rng.normal(size=n), rng.exponential(size=n)),
+                (rng.integers(0, 3, size=n).astype(np.float64), np.ones(n)),
+            ]:
+                sketch = robustats.Sketch(size=100)
+                sketch.add(x, weights)
+                self.assertTrue(sketch.exact)
+                self.assertEqual(sketch.median(), robustats.weighted_median(x, weights))
+
+    def test_exact_quantiles(self):
+        rng = np.random.default_rng(15)
+        qs = [0.0, 0.1, 0.25, 0.5, 0.75, 0.9, 1.0]
+        for n in [1, 2, 3, 4, 10, 100]:
+            for x, weights in [
+                (rng.normal(size=n), rng.exponential(size=n)),
+                (rng.integers(0, 3, size=n).astype(np.float64), rng.integers(1, 3, size=n).astype(np.float64)),
+                (rng.integers(0, 3, size=n).astype(np.float64), np.ones(n)),
+            ]:
+                sketch = robustats.Sketch(size=100)
+                sketch.add(x, weights)
+                self.assertTrue(sketch.exact)
+                expected = robustats.weighted_quantiles(x, weights, qs)
+                self.assertEqual([sketch.quantile(q) for q in qs], expected.tolist())
+                self.assertEqual(sketch.median(), robustats.weighted_median(x, weights))
+
+    def test_merged_shards(self):
+        rng = np.random.default_rng(15)
+        x = rng.normal(size=100000)
+        weights = rng.exponential(size=100000)
+        total = robustats.Sketch(size=1000)
+        for i in range(10):
+            shard = robustats.Sketch(size=1000)
+            shard.add(x[i::10], weights[i::10])
+            total.merge(shard)
+        self.assertFalse(total.exact)
+        self.assertLessEqual(total.n_items, 1000)
+        self.assertAlmostEqual(total.total_weight, weights.sum(), places=6)
+
+        order = np.argsort(x)
+        ranks = np.cumsum(weights[order]) / weights.sum()
+        for q in [0.01, 0.25, 0.5, 0.75, 0.99]:
+            rank = ranks[np.searchsorted(x[order], total.quantile(q))]
+            self.assertLessEqual(abs(rank - q), 0.01)
+
+    def test_many_merges(self):
+        rng = np.random.default_rng(15)
+        shards = [rng.normal(size=10000) for _ in range(100)]
+        total = robustats.Sketch(size=100)
+        for x in shards:
+            shard = robustats.Sketch(size=100)
+            shard.add(x, np.ones(x.size))
+            total.merge(shard)
+        x = np.sort(np.concatenate(shards))
+        for q in np.linspace(0.01, 0.99, 99):
+            rank = np.searchsorted(x, total.quantile(q), side="right") / x.size
+            self.assertLessEqual(abs(rank - q), 0.06)
+
+    def test_bytes(self):
+        sketch = robustats.Sketch(size=50)
+        sketch.add(np.arange(200.0), np.ones(200))
+        copy = robustats.Sketch.from_bytes(sketch.to_bytes())
+        self.assertIsInstance(copy, robustats.Sketch)
+        self.assertEqual(copy.size, 50)
+        self.assertEqual(copy.exact, sketch.exact)
+        self.assertEqual(copy.to_bytes(), sketch.to_bytes())
+        for q in [0.0, 0.3, 0.5, 1.0]:
+            self.assertEqual(copy.quantile(q), sketch.quantile(q))
+
+    def test_wrong_arguments(self):
+        with self.assertRaises(ValueError):
+            robustats.Sketch(size=4)
+        sketch = robustats.Sketch()
+        with self.assertRaises(ValueError):
+            sketch.median()
+        with self.assertRaises(ValueError):
+            sketch.add([1.0, 2.0], [1.0])
+        sketch.add([1.0, 2.0], [1.0, 1.0])
+        with self.assertRaises(ValueError):
+            sketch.quantile(1.5)
+        with self.assertRaises(ValueError):
+            sketch.merge(sketch)
+        with self.assertRaises(ValueError):
+            robustats.Sketch.from_bytes(b"not a sketch")
+        with self.assertRaises(ValueError):
+            robustats.Sketch.from_bytes(sketch.to_bytes()[:-1])
+
+
+class TestQuantiles(unittest.TestCase):
+    def setUp(self):
+        rng = np.random.default_rng(16)
+        self.x = rng.normal(size=10001)
+        self.weights = rng.exponential(size=10001)
+        self.qs = [0.0, 0.01, 0.1, 0.25, 0.5, 0.5, 0.75, 0.9, 0.99, 1.0]
+
+    def weighted_reference(self, x, weights, q):
+        order = np.argsort(x, kind="stable")
+        cumulative = np.cumsum(weights[order])
+        positive = weights[order] > 0.0
+        return x[order][np.argmax((cumulative >= q * cumulative[-1]) & positive)]
+
+    def test_weighted_quantiles(self):
+        values = robustats.weighted_quantiles(self.x, self.weights, self.qs)
+        expected = [self.weighted_reference(self.x, self.weights, q) for q in self.qs]
+        self.assertTrue(np.array_equal(values, expected))
+
+    def test_weighted_median(self):
+        rng = np.random.default_rng(16)
+        for n in [1, 2, 3, 10, 101, 1000]:
+            x = rng.normal(size=n)
+            weights = rng.exponential(size=n)
+            value = robustats.weighted_quantiles(x, weights, 0.5)
+            self.assertEqual(value, robustats.weighted_median(x, weights))
+
+    def test_weighted_median_on_ties(self):
+        rng = np.random.default_rng(16)
+        for n in [1, 2, 3, 4, 10, 101]:
+            for _ in range(20):
+                x = rng.integers(0, 5, size=n).astype(np.float64)
+                weights = rng.integers(0, 3, size=n).astype(np.float64)
+                weights[0] += 1.0
+                values = robustats.weighted_quantiles(x, weights, [0.25, 0.5, 0.5])
+                median = robustats.weighted_median(x, weights)
+                self.assertEqual(values.tolist()[1:], [median, median])
+        self.assertEqual(robustats.weighted_quantiles([1.0, 2.0, 3.0], [2.0, 1.0, 1.0], 0.5), 2.0)
+        self.assertEqual(robustats.weighted_quantiles([1.0, 2.0, 3.0, 4.0], [1.0, 1.0, 1.0, 1.0], 0.5), 3.0)
+
+    def test_weighted_duplicates_and_zero_weights(self):
+        rng = np.random.default_rng(16)
+        x = rng.integers(0, 5, size=1000).astype(np.float64)
+        weights = rng.integers(0, 3, size=1000).astype(np.float64)
+        values = robustats.weighted_quantiles(x, weights, self.qs)
+        expected = [self.weighted_reference(x, weights, q) for q in self.qs]
+        self.assertTrue(np.array_equal(values, expected))
+        self.assertTrue(np.isnan(robustats.weighted_quantiles([1.0, 2.0], [0.0, 0.0], 0.5)))
+
+    def test_quantiles(self):
+        for x in [self.x, self.x[:2], self.x[:1], np.round(self.x)]:
+            values = robustats.quantiles(x, self.qs)
+            self.assertTrue(np.allclose(values, np.quantile(x, self.qs), rtol=0.0, atol=1e-12))
+
+    def test_dtypes(self):
+        for dtype in [np.float32, np.int32, np.int64]:
+            x = (self.x * 100).astype(dtype)
+            self.assertTrue(np.allclose(robustats.quantiles(x, self.qs), np.quantile(x, self.qs)))
+            values = robustats.weighted_quantiles(x, self.weights, self.qs)
+            expected = [self.weighted_reference(x, self.weights, q) for q in self.qs]
+            self.assertTrue(np.array_equal(values, expected))
+
+    def test_shape_and_order(self):
+        values = robustats.quantiles(self.x, [[0.9, 0.1], [0.5, 0.0]])
+        self.assertEqual(values.shape, (2, 2))
+        self.assertTrue(np.allclose(values, np.quantile(self.x, [[0.9, 0.1], [0.5, 0.0]])))
+        self.assertIsInstance(robustats.quantiles(self.x, 0.5), float)
+
+    def test_overwrite_input(self):
+        x = self.x.copy()
+        robustats.quantiles(x, self.qs)
+        self.assertTrue(np.array_equal(x, self.x))
+        value = robustats.quantiles(x, 0.5, overwrite_input=True)
+        self.assertEqual(value, np.median(self.x))
+        self.assertFalse(np.array_equal(x, self.x))
+
+    def test_wrong_arguments(self):
+        with self.assertRaises(ValueError):
+            robustats.quantiles(self.x, [0.5, 1.5])
+        with self.assertRaises(ValueError):
+            robustats.quantiles([], 0.5)
+        with self.assertRaises(ValueError):
+            robustats.weighted_quantiles(self.x, self.weights[:10], 0.5)
+
+
+class TestAdjustedBoxplot(unittest.TestCase):
+    def reference(self, x, factor=1.5):
+        mc = robustats.medcouple(x)
+        q1, q3 = np.quantile(x, [0.25, 0.75])
+        iqr = q3 - q1
+        if mc >= 0:
+            lower, upper = q1 - factor * np.exp(-4 * mc) * iqr, q3 + factor * np.exp(3 * mc) * iqr
+        else:
+            lower, upper = q1 - factor * np.exp(-3 * mc) * iqr, q3 + factor * np.exp(4 * mc) * iqr
+        return lower, upper, mc, q1, q3
+
+    def test_reference(self):
+        rng = np.random.default_rng(17)
+        for x in [rng.lognormal(size=10001), -rng.lognormal(size=1000), rng.normal(size=2), np.array([1.0])]:
+            boxplot = robustats.adjusted_boxplot(x)
+            lower, upper, mc, q1, q3 = self.reference(x)
+            self.assertEqual(boxplot.medcouple, mc)
+            self.assertAlmostEqual(boxplot.first_quartile, q1, places=12)
+            self.assertAlmostEqual(boxplot.third_quartile, q3, places=12)
+            self.assertAlmostEqual(boxplot.lower_fence, lower, places=12)
+            self.assertAlmostEqual(boxplot.upper_fence, upper, places=12)
+            self.assertTrue(np.array_equal(boxplot.outliers, (x < boxplot.lower_fence) | (x > boxplot.upper_fence)))
+
+    def test_input_preserved(self):
+        x = np.random.default_rng(17).lognormal(size=1000)
+        copy = x.copy()
+        robustats.adjusted_boxplot(x, factor=3.0, n_threads=2)
+        self.assertTrue(np.array_equal(x, copy))
+
+    def test_float32(self):
+        x = np.random.default_rng(17).lognormal(size=1000).astype(np.float32)
+        boxplot = robustats.adjusted_boxplot(x)
+        self.assertEqual(boxplot.medcouple, robustats.medcouple(x))
+        self.assertEqual(len(boxplot.outliers), 1000)
+
+    def test_wrong_arguments(self):
+        with self.assertRaises(ValueError):
+            robustats.adjusted_boxplot([])
+        with self.assertRaises(ValueError):
+            robustats.adjusted_boxplot([1.0, 2.0], factor=-1.0)
+
+
+class TestScale(unittest.TestCase):
+    def qn_reference(self, x):
+        n = len(x)
+        h = n // 2 + 1
+        distances = np.sort(np.abs(x[:, None] - x[None, :])[np.triu_indices(n, 1)])
+        if n <= 9:
+            correction = [0.399, 0.994, 0.512, 0.844, 0.611, 0.857, 0.669, 0.872][n - 2]
+        else:
+            correction = n / (n + 1.4) if n % 2 == 1 else n / (n + 3.8)
+        return 2.2219 * correction * distances[h * (h - 1) // 2 - 1]
+
+    def sn_reference(self, x):
+        n = len(x)
+        distances = np.sort([np.sort(np.abs(x[i] - x))[n // 2] for i in range(n)])
+        if n <= 9:
+            correction = [0.743, 1.851, 0.954, 1.351, 0.993, 1.198, 1.005, 1.131][n - 2]
+        else:
+            correction = n / (n - 0.9) if n % 2 == 1 else 1.0
+        return 1.1926 * correction * distances[(n + 1) // 2 - 1]
+
+    def test_reference(self):
+        rng = np.random.default_rng(18)
+        for n in list(range(2, 30)) + [100, 501]:
+            for x in [rng.normal(size=n), rng.lognormal(size=n), rng.integers(0, 4, size=n).astype(np.float64)]:
+                self.assertEqual(robustats.qn(x), self.qn_reference(x))
+                self.assertEqual(robustats.sn(x), self.sn_reference(x))
+
+    def test_normal(self):
+        x = np.random.default_rng(18).normal(scale=2.0, size=100000)
+        self.assertAlmostEqual(robustats.qn(x), 2.0, places=1)
+        self.assertAlmostEqual(robustats.sn(x), 2.0, places=1)
+
+    def test_float32_and_overwrite_input(self):
+        x = np.random.default_rng(18).lognormal(size=1001)
+        self.assertAlmostEqual(robustats.qn(x.astype(np.float32)), robustats.qn(x), places=5)
+        self.assertAlmostEqual(robustats.sn(x.astype(np.float32)), robustats.sn(x), places=5)
+        expected = robustats.qn(x)
+        self.assertEqual(robustats.qn(x, overwrite_input=True), expected)
+        self.assertTrue(np.all(np.diff(x) <= 0))
+
+    def test_small_samples(self):
+        self.assertTrue(np.isnan(robustats.qn([1.0])))
+        self.assertTrue(np.isnan(robustats.sn([])))
+
+
+class TestPairwiseLocationAndRegression(unittest.TestCase):
+    def hodges_lehmann_reference(self, x):
+        i, j = np.triu_indices(len(x))
+        return np.median((x[i] + x[j]) / 2)
+
+    def theil_sen_reference(self, x, y):
+        i, j = np.triu_indices(len(x), 1)
+        different = x[i] != x[j]
+        slope = np.median((y[j] - y[i])[different] / (x[j] - x[i])[different])
+        return slope, np.median(y - slope * x)
+
+    def test_hodges_lehmann_reference(self):
+        rng = np.random.default_rng(19)
+        for n in list(range(1, 30)) + [100, 501]:
+            for x in [rng.normal(size=n), rng.lognormal(size=n), rng.integers(0, 4, size=n).astype(np.float64)]:
+                self.assertEqual(robustats.hodges_lehmann(x), self.hodges_lehmann_reference(x))
+
+    def test_theil_sen_reference(self):
+        rng = np.random.default_rng(19)
+        for n in list(range(2, 30)) + [100, 501, 2000]:
+            x = rng.normal(size=n)
+            for y in [2 * x + rng.standard_cauchy(size=n), rng.integers(0, 3, size=n).astype(np.float64)]:
+                for x_ in [x, np.round(x, 1)]:
+                    if np.all(x_ == x_[0]):
+                        continue
+                    slope, intercept = robustats.theil_sen(x_, y)
+                    expected_slope, expected_intercept = self.theil_sen_reference(x_, y)
+                    self.assertAlmostEqual(slope, expected_slope, places=12)
+                    self.assertAlmostEqual(intercept, expected_intercept, places=12)
+
+    def test_theil_sen_collinear(self):
+        x = np.random.default_rng(19).normal(size=5000)
+        slope, intercept = robustats.theil_sen(x, 3 * x + 1)
+        self.assertAlmostEqual(slope, 3.0, places=12)
+        self.assertAlmostEqual(intercept, 1.0, places=12)
+
+    def test_theil_sen_nearly_collinear(self):
+        # The rounding of the residuals stops the narrowing with many slopes
+        # left, which must all be enumerated
+        rng = np.random.default_rng(19)
+        x = 1e3 * rng.normal(size=3000)
+        y = 3 * x + 1e-11 * rng.normal(size=3000)
+        self.assertEqual(tuple(robustats.theil_sen(x, y)), self.theil_sen_reference(x, y))
+
+    def test_hodges_lehmann_float32_and_overwrite_input(self):
+        x = np.random.default_rng(19).lognormal(size=1001)
+        self.assertAlmostEqual(robustats.hodges_lehmann(x.astype(np.float32)), robustats.hodges_lehmann(x), places=5)
+        expected = robustats.hodges_lehmann(x)
+        self.assertEqual(robustats.hodges_lehmann(x, overwrite_input=True), expected)
+        self.assertTrue(np.all(np.diff(x) <= 0))
+
+    def test_degenerate_samples(self):
+        self.assertTrue(np.isnan(robustats.hodges_lehmann([])))
+        self.assertTrue(np.all(np.isnan(robustats.theil_sen([1.0, 1.0], [0.0, 2.0]))))
+        with self.assertRaises(ValueError):
+            robustats.theil_sen([1.0, 2.0], [1.0])
+
+
+class TestMedianAbsoluteDeviation(unittest.TestCase):
+    def test_reference(self):
+        rng = np.random.default_rng(20)
+        for n in range(1, 40):
+            for x in [rng.normal(size=n), rng.integers(0, 4, size=n).astype(np.float64)]:
+                median = np.median(x)
+                self.assertEqual(robustats.mad(x), np.median(np.abs(x - median)))
+
+    def test_scale(self):
+        x = np.random.default_rng(20).normal(scale=2.0, size=100000)
+        self.assertAlmostEqual(robustats.mad(x, scale="normal"), 2.0, places=1)
+        self.assertEqual(robustats.mad(x, scale=2.0), 2.0 * robustats.mad(x))
+        with self.assertRaises(ValueError):
+            robustats.mad(x, scale="iqr")
+
+    def test_axis(self):
+        x = np.random.default_rng(20).normal(size=(7, 9, 5))
+        for axis in [0, 1, 2, -1]:
+            median = np.median(x, axis=axis, keepdims=True)
+            expected = np.median(np.abs(x - median), axis=axis)
+            np.testing.assert_array_equal(robustats.mad(x, axis=axis), expected)
+
+    def test_float32_and_overwrite_input(self):
+        x = np.random.default_rng(20).lognormal(size=1001)
+        self.assertAlmostEqual(robustats.mad(x.astype(np.float32)), robustats.mad(x), places=5)
+        expected = robustats.mad(x)
+        y = x.copy()
+        self.assertEqual(robustats.mad(y, overwrite_input=True), expected)
+        np.testing.assert_array_equal(np.sort(y), np.sort(np.abs(x - np.median(x))))
+
+    def test_robust_zscore(self):
+        x = np.random.default_rng(20).normal(size=(7, 9, 5))
+        median = np.median(x)
+        expected = (x - median) / (1.482602218505602 * np.median(np.abs(x - median)))
+        np.testing.assert_allclose(robustats.robust_zscore(x), expected, rtol=1e-14)
+        for axis in [0, 1, -1]:
+            median = np.median(x, axis=axis, keepdims=True)
+            expected = (x - median) / (1.482602218505602 * np.median(np.abs(x - median), axis=axis, keepdims=True))
+            np.testing.assert_allclose(robustats.robust_zscore(x, axis=axis), expected, rtol=1e-14)
+
+    def test_robust_zscore_strided(self):
+        x = np.random.default_rng(20).normal(size=(7, 9, 5)).transpose(2, 0, 1)
+        for axis in [None, 0, 2]:
+            np.testing.assert_array_equal(
+                robustats.robust_zscore(x, axis=axis), robustats.robust_zscore(np.ascontiguousarray(x), axis=axis)
+            )
+
+    def test_robust_zscore_out(self):
+        x = np.random.default_rng(20).normal(size=(4, 50))
+        expected = robustats.robust_zscore(x, axis=1)
+        out = np.empty_like(x)
+        self.assertIs(robustats.robust_zscore(x, axis=1, out=out), out)
+        np.testing.assert_array_equal(out, expected)
+        robustats.robust_zscore(x, axis=1, out=x)
+        np.testing.assert_array_equal(x, expected)
+        with self.assertRaises(ValueError):
+            robustats.robust_zscore(x, out=np.empty((4, 50), dtype=np.float32))
+
+
+class TestCounters(unittest.TestCase):
+    def counting_workspace(self):
+        try:
+            return robustats.Workspace(counters=True)
+        except RuntimeError:
+            self.skipTest("The library was compiled without counters.")
+
+    def test_not_recorded_by_default(self):
+        workspace = robustats.Workspace()
+        robustats.medcouple(x=[1.0, 2.0, 3.0, 4.0, 10.0], workspace=workspace)
+        self.assertIsNone(workspace.counters)
+
+    def test_medcouple(self):
+        workspace = self.counting_workspace()
+        x = np.random.default_rng(22).normal(size=5000)
+        expected = robustats.medcouple(x)
+        self.assertEqual(robustats.medcouple(x, workspace=workspace), expected)
+        counters = workspace.counters
+        self.assertGreater(counters["iterations"], 0)
+        self.assertGreater(counters["partitions"], 0)
+        self.assertGreater(counters["comparisons"], 5000)
+        self.assertGreater(counters["bytes_allocated"], 5000 * 8)
+        self.assertGreater(counters["matrix_seconds"], 0.0)
+        self.assertLessEqual(counters["weighted_median_seconds"], counters["matrix_seconds"])
+
+    def test_per_call(self):
+        workspace = self.counting_workspace()
+        x = np.random.default_rng(22).normal(size=5000)
+        robustats.medcouple(x, workspace=workspace)
+        medcouple_counters = workspace.counters
+        robustats.medcouple(x, workspace=workspace)
+        self.assertEqual(workspace.counters["iterations"], medcouple_counters["iterations"])
+        robustats.weighted_median(x, np.ones(5000), workspace=workspace)
+        self.assertEqual(workspace.counters["iterations"], 0)
+        self.assertEqual(workspace.counters["matrix_seconds"], 0.0)
+
+    def test_threads(self):
+        workspace = self.counting_workspace()
+        x = np.random.default_rng(22).normal(size=100000)
+        robustats.medcouple(x, workspace=workspace)
+        serial = workspace.counters
+        robustats.medcouple(x, workspace=workspace, n_threads=4)
+        self.assertEqual(workspace.counters["iterations"], serial["iterations"])
+        self.assertGreaterEqual(workspace.counters["comparisons"], serial["comparisons"])
+
+
+class TestBufferInput(unittest.TestCase):
+    def test_not_modified(self):
+        x = array.array("d", [5.0, 1.0, 4.0, 2.0, 3.0, 9.0, 0.5])
+        expected = robustats.medcouple(np.array(x))
+        self.assertEqual(robustats.medcouple(x), expected)
+        self.assertEqual(robustats.mode(memoryview(x)), robustats.mode(np.array(x)))
+        self.assertEqual(list(x), [5.0, 1.0, 4.0, 2.0, 3.0, 9.0, 0.5])
+        self.assertEqual(robustats.medcouple(x, overwrite_input=True), expected)
+        self.assertEqual(list(x), sorted(x, reverse=True))
+
+    def test_read_only(self):
+        x = np.random.default_rng(23).normal(size=101)
+        expected = robustats.mode(x)
+        buffer = memoryview(x).toreadonly()
+        self.assertEqual(robustats.mode(buffer, overwrite_input=True), expected)
+        self.assertEqual(list(buffer), list(x))
+
+    def test_strided(self):
+        x = np.random.default_rng(23).normal(size=(60, 30))
+        for view in [memoryview(x)[::3], memoryview(x.T)]:
+            contiguous = np.array(view).ravel()
+            self.assertEqual(robustats.medcouple(view), robustats.medcouple(contiguous))
+            weights = np.ones(contiguous.size)
+            self.assertEqual(robustats.weighted_median(view, weights), robustats.weighted_median(contiguous, weights))
+            np.testing.assert_array_equal(robustats.quantiles(view, [0.1, 0.5]), np.quantile(contiguous, [0.1, 0.5]))
+
+    def test_native_types(self):
+        x = np.random.default_rng(23).normal(size=200) * 100
+        for dtype in [np.float32, np.int32, np.int64]:
+            y = x.astype(dtype)
+            self.assertEqual(robustats.mode(memoryview(y)), robustats.mode(y))
+            self.assertEqual(robustats.mode(memoryview(y)[::2]), robustats.mode(y[::2]))
+            self.assertEqual(
+                robustats.weighted_median(array.array(y.dtype.char, y), np.ones(200)),
+                robustats.weighted_median(y, np.ones(200)),
+            )
+        z = x.astype(np.int16)
+        self.assertEqual(robustats.mode(memoryview(z)), robustats.mode(z))
+
+    def test_lists(self):
+        x = list(np.random.default_rng(23).normal(size=101))
+        expected = robustats.weighted_median(np.array(x), np.ones(101))
+        self.assertEqual(robustats.weighted_median(x, [1] * 101), expected)
+        self.assertEqual(robustats.weighted_median(tuple(x), tuple([1.0] * 101)), expected)
+        self.assertEqual(robustats.weighted_median([1, 2**70, 3], [1, 1, 1]), 3.0)
+        self.assertEqual(robustats.weighted_median([True, 2, np.float64(3.5)], [1, 1, 1]), 2.0)
+        with self.assertRaises(ValueError):
+            robustats.mode(["a", "b"])
+
+
+class TestExternal(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+
+    def write(self, name, x):
+        path = os.path.join(self.directory.name, name)
+        x.tofile(path)
+        return path
+
+    def check_weighted_median(self, x, weights):
+        expected = robustats.weighted_median(x, weights)
+        x_path, weights_path = self.write("x", x), self.write("weights", weights)
+        self.assertEqual(robustats.weighted_median_external(x_path, weights_path, memory=1 << 16), expected)
+        memmap = np.memmap(x_path, dtype=np.float64, mode="r")
+        self.assertEqual(robustats.weighted_median_external(memmap, pathlib.Path(weights_path)), expected)
+
+    def test_weighted_median(self):
+        rng = np.random.default_rng(24)
+        for x in [rng.normal(size=100000), np.floor(rng.uniform(size=50000) * 8), rng.lognormal(size=7)]:
+            for weights in [rng.uniform(size=x.size), rng.integers(0, 3, size=x.size).astype(np.float64)]:
+                self.check_weighted_median(x, weights)
+        self.check_weighted_median(np.array([1.0, 2.0, 3.0, 4.0]), np.ones(4))
+        self.check_weighted_median(np.array([2.0, 1.0]), np.ones(2))
+        self.check_weighted_median(np.array([1.0, 2.0, 3.0]), np.array([1.0, 0.0, 1.0]))
+
+    def test_weighted_median_on_ties(self):
+        rng = np.random.default_rng(24)
+        x = rng.permutation(100000).astype(np.float64)
+        for low, high in [(40000, 60000), (49999, 50001)]:
+            weights = np.where((x >= low) & (x < high), 0.0, 1.0)
+            self.check_weighted_median(x, weights)
+        # The weighted median is then a value of zero weight, selected by rank
+        weights = np.where(x < 1000, 1.0, 0.0)
+        weights[x == 99999] = 1000.0
+        self.check_weighted_median(x, weights)
+        x = np.floor(rng.uniform(size=50000) * 8)
+        self.check_weighted_median(x, rng.integers(1, 3, size=x.size).astype(np.float64))
+
+    def test_mode(self):
+        rng = np.random.default_rng(24)
+        for x in [rng.normal(size=100000), np.floor(rng.uniform(size=50000) * 8), rng.lognormal(size=7)]:
+            path = self.write("x", x)
+            expected = robustats.mode(x)
+            self.assertEqual(
+                robustats.mode_external(path, memory=1 << 16, temporary_directory=self.directory.name), expected
+            )
+            self.assertEqual(robustats.mode_external(x, memory=1 << 16), expected)
+        self.assertEqual(os.listdir(self.directory.name), ["x"])
+
+    def test_medcouple(self):
+        rng = np.random.default_rng(25)
+        for x in [
+            rng.lognormal(size=60000),
+            np.round(rng.normal(size=40000), 1),
+            rng.normal(size=5),
+            rng.normal(size=1800),
+        ]:
+            path = self.write("x", x)
+            expected = robustats.medcouple(x)
+            self.assertEqual(
+                robustats.medcouple_external(path, memory=1 << 17, temporary_directory=self.directory.name), expected
+            )
+            self.assertEqual(robustats.medcouple_external(x, memory=1 << 17, seed=1), expected)
+            self.assertEqual(robustats.medcouple_external(np.array_split(x, 3), memory=1 << 17), expected)
+        self.assertEqual(os.listdir(self.directory.name), ["x"])
+        ties = np.concatenate([np.ones(20000), np.arange(10.0)])
+        self.assertEqual(robustats.medcouple_external(ties, memory=1 << 17), robustats.medcouple(ties))
+
+    def test_wrong_files(self):
+        path = self.write("x", np.zeros(3, dtype=np.float32))
+        with self.assertRaises(ValueError):
+            robustats.mode_external(path)
+        with self.assertRaises(OSError):
+            robustats.mode_external(os.path.join(self.directory.name, "missing"))
+        with self.assertRaises(ValueError):
+            robustats.weighted_median_external(np.ones(3), np.ones(4))
+        with self.assertRaises(ValueError):
+            robustats.weighted_median_external(np.ones(3), np.ones(3), memory=1024)
+        with self.assertRaises(ValueError):
+            robustats.medcouple_external(np.ones(3), memory=1 << 16)
@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+# This shell script compiles and runs the C benchmarks in directory benchmarks.
+# Usage: ./utilities/run_benchmarks.sh [benchmark_name] [benchmark arguments...]
+
+BENCHMARKS_DIR="$(dirname "$0")/../benchmarks"
+C_DIR="$(dirname "$0")/../c"
+BUILD_DIR=$(mktemp -d)
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+# Library sources, excluding the Python bindings
+C_SOURCES=$(ls "$C_DIR"/*.c | grep -v "_robustats.c")
+
+if [ $# -gt 0 ]
+then
+  BENCHMARKS="$BENCHMARKS_DIR/$1.c"
+  shift
+else
+  BENCHMARKS=$(ls "$BENCHMARKS_DIR"/*.c)
+fi
+
+for BENCHMARK in $BENCHMARKS
+do
+  NAME=$(basename "$BENCHMARK" .c)
+  printf "Benchmark: %s\n" "$NAME"
+  gcc -std=c99 -O3 -D_POSIX_C_SOURCE=199309L -o "$BUILD_DIR/$NAME" "$BENCHMARK" $C_SOURCES -lm || exit 1
+  "$BUILD_DIR/$NAME" "$@"
+  printf "\n"
+done